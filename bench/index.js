@@ -0,0 +1,458 @@
+/**
+ * Benchmark harness for monitorres
+ *
+ * Runs every export against the simulated display backend for a grid of
+ * monitor counts and mode list sizes, and prints the results as JSON:
+ * per-call latency percentiles, JS heap bytes per call and, in builds made
+ * with --monitorres_bench=1, native allocations per call. The native
+ * microbenchmarks are run as well when they were built.
+ *
+ * With --trace, the cases run against the replay of each trace recorded by
+ * startBackendRecording instead, skipping the ones that change modes, which
+ * the trace cannot answer. --traceLatency=1 replays the recorded timings.
+ *
+ * Usage: node bench/index.js [--monitors=1,4,16] [--modes=10,1000,10000]
+ *                            [--iterations=2000] [--filter=name] [--output=file]
+ *                            [--modeListLatencyMs=0] [--trace=file,...] [--traceLatency=0]
+ */
+
+const { execFileSync } = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const v8 = require('v8');
+
+// Heap measurements need gc() and a young generation large enough that a
+// batch of calls does not trigger a scavenge; re-run with the flags if needed
+if (typeof global.gc !== 'function') {
+  const result = require('child_process').spawnSync(
+    process.execPath,
+    ['--expose-gc', '--max-semi-space-size=64', __filename, ...process.argv.slice(2)],
+    { stdio: 'inherit' }
+  );
+  process.exit(result.status === null ? 1 : result.status);
+}
+
+const buildDir = path.join(__dirname, '..', 'build', 'Release');
+const binary = require(path.join(buildDir, 'monitorres.node'));
+const monitorres = require('..');
+
+function parseArgs(argv) {
+  const options = {
+    monitors: [1, 4, 16],
+    modes: [10, 1000, 10000],
+    iterations: 2000,
+    heapIterations: 200,
+    filter: '',
+    output: null,
+    modeListLatencyMs: 0,
+    trace: [],
+    traceLatency: 0,
+  };
+
+  for (const arg of argv) {
+    const [name, value] = arg.replace(/^--/, '').split('=');
+    switch (name) {
+      case 'monitors':
+      case 'modes':
+        options[name] = value.split(',').map(Number);
+        break;
+      case 'trace':
+        options.trace = value.split(',');
+        break;
+      case 'iterations':
+      case 'heapIterations':
+      case 'modeListLatencyMs':
+      case 'traceLatency':
+        options[name] = Number(value);
+        break;
+      case 'filter':
+      case 'output':
+        options[name] = value;
+        break;
+      default:
+        throw new Error(`Unknown option ${arg}`);
+    }
+  }
+
+  return options;
+}
+
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.round(p * (sorted.length - 1)))];
+}
+
+// Cases get the generated topology and return the function to time. A
+// case that needs to await returns an async function.
+function benchmarkCases(topology) {
+  const ids = topology.map((monitor) => monitor.id);
+  const primary = topology[0];
+  const { width, height, refreshRate } = primary.currentSettings;
+  const alternate = monitorres.getAvailableResolutions(primary.id).find(
+    (mode) => mode.width !== width || mode.height !== height || mode.refreshRate !== refreshRate
+  );
+
+  let toggle = false;
+  const nextMode = () => {
+    toggle = !toggle;
+    return toggle ? alternate : primary.currentSettings;
+  };
+
+  let generation = monitorres.getMonitorsSince(0).generation;
+
+  // Points spread over the desktop and a margin around it
+  const desktopPoints = () => {
+    const { bounds } = monitorres.getDesktopLayout();
+    const points = [];
+    for (let i = 0; i < 256; i++) {
+      points.push([
+        bounds.x - 100 + ((i * 7919) % (bounds.width + 200)),
+        bounds.y - 100 + ((i * 104729) % (bounds.height + 200)),
+      ]);
+    }
+    return points;
+  };
+
+  return {
+    getScreenResolution: () => () => monitorres.getScreenResolution(),
+    getAllMonitors: () => () => monitorres.getAllMonitors(),
+    'getAllMonitors (fields)': () => () =>
+      monitorres.getAllMonitors({ fields: ['id', 'currentSettings.width', 'currentSettings.height'] }),
+    'monitors for IPC (JSON.stringify(getAllMonitors))': () => () => JSON.stringify(monitorres.getAllMonitors()),
+    getAllMonitorsBinary: () => () => monitorres.getAllMonitorsBinary(),
+    'getAllMonitorsBinary + decode ids': () => () => {
+      const ids = [];
+      for (const monitor of monitorres.decodeMonitorsBinary(monitorres.getAllMonitorsBinary())) {
+        ids.push(monitor.id);
+      }
+      return ids;
+    },
+    getMonitorsSince: () => () => {
+      const changes = monitorres.getMonitorsSince(generation);
+      if (changes) {
+        generation = changes.generation;
+      }
+    },
+    getMonitorResolution: () => () => monitorres.getMonitorResolution(primary.id),
+    getAvailableResolutions: () => () => monitorres.getAvailableResolutions(primary.id),
+    'getAvailableResolutions (uncached)': () => () => {
+      monitorres.invalidateModeCache(primary.id);
+      monitorres.getAvailableResolutions(primary.id);
+    },
+    'getAvailableResolutions (file)': () => {
+      const file = path.join(os.tmpdir(), `monitorres-bench-modes-${process.pid}.bin`);
+      monitorres.setModeCacheFile(file);
+      monitorres.getAvailableResolutions(primary.id);
+      const fn = () => {
+        // Drops the in-memory tables but keeps the file's, which are keyed
+        monitorres.invalidateModeCache();
+        monitorres.getAvailableResolutions(primary.id);
+      };
+      fn.cleanup = () => {
+        monitorres.setModeCacheFile(null);
+        fs.rmSync(file, { force: true });
+      };
+      return fn;
+    },
+    'inventory (serial)': () => () => {
+      monitorres.invalidateModeCache();
+      for (const monitor of monitorres.getAllMonitors()) {
+        monitorres.getAvailableResolutions(monitor.id);
+      }
+    },
+    'inventory (getFullInventory)': () => () => {
+      monitorres.invalidateModeCache();
+      return monitorres.getFullInventory();
+    },
+    'first 60 Hz mode (getAvailableResolutions)': () => () => {
+      monitorres.invalidateModeCache(primary.id);
+      return monitorres.getAvailableResolutions(primary.id).find((mode) => mode.refreshRate >= 60);
+    },
+    'first 60 Hz mode (iterateModes)': () => async () => {
+      monitorres.invalidateModeCache(primary.id);
+      for await (const mode of monitorres.iterateModes(primary.id, { batchSize: 64 })) {
+        if (mode.refreshRate >= 60) {
+          return mode;
+        }
+      }
+      return undefined;
+    },
+    getAvailableResolutionsPacked: () => () => monitorres.getAvailableResolutionsPacked(primary.id),
+    findBestMode: () => () =>
+      monitorres.findBestMode(
+        primary.id,
+        { refreshRate: { min: 60 }, aspectRatio: '16:9', width: { max: 2560 } },
+        ['native', 'refreshRate']
+      ),
+    getSystemDPI: () => () => monitorres.getSystemDPI(),
+    'monitor from point (getAllMonitors scan)': () => {
+      const points = desktopPoints();
+      let i = 0;
+      return () => {
+        const [x, y] = points[i++ % points.length];
+        return monitorres.getAllMonitors().findIndex(({ currentSettings: mode }) =>
+          mode && x >= mode.position.x && x < mode.position.x + mode.width &&
+          y >= mode.position.y && y < mode.position.y + mode.height
+        );
+      };
+    },
+    monitorFromPoint: () => {
+      const points = desktopPoints();
+      let i = 0;
+      return () => {
+        const [x, y] = points[i++ % points.length];
+        return monitorres.monitorFromPoint(x, y, 'nearest');
+      };
+    },
+    monitorFromRect: () => {
+      const points = desktopPoints();
+      let i = 0;
+      return () => {
+        const [x, y] = points[i++ % points.length];
+        return monitorres.monitorFromRect({ x: x - 320, y: y - 240, width: 640, height: 480 }, 'nearest');
+      };
+    },
+    'geometry (getAllMonitors + getSystemDPI)': () => () =>
+      monitorres.getAllMonitors()
+        .filter((monitor) => monitor.currentSettings)
+        .map((monitor) => ({ id: monitor.id, settings: monitor.currentSettings, dpi: monitorres.getSystemDPI() })),
+    getDisplayGeometry: () => () => monitorres.getDisplayGeometry(),
+    getModeCacheStats: () => () => monitorres.getModeCacheStats(),
+    // One tick of a JS watchdog keeping every monitor in its mode; setDesiredState does this natively
+    'drift check (getMonitorResolution per monitor)': () => {
+      const desired = topology.filter((monitor) => monitor.currentSettings);
+      return () => {
+        let drifted = 0;
+        for (const monitor of desired) {
+          const mode = monitorres.getMonitorResolution(monitor.id);
+          if (mode.width !== monitor.currentSettings.width || mode.height !== monitor.currentSettings.height) {
+            drifted++;
+          }
+        }
+        return drifted;
+      };
+    },
+    setMonitorResolution: () => () => {
+      const mode = nextMode();
+      monitorres.setMonitorResolution(primary.id, mode.width, mode.height, mode.refreshRate);
+    },
+    'setMonitorResolution (unchanged)': () => () =>
+      monitorres.setMonitorResolution(primary.id, width, height, refreshRate),
+    'setMonitorResolutionAsync (burst of 8)': () => async () => {
+      const calls = [];
+      for (let i = 0; i < 8; i++) {
+        const mode = nextMode();
+        calls.push(monitorres.setMonitorResolutionAsync(primary.id, mode.width, mode.height, mode.refreshRate));
+      }
+      await Promise.all(calls);
+    },
+    setAllScreenResolutions: () => () => {
+      const mode = nextMode();
+      monitorres.setAllScreenResolutions(mode.width, mode.height, mode.refreshRate);
+    },
+    setMonitorResolutionAsync: () => async () => {
+      const mode = nextMode();
+      await monitorres.setMonitorResolutionAsync(primary.id, mode.width, mode.height, mode.refreshRate);
+    },
+    restoreTopology: () => {
+      const original = monitorres.captureTopology();
+      monitorres.setMonitorResolution(primary.id, alternate.width, alternate.height, alternate.refreshRate);
+      const changed = monitorres.captureTopology();
+      monitorres.restoreTopology(original);
+      return () => {
+        toggle = !toggle;
+        monitorres.restoreTopology(toggle ? changed : original);
+      };
+    },
+    beginDisplayTransaction: () => () => {
+      const mode = nextMode();
+      const tx = monitorres.beginDisplayTransaction();
+      for (const id of ids) {
+        tx.set(id, mode.width, mode.height, mode.refreshRate);
+      }
+      tx.commit();
+    },
+  };
+}
+
+async function timeCalls(fn, iterations) {
+  const samples = new Float64Array(iterations);
+  for (let i = 0; i < iterations; i++) {
+    const start = process.hrtime.bigint();
+    const pending = fn();
+    if (pending) {
+      await pending;
+    }
+    samples[i] = Number(process.hrtime.bigint() - start);
+  }
+
+  samples.sort();
+  let total = 0;
+  for (const sample of samples) {
+    total += sample;
+  }
+
+  return {
+    p50: percentile(samples, 0.5),
+    p90: percentile(samples, 0.9),
+    p99: percentile(samples, 0.99),
+    max: samples[samples.length - 1],
+    mean: total / samples.length,
+  };
+}
+
+// Heap growth over a batch of calls, with collection before and none during
+async function heapBytesPerCall(fn, iterations) {
+  global.gc();
+  const before = v8.getHeapStatistics().used_heap_size;
+  for (let i = 0; i < iterations; i++) {
+    const pending = fn();
+    if (pending) {
+      await pending;
+    }
+  }
+  const after = v8.getHeapStatistics().used_heap_size;
+  return Math.max(0, after - before) / iterations;
+}
+
+async function nativeAllocationsPerCall(fn, iterations) {
+  const before = binary.getNativeAllocationStats();
+  if (!before) {
+    return null;
+  }
+
+  for (let i = 0; i < iterations; i++) {
+    const pending = fn();
+    if (pending) {
+      await pending;
+    }
+  }
+
+  const after = binary.getNativeAllocationStats();
+  return {
+    allocations: (after.allocations - before.allocations) / iterations,
+    bytes: (after.bytes - before.bytes) / iterations,
+  };
+}
+
+function runNativeMicrobenchmarks(filter) {
+  const executable = path.join(buildDir, process.platform === 'win32' ? 'monitorres_microbench.exe' : 'monitorres_microbench');
+  if (!fs.existsSync(executable)) {
+    return null;
+  }
+
+  const output = execFileSync(executable, filter ? [filter] : [], { stdio: ['ignore', 'pipe', 'inherit'] });
+  return JSON.parse(output.toString());
+}
+
+// Cases that change modes; a replayed trace only answers the mode-sets it recorded
+const modeSetCases = new Set([
+  'setMonitorResolution',
+  'setAllScreenResolutions',
+  'setMonitorResolutionAsync',
+  'setMonitorResolutionAsync (burst of 8)',
+  'restoreTopology',
+  'beginDisplayTransaction',
+]);
+
+// The backends to run the cases against: the replay of each trace if any
+// were given, otherwise the grid of simulated topologies
+function benchmarkBackends(options) {
+  if (options.trace.length > 0) {
+    return options.trace.map((trace) => ({
+      trace,
+      use: () => monitorres.useReplayBackend(trace, { latency: options.traceLatency !== 0 }),
+    }));
+  }
+
+  const backends = [];
+  for (const monitorCount of options.monitors) {
+    for (const modeCount of options.modes) {
+      backends.push({
+        trace: null,
+        use: () =>
+          monitorres.useSimulatedBackend({
+            monitorCount,
+            modeCount,
+            signalsPerModeSet: 0,
+            modeListLatencyMs: options.modeListLatencyMs,
+          }),
+      });
+    }
+  }
+  return backends;
+}
+
+async function main() {
+  const options = parseArgs(process.argv.slice(2));
+  const results = [];
+
+  for (const backend of benchmarkBackends(options)) {
+    backend.use();
+    const topology = monitorres.getAllMonitors();
+    const monitorCount = topology.length;
+    const modeCount = monitorres.getAvailableResolutions(topology[0].id).length;
+    const cases = benchmarkCases(topology);
+
+    for (const [name, makeCase] of Object.entries(cases)) {
+      if (options.filter && !name.includes(options.filter)) {
+        continue;
+      }
+      if (backend.trace && modeSetCases.has(name)) {
+        continue;
+      }
+
+      const fn = makeCase();
+      // Warm up caches and the JIT
+      await timeCalls(fn, Math.min(200, options.iterations));
+
+      const latencyNs = await timeCalls(fn, options.iterations);
+      const heapBytes = await heapBytesPerCall(fn, options.heapIterations);
+      const native = await nativeAllocationsPerCall(fn, options.heapIterations);
+      if (fn.cleanup) {
+        fn.cleanup();
+      }
+
+      results.push({
+        name,
+        trace: backend.trace,
+        monitors: monitorCount,
+        modes: modeCount,
+        iterations: options.iterations,
+        latencyNs,
+        heapBytesPerCall: heapBytes,
+        nativeAllocationsPerCall: native ? native.allocations : null,
+        nativeBytesPerCall: native ? native.bytes : null,
+      });
+
+      process.stderr.write(
+        `${name.padEnd(36)} ${backend.trace ? `trace=${path.basename(backend.trace)} ` : ''}` +
+          `monitors=${String(monitorCount).padEnd(3)} modes=${String(modeCount).padEnd(6)} ` +
+          `p50 ${(latencyNs.p50 / 1000).toFixed(2)} us  heap ${heapBytes.toFixed(0)} B/call\n`
+      );
+    }
+  }
+
+  monitorres.useSystemBackend();
+
+  const report = {
+    node: process.version,
+    platform: process.platform,
+    arch: process.arch,
+    nativeAllocationCounters: binary.getNativeAllocationStats() !== null,
+    results,
+    native: runNativeMicrobenchmarks(options.filter),
+  };
+
+  const json = JSON.stringify(report, null, 2);
+  if (options.output) {
+    fs.writeFileSync(options.output, json + '\n');
+  } else {
+    process.stdout.write(json + '\n');
+  }
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
@@ -0,0 +1,358 @@
+// Microbenchmarks of the addon's native core against the simulated backend.
+// Prints one JSON document to stdout; pass a substring to run only the
+// benchmarks whose name contains it.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "allocation_counters.h"
+#include "monitorres_core.h"
+
+using namespace monitorres;
+
+namespace
+{
+    // Samples per benchmark; each sample times a batch of operations
+    const size_t kSamples = 200;
+    // A sample should take at least this long to drown out timer overhead
+    const std::chrono::nanoseconds kMinSampleTime(20000);
+
+    struct BenchmarkResult
+    {
+        std::string name;
+        std::string params;
+        uint64_t operations = 0;
+        double p50 = 0;
+        double p90 = 0;
+        double p99 = 0;
+        double mean = 0;
+        double allocationsPerOp = 0;
+        double bytesPerOp = 0;
+        // Only set by throughput benchmarks
+        double bytesProcessedPerSecond = 0;
+    };
+
+    std::vector<BenchmarkResult> results;
+    std::string filter;
+
+    double Percentile(const std::vector<double> &sorted, double percentile)
+    {
+        size_t index = static_cast<size_t>(percentile * (sorted.size() - 1) + 0.5);
+        return sorted[index];
+    }
+
+    // Time operation, reporting nanoseconds per call
+    BenchmarkResult &Run(const std::string &name, const std::string &params, const std::function<void()> &operation)
+    {
+        static BenchmarkResult skipped;
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+        {
+            return skipped;
+        }
+
+        // Warm up and pick a batch size
+        size_t batch = 1;
+        while (true)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < batch; i++)
+            {
+                operation();
+            }
+            if (std::chrono::steady_clock::now() - start >= kMinSampleTime || batch >= (1u << 20))
+            {
+                break;
+            }
+            batch *= 2;
+        }
+
+        std::vector<double> samples;
+        samples.reserve(kSamples);
+
+        AllocationCounters before = GetAllocationCounters();
+        for (size_t sample = 0; sample < kSamples; sample++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < batch; i++)
+            {
+                operation();
+            }
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            samples.push_back(static_cast<double>(elapsed.count()) / batch);
+        }
+        AllocationCounters after = GetAllocationCounters();
+
+        // The samples vector was reserved up front, so every counted allocation is the operation's
+        BenchmarkResult result;
+        result.name = name;
+        result.params = params;
+        result.operations = static_cast<uint64_t>(batch) * kSamples;
+        result.allocationsPerOp = static_cast<double>(after.allocations - before.allocations) / result.operations;
+        result.bytesPerOp = static_cast<double>(after.bytes - before.bytes) / result.operations;
+
+        double total = 0;
+        for (double sample : samples)
+        {
+            total += sample;
+        }
+        result.mean = total / samples.size();
+
+        std::sort(samples.begin(), samples.end());
+        result.p50 = Percentile(samples, 0.50);
+        result.p90 = Percentile(samples, 0.90);
+        result.p99 = Percentile(samples, 0.99);
+
+        fprintf(stderr, "%-32s %-24s %12.1f ns/op\n", name.c_str(), params.c_str(), result.p50);
+        results.push_back(result);
+        return results.back();
+    }
+
+    // Keep the compiler from discarding a computed value
+#ifdef _MSC_VER
+    const void *volatile sink;
+
+    template <typename T>
+    void DoNotOptimize(const T &value)
+    {
+        sink = &value;
+        _ReadWriteBarrier();
+    }
+#else
+    template <typename T>
+    void DoNotOptimize(const T &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+#endif
+
+    std::vector<DisplayMode> GeneratedModes(uint32_t modeCount)
+    {
+        return SimulatedDisplayBackend::GenerateMonitors(1, modeCount).front().modes;
+    }
+
+    std::string ModeParams(uint32_t modeCount)
+    {
+        return "modes=" + std::to_string(modeCount);
+    }
+
+    std::string TopologyParams(uint32_t monitorCount, uint32_t modeCount)
+    {
+        return "monitors=" + std::to_string(monitorCount) + ",modes=" + std::to_string(modeCount);
+    }
+
+    // 384 byte EDID: base block, a CEA-861 extension and a DisplayID extension
+    std::vector<uint8_t> SampleEdid()
+    {
+        std::vector<uint8_t> edid(3 * kEdidBlockSize, 0);
+        const uint8_t header[] = {0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00};
+        memcpy(edid.data(), header, sizeof(header));
+
+        // GSM, product 0x5B08, EDID 1.4, 60x34 cm
+        edid[8] = 0x1E;
+        edid[9] = 0x6D;
+        edid[10] = 0x08;
+        edid[11] = 0x5B;
+        edid[18] = 1;
+        edid[19] = 4;
+        edid[21] = 60;
+        edid[22] = 34;
+
+        // 1920x1080@60 preferred timing
+        const uint8_t preferred[] = {0x02, 0x3A, 0x80, 0x18, 0x71, 0x38, 0x2D, 0x40, 0x58, 0x2C, 0x45, 0x00, 0x56, 0x50, 0x21, 0x00, 0x00, 0x1E};
+        memcpy(&edid[54], preferred, sizeof(preferred));
+
+        // Product name descriptor
+        const char name[] = "BENCH\n       ";
+        edid[72 + 3] = 0xFC;
+        memcpy(&edid[72 + 5], name, 13);
+        edid[126] = 2;
+
+        // CEA-861 extension with the preferred timing repeated as its only DTD
+        edid[128] = 0x02;
+        edid[129] = 0x03;
+        edid[130] = 4;
+        memcpy(&edid[132], preferred, sizeof(preferred));
+
+        // DisplayID extension with one Type I timing, 2560x1440
+        uint8_t *displayId = &edid[256];
+        displayId[0] = 0x70;
+        displayId[1] = 0x13;
+        displayId[2] = 23;
+        displayId[5] = 0x03;
+        displayId[7] = 20;
+        const uint8_t timing[] = {0x22, 0xE5, 0x00, 0x80, 0xFF, 0x09, 0x9F, 0x00, 0x30, 0x00, 0x1F, 0x00, 0x9F, 0x05, 0x28, 0x00, 0x02, 0x00, 0x04, 0x00};
+        memcpy(&displayId[8], timing, sizeof(timing));
+
+        for (size_t block = 0; block < 3; block++)
+        {
+            uint8_t sum = 0;
+            for (size_t i = 0; i < kEdidBlockSize - 1; i++)
+            {
+                sum = static_cast<uint8_t>(sum + edid[block * kEdidBlockSize + i]);
+            }
+            edid[block * kEdidBlockSize + kEdidBlockSize - 1] = static_cast<uint8_t>(0x100 - sum);
+        }
+
+        return edid;
+    }
+
+    void ModeTableBenchmarks()
+    {
+        for (uint32_t modeCount : {10u, 100u, 1000u, 10000u})
+        {
+            std::vector<DisplayMode> modes = GeneratedModes(modeCount);
+            ModeTable table(modes);
+            const DisplayMode &last = modes.back();
+
+            Run("ModeTable/Build", ModeParams(modeCount), [&]
+                { ModeTable built(modes); DoNotOptimize(built.Keys().size()); });
+            Run("ModeTable/HasMode", ModeParams(modeCount), [&]
+                { DoNotOptimize(table.HasMode(last.width, last.height, last.refreshRate)); });
+            Run("ModeTable/ClosestRefreshRate", ModeParams(modeCount), [&]
+                { DoNotOptimize(table.ClosestRefreshRate(last.width, last.height, 59)); });
+            Run("ModeTable/RefreshRates", ModeParams(modeCount), [&]
+                { DoNotOptimize(table.RefreshRates(last.width, last.height).size()); });
+
+            // "Highest refresh rate of at least 60 Hz at 16:9 up to 2560 wide, prefer native"
+            ModeQuery query;
+            query.constraints.width.max = 2560;
+            query.constraints.refreshRate.min = 60;
+            query.constraints.minAspectRatio = 16.0 / 9 * (1 - kAspectRatioTolerance);
+            query.constraints.maxAspectRatio = 16.0 / 9 * (1 + kAspectRatioTolerance);
+            query.ranking = {{ModeRankField::Native}, {ModeRankField::RefreshRate}};
+            Run("ModeQuery/FindBestModes", ModeParams(modeCount), [&]
+                { DoNotOptimize(FindBestModes(table, query, nullptr, kDefaultModeAlternatives + 1).size()); });
+
+            SimulatedBackendOptions options;
+            options.monitors = SimulatedDisplayBackend::GenerateMonitors(1, modeCount);
+            SimulatedDisplayBackend backend(options);
+            Run("ModeTable/Enumerate", ModeParams(modeCount), [&]
+                { DoNotOptimize(ModeTable::Enumerate(backend, "").get()); });
+
+            ModeTableCache cache;
+            cache.Get(backend, "");
+            Run("ModeTableCache/Hit", ModeParams(modeCount), [&]
+                { DoNotOptimize(cache.Get(backend, "").get()); });
+        }
+    }
+
+    void TopologyBenchmarks()
+    {
+        for (uint32_t monitorCount : {1u, 4u, 16u})
+        {
+            for (uint32_t modeCount : {10u, 1000u, 10000u})
+            {
+                SimulatedBackendOptions options;
+                options.monitors = SimulatedDisplayBackend::GenerateMonitors(monitorCount, modeCount);
+                options.signalsPerModeSet = 0;
+                SimulatedDisplayBackend backend(options);
+                std::string params = TopologyParams(monitorCount, modeCount);
+
+                MonitorSnapshot snapshot = TakeMonitorSnapshot(backend);
+                Run("MonitorSnapshot/Take", params, [&]
+                    { DoNotOptimize(TakeMonitorSnapshot(backend).size()); });
+                Run("MonitorSnapshot/DiffUnchanged", params, [&]
+                    { DoNotOptimize(DiffMonitorSnapshots(snapshot, snapshot).Empty()); });
+
+                // Plans go through the process-wide cache, so point it at this backend
+                ModeTables().InvalidateAll();
+                ModeChangeRequest request;
+                request.id = options.monitors.back().device.id;
+                request.width = static_cast<int>(options.monitors.back().current.width);
+                request.height = static_cast<int>(options.monitors.back().current.height);
+                request.refreshRate = 59;
+                request.hasRefreshRate = true;
+                Run("ModeChange/Plan", params, [&]
+                    { DoNotOptimize(PlanModeChange(backend, request).resolved); });
+
+                Run("DisplayTransaction/Commit", params, [&]
+                    {
+                    DisplayTransaction transaction;
+                    for (const auto &monitor : options.monitors)
+                    {
+                        ModeChangeRequest change;
+                        change.id = monitor.device.id;
+                        change.width = static_cast<int>(monitor.current.width);
+                        change.height = static_cast<int>(monitor.current.height);
+                        change.refreshRate = static_cast<int>(monitor.current.refreshRate);
+                        change.hasRefreshRate = true;
+                        transaction.Add(backend, change);
+                    }
+                    DoNotOptimize(transaction.Commit(backend).code); });
+            }
+        }
+        ModeTables().InvalidateAll();
+    }
+
+    void EdidBenchmarks()
+    {
+        std::vector<uint8_t> edid = SampleEdid();
+
+        BenchmarkResult &parse = Run("Edid/Parse", "bytes=" + std::to_string(edid.size()), [&]
+                                     {
+            EdidInfo info;
+            DoNotOptimize(ParseEdid(edid.data(), edid.size(), info)); });
+        if (parse.p50 > 0)
+        {
+            parse.bytesProcessedPerSecond = edid.size() * 1e9 / parse.p50;
+        }
+
+        EdidCache cache;
+        cache.Get(edid);
+        Run("EdidCache/Hit", "bytes=" + std::to_string(edid.size()), [&]
+            { DoNotOptimize(cache.Get(edid).get()); });
+    }
+
+    void PrintJson()
+    {
+        printf("{\n  \"allocationCounters\": %s,\n  \"benchmarks\": [\n",
+#ifdef MONITORRES_ALLOCATION_COUNTERS
+               "true"
+#else
+               "false"
+#endif
+        );
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const BenchmarkResult &result = results[i];
+            printf("    {\"name\": \"%s\", \"params\": \"%s\", \"operations\": %llu, "
+                   "\"latencyNs\": {\"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"mean\": %.2f}, "
+                   "\"allocationsPerOp\": %.3f, \"bytesPerOp\": %.1f",
+                   result.name.c_str(), result.params.c_str(), static_cast<unsigned long long>(result.operations),
+                   result.p50, result.p90, result.p99, result.mean,
+                   result.allocationsPerOp, result.bytesPerOp);
+            if (result.bytesProcessedPerSecond > 0)
+            {
+                printf(", \"bytesPerSecond\": %.0f", result.bytesProcessedPerSecond);
+            }
+            printf("}%s\n", i + 1 < results.size() ? "," : "");
+        }
+
+        printf("  ]\n}\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+    {
+        filter = argv[1];
+    }
+
+    ModeTableBenchmarks();
+    TopologyBenchmarks();
+    EdidBenchmarks();
+
+    PrintJson();
+    return 0;
+}
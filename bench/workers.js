@@ -0,0 +1,178 @@
+/**
+ * Stress test of the addon under worker_threads
+ *
+ * Loads the addon in the main thread and in a number of workers, which all
+ * call the read exports in a tight loop against one shared simulated
+ * backend. Some workers also subscribe to display changes and invalidate
+ * the mode cache now and then, so lookups race with invalidations. Every
+ * result is checked against the topology the main thread generated.
+ *
+ * Prints the calls made and the mode cache counters as JSON. Exits with a
+ * non-zero status if any result was wrong or any worker failed.
+ *
+ * Usage: node bench/workers.js [--workers=8] [--monitors=8] [--modes=1000]
+ *                              [--durationMs=3000] [--modeListLatencyMs=0]
+ */
+
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+const monitorres = require('..');
+
+function parseArgs(argv) {
+  const options = {
+    workers: 8,
+    monitors: 8,
+    modes: 1000,
+    durationMs: 3000,
+    modeListLatencyMs: 0,
+  };
+
+  for (const arg of argv) {
+    const [name, value] = arg.replace(/^--/, '').split('=');
+    if (!(name in options)) {
+      throw new Error(`Unknown option ${arg}`);
+    }
+    options[name] = Number(value);
+  }
+
+  return options;
+}
+
+function check(condition, message) {
+  if (!condition) {
+    throw new Error(message);
+  }
+}
+
+async function hammer({ index, durationMs, expected, invalidate }) {
+  const calls = {};
+  const count = (name) => {
+    calls[name] = (calls[name] || 0) + 1;
+  };
+
+  let events = 0;
+  const listener = () => {
+    events++;
+  };
+  if (invalidate) {
+    monitorres.on('change', listener);
+  }
+
+  let generation = 0;
+  const deadline = Date.now() + durationMs;
+  for (let round = 0; Date.now() < deadline; round++) {
+    const monitors = monitorres.getAllMonitors();
+    count('getAllMonitors');
+    check(monitors.length === expected.ids.length, `worker ${index}: ${monitors.length} monitors`);
+
+    const id = expected.ids[(index + round) % expected.ids.length];
+    const modes = monitorres.getAvailableResolutions(id);
+    count('getAvailableResolutions');
+    check(modes.length === expected.modeCount, `worker ${index}: ${modes.length} modes on ${id}`);
+
+    const packed = monitorres.getAvailableResolutionsPacked(id);
+    count('getAvailableResolutionsPacked');
+    check(packed.width.length === expected.modeCount, `worker ${index}: ${packed.width.length} packed modes on ${id}`);
+
+    const best = monitorres.findBestMode(id, { refreshRate: { min: 60 } });
+    count('findBestMode');
+    check(best !== null && best.mode.refreshRate >= 60, `worker ${index}: no mode of 60 Hz or more on ${id}`);
+
+    const changes = monitorres.getMonitorsSince(generation);
+    count('getMonitorsSince');
+    if (changes) {
+      generation = changes.generation;
+    }
+
+    if (round % 16 === 0) {
+      const inventory = await monitorres.getFullInventory();
+      count('getFullInventory');
+      check(inventory.monitors.length === expected.ids.length, `worker ${index}: ${inventory.monitors.length} monitors in inventory`);
+      for (const monitorId of expected.ids) {
+        check(inventory.modes[monitorId].length === expected.modeCount, `worker ${index}: inventory of ${monitorId}`);
+      }
+    }
+
+    if (invalidate && round % 64 === 0) {
+      monitorres.invalidateModeCache(round % 128 === 0 ? undefined : id);
+      count('invalidateModeCache');
+    }
+  }
+
+  if (invalidate) {
+    monitorres.off('change', listener);
+  }
+
+  return { calls, events };
+}
+
+async function main() {
+  const options = parseArgs(process.argv.slice(2));
+
+  monitorres.useSimulatedBackend({
+    monitorCount: options.monitors,
+    modeCount: options.modes,
+    signalsPerModeSet: 0,
+    modeListLatencyMs: options.modeListLatencyMs,
+  });
+  const expected = {
+    ids: monitorres.getAllMonitors().map((monitor) => monitor.id),
+    modeCount: options.modes,
+  };
+  monitorres.invalidateModeCache();
+  const before = monitorres.getModeCacheStats();
+
+  const start = Date.now();
+  const results = await Promise.all(
+    Array.from({ length: options.workers }, (_, index) =>
+      new Promise((resolve, reject) => {
+        const worker = new Worker(__filename, {
+          workerData: { index, durationMs: options.durationMs, expected, invalidate: index % 4 === 0 },
+        });
+        worker.once('message', resolve);
+        worker.once('error', reject);
+        worker.once('exit', (code) => {
+          if (code !== 0) {
+            reject(new Error(`Worker ${index} exited with code ${code}`));
+          }
+        });
+      })
+    )
+  );
+  const elapsedMs = Date.now() - start;
+
+  const calls = {};
+  for (const result of results) {
+    for (const [name, value] of Object.entries(result.calls)) {
+      calls[name] = (calls[name] || 0) + value;
+    }
+  }
+  const totalCalls = Object.values(calls).reduce((sum, value) => sum + value, 0);
+
+  const after = monitorres.getModeCacheStats();
+  const report = {
+    workers: options.workers,
+    monitors: options.monitors,
+    modes: options.modes,
+    elapsedMs,
+    calls,
+    callsPerSecond: Math.round((totalCalls / elapsedMs) * 1000),
+    modeCache: {
+      hits: after.hits - before.hits,
+      misses: after.misses - before.misses,
+      coalesced: after.coalesced - before.coalesced,
+      invalidations: after.invalidations - before.invalidations,
+    },
+  };
+
+  process.stdout.write(JSON.stringify(report, null, 2) + '\n');
+  monitorres.useSystemBackend();
+}
+
+if (isMainThread) {
+  main().catch((error) => {
+    console.error(error);
+    process.exit(1);
+  });
+} else {
+  hammer(workerData).then((result) => parentPort.postMessage(result));
+}
@@ -1,24 +1,169 @@
 {
+  "variables": {
+    # Build with --monitorres_bench=1 to count native allocations and build the microbenchmarks
+    "monitorres_bench%": 0,
+    # Build with --monitorres_stats=0 to compile out getStats() latency histograms, call counters and tracing
+    "monitorres_stats%": 1,
+    # Build with --monitorres_cli=0 to skip the monitorres_cli executable
+    "monitorres_cli%": 1,
+    # Build with --monitorres_tests=1 to build the monitorres_core_tests executable
+    "monitorres_tests%": 0
+  },
+  "target_defaults": {
+    "cflags!": [ "-fno-exceptions" ],
+    "cflags_cc!": [ "-fno-exceptions" ],
+    "conditions": [
+      ["OS=='win'", {
+        "msvs_settings": {
+          "VCCLCompilerTool": {
+            "ExceptionHandling": 1
+          }
+        }
+      }],
+      ["monitorres_stats==1", {
+        "defines": [ "MONITORRES_STATS" ]
+      }],
+      ["monitorres_bench==1", {
+        "defines": [ "MONITORRES_ALLOCATION_COUNTERS" ]
+      }],
+      ["monitorres_bench==1 and OS=='linux'", {
+        "ldflags": [ "-Wl,-Bsymbolic-functions" ]
+      }]
+    ]
+  },
   "targets": [
     {
+      # Enumeration, validation and mode-set logic with a plain C++ API
+      # (src/monitorres_core.h), for the addon and for native callers
+      "target_name": "monitorres_core",
+      "type": "static_library",
+      "sources": [
+        "src/allocation_counters.cc",
+        "src/desktop_layout.cc",
+        "src/display_backend.cc",
+        "src/display_events.cc",
+        "src/display_reconciler.cc",
+        "src/display_geometry.cc",
+        "src/display_transaction.cc",
+        "src/edid.cc",
+        "src/inventory.cc",
+        "src/mode_change.cc",
+        "src/mode_change_scheduler.cc",
+        "src/mode_cursor.cc",
+        "src/mode_query.cc",
+        "src/mode_table.cc",
+        "src/mode_table_file.cc",
+        "src/monitor_binary.cc",
+        "src/monitor_snapshot.cc",
+        "src/monitorres_core.cc",
+        "src/simulated_backend.cc",
+        "src/stats.cc",
+        "src/topology.cc",
+        "src/trace_backend.cc",
+        "src/worker_pool.cc",
+        "src/win32_backend.cc",
+        "src/win32_display_events.cc"
+      ],
+      "direct_dependent_settings": {
+        "include_dirs": [ "src" ]
+      },
+      "conditions": [
+        ["OS!='win'", {
+          "sources": [
+            "src/drm_backend.cc"
+          ],
+          # Linked into the addon, which is a shared object
+          "cflags": [ "-fPIC" ]
+        }]
+      ]
+    },
+    {
+      # The N-API layer: argument parsing and conversion around monitorres_core
       "target_name": "monitorres",
-      "sources": [ "src/monitorres.cc" ],
+      "dependencies": [ "monitorres_core" ],
+      "sources": [
+        "src/monitorres.cc",
+        "src/display_reconciler_wrap.cc",
+        "src/display_transaction_wrap.cc",
+        "src/display_watcher_wrap.cc",
+        "src/inventory_worker.cc",
+        "src/marshal.cc",
+        "src/mode_change_worker.cc",
+        "src/mode_cursor_wrap.cc",
+        "src/object_shapes.cc"
+      ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")"
       ],
       'defines': [ 'NAPI_DISABLE_CPP_EXCEPTIONS' ],
-      "libraries": [],
-      "cflags!": [ "-fno-exceptions" ],
-      "cflags_cc!": [ "-fno-exceptions" ],
-      "conditions": [
-        ["OS=='win'", {
-          "msvs_settings": {
-            "VCCLCompilerTool": {
-              "ExceptionHandling": 1
-            }
-          }
-        }]
-      ]
+      "libraries": []
     }
+  ],
+  "conditions": [
+    ["monitorres_cli==1", {
+      "targets": [
+        {
+          # Command-line tool on top of monitorres_core, without Node (cli/main.cc)
+          "target_name": "monitorres_cli",
+          "type": "executable",
+          "dependencies": [ "monitorres_core" ],
+          "sources": [
+            "cli/main.cc"
+          ],
+          "conditions": [
+            ["OS!='win'", {
+              "libraries": [ "-lpthread" ]
+            }]
+          ]
+        }
+      ]
+    }],
+    ["monitorres_bench==1", {
+      "targets": [
+        {
+          "target_name": "monitorres_microbench",
+          "type": "executable",
+          "dependencies": [ "monitorres_core" ],
+          "sources": [
+            "bench/native/microbench.cc"
+          ],
+          "conditions": [
+            ["OS!='win'", {
+              "libraries": [ "-lpthread" ]
+            }]
+          ]
+        }
+      ]
+    }],
+    ["monitorres_tests==1", {
+      "targets": [
+        {
+          # Tests of monitorres_core against the simulated backend (test/core);
+          # run from the repository root, or point MONITORRES_TEST_FIXTURES at test/fixtures
+          "target_name": "monitorres_core_tests",
+          "type": "executable",
+          "dependencies": [ "monitorres_core" ],
+          "sources": [
+            "test/core/desktop_layout_test.cc",
+            "test/core/display_reconciler_test.cc",
+            "test/core/display_transaction_test.cc",
+            "test/core/display_watcher_test.cc",
+            "test/core/edid_test.cc",
+            "test/core/mode_change_scheduler_test.cc",
+            "test/core/mode_change_test.cc",
+            "test/core/mode_query_test.cc",
+            "test/core/mode_table_file_test.cc",
+            "test/core/mode_table_test.cc",
+            "test/core/test_main.cc",
+            "test/core/topology_test.cc"
+          ],
+          "conditions": [
+            ["OS!='win'", {
+              "libraries": [ "-lpthread" ]
+            }]
+          ]
+        }
+      ]
+    }]
   ]
 }
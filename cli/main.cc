@@ -0,0 +1,673 @@
+// monitorres command-line tool: the addon's native core without Node, for
+// scripts that would otherwise pay for starting a Node process per query.
+// Prints compact JSON, or one line per item with --lines.
+//
+//   monitorres_cli [options] list
+//   monitorres_cli [options] modes [id]
+//   monitorres_cli [options] set [id] WIDTHxHEIGHT[@RATE]
+//   monitorres_cli [options] capture [file]
+//   monitorres_cli [options] restore [file]
+//   monitorres_cli [options] watch
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "monitorres_core.h"
+
+using namespace monitorres;
+
+namespace
+{
+    // Exit codes
+    const int kExitSuccess = 0;
+    const int kExitFailure = 1;
+    const int kExitUsage = 2;
+
+    // Default interval at which watch polls backends without change notifications
+    const uint32_t kDefaultPollMs = 1000;
+
+    const char *const kUsage =
+        "Usage: monitorres_cli [options] <command> [arguments]\n"
+        "\n"
+        "Commands:\n"
+        "  list                       Active monitors and their current mode\n"
+        "  modes [id]                 Modes of a monitor, the primary one by default\n"
+        "  set [id] WxH[@RATE]        Change the mode of a monitor, the primary one by default\n"
+        "  capture [file]             Write the topology blob of every active monitor (stdout by default)\n"
+        "  restore [file]             Restore a topology blob written by capture (stdin by default)\n"
+        "  watch                      Print one line per display change until interrupted\n"
+        "\n"
+        "Options:\n"
+        "  --lines                    Print tab-separated lines instead of JSON\n"
+        "  --simulated[=MxN]          Use the simulated backend, optionally with M monitors of N modes\n"
+        "  --replay=FILE              Answer from a trace recorded by startBackendRecording\n"
+#ifndef _WIN32
+        "  --drm=ROOT                 Read DRM connectors under ROOT instead of /sys/class/drm\n"
+#endif
+        "  --count=N                  watch: exit after N changes\n"
+        "  --timeout=MS               watch: exit after MS milliseconds\n"
+        "  --interval=MS              watch: poll interval for backends without notifications (1000)\n"
+        "  --coalesce=MS              watch: quiet period that ends a burst of changes (250)\n"
+        "  --help                     Show this help\n";
+
+    // Wrong arguments; main prints the usage
+    class UsageError : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    struct Options
+    {
+        bool lines = false;
+        std::string backend;
+        std::string backendArgument;
+        uint32_t count = 0;
+        uint32_t timeoutMs = 0;
+        uint32_t intervalMs = kDefaultPollMs;
+        uint32_t coalesceMs = static_cast<uint32_t>(kDefaultCoalesceWindow.count());
+        std::string command;
+        std::vector<std::string> arguments;
+    };
+
+    // Parse a decimal number of at most max. strtoul alone would take a sign
+    // or leading blanks and, where unsigned long is 32 bits, wrap a negative
+    // number or saturate an overflow into range.
+    uint32_t ParseNumber(const std::string &text, const char *what, uint32_t max = UINT32_MAX)
+    {
+        char *end = nullptr;
+        errno = 0;
+        unsigned long value = text.empty() || text[0] < '0' || text[0] > '9' ? 0 : strtoul(text.c_str(), &end, 10);
+        if (end == nullptr || *end != '\0' || errno == ERANGE || value > max)
+        {
+            throw UsageError(std::string("invalid ") + what + " '" + text + "'");
+        }
+        return static_cast<uint32_t>(value);
+    }
+
+    Options ParseOptions(int argc, char **argv)
+    {
+        Options options;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg.compare(0, 2, "--") != 0)
+            {
+                if (options.command.empty())
+                {
+                    options.command = arg;
+                }
+                else
+                {
+                    options.arguments.push_back(arg);
+                }
+                continue;
+            }
+
+            size_t equals = arg.find('=');
+            std::string name = arg.substr(2, equals == std::string::npos ? std::string::npos : equals - 2);
+            std::string value = equals == std::string::npos ? std::string() : arg.substr(equals + 1);
+
+            if (name == "help")
+            {
+                options.command = "help";
+            }
+            else if (name == "lines")
+            {
+                options.lines = true;
+            }
+            else if (name == "simulated" || name == "replay" || name == "drm")
+            {
+                options.backend = name;
+                options.backendArgument = value;
+            }
+            else if (name == "count")
+            {
+                options.count = ParseNumber(value, "count");
+            }
+            else if (name == "timeout")
+            {
+                options.timeoutMs = ParseNumber(value, "timeout");
+            }
+            else if (name == "interval")
+            {
+                options.intervalMs = ParseNumber(value, "interval");
+            }
+            else if (name == "coalesce")
+            {
+                options.coalesceMs = ParseNumber(value, "coalesce window");
+            }
+            else
+            {
+                throw UsageError("unknown option " + arg);
+            }
+        }
+        return options;
+    }
+
+    std::shared_ptr<DisplayBackend> CreateBackend(const Options &options)
+    {
+        if (options.backend == "simulated")
+        {
+            SimulatedBackendOptions simulated;
+            if (!options.backendArgument.empty())
+            {
+                size_t x = options.backendArgument.find('x');
+                uint32_t monitors = ParseNumber(options.backendArgument.substr(0, x), "monitor count");
+                uint32_t modes = x == std::string::npos ? kMinGeneratedModes : ParseNumber(options.backendArgument.substr(x + 1), "mode count");
+                if (monitors < 1 || monitors > kMaxGeneratedMonitors || modes < kMinGeneratedModes || modes > kMaxGeneratedModes)
+                {
+                    throw UsageError("--simulated takes 1-" + std::to_string(kMaxGeneratedMonitors) + " monitors of " +
+                                     std::to_string(kMinGeneratedModes) + "-" + std::to_string(kMaxGeneratedModes) + " modes");
+                }
+                simulated.monitors = SimulatedDisplayBackend::GenerateMonitors(monitors, modes);
+            }
+            else
+            {
+                simulated.monitors = SimulatedDisplayBackend::DefaultMonitors();
+            }
+            return std::make_shared<SimulatedDisplayBackend>(std::move(simulated));
+        }
+
+        if (options.backend == "replay")
+        {
+            DisplayTrace trace;
+            std::string error;
+            if (options.backendArgument.empty())
+            {
+                throw UsageError("--replay needs a trace file");
+            }
+            if (!ReadDisplayTrace(options.backendArgument, trace, error))
+            {
+                throw std::runtime_error(options.backendArgument + ": " + error);
+            }
+            return std::make_shared<ReplayDisplayBackend>(trace, ReplayBackendOptions());
+        }
+
+#ifndef _WIN32
+        if (options.backend == "drm")
+        {
+            return CreateDrmDisplayBackend(options.backendArgument.empty() ? kDefaultSysfsRoot : options.backendArgument);
+        }
+#else
+        if (options.backend == "drm")
+        {
+            throw UsageError("--drm is only available on Linux");
+        }
+#endif
+
+        std::shared_ptr<DisplayBackend> backend = CreateSystemDisplayBackend();
+        if (!backend)
+        {
+            throw std::runtime_error("this platform has no display backend");
+        }
+        return backend;
+    }
+
+    std::string JsonString(const std::string &value)
+    {
+        std::string out = "\"";
+        for (char c : value)
+        {
+            switch (c)
+            {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                }
+                else
+                {
+                    out += c;
+                }
+            }
+        }
+        return out + "\"";
+    }
+
+    std::string JsonStringArray(const std::vector<std::string> &values)
+    {
+        std::string out = "[";
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            out += (i ? "," : "") + JsonString(values[i]);
+        }
+        return out + "]";
+    }
+
+    std::string JoinIds(const std::vector<std::string> &ids)
+    {
+        std::string out;
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            out += (i ? "," : "") + ids[i];
+        }
+        return out.empty() ? "-" : out;
+    }
+
+    std::string FormatMode(const DisplayMode &mode)
+    {
+        return std::to_string(mode.width) + "x" + std::to_string(mode.height) + "@" + std::to_string(mode.refreshRate);
+    }
+
+    // Parse WIDTHxHEIGHT[@RATE] into a request; returns false if text has
+    // another shape and throws UsageError for a component out of range
+    bool ParseModeSpec(const std::string &text, ModeChangeRequest &request)
+    {
+        size_t x = text.find('x');
+        if (x == std::string::npos)
+        {
+            return false;
+        }
+        size_t at = text.find('@', x + 1);
+        std::string height = text.substr(x + 1, at == std::string::npos ? std::string::npos : at - x - 1);
+
+        request.width = static_cast<int>(ParseNumber(text.substr(0, x), "width", INT32_MAX));
+        request.height = static_cast<int>(ParseNumber(height, "height", INT32_MAX));
+        if (at != std::string::npos)
+        {
+            request.refreshRate = static_cast<int>(ParseNumber(text.substr(at + 1), "refresh rate", INT32_MAX));
+            request.hasRefreshRate = true;
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> ReadAll(FILE *file)
+    {
+        std::vector<uint8_t> data;
+        uint8_t chunk[4096];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        {
+            data.insert(data.end(), chunk, chunk + read);
+        }
+        return data;
+    }
+
+    int List(DisplayBackend &backend, const Options &options)
+    {
+        MonitorSnapshot snapshot = TakeMonitorSnapshot(backend);
+
+        std::string out = options.lines ? "" : "[";
+        for (size_t i = 0; i < snapshot.size(); i++)
+        {
+            const MonitorState &state = snapshot[i];
+            bool primary = (state.device.stateFlags & kDevicePrimary) != 0;
+            if (options.lines)
+            {
+                out += state.device.id + "\t" + (state.hasMode ? FormatMode(state.mode) : "-") + "\t" +
+                       (state.hasMode ? std::to_string(state.mode.positionX) + "," + std::to_string(state.mode.positionY) : "-") + "\t" +
+                       (primary ? "primary" : "-") + "\t" + state.device.name + "\n";
+                continue;
+            }
+
+            out += (i ? "," : "");
+            out += "{\"id\":" + JsonString(state.device.id) + ",\"name\":" + JsonString(state.device.name) +
+                   ",\"deviceId\":" + JsonString(state.device.deviceId) + ",\"primary\":" + (primary ? "true" : "false");
+            if (state.hasMode)
+            {
+                out += ",\"width\":" + std::to_string(state.mode.width) + ",\"height\":" + std::to_string(state.mode.height) +
+                       ",\"refreshRate\":" + std::to_string(state.mode.refreshRate) + ",\"bitsPerPixel\":" + std::to_string(state.mode.bitsPerPixel) +
+                       ",\"orientation\":" + std::to_string(state.mode.orientation) + ",\"x\":" + std::to_string(state.mode.positionX) +
+                       ",\"y\":" + std::to_string(state.mode.positionY);
+            }
+            out += "}";
+        }
+        if (!options.lines)
+        {
+            out += "]\n";
+        }
+
+        fputs(out.c_str(), stdout);
+        return kExitSuccess;
+    }
+
+    int Modes(DisplayBackend &backend, const Options &options)
+    {
+        if (options.arguments.size() > 1)
+        {
+            throw UsageError("modes takes at most a monitor id");
+        }
+        std::string id = options.arguments.empty() ? std::string() : options.arguments[0];
+        if (id.empty())
+        {
+            for (const MonitorState &state : TakeMonitorSnapshot(backend))
+            {
+                if (state.device.stateFlags & kDevicePrimary)
+                {
+                    id = state.device.id;
+                    break;
+                }
+            }
+        }
+
+        std::shared_ptr<const ModeTable> modes = ModeTables().Get(backend, id);
+        if (modes->Modes().empty())
+        {
+            fprintf(stderr, "monitorres: no modes for monitor '%s'\n", id.c_str());
+            return kExitFailure;
+        }
+
+        std::string out = options.lines ? "" : "[";
+        for (size_t i = 0; i < modes->Modes().size(); i++)
+        {
+            const DisplayMode &mode = modes->Modes()[i];
+            if (options.lines)
+            {
+                out += FormatMode(mode) + "\t" + std::to_string(mode.bitsPerPixel) + "\n";
+            }
+            else
+            {
+                out += std::string(i ? "," : "") + "{\"width\":" + std::to_string(mode.width) + ",\"height\":" + std::to_string(mode.height) +
+                       ",\"refreshRate\":" + std::to_string(mode.refreshRate) + ",\"bitsPerPixel\":" + std::to_string(mode.bitsPerPixel) + "}";
+            }
+        }
+        if (!options.lines)
+        {
+            out += "]\n";
+        }
+
+        fputs(out.c_str(), stdout);
+        return kExitSuccess;
+    }
+
+    int Set(DisplayBackend &backend, const Options &options)
+    {
+        ModeChangeRequest request;
+        if (options.arguments.empty() || options.arguments.size() > 2 || !ParseModeSpec(options.arguments.back(), request))
+        {
+            throw UsageError("set takes [id] WIDTHxHEIGHT[@RATE]");
+        }
+        if (options.arguments.size() == 2)
+        {
+            request.id = options.arguments[0];
+        }
+
+        ModeChangeResult result = ChangeDisplayMode(backend, request);
+        bool succeeded = result.status == ModeChangeResult::Status::Applied ||
+                         result.status == ModeChangeResult::Status::AppliedClosestRefreshRate;
+        if (!succeeded)
+        {
+            std::string message = result.message.empty() ? DescribeDisplayChangeCode(result.code) : result.message;
+            if (options.lines)
+            {
+                fprintf(stdout, "error\t%ld\t%s\n", result.code, message.c_str());
+            }
+            else
+            {
+                fprintf(stdout, "{\"code\":%ld,\"message\":%s}\n", result.code, JsonString(message).c_str());
+            }
+            return kExitFailure;
+        }
+
+        // Report the mode the monitor runs now, whose refresh rate may be the closest one or the kept one
+        DisplayMode mode;
+        if (!backend.GetCurrentMode(request.id, mode))
+        {
+            mode.width = static_cast<uint32_t>(request.width);
+            mode.height = static_cast<uint32_t>(request.height);
+            mode.refreshRate = static_cast<uint32_t>(result.actualRefreshRate);
+        }
+
+        if (options.lines)
+        {
+            fprintf(stdout, "%s\t%s\n", result.unchanged ? "unchanged" : "applied", FormatMode(mode).c_str());
+        }
+        else
+        {
+            fprintf(stdout, "{\"success\":true,\"unchanged\":%s,\"width\":%u,\"height\":%u,\"refreshRate\":%u}\n",
+                    result.unchanged ? "true" : "false", mode.width, mode.height, mode.refreshRate);
+        }
+        return kExitSuccess;
+    }
+
+    int Capture(DisplayBackend &backend, const Options &options)
+    {
+        if (options.arguments.size() > 1)
+        {
+            throw UsageError("capture takes at most a file");
+        }
+
+        std::vector<uint8_t> blob = SerializeTopology(CaptureTopology(backend));
+        if (options.arguments.empty() || options.arguments[0] == "-")
+        {
+#ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            fwrite(blob.data(), 1, blob.size(), stdout);
+            return kExitSuccess;
+        }
+
+        FILE *file = fopen(options.arguments[0].c_str(), "wb");
+        if (file == nullptr)
+        {
+            throw std::runtime_error("cannot write " + options.arguments[0]);
+        }
+        bool written = fwrite(blob.data(), 1, blob.size(), file) == blob.size();
+        written = fclose(file) == 0 && written;
+        if (!written)
+        {
+            throw std::runtime_error("cannot write " + options.arguments[0]);
+        }
+        return kExitSuccess;
+    }
+
+    int Restore(DisplayBackend &backend, const Options &options)
+    {
+        if (options.arguments.size() > 1)
+        {
+            throw UsageError("restore takes at most a file");
+        }
+
+        std::vector<uint8_t> blob;
+        if (options.arguments.empty() || options.arguments[0] == "-")
+        {
+#ifdef _WIN32
+            _setmode(_fileno(stdin), _O_BINARY);
+#endif
+            blob = ReadAll(stdin);
+        }
+        else
+        {
+            FILE *file = fopen(options.arguments[0].c_str(), "rb");
+            if (file == nullptr)
+            {
+                throw std::runtime_error("cannot read " + options.arguments[0]);
+            }
+            blob = ReadAll(file);
+            fclose(file);
+        }
+
+        Topology topology;
+        std::string error;
+        if (!DeserializeTopology(blob.data(), blob.size(), topology, error))
+        {
+            throw std::runtime_error("invalid topology: " + error);
+        }
+
+        TopologyRestoreResult result = RestoreTopology(backend, topology);
+        if (result.code != kDispChangeSuccessful)
+        {
+            std::string message = result.message.empty() ? DescribeDisplayChangeCode(result.code) : result.message;
+            if (options.lines)
+            {
+                fprintf(stdout, "error\t%ld\t%s\t%s\n", result.code, message.c_str(), result.failedId.empty() ? "-" : result.failedId.c_str());
+            }
+            else
+            {
+                fprintf(stdout, "{\"code\":%ld,\"message\":%s,\"failedId\":%s}\n", result.code, JsonString(message).c_str(), JsonString(result.failedId).c_str());
+            }
+            return kExitFailure;
+        }
+
+        if (options.lines)
+        {
+            fprintf(stdout, "changed\t%s\nmissing\t%s\n", JoinIds(result.changed).c_str(), JoinIds(result.missing).c_str());
+        }
+        else
+        {
+            fprintf(stdout, "{\"changed\":%s,\"missing\":%s}\n", JsonStringArray(result.changed).c_str(), JsonStringArray(result.missing).c_str());
+        }
+        return kExitSuccess;
+    }
+
+    // Set by SIGINT and SIGTERM to end watch
+    std::atomic<bool> interrupted{false};
+
+    void OnInterrupt(int)
+    {
+        interrupted.store(true);
+    }
+
+    int Watch(std::shared_ptr<DisplayBackend> backend, const Options &options)
+    {
+        if (!options.arguments.empty())
+        {
+            throw UsageError("watch takes no arguments");
+        }
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        uint32_t events = 0;
+
+        DisplayChangeWatcher watcher(backend, [&](const DisplayChangeEvent &event)
+                                     {
+            if (options.lines)
+            {
+                fprintf(stdout, "added\t%s\tremoved\t%s\tchanged\t%s\n", JoinIds(event.added).c_str(), JoinIds(event.removed).c_str(), JoinIds(event.changed).c_str());
+            }
+            else
+            {
+                fprintf(stdout, "{\"added\":%s,\"removed\":%s,\"changed\":%s,\"signals\":%u}\n", JsonStringArray(event.added).c_str(),
+                        JsonStringArray(event.removed).c_str(), JsonStringArray(event.changed).c_str(), event.signals);
+            }
+            fflush(stdout);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                events++;
+            }
+            changed.notify_all(); });
+        watcher.SetCoalesceWindow(std::chrono::milliseconds(options.coalesceMs));
+
+        // Backends without notifications, such as DRM, are polled instead
+        std::shared_ptr<DisplayEventSource> source = backend->CreateEventSource();
+        std::shared_ptr<ManualDisplayEventSource> poller;
+        if (!source)
+        {
+            poller = std::make_shared<ManualDisplayEventSource>();
+            source = poller;
+        }
+        if (!watcher.Start(source))
+        {
+            throw std::runtime_error("cannot listen for display changes");
+        }
+
+        std::signal(SIGINT, OnInterrupt);
+        std::signal(SIGTERM, OnInterrupt);
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.timeoutMs);
+        auto nextPoll = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.intervalMs);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!interrupted.load() && (options.count == 0 || events < options.count) &&
+                   (options.timeoutMs == 0 || std::chrono::steady_clock::now() < deadline))
+            {
+                // Wake up regularly to notice signals, which cannot notify the condition
+                changed.wait_for(lock, std::chrono::milliseconds(50));
+
+                if (poller && std::chrono::steady_clock::now() >= nextPoll)
+                {
+                    lock.unlock();
+                    poller->Raise(DisplaySignal::DevicesChanged);
+                    lock.lock();
+                    nextPoll = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.intervalMs);
+                }
+            }
+        }
+
+        watcher.Stop();
+        return kExitSuccess;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    try
+    {
+        options = ParseOptions(argc, argv);
+        if (options.command.empty() || options.command == "help")
+        {
+            fputs(kUsage, options.command.empty() ? stderr : stdout);
+            return options.command.empty() ? kExitUsage : kExitSuccess;
+        }
+
+        std::shared_ptr<DisplayBackend> backend = CreateBackend(options);
+        if (options.command == "list")
+        {
+            return List(*backend, options);
+        }
+        if (options.command == "modes")
+        {
+            return Modes(*backend, options);
+        }
+        if (options.command == "set")
+        {
+            return Set(*backend, options);
+        }
+        if (options.command == "capture")
+        {
+            return Capture(*backend, options);
+        }
+        if (options.command == "restore")
+        {
+            return Restore(*backend, options);
+        }
+        if (options.command == "watch")
+        {
+            return Watch(backend, options);
+        }
+        throw UsageError("unknown command '" + options.command + "'");
+    }
+    catch (const UsageError &e)
+    {
+        fprintf(stderr, "monitorres: %s\n\n%s", e.what(), kUsage);
+        return kExitUsage;
+    }
+    catch (const std::exception &e)
+    {
+        fprintf(stderr, "monitorres: %s\n", e.what());
+        return kExitFailure;
+    }
+}
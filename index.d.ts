@@ -70,6 +70,73 @@ export interface Resolution {
   bitsPerPixel: number;
 }
 
+/**
+ * Inclusive range of a mode field; a number means exactly that value
+ */
+export type ModeRange = number | { min?: number; max?: number };
+
+/**
+ * Ratio of width to height, as a number such as 1.78 or a string such as '16:9'
+ */
+export type AspectRatio = number | string;
+
+/**
+ * Ranges a mode must fall in; omitted fields are unconstrained
+ */
+export interface ModeConstraints {
+  width?: ModeRange;
+  height?: ModeRange;
+  refreshRate?: ModeRange;
+  bitsPerPixel?: ModeRange;
+  /** A single ratio matches within 1%, so 1366x768 counts as 16:9 */
+  aspectRatio?: AspectRatio | { min?: AspectRatio; max?: AspectRatio };
+}
+
+/**
+ * A ranking criterion. 'native' prefers the panel's native resolution and
+ * 'current' the current mode; the numeric fields prefer higher values
+ * unless order is 'asc'
+ */
+export type ModeRankField = 'native' | 'current' | 'width' | 'height' | 'area' | 'refreshRate' | 'bitsPerPixel';
+export type ModeRankKey = ModeRankField | { key: ModeRankField; order?: 'asc' | 'desc' };
+
+/**
+ * Criteria in order of precedence (at most 8); later ones only break ties of
+ * earlier ones. Defaults to ['area', 'refreshRate', 'bitsPerPixel']
+ */
+export type ModeRanking = ModeRankKey[];
+
+export interface FindBestModeOptions {
+  /** Runners-up to report, 0 to 64 (default: 4) */
+  alternatives?: number;
+}
+
+/**
+ * Result of findBestMode
+ */
+export interface BestMode {
+  mode: Resolution;
+  /** Next best modes, best first */
+  alternatives: Resolution[];
+}
+
+/**
+ * Available resolutions as columns sharing one ArrayBuffer; entry i is
+ * width[i] x height[i] @ refreshRate[i] with bitsPerPixel[i]
+ */
+export interface PackedResolutions {
+  /** Number of modes */
+  count: number;
+  /** Widths in pixels */
+  width: Uint32Array;
+  /** Heights in pixels */
+  height: Uint32Array;
+  /** Refresh rates in Hz */
+  refreshRate: Uint32Array;
+  /** Bits per pixel */
+  bitsPerPixel: Uint32Array;
+}
+
 /**
  * Position information
  */
@@ -98,6 +165,47 @@ export interface MonitorSettings {
   position: Position;
 }
 
+/**
+ * A detailed timing listed in a monitor's EDID
+ */
+export interface EdidTiming {
+  width: number;
+  height: number;
+  /** Rounded to the nearest Hz */
+  refreshRate: number;
+  pixelClockKHz: number;
+  interlaced: boolean;
+}
+
+/**
+ * Identification and timings parsed from a monitor's EDID
+ */
+export interface Edid {
+  /** Three letter PNP vendor id, e.g. GSM */
+  manufacturer: string;
+  productCode: number;
+  /** Numeric serial number, 0 if not set */
+  serialNumber: number;
+  /** Serial number descriptor, empty if not present */
+  serial: string;
+  /** Product name descriptor, empty if not present */
+  name: string;
+  /** 0 if unspecified */
+  manufactureWeek: number;
+  /** 0 if unspecified */
+  manufactureYear: number;
+  /** EDID version, e.g. "1.4" */
+  version: string;
+  /** Physical width in millimeters, 0 if unknown */
+  widthMm: number;
+  /** Physical height in millimeters, 0 if unknown */
+  heightMm: number;
+  /** The monitor's native timing */
+  preferredTiming: EdidTiming | null;
+  /** Detailed timings of the base block, CEA-861 and DisplayID extensions */
+  timings: EdidTiming[];
+}
+
 /**
  * Monitor information
  */
@@ -116,8 +224,64 @@ export interface Monitor {
   attachedToDesktop: boolean;
   /** Whether this is the primary monitor */
   primaryDevice: boolean;
-  /** Current monitor settings */
-  currentSettings: MonitorSettings;
+  /** Current monitor settings, or null if the monitor has no current mode */
+  currentSettings: MonitorSettings | null;
+  /** Parsed EDID, or null if the monitor does not report one */
+  edid: Edid | null;
+}
+
+/**
+ * A monitor of a MonitorInventoryView; fields are read from the buffer when accessed
+ */
+export interface MonitorRecordView extends Omit<Monitor, 'edid'> {
+  /** Parsed EDID without the timings list, or null if the monitor does not report one */
+  readonly edid: Omit<Edid, 'timings'> | null;
+  /** The object getAllMonitors reports, without edid.timings */
+  toJSON(): Omit<Monitor, 'edid'> & { edid: Omit<Edid, 'timings'> | null };
+}
+
+/**
+ * Read-only view over a buffer from getAllMonitorsBinary
+ */
+export interface MonitorInventoryView extends Iterable<MonitorRecordView> {
+  /** Number of monitors */
+  readonly length: number;
+  /** Low 32 bits of the getMonitorsSince generation the inventory was taken at */
+  readonly generation: number;
+  /** DataView over the buffer */
+  readonly view: DataView;
+  /** Monitor at an index, or undefined */
+  at(index: number): MonitorRecordView | undefined;
+  /** Decode a string of the string table */
+  string(index: number): string;
+  /** Decode every monitor */
+  toArray(): ReturnType<MonitorRecordView['toJSON']>[];
+}
+
+/**
+ * Every active monitor and its mode list
+ */
+export interface Inventory {
+  /** Monitors, as returned by getAllMonitors */
+  monitors: Monitor[];
+  /** Mode list of each monitor, keyed by monitor ID */
+  modes: Record<string, Resolution[]>;
+}
+
+/**
+ * Monitors that changed between two generations
+ */
+export interface MonitorChanges {
+  /** Pass this to the next getMonitorsSince call */
+  generation: number;
+  /** True if the requested generation was unknown; added then holds every monitor and callers should replace their list */
+  full: boolean;
+  /** Monitors that appeared */
+  added: Monitor[];
+  /** IDs of monitors that went away */
+  removed: string[];
+  /** Monitors whose state, mode, position or orientation changed */
+  changed: Monitor[];
 }
 
 /**
@@ -130,6 +294,90 @@ export interface DPI {
   y: number;
 }
 
+/**
+ * Counters of the mode change scheduler
+ */
+export interface ModeChangeStats {
+  /** Mode changes requested */
+  requests: number;
+  /** Mode-sets the driver applied */
+  applied: number;
+  /** Changes skipped because the monitor already ran the mode */
+  unchanged: number;
+  /** Requests folded into a later request for the same monitor */
+  coalesced: number;
+  /** Requests cancelled or timed out before their change started */
+  withdrawn: number;
+  /** Mode-sets avoided: unchanged plus coalesced */
+  elided: number;
+}
+
+/**
+ * A rectangle of the virtual desktop, in pixels
+ */
+export interface DesktopRect {
+  x: number;
+  y: number;
+  width: number;
+  height: number;
+}
+
+/**
+ * Monitor a lookup falls back to when nothing is under the point or rect
+ */
+export type MonitorFallback = 'none' | 'primary' | 'nearest';
+
+/**
+ * A monitor of the desktop layout
+ */
+export interface DesktopMonitor extends DesktopRect {
+  id: string;
+  primary: boolean;
+}
+
+/**
+ * Where the active monitors sit on the virtual desktop
+ */
+export interface DesktopLayout {
+  /** Changes whenever the layout is rebuilt, and with it what the indexes refer to */
+  generation: number;
+  /** Bounding box of every monitor */
+  bounds: DesktopRect;
+  /** Index of the primary monitor, or -1 */
+  primary: number;
+  /** Monitors in the order monitorFromPoint and monitorFromRect index them */
+  monitors: DesktopMonitor[];
+}
+
+/**
+ * Bounds, work area, scaling and mode of a monitor of the desktop layout
+ */
+export interface MonitorGeometry {
+  id: string;
+  primary: boolean;
+  /** Bounds on the virtual desktop */
+  x: number;
+  y: number;
+  width: number;
+  height: number;
+  /** Bounds less the taskbar and docked toolbars */
+  workX: number;
+  workY: number;
+  workWidth: number;
+  workHeight: number;
+  /** Effective DPI, the one applications scale for */
+  dpiX: number;
+  dpiY: number;
+  /** Physical DPI of the panel from its EDID size, or 0 if unknown */
+  rawDpiX: number;
+  rawDpiY: number;
+  /** dpiX / 96, e.g. 1.5 at 150% */
+  scaleFactor: number;
+  orientation: DisplayOrientation;
+  refreshRate: number;
+  bitsPerPixel: number;
+}
+
 /**
  * Error information
  */
@@ -140,6 +388,333 @@ export interface ErrorInfo {
   message: string;
 }
 
+/**
+ * Success information when the closest supported refresh rate was used
+ */
+export interface ClosestRefreshRateResult {
+  /** Always true */
+  success: true;
+  /** Description of the substitution */
+  message: string;
+  /** Refresh rate that was applied */
+  actualRefreshRate: number;
+}
+
+/**
+ * Options for the asynchronous set functions
+ */
+export interface ModeChangeOptions {
+  /** Reject if the change has not finished within this many milliseconds; a mode-set already running completes in the background */
+  timeout?: number;
+  /** Reject when aborted; a mode-set already running completes in the background */
+  signal?: AbortSignal;
+}
+
+/**
+ * Error information for a failed transaction commit
+ */
+export interface TransactionErrorInfo extends ErrorInfo {
+  /** Monitor that rejected its mode, if the failure was device specific */
+  monitorId?: string;
+}
+
+/**
+ * Changes for several monitors that are applied in one mode-set
+ */
+export interface DisplayTransaction {
+  /**
+   * Validate a monitor's change and stage it, replacing an earlier change for the same monitor
+   * @returns True or a closest refresh rate result if staged, error object if rejected
+   */
+  set(
+    monitorId: string,
+    width: number,
+    height: number,
+    refreshRate?: number
+  ): boolean | ClosestRefreshRateResult | ErrorInfo;
+  set(monitorId: string, constraints: ModeConstraints, ranking?: ModeRanking): boolean | ClosestRefreshRateResult | ErrorInfo;
+  /** Apply every staged change in one mode-set */
+  commit(): boolean | TransactionErrorInfo;
+  /** Drop every staged change */
+  discard(): void;
+  /** Number of staged changes */
+  readonly size: number;
+}
+
+/**
+ * Counters of the simulated display backend
+ */
+export interface SimulatedBackendStats {
+  /** Immediate mode-sets */
+  modeSets: number;
+  /** Changes staged by transactions */
+  stagedModes: number;
+  /** Transaction commits */
+  commits: number;
+}
+
+/**
+ * Counters of the mode list cache
+ */
+export interface ModeCacheStats {
+  /** Lookups answered from the cache */
+  hits: number;
+  /** Lookups that had to enumerate the device's modes */
+  misses: number;
+  /** Lookups that waited for an enumeration another thread had already started */
+  coalesced: number;
+  /** Number of invalidations */
+  invalidations: number;
+  /** Mode lists currently cached */
+  entries: number;
+  /** Counters of the mode cache file, or null if none is set */
+  file: ModeCacheFileStats | null;
+}
+
+/**
+ * Counters of the mode cache file
+ */
+export interface ModeCacheFileStats {
+  /** Path passed to setModeCacheFile */
+  path: string;
+  /** Mode lists in the file */
+  entries: number;
+  /** Lookups answered from the file; the first for a list copies it out of the mapping */
+  hits: number;
+  /** Lookups with no entry or one whose monitor, orientation or driver changed */
+  misses: number;
+  /** Times the file was rewritten */
+  writes: number;
+  /** Files that were corrupt or could not be written */
+  errors: number;
+}
+
+/**
+ * Latencies of one export or phase. Percentiles are the upper bounds of
+ * power of two buckets, so they are accurate to within a factor of two.
+ */
+export interface LatencyStats {
+  count: number;
+  totalNs: number;
+  meanNs: number;
+  maxNs: number;
+  p50Ns: number;
+  p90Ns: number;
+  p99Ns: number;
+  /** Non-empty buckets as [upper bound in ns, count] */
+  buckets: [number, number][];
+}
+
+export interface AddonStats {
+  /** Per export, from entry to return; only exports called since the last reset */
+  exports: Record<string, LatencyStats>;
+  /** Native work inside exports: enumerateModes, planModeChange, applyMode, commitTransaction, restoreTopology, takeMonitorSnapshot, takeInventory, readEdid, readModeBatch, buildDesktopLayout, readDisplayGeometry, writeMonitorsBinary, reconcile */
+  phases: Record<string, LatencyStats>;
+  /** Backend calls; the simulated and DRM backends count the operation that stands in for each */
+  osCalls: {
+    EnumDisplayDevices: number;
+    EnumDisplaySettings: number;
+    ChangeDisplaySettingsEx: number;
+    GetDC: number;
+    GetMonitorInfo: number;
+  };
+  /** JS objects and arrays the addon created */
+  jsObjects: number;
+  /** Whether startTrace is recording */
+  tracing: boolean;
+}
+
+export interface TraceOptions {
+  /** Spans to keep; later ones are dropped and counted in otherData.droppedEvents (default: 100000) */
+  maxEvents?: number;
+}
+
+/**
+ * A mode of a simulated monitor
+ */
+export interface SimulatedMode {
+  width: number;
+  height: number;
+  refreshRate: number;
+  /** Defaults to 32 */
+  bitsPerPixel?: number;
+}
+
+/**
+ * A simulated monitor
+ */
+export interface SimulatedMonitor extends SimulatedMode {
+  /** Defaults to \\.\DISPLAYn */
+  id?: string;
+  name?: string;
+  /** Defaults to true for the first monitor */
+  primary?: boolean;
+  position?: Position;
+  /** Supported modes; defaults to just the current one */
+  modes?: SimulatedMode[];
+  /** Raw EDID reported by the monitor */
+  edid?: Uint8Array;
+  /** Effective DPI; defaults to the backend's dpi */
+  dpi?: DPI;
+  /** Panel DPI; defaults to the one the EDID's image size gives */
+  rawDpi?: DPI;
+  /** Pixels the taskbar takes from each edge of the work area */
+  workAreaInsets?: { left?: number; top?: number; right?: number; bottom?: number };
+}
+
+/**
+ * Options for the simulated display backend
+ */
+export interface SimulatedBackendOptions {
+  /** Defaults to one 1920x1080 display */
+  monitors?: SimulatedMonitor[];
+  /** Generate this many monitors (1-16) instead of listing them */
+  monitorCount?: number;
+  /** Modes listed by each generated monitor (10-10000) */
+  modeCount?: number;
+  /** Time each mode-set blocks, in milliseconds */
+  applyLatencyMs?: number;
+  /** Time reading a monitor's mode list blocks before its first mode, in milliseconds */
+  modeListLatencyMs?: number;
+  /** Raw display messages raised by each mode-set, 2 by default */
+  signalsPerModeSet?: number;
+  dpi?: DPI;
+}
+
+/**
+ * Summary of a finished backend recording
+ */
+export interface BackendRecording {
+  /** Trace file that was written */
+  path: string;
+  /** Backend calls recorded */
+  calls: number;
+  /** Size of the trace file */
+  bytes: number;
+  /** Failed writes; the trace is incomplete if any */
+  errors: number;
+}
+
+/**
+ * Options for the replay display backend
+ */
+export interface ReplayBackendOptions {
+  /** Sleep for the recorded duration of each call, false by default */
+  latency?: boolean;
+}
+
+/**
+ * Counters of the replay display backend
+ */
+export interface ReplayBackendStats {
+  /** Calls recorded in the trace */
+  records: number;
+  /** Calls answered from the trace */
+  calls: number;
+  /** Calls the trace holds no answer for, which failed */
+  unanswered: number;
+}
+
+/**
+ * Options for the DRM display backend
+ */
+export interface DrmBackendOptions {
+  /** Directory holding the card*-* connectors, /sys/class/drm by default */
+  sysfsRoot?: string;
+}
+
+/**
+ * Display changes coalesced from one burst of display messages
+ */
+export interface DisplayChangeEvent {
+  /** IDs of all monitors after the change */
+  ids: string[];
+  /** Monitors that were connected */
+  added: string[];
+  /** Monitors that were disconnected */
+  removed: string[];
+  /** Monitors whose mode, position or orientation changed */
+  changed: string[];
+  /** Number of raw display messages coalesced into this event */
+  signals: number;
+}
+
+/**
+ * The state setDesiredState keeps a monitor in; omitted fields are not reconciled
+ */
+export interface DesiredState {
+  width: number;
+  height: number;
+  /** Compared only when given; a correction otherwise uses the supported rate closest to the current one */
+  refreshRate?: number;
+  position?: Position;
+  primary?: boolean;
+}
+
+/**
+ * Timing of the reconciler; omitted fields take their defaults
+ */
+export interface ReconcilerOptions {
+  /** How often monitors are checked when no display message arrives (default: 1000) */
+  intervalMs?: number;
+  /** Wait before retrying a monitor whose correction failed, doubling per further failure (default: 1000) */
+  minBackoffMs?: number;
+  /** Longest wait between retries (default: 60000) */
+  maxBackoffMs?: number;
+  /** Corrections of one monitor allowed in any 60 second window (default: 6) */
+  maxCorrectionsPerMinute?: number;
+}
+
+/**
+ * What the reconciler did about a monitor that drifted from its desired state
+ */
+export interface ReconcileEvent {
+  /** corrected: the desired state was applied; failed: it was rejected and is retried later; rateLimited: the monitor drifted again after maxCorrectionsPerMinute corrections */
+  type: 'corrected' | 'failed' | 'rateLimited';
+  id: string;
+  /** State the monitor drifted to */
+  from: MonitorSettings;
+  /** State the monitor was put back in */
+  to: MonitorSettings;
+  /** Result code of the mode-set; DISP_CHANGE_SUCCESSFUL (0) unless type is failed */
+  code: number;
+  message: string;
+  /** Consecutive failed corrections of the monitor */
+  failures: number;
+  /** Milliseconds until the monitor is corrected again; 0 when type is corrected */
+  retryAfter: number;
+}
+
+/**
+ * Counters of the reconciler, over every time it ran
+ */
+export interface ReconcilerStats {
+  /** Monitors with a desired state */
+  devices: number;
+  /** Checks of all monitors with a desired state */
+  passes: number;
+  /** Monitors found drifted, counted once per pass */
+  drifted: number;
+  corrected: number;
+  failed: number;
+  /** Drifted monitors left alone because of maxCorrectionsPerMinute */
+  rateLimited: number;
+  /** Drifted monitors left alone while backing off after a failure */
+  backedOff: number;
+}
+
+/**
+ * Changes injected into the simulated backend
+ */
+export interface SimulatedDisplayChange {
+  /** Raw display messages to send; 1 by default, also when no options are passed */
+  signals?: number;
+  /** Monitor to hotplug, replacing one with the same ID; sends a device change message of its own */
+  connect?: SimulatedMonitor;
+  /** ID of the monitor to unplug; sends a device change message of its own */
+  disconnect?: string;
+}
+
 /**
  * Get the current screen resolution of the primary display
  * @returns Object containing width, height, refreshRate, and bitsPerPixel
@@ -157,13 +732,93 @@ export function setAllScreenResolutions(
   width: number,
   height: number,
   refreshRate?: number
-): boolean | ErrorInfo;
+): boolean | ClosestRefreshRateResult | ErrorInfo;
+
+/**
+ * Set all screens to the best mode of the primary display that satisfies constraints
+ * @param constraints - Ranges the mode must fall in
+ * @param ranking - Preference order among matching modes
+ * @returns True if successful, or error object with details if failed or if no mode matches
+ */
+export function setAllScreenResolutions(
+  constraints: ModeConstraints,
+  ranking?: ModeRanking
+): boolean | ClosestRefreshRateResult | ErrorInfo;
+
+/**
+ * Set the resolution for all screens without blocking the event loop
+ * @param width - The width in pixels
+ * @param height - The height in pixels
+ * @param refreshRate - The refresh rate in Hz (optional, default: current refresh rate)
+ * @param options - Timeout and cancellation
+ * @returns Promise resolving with the same values as setAllScreenResolutions
+ */
+export function setAllScreenResolutionsAsync(
+  width: number,
+  height: number,
+  refreshRate?: number,
+  options?: ModeChangeOptions
+): Promise<boolean | ClosestRefreshRateResult | ErrorInfo>;
+export function setAllScreenResolutionsAsync(
+  constraints: ModeConstraints,
+  ranking?: ModeRanking,
+  options?: ModeChangeOptions
+): Promise<boolean | ClosestRefreshRateResult | ErrorInfo>;
+
+/**
+ * Monitor field paths getAllMonitors can build: a top-level field, a field of
+ * currentSettings, currentSettings.position or edid, or a whole nested object
+ */
+export type MonitorField =
+  | keyof Monitor
+  | `currentSettings.${Exclude<keyof MonitorSettings, 'position'>}`
+  | 'currentSettings.position'
+  | 'currentSettings.position.x'
+  | 'currentSettings.position.y'
+  | `edid.${keyof Edid}`;
+
+/**
+ * Options for getAllMonitors
+ */
+export interface GetAllMonitorsOptions {
+  /**
+   * Fields to build, e.g. ['id', 'currentSettings.width']. Other fields are
+   * left out, and the EDID is not read unless an edid field is requested
+   */
+  fields?: MonitorField[];
+}
 
 /**
  * Get information about all connected monitors
+ * @param options - Fields to build
  * @returns Array of monitor objects with details
  */
 export function getAllMonitors(): Monitor[];
+export function getAllMonitors(options: GetAllMonitorsOptions): Partial<Monitor>[];
+
+/**
+ * Get every connected monitor with its EDID as one transferable ArrayBuffer in a
+ * versioned fixed layout with a string table, without building JS objects
+ */
+export function getAllMonitorsBinary(): ArrayBuffer;
+
+/**
+ * Wrap a buffer from getAllMonitorsBinary in a view that reads fields only when accessed
+ * @throws If the buffer is not an inventory, is truncated or has an unsupported version
+ */
+export function decodeMonitorsBinary(buffer: ArrayBuffer | ArrayBufferView): MonitorInventoryView;
+
+/**
+ * Get the monitors that changed since an earlier call
+ * @param generation - Generation returned by the previous call; 0 or omitted for everything
+ * @returns null if nothing changed since generation
+ */
+export function getMonitorsSince(generation?: number): MonitorChanges | null;
+
+/**
+ * Get every active monitor and its mode list, reading the monitors in parallel off the JS thread
+ */
+export function getFullInventory(): Promise<Inventory>;
 
 /**
  * Set the resolution for a specific monitor
@@ -178,7 +833,43 @@ export function setMonitorResolution(
   width: number,
   height: number,
   refreshRate?: number
-): boolean | ErrorInfo;
+): boolean | ClosestRefreshRateResult | ErrorInfo;
+
+/**
+ * Set a monitor to its best mode that satisfies constraints
+ * @param monitorId - The monitor ID (from getAllMonitors)
+ * @param constraints - Ranges the mode must fall in
+ * @param ranking - Preference order among matching modes
+ * @returns True if successful, or error object with details if failed or if no mode matches
+ */
+export function setMonitorResolution(
+  monitorId: string,
+  constraints: ModeConstraints,
+  ranking?: ModeRanking
+): boolean | ClosestRefreshRateResult | ErrorInfo;
+
+/**
+ * Set the resolution for a specific monitor without blocking the event loop
+ * @param monitorId - The monitor ID (from getAllMonitors)
+ * @param width - The width in pixels
+ * @param height - The height in pixels
+ * @param refreshRate - The refresh rate in Hz (optional, default: current refresh rate)
+ * @param options - Timeout and cancellation
+ * @returns Promise resolving with the same values as setMonitorResolution
+ */
+export function setMonitorResolutionAsync(
+  monitorId: string,
+  width: number,
+  height: number,
+  refreshRate?: number,
+  options?: ModeChangeOptions
+): Promise<boolean | ClosestRefreshRateResult | ErrorInfo>;
+export function setMonitorResolutionAsync(
+  monitorId: string,
+  constraints: ModeConstraints,
+  ranking?: ModeRanking,
+  options?: ModeChangeOptions
+): Promise<boolean | ClosestRefreshRateResult | ErrorInfo>;
 
 /**
  * Get the current resolution of a specific monitor
@@ -187,6 +878,21 @@ export function setMonitorResolution(
  */
 export function getMonitorResolution(monitorId: string): Resolution;
 
+/**
+ * Find the modes of a monitor that best satisfy constraints, using its cached mode table
+ * @param monitorId - The monitor ID (from getAllMonitors)
+ * @param constraints - Ranges the mode must fall in
+ * @param ranking - Preference order among matching modes
+ * @param options - Number of alternatives to report
+ * @returns The best mode and the runners-up, or null if no mode matches
+ */
+export function findBestMode(
+  monitorId: string,
+  constraints: ModeConstraints,
+  ranking?: ModeRanking,
+  options?: FindBestModeOptions
+): BestMode | null;
+
 /**
  * Get all available resolutions for a specific monitor
  * @param monitorId - The monitor ID (from getAllMonitors)
@@ -194,8 +900,252 @@ export function getMonitorResolution(monitorId: string): Resolution;
  */
 export function getAvailableResolutions(monitorId: string): Resolution[];
 
+/**
+ * Options for iterateModes
+ */
+export interface IterateModesOptions {
+  /** Modes read per native call, from 1 to 65536; 256 by default */
+  batchSize?: number;
+}
+
+/**
+ * Iterate over the modes of a monitor without reading the whole list first.
+ * Modes are read in batches off the JS thread; leaving the loop early stops the enumeration.
+ * @param monitorId - The monitor ID (from getAllMonitors)
+ * @param options - Batch size
+ * @returns The modes getAvailableResolutions returns, in the same order
+ */
+export function iterateModes(monitorId: string, options?: IterateModesOptions): AsyncIterableIterator<Resolution>;
+
+/**
+ * Get all available resolutions for a specific monitor as typed array columns
+ * @param monitorId - The monitor ID (from getAllMonitors)
+ * @returns Columns sorted by width, height, refresh rate and bits per pixel
+ */
+export function getAvailableResolutionsPacked(monitorId: string): PackedResolutions;
+
 /**
  * Get the system DPI settings
  * @returns Object containing x and y DPI values
  */
-export function getSystemDPI(): DPI; 
\ No newline at end of file
+export function getSystemDPI(): DPI;
+
+/**
+ * Find the monitor containing a point of the virtual desktop
+ * @param x - Desktop x coordinate
+ * @param y - Desktop y coordinate
+ * @param policy - Monitor to fall back to outside every monitor; 'none' by default
+ * @returns Index into getDesktopLayout().monitors, or -1 if none
+ */
+export function monitorFromPoint(x: number, y: number, policy?: MonitorFallback): number;
+
+/**
+ * Find the monitor sharing the largest area with a rect of the virtual desktop
+ * @param rect - Rect to look up; an empty one is looked up as its top left corner
+ * @param policy - Monitor to fall back to outside every monitor; 'none' by default
+ * @returns Index into getDesktopLayout().monitors, or -1 if none
+ */
+export function monitorFromRect(rect: DesktopRect, policy?: MonitorFallback): number;
+
+/**
+ * Get the monitors monitorFromPoint and monitorFromRect index into, and the desktop's bounding box
+ */
+export function getDesktopLayout(): DesktopLayout;
+
+/**
+ * Get the bounds, work area, DPI and mode of every monitor in one call, in the order of getDesktopLayout().monitors
+ */
+export function getDisplayGeometry(): MonitorGeometry[];
+
+/**
+ * Start a transaction that applies changes to several monitors in one mode-set
+ */
+export function beginDisplayTransaction(): DisplayTransaction;
+
+/**
+ * Outcome of a successful restoreTopology
+ */
+export interface TopologyRestoreResult {
+  /** Monitors whose state differed and was applied */
+  changed: string[];
+  /** Monitors of the topology that are not active any more; they are skipped */
+  missing: string[];
+}
+
+/**
+ * Capture every active monitor's mode, orientation, position and primary flag
+ * @returns Versioned, checksummed blob of about 20 bytes per monitor
+ */
+export function captureTopology(): Buffer;
+
+/**
+ * Restore a topology captured by captureTopology, applying only the monitors
+ * whose live state differs in a single mode-set
+ * @param topology - Blob returned by captureTopology
+ * @returns The monitors changed and missing, or error object if a monitor rejected its state
+ */
+export function restoreTopology(topology: Buffer | Uint8Array): TopologyRestoreResult | TransactionErrorInfo;
+
+/**
+ * Subscribe to display changes (monitors added, removed, or changing mode, position or orientation)
+ * @param eventName - 'change'
+ * @param listener - Called once per burst of display messages
+ */
+export function on(eventName: 'change', listener: (event: DisplayChangeEvent) => void): typeof import('.');
+
+/**
+ * Subscribe to what the reconciler did about monitors that drifted from their desired state
+ * @param eventName - 'reconcile'
+ * @param listener - Called once per corrected, failed or rate limited monitor
+ */
+export function on(eventName: 'reconcile', listener: (event: ReconcileEvent) => void): typeof import('.');
+
+/**
+ * Unsubscribe from display changes
+ * @param eventName - 'change'
+ * @param listener - Listener passed to on()
+ */
+export function off(eventName: 'change', listener: (event: DisplayChangeEvent) => void): typeof import('.');
+
+/**
+ * Unsubscribe from reconciler events
+ * @param eventName - 'reconcile'
+ * @param listener - Listener passed to on()
+ */
+export function off(eventName: 'reconcile', listener: (event: ReconcileEvent) => void): typeof import('.');
+
+/**
+ * Set how long display messages must stop arriving before a change event is emitted
+ * @param milliseconds - Quiet period, 250 by default
+ */
+export function setDisplayChangeCoalescing(milliseconds: number): void;
+
+/**
+ * Keep a monitor in a mode. A native reconciler checks it after display
+ * messages and every intervalMs, and puts it back whenever it drifts.
+ * @param monitorId - Monitor ID from getAllMonitors
+ * @param state - Mode, position and primary flag to keep
+ * @throws If the monitor does not support the mode
+ */
+export function setDesiredState(monitorId: string, state: DesiredState): void;
+
+/**
+ * Stop keeping a monitor in its desired state; the reconciler stops with the last monitor
+ * @param monitorId - Monitor to release; every monitor if omitted
+ */
+export function clearDesiredState(monitorId?: string): void;
+
+/**
+ * Set how often the reconciler checks monitors, how it backs off and how often it may correct a monitor
+ */
+export function setReconcilerOptions(options: ReconcilerOptions): void;
+
+/**
+ * Get the counters of the reconciler
+ */
+export function getReconcilerStats(): ReconcilerStats;
+
+/**
+ * Drop cached mode lists so the next query re-enumerates them
+ * @param monitorId - Only drop this monitor's list (optional)
+ */
+export function invalidateModeCache(monitorId?: string): void;
+
+/**
+ * Get the counters of the mode list cache
+ */
+export function getModeCacheStats(): ModeCacheStats;
+
+/**
+ * Set how long an async mode change waits for more changes to the same monitor, applying only the last
+ * @param milliseconds - Coalescing window, 0 by default
+ */
+export function setModeChangeCoalescing(milliseconds: number): void;
+
+/**
+ * Get the counters of the mode change scheduler
+ */
+export function getModeChangeStats(): ModeChangeStats;
+
+/**
+ * Persist mode lists to a file that later processes read instead of enumerating modes
+ * @param path - File to use, or null to stop using one
+ * @returns True if the file existed and was loaded
+ */
+export function setModeCacheFile(path: string | null): boolean;
+
+/**
+ * Get latency histograms per export and per native phase, OS call counts and JS objects created
+ * @returns null if the addon was built with --monitorres_stats=0
+ */
+export function getStats(): AddonStats | null;
+
+/**
+ * Zero the histograms and counters reported by getStats
+ */
+export function resetStats(): void;
+
+/**
+ * Start recording every timed export and phase for stopTrace
+ * @param options - Number of spans to keep
+ * @returns False if the addon was built with --monitorres_stats=0
+ */
+export function startTrace(options?: TraceOptions): boolean;
+
+/**
+ * Stop recording and get the spans as Chrome trace event JSON, for chrome://tracing or Perfetto
+ * @returns The trace, or null if no trace was running
+ */
+export function stopTrace(): string | null;
+
+/**
+ * Replace the system display backend with a simulated one
+ * @param options - Simulated monitors, mode-set latency and DPI
+ */
+export function useSimulatedBackend(options?: SimulatedBackendOptions): void;
+
+/**
+ * Switch back to the display backend of the platform
+ */
+export function useSystemBackend(): void;
+
+/**
+ * Read monitors from the DRM connectors in sysfs (Linux only)
+ * @param options - Directory to read the connectors from
+ */
+export function useDrmBackend(options?: DrmBackendOptions): void;
+
+/**
+ * Inject display changes into the active simulated backend
+ * @param change - Raw messages, a monitor to hotplug or a monitor to unplug; one raw
+ *   message is sent unless `signals` says otherwise
+ */
+export function simulateDisplayChange(change?: SimulatedDisplayChange): void;
+
+/**
+ * Get the counters of the active simulated backend
+ */
+export function getSimulatedBackendStats(): SimulatedBackendStats;
+
+/**
+ * Record every call to the active backend, with its results and timing, into a trace file
+ * @param path - File to write the trace to
+ */
+export function startBackendRecording(path: string): void;
+
+/**
+ * Finish the trace file and go back to the backend that was recorded
+ */
+export function stopBackendRecording(): BackendRecording;
+
+/**
+ * Replace the system display backend with one answering from a trace file
+ * @param path - Trace written by startBackendRecording
+ * @param options - Whether to replay the recorded latencies
+ */
+export function useReplayBackend(path: string, options?: ReplayBackendOptions): void;
+
+/**
+ * Get the counters of the active replay backend
+ */
+export function getReplayBackendStats(): ReplayBackendStats;
@@ -9,6 +9,256 @@
 // Load the binary module
 const binary = require('./build/Release/monitorres.node');
 
+// Listeners registered through on('change'); the native watcher runs while there is at least one
+const changeListeners = new Set();
+
+function dispatchChange(event) {
+  for (const listener of Array.from(changeListeners)) {
+    listener(event);
+  }
+}
+
+// Listeners registered through on('reconcile'); the native reconciler runs while a monitor has a desired state
+const reconcileListeners = new Set();
+
+function dispatchReconcile(event) {
+  for (const listener of Array.from(reconcileListeners)) {
+    listener(event);
+  }
+}
+
+function checkEventName(eventName) {
+  if (eventName !== 'change' && eventName !== 'reconcile') {
+    throw new TypeError(`Unknown event "${eventName}". Only "change" and "reconcile" are supported`);
+  }
+}
+
+// Projections compiled from getAllMonitors field lists, keyed by the joined paths
+const monitorProjections = new Map();
+const kMaxMonitorProjections = 64;
+
+function getAllMonitors(options) {
+  if (options == null || options.fields === undefined) {
+    return binary.getAllMonitors();
+  }
+
+  const fields = options.fields;
+  const key = Array.isArray(fields) ? fields.join('\n') : null;
+  let projection = key === null ? undefined : monitorProjections.get(key);
+  if (projection === undefined) {
+    projection = binary.compileMonitorFields(fields);
+    if (monitorProjections.size >= kMaxMonitorProjections) {
+      monitorProjections.clear();
+    }
+    monitorProjections.set(key, projection);
+  }
+
+  return binary.getAllMonitors(projection);
+}
+
+// Modes are read in batches from a native cursor as the loop asks for them;
+// leaving the loop early closes the cursor, which stops the enumeration
+async function* iterateModes(monitorId, options) {
+  const cursor = new binary.ModeCursor(monitorId, options);
+  try {
+    for (;;) {
+      const batch = await cursor.next();
+      if (batch === null) {
+        return;
+      }
+      yield* batch;
+    }
+  } finally {
+    cursor.close();
+  }
+}
+
+// Layout of the buffers getAllMonitorsBinary returns; src/monitor_binary.h documents it
+const kMonitorBinaryMagic = 0x494d524d; // 'MRMI' read as a little-endian u32
+const kMonitorBinaryVersion = 1;
+const kMonitorBinaryHeaderSize = 32;
+// Records may grow within a version; this is the size fields are read from
+const kMonitorBinaryRecordSize = 112;
+const kBinaryHasMode = 0x01;
+const kBinaryHasEdid = 0x02;
+const kBinaryPrimary = 0x04;
+const kBinaryAttached = 0x08;
+const kBinaryHasPreferredTiming = 0x10;
+const kBinaryPreferredInterlaced = 0x20;
+
+const utf8Decoder = new TextDecoder();
+
+// A monitor of a MonitorInventoryView. Each field is read from the buffer
+// when it is accessed, so consumers only pay for what they read
+class MonitorRecordView {
+  #inventory;
+  #view;
+  #offset;
+
+  constructor(inventory, offset) {
+    this.#inventory = inventory;
+    this.#view = inventory.view;
+    this.#offset = offset;
+  }
+
+  get id() { return this.#inventory.string(this.#view.getUint32(this.#offset, true)); }
+  get name() { return this.#inventory.string(this.#view.getUint32(this.#offset + 4, true)); }
+  get deviceId() { return this.#inventory.string(this.#view.getUint32(this.#offset + 8, true)); }
+  get deviceKey() { return this.#inventory.string(this.#view.getUint32(this.#offset + 12, true)); }
+  get stateFlags() { return this.#view.getUint32(this.#offset + 16, true); }
+  get attachedToDesktop() { return (this.#view.getUint32(this.#offset + 20, true) & kBinaryAttached) !== 0; }
+  get primaryDevice() { return (this.#view.getUint32(this.#offset + 20, true) & kBinaryPrimary) !== 0; }
+
+  get currentSettings() {
+    if (!(this.#view.getUint32(this.#offset + 20, true) & kBinaryHasMode)) {
+      return null;
+    }
+    return {
+      width: this.#view.getUint32(this.#offset + 24, true),
+      height: this.#view.getUint32(this.#offset + 28, true),
+      refreshRate: this.#view.getUint32(this.#offset + 32, true),
+      bitsPerPixel: this.#view.getUint32(this.#offset + 36, true),
+      orientation: this.#view.getUint32(this.#offset + 40, true),
+      position: { x: this.#view.getInt32(this.#offset + 44, true), y: this.#view.getInt32(this.#offset + 48, true) },
+    };
+  }
+
+  get edid() {
+    const flags = this.#view.getUint32(this.#offset + 20, true);
+    if (!(flags & kBinaryHasEdid)) {
+      return null;
+    }
+    const version = this.#view.getUint32(this.#offset + 80, true);
+    return {
+      manufacturer: this.#inventory.string(this.#view.getUint32(this.#offset + 52, true)),
+      productCode: this.#view.getUint32(this.#offset + 64, true),
+      serialNumber: this.#view.getUint32(this.#offset + 68, true),
+      serial: this.#inventory.string(this.#view.getUint32(this.#offset + 60, true)),
+      name: this.#inventory.string(this.#view.getUint32(this.#offset + 56, true)),
+      manufactureWeek: this.#view.getUint32(this.#offset + 72, true),
+      manufactureYear: this.#view.getUint32(this.#offset + 76, true),
+      version: `${version >> 8}.${version & 0xff}`,
+      widthMm: this.#view.getUint32(this.#offset + 84, true),
+      heightMm: this.#view.getUint32(this.#offset + 88, true),
+      preferredTiming: flags & kBinaryHasPreferredTiming ? {
+        width: this.#view.getUint32(this.#offset + 92, true),
+        height: this.#view.getUint32(this.#offset + 96, true),
+        refreshRate: this.#view.getUint32(this.#offset + 100, true),
+        pixelClockKHz: this.#view.getUint32(this.#offset + 104, true),
+        interlaced: (flags & kBinaryPreferredInterlaced) !== 0,
+      } : null,
+    };
+  }
+
+  // The object getAllMonitors reports, without edid.timings
+  toJSON() {
+    return {
+      id: this.id,
+      name: this.name,
+      deviceId: this.deviceId,
+      deviceKey: this.deviceKey,
+      stateFlags: this.stateFlags,
+      attachedToDesktop: this.attachedToDesktop,
+      primaryDevice: this.primaryDevice,
+      currentSettings: this.currentSettings,
+      edid: this.edid,
+    };
+  }
+}
+
+// Read-only view over a buffer from getAllMonitorsBinary. Nothing is decoded
+// up front; strings are decoded on first access and then reused
+class MonitorInventoryView {
+  #bytes;
+  #recordSize;
+  #recordsOffset;
+  #stringCount;
+  #offsetsStart;
+  #bytesStart;
+  #strings;
+
+  constructor(buffer) {
+    const bytes = ArrayBuffer.isView(buffer)
+      ? new Uint8Array(buffer.buffer, buffer.byteOffset, buffer.byteLength)
+      : new Uint8Array(buffer);
+    const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+    if (bytes.byteLength < kMonitorBinaryHeaderSize || view.getUint32(0, true) !== kMonitorBinaryMagic) {
+      throw new TypeError('Not a monitor inventory buffer');
+    }
+
+    const version = view.getUint16(4, true);
+    if (version !== kMonitorBinaryVersion) {
+      throw new Error(`Unsupported monitor inventory version ${version}`);
+    }
+
+    const length = view.getUint32(8, true);
+    const recordSize = view.getUint32(12, true);
+    const recordsOffset = view.getUint32(16, true);
+    const stringsOffset = view.getUint32(20, true);
+    if (view.getUint32(24, true) > bytes.byteLength || recordSize < kMonitorBinaryRecordSize ||
+        recordsOffset + length * recordSize > stringsOffset || stringsOffset + 4 > bytes.byteLength) {
+      throw new Error('Monitor inventory buffer is truncated');
+    }
+
+    const stringCount = view.getUint32(stringsOffset, true);
+    const bytesStart = stringsOffset + 4 + (stringCount + 1) * 4;
+    if (bytesStart > bytes.byteLength || bytesStart + view.getUint32(bytesStart - 4, true) > bytes.byteLength) {
+      throw new Error('Monitor inventory buffer is truncated');
+    }
+
+    /** DataView over the buffer, for readers of fields this view does not expose */
+    this.view = view;
+    /** Number of monitors */
+    this.length = length;
+    /** Low 32 bits of the getMonitorsSince generation the inventory was taken at */
+    this.generation = view.getUint32(28, true);
+    this.#bytes = bytes;
+    this.#recordSize = recordSize;
+    this.#recordsOffset = recordsOffset;
+    this.#stringCount = stringCount;
+    this.#offsetsStart = stringsOffset + 4;
+    this.#bytesStart = bytesStart;
+    this.#strings = new Array(stringCount);
+  }
+
+  // Decode string index of the string table
+  string(index) {
+    if (index >= this.#stringCount) {
+      throw new RangeError(`String ${index} is not in the string table`);
+    }
+    let value = this.#strings[index];
+    if (value === undefined) {
+      const start = this.view.getUint32(this.#offsetsStart + index * 4, true);
+      const end = this.view.getUint32(this.#offsetsStart + index * 4 + 4, true);
+      value = utf8Decoder.decode(this.#bytes.subarray(this.#bytesStart + start, this.#bytesStart + end));
+      this.#strings[index] = value;
+    }
+    return value;
+  }
+
+  at(index) {
+    if (!(index >= 0 && index < this.length)) {
+      return undefined;
+    }
+    return new MonitorRecordView(this, this.#recordsOffset + Math.floor(index) * this.#recordSize);
+  }
+
+  *[Symbol.iterator]() {
+    for (let i = 0; i < this.length; i++) {
+      yield this.at(i);
+    }
+  }
+
+  // Decode every monitor into the objects getAllMonitors reports
+  toArray() {
+    return Array.from(this, (monitor) => monitor.toJSON());
+  }
+}
+
+function decodeMonitorsBinary(buffer) {
+  return new MonitorInventoryView(buffer);
+}
+
 // Export the API with documentation
 module.exports = {
   /**
@@ -18,7 +268,8 @@ module.exports = {
   getScreenResolution: binary.getScreenResolution,
 
   /**
-   * Set the resolution for all screens
+   * Set the resolution for all screens. Pass (constraints, [ranking]) instead of
+   * the numbers to use the best matching mode, as with findBestMode
    * @param {number} width - The width in pixels
    * @param {number} height - The height in pixels
    * @param {number} [refreshRate=60] - The refresh rate in Hz (optional)
@@ -26,14 +277,52 @@ module.exports = {
    */
   setAllScreenResolutions: binary.setAllScreenResolutions,
 
+  /**
+   * Set the resolution for all screens without blocking the event loop
+   * @param {number} width - The width in pixels
+   * @param {number} height - The height in pixels
+   * @param {number} [refreshRate] - The refresh rate in Hz (optional)
+   * @param {Object} [options] - { timeout: milliseconds, signal: AbortSignal }
+   * @returns {Promise<boolean|Object>} Resolves with the same values as setAllScreenResolutions
+   */
+  setAllScreenResolutionsAsync: binary.setAllScreenResolutionsAsync,
+
   /**
    * Get information about all connected monitors
+   * @param {Object} [options] - { fields: paths such as 'id' or 'currentSettings.width' to build only those fields }
    * @returns {Array} Array of monitor objects with details
    */
-  getAllMonitors: binary.getAllMonitors,
+  getAllMonitors,
+
+  /**
+   * Get every connected monitor with its EDID as one transferable ArrayBuffer, without building JS objects
+   * @returns {ArrayBuffer} Versioned fixed-layout records with a string table; read it with decodeMonitorsBinary
+   */
+  getAllMonitorsBinary: binary.getAllMonitorsBinary,
+
+  /**
+   * Wrap a buffer from getAllMonitorsBinary in a view that reads fields only when accessed
+   * @param {ArrayBuffer|ArrayBufferView} buffer - The buffer, possibly received from another thread
+   * @returns {MonitorInventoryView} View with length, generation, at(index), iteration and toArray()
+   */
+  decodeMonitorsBinary,
 
   /**
-   * Set the resolution for a specific monitor
+   * Get the monitors that changed since an earlier call, for cheap polling
+   * @param {number} [generation] - Generation returned by the previous call; 0 or omitted for everything
+   * @returns {Object|null} null if nothing changed, otherwise { generation, full, added, removed, changed }
+   */
+  getMonitorsSince: binary.getMonitorsSince,
+
+  /**
+   * Get every active monitor and its mode list, reading the monitors in parallel off the JS thread
+   * @returns {Promise<Object>} Resolves to { monitors, modes }, where modes maps each monitor ID to its mode list
+   */
+  getFullInventory: binary.getFullInventory,
+
+  /**
+   * Set the resolution for a specific monitor. Pass (monitorId, constraints, [ranking])
+   * instead of the numbers to use the best matching mode, as with findBestMode
    * @param {string} monitorId - The monitor ID (from getAllMonitors)
    * @param {number} width - The width in pixels
    * @param {number} height - The height in pixels
@@ -42,6 +331,17 @@ module.exports = {
    */
   setMonitorResolution: binary.setMonitorResolution,
 
+  /**
+   * Set the resolution for a specific monitor without blocking the event loop
+   * @param {string} monitorId - The monitor ID (from getAllMonitors)
+   * @param {number} width - The width in pixels
+   * @param {number} height - The height in pixels
+   * @param {number} [refreshRate] - The refresh rate in Hz (optional)
+   * @param {Object} [options] - { timeout: milliseconds, signal: AbortSignal }
+   * @returns {Promise<boolean|Object>} Resolves with the same values as setMonitorResolution
+   */
+  setMonitorResolutionAsync: binary.setMonitorResolutionAsync,
+
   /**
    * Get the current resolution of a specific monitor
    * @param {string} monitorId - The monitor ID (from getAllMonitors)
@@ -49,6 +349,16 @@ module.exports = {
    */
   getMonitorResolution: binary.getMonitorResolution,
 
+  /**
+   * Find the modes of a monitor that best satisfy constraints, using its cached mode table
+   * @param {string} monitorId - The monitor ID (from getAllMonitors)
+   * @param {Object} constraints - Ranges: { width, height, refreshRate, bitsPerPixel, aspectRatio }
+   * @param {Array} [ranking] - Preference order, e.g. ['native', 'refreshRate']
+   * @param {Object} [options] - { alternatives: number of runners-up to report (default 4) }
+   * @returns {Object|null} { mode, alternatives }, or null if no mode matches
+   */
+  findBestMode: binary.findBestMode,
+
   /**
    * Get all available resolutions for a specific monitor
    * @param {string} monitorId - The monitor ID (from getAllMonitors)
@@ -56,9 +366,256 @@ module.exports = {
    */
   getAvailableResolutions: binary.getAvailableResolutions,
 
+  /**
+   * Iterate over the modes of a monitor without reading the whole list first
+   * @param {string} monitorId - The monitor ID (from getAllMonitors)
+   * @param {Object} [options] - { batchSize: modes read per native call, 256 by default }
+   * @returns {AsyncIterableIterator<Object>} The modes getAvailableResolutions returns, in the same order
+   */
+  iterateModes,
+
+  /**
+   * Get all available resolutions for a specific monitor as typed array columns
+   * @param {string} monitorId - The monitor ID (from getAllMonitors)
+   * @returns {Object} Object containing count and Uint32Array columns width, height, refreshRate and bitsPerPixel
+   */
+  getAvailableResolutionsPacked: binary.getAvailableResolutionsPacked,
+
   /**
    * Get the system DPI settings
    * @returns {Object} Object containing x and y DPI values
    */
-  getSystemDPI: binary.getSystemDPI
+  getSystemDPI: binary.getSystemDPI,
+
+  /**
+   * Find the monitor containing a point of the virtual desktop
+   * @param {number} x - Desktop x coordinate
+   * @param {number} y - Desktop y coordinate
+   * @param {string} [policy='none'] - Monitor to fall back to outside every monitor: 'none', 'primary' or 'nearest'
+   * @returns {number} Index into getDesktopLayout().monitors, or -1 if none
+   */
+  monitorFromPoint: binary.monitorFromPoint,
+
+  /**
+   * Find the monitor sharing the largest area with a rect of the virtual desktop
+   * @param {Object} rect - { x, y, width, height }
+   * @param {string} [policy='none'] - Monitor to fall back to outside every monitor: 'none', 'primary' or 'nearest'
+   * @returns {number} Index into getDesktopLayout().monitors, or -1 if none
+   */
+  monitorFromRect: binary.monitorFromRect,
+
+  /**
+   * Get the monitors monitorFromPoint and monitorFromRect index into, and the desktop's bounding box
+   * @returns {Object} { generation, bounds, primary, monitors: [{ id, x, y, width, height, primary }] }
+   */
+  getDesktopLayout: binary.getDesktopLayout,
+
+  /**
+   * Get the bounds, work area, DPI and mode of every monitor in one call
+   * @returns {Array} [{ id, primary, x, y, width, height, workX, workY, workWidth, workHeight, dpiX, dpiY, rawDpiX, rawDpiY, scaleFactor, orientation, refreshRate, bitsPerPixel }] in the order of getDesktopLayout().monitors
+   */
+  getDisplayGeometry: binary.getDisplayGeometry,
+
+  /**
+   * Start a transaction that applies changes to several monitors in one mode-set
+   * @returns {DisplayTransaction} Transaction with set(monitorId, width, height, [refreshRate]), commit() and discard()
+   */
+  beginDisplayTransaction: () => new binary.DisplayTransaction(),
+
+  /**
+   * Capture every active monitor's mode, orientation, position and primary flag as a compact blob
+   * @returns {Buffer} Versioned, checksummed topology for restoreTopology
+   */
+  captureTopology: binary.captureTopology,
+
+  /**
+   * Restore a captured topology, applying only the monitors that differ in one mode-set
+   * @param {Buffer|Uint8Array} topology - Blob returned by captureTopology
+   * @returns {Object} { changed, missing } monitor IDs, or error object with code, message and monitorId if failed
+   */
+  restoreTopology: binary.restoreTopology,
+
+  /**
+   * Subscribe to display changes (monitors added, removed, or changing mode, position or orientation),
+   * or to what the reconciler did about monitors that drifted from their desired state
+   * @param {string} eventName - 'change' or 'reconcile'
+   * @param {Function} listener - Called with { ids, added, removed, changed, signals } for 'change',
+   *   { type, id, from, to, code, message, failures, retryAfter } for 'reconcile'
+   * @returns {Object} The module, for chaining
+   */
+  on(eventName, listener) {
+    checkEventName(eventName);
+    if (typeof listener !== 'function') {
+      throw new TypeError('Listener must be a function');
+    }
+    if (eventName === 'reconcile') {
+      reconcileListeners.add(listener);
+      return module.exports;
+    }
+    if (changeListeners.size === 0) {
+      binary.startDisplayWatcher(dispatchChange);
+    }
+    changeListeners.add(listener);
+    return module.exports;
+  },
+
+  /**
+   * Unsubscribe from display changes or reconciler events
+   * @param {string} eventName - 'change' or 'reconcile'
+   * @param {Function} listener - Listener passed to on()
+   * @returns {Object} The module, for chaining
+   */
+  off(eventName, listener) {
+    checkEventName(eventName);
+    if (eventName === 'reconcile') {
+      reconcileListeners.delete(listener);
+      return module.exports;
+    }
+    if (changeListeners.delete(listener) && changeListeners.size === 0) {
+      binary.stopDisplayWatcher();
+    }
+    return module.exports;
+  },
+
+  /**
+   * Set how long display messages must stop arriving before a change event is emitted
+   * @param {number} milliseconds - Quiet period, 250 by default
+   */
+  setDisplayChangeCoalescing: binary.setDisplayChangeCoalescing,
+
+  /**
+   * Keep a monitor in a mode. A native reconciler puts it back whenever it drifts and emits 'reconcile' events.
+   * @param {string} monitorId - Monitor ID from getAllMonitors
+   * @param {Object} state - { width, height, refreshRate?, position?: { x, y }, primary? }; omitted fields are not reconciled
+   */
+  setDesiredState(monitorId, state) {
+    binary.setDesiredState(monitorId, state, dispatchReconcile);
+  },
+
+  /**
+   * Stop keeping a monitor in its desired state; the reconciler stops with the last monitor
+   * @param {string} [monitorId] - Monitor to release; every monitor if omitted
+   */
+  clearDesiredState: binary.clearDesiredState,
+
+  /**
+   * Set how often the reconciler checks monitors, how it backs off after failures and how often it may correct a monitor
+   * @param {Object} options - { intervalMs: 1000, minBackoffMs: 1000, maxBackoffMs: 60000, maxCorrectionsPerMinute: 6 }; omitted fields take these defaults
+   */
+  setReconcilerOptions: binary.setReconcilerOptions,
+
+  /**
+   * Get the counters of the reconciler
+   * @returns {Object} Object containing devices, passes, drifted, corrected, failed, rateLimited and backedOff
+   */
+  getReconcilerStats: binary.getReconcilerStats,
+
+  /**
+   * Set how long an async mode change waits for more changes to the same monitor, applying only the last
+   * @param {number} milliseconds - Coalescing window, 0 by default
+   */
+  setModeChangeCoalescing: binary.setModeChangeCoalescing,
+
+  /**
+   * Get the counters of the mode change scheduler
+   * @returns {Object} Object containing requests, applied, unchanged, coalesced, withdrawn and elided
+   */
+  getModeChangeStats: binary.getModeChangeStats,
+
+  /**
+   * Drop cached mode lists so the next query re-enumerates them
+   * @param {string} [monitorId] - Only drop this monitor's list (optional)
+   */
+  invalidateModeCache: binary.invalidateModeCache,
+
+  /**
+   * Get the counters of the mode list cache
+   * @returns {Object} Object containing hits, misses, coalesced, invalidations, entries and file
+   */
+  getModeCacheStats: binary.getModeCacheStats,
+
+  /**
+   * Persist mode lists to a file that later processes read instead of enumerating modes
+   * @param {string|null} path - File to use, or null to stop using one
+   * @returns {boolean} True if the file existed and was loaded
+   */
+  setModeCacheFile: binary.setModeCacheFile,
+
+  /**
+   * Get latency histograms per export and per native phase, OS call counts and JS objects created
+   * @returns {Object|null} { exports, phases, osCalls, jsObjects, tracing }, or null if built with --monitorres_stats=0
+   */
+  getStats: binary.getStats,
+
+  /**
+   * Zero the histograms and counters reported by getStats
+   */
+  resetStats: binary.resetStats,
+
+  /**
+   * Start recording every timed export and phase for stopTrace
+   * @param {Object} [options] - { maxEvents: spans to keep (default 100000) }
+   * @returns {boolean} False if built with --monitorres_stats=0
+   */
+  startTrace: binary.startTrace,
+
+  /**
+   * Stop recording and get the spans as Chrome trace event JSON, for chrome://tracing or Perfetto
+   * @returns {string|null} The trace, or null if no trace was running
+   */
+  stopTrace: binary.stopTrace,
+
+  /**
+   * Replace the system display backend with a simulated one
+   * @param {Object} [options] - Simulated monitors, mode-set latency and DPI
+   */
+  useSimulatedBackend: binary.useSimulatedBackend,
+
+  /**
+   * Switch back to the display backend of the platform
+   */
+  useSystemBackend: binary.useSystemBackend,
+
+  /**
+   * Read monitors from the DRM connectors in sysfs (Linux only)
+   * @param {Object} [options] - { sysfsRoot: directory holding the card*-* connectors, /sys/class/drm by default }
+   */
+  useDrmBackend: binary.useDrmBackend,
+
+  /**
+   * Inject display changes into the active simulated backend
+   * @param {Object} [options] - { signals: raw messages to send (default 1), connect: monitor to hotplug, disconnect: monitor ID to unplug }
+   */
+  simulateDisplayChange: binary.simulateDisplayChange,
+
+  /**
+   * Get the counters of the active simulated backend
+   * @returns {Object} Object containing modeSets, stagedModes and commits
+   */
+  getSimulatedBackendStats: binary.getSimulatedBackendStats,
+
+  /**
+   * Record every call to the active backend, with its results and timing, into a trace file
+   * @param {string} path - File to write the trace to
+   */
+  startBackendRecording: binary.startBackendRecording,
+
+  /**
+   * Finish the trace file and go back to the backend that was recorded
+   * @returns {Object} Object containing path, calls, bytes and errors
+   */
+  stopBackendRecording: binary.stopBackendRecording,
+
+  /**
+   * Replace the system display backend with one answering from a trace file
+   * @param {string} path - Trace written by startBackendRecording
+   * @param {Object} [options] - { latency: sleep for the recorded duration of each call }
+   */
+  useReplayBackend: binary.useReplayBackend,
+
+  /**
+   * Get the counters of the active replay backend
+   * @returns {Object} Object containing records, calls and unanswered
+   */
+  getReplayBackendStats: binary.getReplayBackendStats
 };
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "allocation_counters.h"
+
+#ifdef MONITORRES_ALLOCATION_COUNTERS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new of the module. On Linux binding.gyp links
+// with -Bsymbolic-functions so the addon binds to these instead of the C++
+// runtime Node already loaded, and Node's own allocations are not counted.
+
+namespace
+{
+    std::atomic<uint64_t> allocationCount(0);
+    std::atomic<uint64_t> allocationBytes(0);
+
+    void *CountedAllocate(size_t size)
+    {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add(size, std::memory_order_relaxed);
+        return malloc(size == 0 ? 1 : size);
+    }
+}
+
+void *operator new(size_t size)
+{
+    void *p = CountedAllocate(size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace monitorres
+{
+    AllocationCounters GetAllocationCounters()
+    {
+        AllocationCounters counters;
+        counters.allocations = allocationCount.load(std::memory_order_relaxed);
+        counters.bytes = allocationBytes.load(std::memory_order_relaxed);
+        return counters;
+    }
+}
+
+#else
+
+namespace monitorres
+{
+    AllocationCounters GetAllocationCounters()
+    {
+        return AllocationCounters();
+    }
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef MONITORRES_ALLOCATION_COUNTERS_H_
+#define MONITORRES_ALLOCATION_COUNTERS_H_
+
+#include <cstdint>
+
+namespace monitorres
+{
+    // Heap allocations made through operator new by the addon's own code.
+    // Only counted in builds with MONITORRES_ALLOCATION_COUNTERS, which
+    // replace the global operator new of the module.
+    struct AllocationCounters
+    {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    AllocationCounters GetAllocationCounters();
+}
+
+#endif
@@ -0,0 +1,248 @@
+#include "desktop_layout.h"
+
+#include <algorithm>
+
+#include "stats.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        int64_t Right(const DesktopRect &rect) { return static_cast<int64_t>(rect.x) + rect.width; }
+        int64_t Bottom(const DesktopRect &rect) { return static_cast<int64_t>(rect.y) + rect.height; }
+
+        int64_t OverlapArea(const DesktopRect &a, const DesktopRect &b)
+        {
+            int64_t width = std::min(Right(a), Right(b)) - std::max<int64_t>(a.x, b.x);
+            int64_t height = std::min(Bottom(a), Bottom(b)) - std::max<int64_t>(a.y, b.y);
+            return width > 0 && height > 0 ? width * height : 0;
+        }
+
+        // Pixels between the closest pixels of two rects along one axis; 0 if they overlap
+        int64_t Gap(int64_t start, int64_t end, int64_t otherStart, int64_t otherEnd)
+        {
+            return std::max<int64_t>(0, std::max(otherStart - end + 1, start - otherEnd + 1));
+        }
+
+        void SortEdges(std::vector<int64_t> &edges)
+        {
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        }
+    }
+
+    DesktopLayout::DesktopLayout(const MonitorSnapshot &snapshot, uint64_t generation)
+        : generation_(generation)
+    {
+        for (const MonitorState &state : snapshot)
+        {
+            if (!state.hasMode || state.mode.width == 0 || state.mode.height == 0)
+            {
+                continue;
+            }
+
+            DesktopMonitor monitor;
+            monitor.id = state.device.id;
+            monitor.rect.x = state.mode.positionX;
+            monitor.rect.y = state.mode.positionY;
+            monitor.rect.width = static_cast<int32_t>(state.mode.width);
+            monitor.rect.height = static_cast<int32_t>(state.mode.height);
+            monitor.primary = (state.device.stateFlags & kDevicePrimary) != 0;
+            if (monitor.primary && primary_ < 0)
+            {
+                primary_ = static_cast<int>(monitors_.size());
+            }
+
+            columns_.push_back(monitor.rect.x);
+            columns_.push_back(Right(monitor.rect));
+            rows_.push_back(monitor.rect.y);
+            rows_.push_back(Bottom(monitor.rect));
+            monitors_.push_back(std::move(monitor));
+        }
+
+        if (monitors_.empty())
+        {
+            return;
+        }
+
+        SortEdges(columns_);
+        SortEdges(rows_);
+        bounds_.x = static_cast<int32_t>(columns_.front());
+        bounds_.y = static_cast<int32_t>(rows_.front());
+        bounds_.width = static_cast<int32_t>(columns_.back() - columns_.front());
+        bounds_.height = static_cast<int32_t>(rows_.back() - rows_.front());
+
+        // Every monitor edge is a grid line, so each monitor covers whole cells
+        size_t columnCount = columns_.size() - 1;
+        cells_.assign(columnCount * (rows_.size() - 1), -1);
+        for (size_t i = 0; i < monitors_.size(); i++)
+        {
+            const DesktopRect &rect = monitors_[i].rect;
+            int firstColumn = Cell(columns_, rect.x);
+            int lastColumn = Cell(columns_, Right(rect) - 1);
+            int firstRow = Cell(rows_, rect.y);
+            int lastRow = Cell(rows_, Bottom(rect) - 1);
+            for (int row = firstRow; row <= lastRow; row++)
+            {
+                for (int column = firstColumn; column <= lastColumn; column++)
+                {
+                    int32_t &cell = cells_[row * columnCount + column];
+                    if (cell < 0)
+                    {
+                        cell = static_cast<int32_t>(i);
+                    }
+                }
+            }
+        }
+    }
+
+    int DesktopLayout::Cell(const std::vector<int64_t> &edges, int64_t value)
+    {
+        if (edges.size() < 2 || value < edges.front() || value >= edges.back())
+        {
+            return -1;
+        }
+        return static_cast<int>(std::upper_bound(edges.begin(), edges.end(), value) - edges.begin()) - 1;
+    }
+
+    int DesktopLayout::MonitorFromPoint(int32_t x, int32_t y, MonitorFallback fallback) const
+    {
+        int column = Cell(columns_, x);
+        int row = Cell(rows_, y);
+        if (column >= 0 && row >= 0)
+        {
+            int32_t cell = cells_[row * (columns_.size() - 1) + column];
+            if (cell >= 0)
+            {
+                return cell;
+            }
+        }
+
+        DesktopRect point;
+        point.x = x;
+        point.y = y;
+        point.width = 1;
+        point.height = 1;
+        return Fallback(point, fallback);
+    }
+
+    int DesktopLayout::MonitorFromRect(const DesktopRect &rect, MonitorFallback fallback) const
+    {
+        if (rect.width <= 0 || rect.height <= 0)
+        {
+            return MonitorFromPoint(rect.x, rect.y, fallback);
+        }
+        if (monitors_.empty())
+        {
+            return -1;
+        }
+
+        // The part of the rect inside the grid
+        int64_t left = std::max<int64_t>(rect.x, columns_.front());
+        int64_t right = std::min(Right(rect), columns_.back());
+        int64_t top = std::max<int64_t>(rect.y, rows_.front());
+        int64_t bottom = std::min(Bottom(rect), rows_.back());
+        if (left >= right || top >= bottom)
+        {
+            return Fallback(rect, fallback);
+        }
+
+        // Each monitor under the rect owns one of the cells it spans
+        size_t columnCount = columns_.size() - 1;
+        int lastColumn = Cell(columns_, right - 1);
+        int lastRow = Cell(rows_, bottom - 1);
+        int best = -1;
+        int64_t bestArea = 0;
+        for (int row = Cell(rows_, top); row <= lastRow; row++)
+        {
+            for (int column = Cell(columns_, left); column <= lastColumn; column++)
+            {
+                int32_t cell = cells_[row * columnCount + column];
+                if (cell < 0 || cell == best)
+                {
+                    continue;
+                }
+
+                int64_t area = OverlapArea(monitors_[cell].rect, rect);
+                if (area > bestArea || (area == bestArea && cell < best))
+                {
+                    best = cell;
+                    bestArea = area;
+                }
+            }
+        }
+
+        return best >= 0 ? best : Fallback(rect, fallback);
+    }
+
+    int DesktopLayout::Fallback(const DesktopRect &rect, MonitorFallback fallback) const
+    {
+        switch (fallback)
+        {
+        case MonitorFallback::Primary:
+            // With no monitor flagged primary, the first one stands in
+            return primary_ >= 0 || monitors_.empty() ? primary_ : 0;
+        case MonitorFallback::Nearest:
+        {
+            int nearest = -1;
+            int64_t nearestDistance = 0;
+            for (size_t i = 0; i < monitors_.size(); i++)
+            {
+                const DesktopRect &monitor = monitors_[i].rect;
+                int64_t dx = Gap(rect.x, Right(rect), monitor.x, Right(monitor));
+                int64_t dy = Gap(rect.y, Bottom(rect), monitor.y, Bottom(monitor));
+                int64_t distance = dx * dx + dy * dy;
+                if (nearest < 0 || distance < nearestDistance)
+                {
+                    nearest = static_cast<int>(i);
+                    nearestDistance = distance;
+                }
+            }
+            return nearest;
+        }
+        default:
+            return -1;
+        }
+    }
+
+    std::shared_ptr<const DesktopLayout> DesktopLayoutCache::Get(DisplayBackend &backend)
+    {
+        std::shared_ptr<const DesktopLayout> layout = std::atomic_load(&layout_);
+        if (layout)
+        {
+            return layout;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // Built while this thread waited for the lock
+        layout = std::atomic_load(&layout_);
+        if (layout)
+        {
+            return layout;
+        }
+
+        MONITORRES_TIME_PHASE("buildDesktopLayout");
+        uint64_t invalidations = invalidations_.load();
+        layout = std::make_shared<const DesktopLayout>(TakeMonitorSnapshot(backend), ++builds_);
+
+        // A change since the snapshot was taken may not be in it
+        if (invalidations_.load() == invalidations)
+        {
+            std::atomic_store(&layout_, layout);
+        }
+        return layout;
+    }
+
+    void DesktopLayoutCache::Invalidate()
+    {
+        invalidations_++;
+        std::atomic_store(&layout_, std::shared_ptr<const DesktopLayout>());
+    }
+
+    DesktopLayoutCache &DesktopLayouts()
+    {
+        static DesktopLayoutCache cache;
+        return cache;
+    }
+}
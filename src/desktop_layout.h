@@ -0,0 +1,110 @@
+#ifndef MONITORRES_DESKTOP_LAYOUT_H_
+#define MONITORRES_DESKTOP_LAYOUT_H_
+
+#include "display_backend.h"
+#include "monitor_snapshot.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace monitorres
+{
+    // The monitor a lookup falls back to when nothing is under the point or
+    // rect, like the MONITOR_DEFAULTTO* flags of MonitorFromPoint
+    enum class MonitorFallback
+    {
+        None,
+        Primary,
+        Nearest
+    };
+
+    // One monitor of a desktop layout
+    struct DesktopMonitor
+    {
+        std::string id;
+        DesktopRect rect;
+        bool primary = false;
+    };
+
+    // Where the active monitors sit on the virtual desktop, indexed for
+    // lookups. The distinct left/right and top/bottom edges of the monitors
+    // cut the desktop into a grid whose cells each hold the monitor covering
+    // them, so finding the monitor under a point takes two binary searches.
+    // Immutable once built.
+    class DesktopLayout
+    {
+    public:
+        // Index the monitors of snapshot that have a mode and a size, in
+        // enumeration order; where monitors overlap, as when mirrored, the
+        // first one owns the overlap
+        DesktopLayout(const MonitorSnapshot &snapshot, uint64_t generation);
+
+        // Index of the monitor containing a point, or of the fallback; -1 if none
+        int MonitorFromPoint(int32_t x, int32_t y, MonitorFallback fallback) const;
+
+        // Index of the monitor sharing the largest area with a rect (the
+        // first one on ties), or of the fallback; -1 if none. An empty rect
+        // is looked up as its top left corner.
+        int MonitorFromRect(const DesktopRect &rect, MonitorFallback fallback) const;
+
+        const std::vector<DesktopMonitor> &Monitors() const { return monitors_; }
+
+        // Bounding box of every monitor; empty if there are none
+        const DesktopRect &Bounds() const { return bounds_; }
+
+        // Index of the primary monitor; -1 if none is primary
+        int Primary() const { return primary_; }
+
+        // Number of the build this layout came from; a new one means the
+        // indexes may refer to other monitors
+        uint64_t Generation() const { return generation_; }
+
+    private:
+        // Column or row of the grid holding a coordinate; -1 if outside it
+        static int Cell(const std::vector<int64_t> &edges, int64_t value);
+
+        // Index of the fallback monitor for a rect nothing lies under
+        int Fallback(const DesktopRect &rect, MonitorFallback fallback) const;
+
+        std::vector<DesktopMonitor> monitors_;
+        // Sorted distinct monitor edges along each axis
+        std::vector<int64_t> columns_;
+        std::vector<int64_t> rows_;
+        // Monitor owning each grid cell, row by row; -1 for gaps
+        std::vector<int32_t> cells_;
+        DesktopRect bounds_;
+        int primary_ = -1;
+        uint64_t generation_ = 0;
+    };
+
+    // Process-wide cache of the desktop layout of the active backend. The
+    // layout is rebuilt on the first lookup after an invalidation, which
+    // the addon's own mode-sets, display signals of the active backend (see
+    // CacheInvalidator), new snapshot generations and backend swaps
+    // trigger. Lookups take no lock.
+    class DesktopLayoutCache
+    {
+    public:
+        std::shared_ptr<const DesktopLayout> Get(DisplayBackend &backend);
+
+        void Invalidate();
+
+    private:
+        // Null until built and after an invalidation; read with std::atomic_load
+        std::shared_ptr<const DesktopLayout> layout_;
+        // Serializes builds
+        std::mutex mutex_;
+        // Bumped by every invalidation so a build that raced with one is not cached
+        std::atomic<uint64_t> invalidations_{0};
+        uint64_t builds_ = 0;
+    };
+
+    // The process-wide desktop layout cache
+    DesktopLayoutCache &DesktopLayouts();
+}
+
+#endif
@@ -0,0 +1,118 @@
+#include "display_backend.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+#include "desktop_layout.h"
+#include "display_events.h"
+#include "mode_table.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        // Serializes replacing the backend; readers use std::atomic_load
+        std::mutex backendMutex;
+        std::shared_ptr<DisplayBackend> activeBackend;
+        std::atomic<bool> activeBackendInitialized{false};
+
+        // Held while listeners run, so swaps notify in order and a removed
+        // listener is never running
+        std::mutex listenersMutex;
+        std::map<uint64_t, DisplayBackendListener> listeners;
+        uint64_t nextListener = 0;
+    }
+
+    std::string ResolveDeviceId(DisplayBackend &backend, const std::string &id)
+    {
+        if (!id.empty())
+        {
+            return id;
+        }
+        DisplayDevice device;
+        for (uint32_t i = 0; backend.EnumDevice(i, device); i++)
+        {
+            if (device.stateFlags & kDevicePrimary)
+            {
+                return device.id;
+            }
+        }
+        return id;
+    }
+
+    std::shared_ptr<DisplayBackend> CreateSystemDisplayBackend()
+    {
+#ifdef _WIN32
+        return CreateWin32DisplayBackend();
+#else
+        const char *sysfsRoot = getenv("MONITORRES_SYSFS_ROOT");
+        return CreateDrmDisplayBackend(sysfsRoot != nullptr && *sysfsRoot != '\0' ? sysfsRoot : kDefaultSysfsRoot);
+#endif
+    }
+
+    std::shared_ptr<DisplayBackend> GetDisplayBackend()
+    {
+        // Every export starts here, so after the first call no lock is taken
+        if (!activeBackendInitialized.load(std::memory_order_acquire))
+        {
+            bool created = false;
+            {
+                std::lock_guard<std::mutex> lock(backendMutex);
+                if (!activeBackendInitialized.load(std::memory_order_relaxed))
+                {
+                    std::atomic_store(&activeBackend, CreateSystemDisplayBackend());
+                    activeBackendInitialized.store(true, std::memory_order_release);
+                    created = true;
+                }
+            }
+            if (created)
+            {
+                CacheInvalidator().Follow(std::atomic_load(&activeBackend));
+            }
+        }
+        return std::atomic_load(&activeBackend);
+    }
+
+    void SetDisplayBackend(std::shared_ptr<DisplayBackend> backend)
+    {
+        if (!backend)
+        {
+            backend = CreateSystemDisplayBackend();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(backendMutex);
+            std::atomic_store(&activeBackend, std::move(backend));
+            activeBackendInitialized.store(true, std::memory_order_release);
+        }
+
+        // Cached mode lists and layout describe the previous backend's devices.
+        // Following the backend read back keeps the last of racing swaps.
+        CacheInvalidator().Follow(std::atomic_load(&activeBackend));
+        ModeTables().InvalidateAll();
+        DesktopLayouts().Invalidate();
+
+        std::lock_guard<std::mutex> lock(listenersMutex);
+        std::shared_ptr<DisplayBackend> active = std::atomic_load(&activeBackend);
+        for (const auto &entry : listeners)
+        {
+            entry.second(active);
+        }
+    }
+
+    uint64_t AddDisplayBackendListener(DisplayBackendListener listener)
+    {
+        std::lock_guard<std::mutex> lock(listenersMutex);
+        uint64_t handle = ++nextListener;
+        listeners.emplace(handle, std::move(listener));
+        return handle;
+    }
+
+    void RemoveDisplayBackendListener(uint64_t handle)
+    {
+        std::lock_guard<std::mutex> lock(listenersMutex);
+        listeners.erase(handle);
+    }
+}
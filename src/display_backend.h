@@ -0,0 +1,175 @@
+#ifndef MONITORRES_DISPLAY_BACKEND_H_
+#define MONITORRES_DISPLAY_BACKEND_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace monitorres
+{
+    class DisplayEventSource;
+
+    // Result codes of a display settings change. The values mirror the Win32
+    // DISP_CHANGE_* constants so every backend reports the same codes to JS.
+    enum DisplayChangeCode : long
+    {
+        kDispChangeSuccessful = 0,
+        kDispChangeRestart = 1,
+        kDispChangeFailed = -1,
+        kDispChangeBadMode = -2,
+        kDispChangeNotUpdated = -3,
+        kDispChangeBadFlags = -4,
+        kDispChangeBadParam = -5,
+        kDispChangeBadDualView = -6
+    };
+
+    // DISPLAY_DEVICE state flags used by the addon (same values as Win32)
+    const uint32_t kDeviceActive = 0x1;
+    const uint32_t kDeviceAttachedToDesktop = 0x1;
+    const uint32_t kDevicePrimary = 0x4;
+
+    // One display mode, i.e. the subset of DEVMODE the addon works with
+    struct DisplayMode
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t refreshRate = 0;
+        uint32_t bitsPerPixel = 0;
+        uint32_t orientation = 0;
+        int32_t positionX = 0;
+        int32_t positionY = 0;
+    };
+
+    // A rectangle in virtual desktop coordinates; contains x <= px < x + width
+    struct DesktopRect
+    {
+        int32_t x = 0;
+        int32_t y = 0;
+        int32_t width = 0;
+        int32_t height = 0;
+    };
+
+    // Where the monitor on a device sits and how it is scaled, i.e. the
+    // subset of MONITORINFO and GetDpiForMonitor the addon works with
+    struct MonitorGeometry
+    {
+        DesktopRect bounds;
+        // Bounds minus the taskbar and docked toolbars
+        DesktopRect workArea;
+        // DPI the monitor's content is scaled for (MDT_EFFECTIVE_DPI)
+        uint32_t effectiveDpiX = 96;
+        uint32_t effectiveDpiY = 96;
+        // Pixel density of the panel (MDT_RAW_DPI); 0 if unknown
+        uint32_t rawDpiX = 0;
+        uint32_t rawDpiY = 0;
+    };
+
+    // One display device, i.e. the subset of DISPLAY_DEVICE the addon works with
+    struct DisplayDevice
+    {
+        std::string id;
+        std::string name;
+        std::string deviceId;
+        std::string deviceKey;
+        uint32_t stateFlags = 0;
+    };
+
+    // Access to the operating system's display configuration. All exports go
+    // through the active backend, so a simulated backend can stand in for the
+    // real one on machines without the matching display stack.
+    //
+    // An empty device id addresses the primary display. Implementations must
+    // be safe to call from worker threads.
+    class DisplayBackend
+    {
+    public:
+        virtual ~DisplayBackend() = default;
+
+        // Get the device at index; returns false past the last device
+        virtual bool EnumDevice(uint32_t index, DisplayDevice &device) = 0;
+
+        // Get the current mode of a device
+        virtual bool GetCurrentMode(const std::string &id, DisplayMode &mode) = 0;
+
+        // Get the mode stored for a device, which ApplyMode with
+        // updateRegistry writes and the device starts in; returns false if
+        // it cannot be read
+        virtual bool GetRegistryMode(const std::string &id, DisplayMode &mode) = 0;
+
+        // Get the supported mode at index; returns false past the last mode
+        virtual bool EnumMode(const std::string &id, uint32_t index, DisplayMode &mode) = 0;
+
+        // Apply the width, height and refresh rate of mode to a device while
+        // keeping its other settings; returns a DisplayChangeCode
+        virtual long ApplyMode(const std::string &id, const DisplayMode &mode, bool updateRegistry) = 0;
+
+        // Record a mode change for a device without applying it yet; staged
+        // changes take effect together on the next CommitStagedModes()
+        virtual long StageMode(const std::string &id, const DisplayMode &mode) = 0;
+
+        // Record the full state of a device for the next CommitStagedModes():
+        // its mode including bits per pixel, orientation and position, and
+        // whether it becomes the primary display
+        virtual long StageDeviceState(const std::string &id, const DisplayMode &mode, bool primary) = 0;
+
+        // Apply every staged mode change in a single mode-set
+        virtual long CommitStagedModes() = 0;
+
+        // Get the system-wide DPI
+        virtual bool GetSystemDpi(int &dpiX, int &dpiY) = 0;
+
+        // Get the bounds, work area and DPI of the monitor on an active device
+        virtual bool GetMonitorGeometry(const std::string &id, MonitorGeometry &geometry) = 0;
+
+        // Get the raw EDID of the monitor on a device, extension blocks included
+        virtual bool GetEdid(const std::string &id, std::vector<uint8_t> &edid) = 0;
+
+        // Get the version of the driver behind a device; mode lists only
+        // change with the monitor or the driver
+        virtual bool GetDriverVersion(const std::string &id, std::string &version) = 0;
+
+        // Create the source of display change notifications for this backend
+        virtual std::shared_ptr<DisplayEventSource> CreateEventSource() = 0;
+    };
+
+#ifdef _WIN32
+    // Backend on top of EnumDisplayDevices/EnumDisplaySettings/ChangeDisplaySettingsEx
+    std::shared_ptr<DisplayBackend> CreateWin32DisplayBackend();
+#else
+    // Where the kernel exposes DRM connectors; MONITORRES_SYSFS_ROOT overrides it
+    const char *const kDefaultSysfsRoot = "/sys/class/drm";
+
+    // Read-only backend on top of the connectors under sysfsRoot
+    std::shared_ptr<DisplayBackend> CreateDrmDisplayBackend(const std::string &sysfsRoot);
+#endif
+
+    // The id of the primary display for an empty id, so both spellings of
+    // the primary address one device; id itself otherwise, or if no device
+    // is primary
+    std::string ResolveDeviceId(DisplayBackend &backend, const std::string &id);
+
+    // Create the backend for the platform the addon was built on, or nullptr
+    // if the platform has none
+    std::shared_ptr<DisplayBackend> CreateSystemDisplayBackend();
+
+    // Get the active backend (nullptr if none is available)
+    std::shared_ptr<DisplayBackend> GetDisplayBackend();
+
+    // Replace the active backend; nullptr restores the system backend
+    void SetDisplayBackend(std::shared_ptr<DisplayBackend> backend);
+
+    // Called on the thread of SetDisplayBackend with the backend it made active
+    using DisplayBackendListener = std::function<void(const std::shared_ptr<DisplayBackend> &)>;
+
+    // Call listener whenever the active backend is replaced, so whatever
+    // runs against the previous one can move over; returns a handle for
+    // RemoveDisplayBackendListener
+    uint64_t AddDisplayBackendListener(DisplayBackendListener listener);
+
+    // Once this returns the listener is not running and is not called again
+    void RemoveDisplayBackendListener(uint64_t handle);
+}
+
+#endif
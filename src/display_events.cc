@@ -0,0 +1,272 @@
+#include "display_events.h"
+
+#include "desktop_layout.h"
+#include "display_geometry.h"
+#include "mode_table.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        // A burst that never goes quiet is still reported after this many windows
+        const int kMaxCoalesceWindows = 8;
+    }
+
+    bool ManualDisplayEventSource::Start(DisplaySignalCallback callback)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        callback_ = std::move(callback);
+        return true;
+    }
+
+    void ManualDisplayEventSource::Stop()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        callback_ = nullptr;
+    }
+
+    void ManualDisplayEventSource::Raise(DisplaySignal signal)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (callback_)
+        {
+            callback_(signal);
+        }
+    }
+
+    void InvalidateStaleModeTables(DisplayBackend &backend, const MonitorSnapshot &before, const MonitorSnapshot &after,
+                                   const MonitorSnapshotDiff &diff, bool devicesChanged)
+    {
+        if (devicesChanged || !diff.added.empty() || !diff.removed.empty())
+        {
+            ModeTables().InvalidateAll();
+            return;
+        }
+
+        // Mode lists follow the orientation and the attached monitor, not the current mode
+        for (const auto &id : diff.changed)
+        {
+            const MonitorState *previous = FindMonitorState(before, id);
+            const MonitorState *next = FindMonitorState(after, id);
+            if (previous->device.deviceId != next->device.deviceId ||
+                previous->mode.orientation != next->mode.orientation)
+            {
+                ModeTables().Invalidate(backend, id);
+            }
+        }
+    }
+
+    void DisplayCacheInvalidator::Follow(std::shared_ptr<DisplayBackend> backend)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (subscription_ && subscription_->backend == backend)
+        {
+            return;
+        }
+
+        // Signals of the previous backend stop before its subscription goes
+        if (subscription_ && subscription_->source)
+        {
+            subscription_->source->Stop();
+        }
+        subscription_.reset();
+        if (!backend)
+        {
+            return;
+        }
+
+        std::unique_ptr<Subscription> subscription(new Subscription());
+        subscription->backend = std::move(backend);
+        subscription->source = subscription->backend->CreateEventSource();
+        Subscription *target = subscription.get();
+        if (subscription->source && !subscription->source->Start([target](DisplaySignal signal)
+                                                                 { OnSignal(*target, signal); }))
+        {
+            // Without signals only the re-enumeration before a rejection catches up
+            subscription->source.reset();
+        }
+        else if (subscription->source)
+        {
+            // Taken after starting, so no change slips in between; a signal
+            // that beat it has already dropped every table
+            std::lock_guard<std::mutex> signalLock(subscription->mutex);
+            if (!subscription->hasSnapshot)
+            {
+                subscription->snapshot = TakeMonitorSnapshot(*subscription->backend);
+                subscription->hasSnapshot = true;
+            }
+        }
+        subscription_ = std::move(subscription);
+    }
+
+    void DisplayCacheInvalidator::OnSignal(Subscription &subscription, DisplaySignal signal)
+    {
+        std::lock_guard<std::mutex> lock(subscription.mutex);
+        MonitorSnapshot next = TakeMonitorSnapshot(*subscription.backend);
+        if (subscription.hasSnapshot)
+        {
+            MonitorSnapshotDiff diff = DiffMonitorSnapshots(subscription.snapshot, next);
+            InvalidateStaleModeTables(*subscription.backend, subscription.snapshot, next, diff, signal == DisplaySignal::DevicesChanged);
+            if (!diff.Empty())
+            {
+                DesktopLayouts().Invalidate();
+            }
+        }
+        else
+        {
+            ModeTables().InvalidateAll();
+            DesktopLayouts().Invalidate();
+        }
+        // Scale and work area can change without the topology
+        DisplayGeometries().Invalidate();
+        subscription.snapshot = std::move(next);
+        subscription.hasSnapshot = true;
+    }
+
+    DisplayCacheInvalidator &CacheInvalidator()
+    {
+        // Never destroyed, so no signal can arrive during static destruction
+        static DisplayCacheInvalidator *invalidator = new DisplayCacheInvalidator();
+        return *invalidator;
+    }
+
+    DisplayChangeWatcher::DisplayChangeWatcher(std::shared_ptr<DisplayBackend> backend, ChangeCallback onChange)
+        : backend_(std::move(backend)),
+          onChange_(std::move(onChange)),
+          coalesceMs_(kDefaultCoalesceWindow.count())
+    {
+    }
+
+    DisplayChangeWatcher::~DisplayChangeWatcher()
+    {
+        Stop();
+    }
+
+    bool DisplayChangeWatcher::Start(std::shared_ptr<DisplayEventSource> source)
+    {
+        snapshot_ = TakeMonitorSnapshot(*backend_);
+        thread_ = std::thread(&DisplayChangeWatcher::Run, this);
+
+        source_ = std::move(source);
+        if (!source_ || !source_->Start([this](DisplaySignal signal)
+                                        { Notify(signal); }))
+        {
+            source_.reset();
+            Stop();
+            return false;
+        }
+        return true;
+    }
+
+    void DisplayChangeWatcher::Stop()
+    {
+        if (source_)
+        {
+            source_->Stop();
+            source_.reset();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+    }
+
+    void DisplayChangeWatcher::Rebind(std::shared_ptr<DisplayBackend> backend, std::shared_ptr<DisplayEventSource> source)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (backend_ == backend)
+            {
+                return;
+            }
+        }
+
+        if (source_)
+        {
+            source_->Stop();
+            source_.reset();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            backend_ = std::move(backend);
+            pendingSignals_++;
+            lastSignal_ = std::chrono::steady_clock::now();
+        }
+        wake_.notify_all();
+
+        source_ = std::move(source);
+        if (source_ && !source_->Start([this](DisplaySignal signal)
+                                       { Notify(signal); }))
+        {
+            source_.reset();
+        }
+    }
+
+    void DisplayChangeWatcher::Notify(DisplaySignal signal)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pendingSignals_++;
+            lastSignal_ = std::chrono::steady_clock::now();
+        }
+        wake_.notify_all();
+    }
+
+    void DisplayChangeWatcher::Run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (true)
+        {
+            wake_.wait(lock, [this]
+                       { return stopping_ || pendingSignals_ > 0; });
+            if (stopping_)
+            {
+                return;
+            }
+
+            // Wait for the burst to go quiet, but not forever
+            std::chrono::milliseconds window(coalesceMs_.load());
+            auto giveUp = std::chrono::steady_clock::now() + window * kMaxCoalesceWindows;
+            while (!stopping_)
+            {
+                auto quietAt = std::min(lastSignal_ + window, giveUp);
+                if (std::chrono::steady_clock::now() >= quietAt)
+                {
+                    break;
+                }
+                wake_.wait_until(lock, quietAt);
+            }
+            if (stopping_)
+            {
+                return;
+            }
+
+            uint32_t signals = pendingSignals_;
+            pendingSignals_ = 0;
+            std::shared_ptr<DisplayBackend> backend = backend_;
+            lock.unlock();
+
+            MonitorSnapshot next = TakeMonitorSnapshot(*backend);
+            DisplayChangeEvent event;
+            static_cast<MonitorSnapshotDiff &>(event) = DiffMonitorSnapshots(snapshot_, next);
+            event.signals = signals;
+            snapshot_ = std::move(next);
+
+            if (!event.Empty())
+            {
+                onChange_(event);
+            }
+
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,164 @@
+#ifndef MONITORRES_DISPLAY_EVENTS_H_
+#define MONITORRES_DISPLAY_EVENTS_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "display_backend.h"
+#include "monitor_snapshot.h"
+
+namespace monitorres
+{
+    // Raw notification that something about the displays may have changed
+    enum class DisplaySignal
+    {
+        // A mode, position or orientation changed (WM_DISPLAYCHANGE)
+        ModeChanged,
+        // A monitor was connected or disconnected (WM_DEVICECHANGE)
+        DevicesChanged
+    };
+
+    using DisplaySignalCallback = std::function<void(DisplaySignal)>;
+
+    // Delivers raw display signals from some thread of its choosing
+    class DisplayEventSource
+    {
+    public:
+        virtual ~DisplayEventSource() = default;
+
+        // Start delivering signals to callback; returns false if the source could not start
+        virtual bool Start(DisplaySignalCallback callback) = 0;
+
+        // Stop delivering signals; callback is not called after this returns
+        virtual void Stop() = 0;
+    };
+
+    // Event source fed by explicit Raise() calls, for backends without
+    // operating system notifications and for injecting signals in tests
+    class ManualDisplayEventSource : public DisplayEventSource
+    {
+    public:
+        bool Start(DisplaySignalCallback callback) override;
+        void Stop() override;
+
+        void Raise(DisplaySignal signal);
+
+    private:
+        std::mutex mutex_;
+        DisplaySignalCallback callback_;
+    };
+
+#ifdef _WIN32
+    // Event source backed by a hidden window listening for WM_DISPLAYCHANGE and WM_DEVICECHANGE
+    std::shared_ptr<DisplayEventSource> CreateWin32DisplayEventSource();
+#endif
+
+    // One coalesced display change
+    struct DisplayChangeEvent : MonitorSnapshotDiff
+    {
+        // Raw signals folded into this event
+        uint32_t signals = 0;
+    };
+
+    // Drop the cached mode tables a change from before to after may have made
+    // stale: all of them after hotplug, which can put a different monitor on
+    // the same output, otherwise those of devices whose monitor or
+    // orientation changed
+    void InvalidateStaleModeTables(DisplayBackend &backend, const MonitorSnapshot &before, const MonitorSnapshot &after,
+                                   const MonitorSnapshotDiff &diff, bool devicesChanged);
+
+    // Keeps the process-wide mode tables, desktop layout and display
+    // geometry in step with the active backend. Listens to the backend's event source for as long as
+    // the backend is active, whether or not a watcher runs, and invalidates
+    // on every signal as soon as it arrives rather than after the burst goes
+    // quiet.
+    class DisplayCacheInvalidator
+    {
+    public:
+        // Listen to backend's signals instead of the previous backend's;
+        // nullptr stops listening
+        void Follow(std::shared_ptr<DisplayBackend> backend);
+
+    private:
+        // The backend being followed and the topology its last signal left
+        struct Subscription
+        {
+            std::shared_ptr<DisplayBackend> backend;
+            std::shared_ptr<DisplayEventSource> source;
+            std::mutex mutex;
+            // Unset until Follow takes the baseline; a signal before then
+            // drops every cached table
+            bool hasSnapshot = false;
+            MonitorSnapshot snapshot;
+        };
+
+        static void OnSignal(Subscription &subscription, DisplaySignal signal);
+
+        // Serializes Follow
+        std::mutex mutex_;
+        std::unique_ptr<Subscription> subscription_;
+    };
+
+    // The invalidator following the active backend (see SetDisplayBackend)
+    DisplayCacheInvalidator &CacheInvalidator();
+
+    // Turns bursts of raw signals into display change events. Runs a thread
+    // that waits until signals stop arriving for the coalescing window,
+    // compares the topology against the previous snapshot and reports the
+    // monitors that were added, removed or changed. Cached mode tables and
+    // layout are left to the CacheInvalidator, which sees the same signals.
+    class DisplayChangeWatcher
+    {
+    public:
+        using ChangeCallback = std::function<void(const DisplayChangeEvent &)>;
+
+        DisplayChangeWatcher(std::shared_ptr<DisplayBackend> backend, ChangeCallback onChange);
+        ~DisplayChangeWatcher();
+
+        // Take the baseline snapshot and start listening
+        bool Start(std::shared_ptr<DisplayEventSource> source);
+        void Stop();
+
+        // Watch backend from now on, listening to source instead. The swap
+        // counts as a signal, so the monitors that differ between the two
+        // backends are reported as one change. Safe to call from any thread,
+        // but not concurrently with Start or Stop.
+        void Rebind(std::shared_ptr<DisplayBackend> backend, std::shared_ptr<DisplayEventSource> source);
+
+        // Feed a raw signal; safe to call from any thread
+        void Notify(DisplaySignal signal);
+
+        // Quiet period that ends a burst; takes effect on the next burst
+        void SetCoalesceWindow(std::chrono::milliseconds window) { coalesceMs_.store(window.count()); }
+
+    private:
+        void Run();
+
+        // Guarded by mutex_ once the thread runs; bursts are compared on a copy
+        std::shared_ptr<DisplayBackend> backend_;
+        ChangeCallback onChange_;
+        std::shared_ptr<DisplayEventSource> source_;
+        std::atomic<long long> coalesceMs_;
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        bool stopping_ = false;
+        uint32_t pendingSignals_ = 0;
+        std::chrono::steady_clock::time_point lastSignal_;
+
+        MonitorSnapshot snapshot_;
+        std::thread thread_;
+    };
+
+    // Default quiet period that ends a burst of display signals
+    const std::chrono::milliseconds kDefaultCoalesceWindow(250);
+}
+
+#endif
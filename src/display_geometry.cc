@@ -0,0 +1,93 @@
+#include "display_geometry.h"
+
+#include "stats.h"
+
+namespace monitorres
+{
+    std::shared_ptr<const DisplayGeometry> ReadDisplayGeometry(DisplayBackend &backend, const DesktopLayout &layout)
+    {
+        MONITORRES_TIME_PHASE("readDisplayGeometry");
+        std::shared_ptr<DisplayGeometry> result = std::make_shared<DisplayGeometry>();
+        result->generation = layout.Generation();
+
+        int systemDpiX = 96;
+        int systemDpiY = 96;
+        bool hasSystemDpi = false;
+
+        const std::vector<DesktopMonitor> &monitors = layout.Monitors();
+        result->monitors.reserve(monitors.size());
+        for (const DesktopMonitor &monitor : monitors)
+        {
+            MonitorGeometryState state;
+            state.id = monitor.id;
+            state.primary = monitor.primary;
+            if (!backend.GetCurrentMode(monitor.id, state.mode))
+            {
+                state.mode.width = static_cast<uint32_t>(monitor.rect.width);
+                state.mode.height = static_cast<uint32_t>(monitor.rect.height);
+                state.mode.positionX = monitor.rect.x;
+                state.mode.positionY = monitor.rect.y;
+            }
+
+            if (!backend.GetMonitorGeometry(monitor.id, state.geometry))
+            {
+                if (!hasSystemDpi)
+                {
+                    backend.GetSystemDpi(systemDpiX, systemDpiY);
+                    hasSystemDpi = true;
+                }
+
+                state.geometry.bounds = monitor.rect;
+                state.geometry.workArea = monitor.rect;
+                state.geometry.effectiveDpiX = static_cast<uint32_t>(systemDpiX);
+                state.geometry.effectiveDpiY = static_cast<uint32_t>(systemDpiY);
+            }
+
+            result->monitors.push_back(std::move(state));
+        }
+
+        return result;
+    }
+
+    std::shared_ptr<const DisplayGeometry> DisplayGeometryCache::Get(DisplayBackend &backend)
+    {
+        std::shared_ptr<const DesktopLayout> layout = DesktopLayouts().Get(backend);
+
+        std::shared_ptr<const DisplayGeometry> geometry = std::atomic_load(&geometry_);
+        if (geometry && geometry->generation == layout->Generation())
+        {
+            return geometry;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // Read while this thread waited for the lock
+        geometry = std::atomic_load(&geometry_);
+        if (geometry && geometry->generation == layout->Generation())
+        {
+            return geometry;
+        }
+
+        uint64_t invalidations = invalidations_.load();
+        geometry = ReadDisplayGeometry(backend, *layout);
+
+        // A change since the read started may not be in it
+        if (invalidations_.load() == invalidations)
+        {
+            std::atomic_store(&geometry_, geometry);
+        }
+        return geometry;
+    }
+
+    void DisplayGeometryCache::Invalidate()
+    {
+        invalidations_++;
+        std::atomic_store(&geometry_, std::shared_ptr<const DisplayGeometry>());
+    }
+
+    DisplayGeometryCache &DisplayGeometries()
+    {
+        static DisplayGeometryCache cache;
+        return cache;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef MONITORRES_DISPLAY_GEOMETRY_H_
+#define MONITORRES_DISPLAY_GEOMETRY_H_
+
+#include "desktop_layout.h"
+#include "display_backend.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace monitorres
+{
+    // Geometry, scaling and mode of one active monitor
+    struct MonitorGeometryState
+    {
+        std::string id;
+        bool primary = false;
+        // Current mode, with orientation and position
+        DisplayMode mode;
+        MonitorGeometry geometry;
+    };
+
+    // Geometry of the monitors of a desktop layout, in the same order
+    struct DisplayGeometry
+    {
+        // Generation of the desktop layout it was read for
+        uint64_t generation = 0;
+        std::vector<MonitorGeometryState> monitors;
+    };
+
+    // Read the geometry of every monitor of a layout. A monitor the
+    // backend has no geometry for keeps bounds and work area equal to its
+    // rect in the layout and the system DPI.
+    std::shared_ptr<const DisplayGeometry> ReadDisplayGeometry(DisplayBackend &backend, const DesktopLayout &layout);
+
+    // Process-wide cache of the display geometry of the active backend,
+    // read again when DesktopLayouts() rebuilds the layout, i.e. after the
+    // topology changed, and after an invalidation. Scale and work area
+    // changes alone are not a topology change, so the cache invalidator
+    // drops the geometry on every display signal.
+    class DisplayGeometryCache
+    {
+    public:
+        std::shared_ptr<const DisplayGeometry> Get(DisplayBackend &backend);
+
+        void Invalidate();
+
+    private:
+        // Read with std::atomic_load; for an older layout once it was
+        // rebuilt, null after an invalidation
+        std::shared_ptr<const DisplayGeometry> geometry_;
+        // Serializes reads
+        std::mutex mutex_;
+        // Bumped by every invalidation so a read that raced with one is not cached
+        std::atomic<uint64_t> invalidations_{0};
+    };
+
+    // The process-wide display geometry cache
+    DisplayGeometryCache &DisplayGeometries();
+}
+
+#endif
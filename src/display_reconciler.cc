@@ -0,0 +1,518 @@
+#include "display_reconciler.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "mode_change.h"
+#include "mode_table.h"
+#include "stats.h"
+#include "topology.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        const std::chrono::seconds kRateLimitWindow(60);
+
+        using Clock = std::chrono::steady_clock;
+
+        bool Drifted(const DesiredDisplayState &desired, const DisplayMode &mode, bool primary)
+        {
+            return mode.width != desired.width ||
+                   mode.height != desired.height ||
+                   (desired.hasRefreshRate && mode.refreshRate != desired.refreshRate) ||
+                   (desired.hasPosition && (mode.positionX != desired.positionX || mode.positionY != desired.positionY)) ||
+                   (desired.hasPrimary && primary != desired.primary);
+        }
+
+        // The live state of a device with the desired fields applied
+        TopologyDevice TargetState(DisplayBackend &backend, const std::string &id, const DesiredDisplayState &desired, const TopologyDevice &live)
+        {
+            TopologyDevice target = live;
+            target.mode.width = desired.width;
+            target.mode.height = desired.height;
+            if (desired.hasRefreshRate)
+            {
+                target.mode.refreshRate = desired.refreshRate;
+            }
+            else if (live.mode.width != desired.width || live.mode.height != desired.height)
+            {
+                // The current rate may not exist at the desired resolution
+                uint32_t closest = ModeTables().Get(backend, id)->ClosestRefreshRate(desired.width, desired.height, live.mode.refreshRate);
+                if (closest != 0)
+                {
+                    target.mode.refreshRate = closest;
+                }
+            }
+            if (desired.hasPosition)
+            {
+                target.mode.positionX = desired.positionX;
+                target.mode.positionY = desired.positionY;
+            }
+            if (desired.hasPrimary)
+            {
+                target.primary = desired.primary;
+            }
+            return target;
+        }
+
+        // A drifted device and the state it goes back to
+        struct Correction
+        {
+            std::string id;
+            DisplayMode from;
+            TopologyDevice target;
+            bool attempted = false;
+            // The mode-set changed the device; unset if it was already back
+            bool applied = false;
+            long code = kDispChangeSuccessful;
+            std::string message;
+        };
+    }
+
+    DisplayReconciler::DisplayReconciler(std::shared_ptr<DisplayBackend> backend, EventCallback onEvent)
+        : backend_(std::move(backend)), onEvent_(std::move(onEvent))
+    {
+    }
+
+    DisplayReconciler::~DisplayReconciler()
+    {
+        Stop();
+    }
+
+    bool DisplayReconciler::SetDesired(const std::string &id, const DesiredDisplayState &state, std::string &error)
+    {
+        std::shared_ptr<DisplayBackend> backend;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            backend = backend_;
+        }
+
+        std::shared_ptr<const ModeTable> table = ModeTables().Get(*backend, id);
+        bool supported = state.hasRefreshRate ? table->HasMode(state.width, state.height, state.refreshRate)
+                                              : table->HasResolution(state.width, state.height);
+        if (!supported)
+        {
+            error = "Monitor " + id + " does not support " + std::to_string(state.width) + "x" + std::to_string(state.height);
+            if (state.hasRefreshRate)
+            {
+                error += "@" + std::to_string(state.refreshRate) + "Hz";
+            }
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Target &target = targets_[id];
+            target.desired = state;
+            target.failures = 0;
+            target.retryAt = Clock::time_point();
+            pending_ = true;
+        }
+        wake_.notify_all();
+        return true;
+    }
+
+    bool DisplayReconciler::ClearDesired(const std::string &id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return targets_.erase(id) != 0;
+    }
+
+    void DisplayReconciler::ClearAll()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        targets_.clear();
+    }
+
+    size_t DisplayReconciler::Size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return targets_.size();
+    }
+
+    void DisplayReconciler::SetOptions(const ReconcilerOptions &options)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            options_ = options;
+            // A shorter interval should not wait out the longer one
+            pending_ = true;
+        }
+        wake_.notify_all();
+    }
+
+    void DisplayReconciler::Start(std::shared_ptr<DisplayEventSource> source)
+    {
+        thread_ = std::thread(&DisplayReconciler::Run, this);
+
+        // Without a source, or one that does not start, the interval is all there is
+        source_ = std::move(source);
+        if (source_ && !source_->Start([this](DisplaySignal)
+                                       { Notify(); }))
+        {
+            source_.reset();
+        }
+    }
+
+    void DisplayReconciler::Stop()
+    {
+        if (source_)
+        {
+            source_->Stop();
+            source_.reset();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+    }
+
+    void DisplayReconciler::Rebind(std::shared_ptr<DisplayBackend> backend, std::shared_ptr<DisplayEventSource> source)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (backend_ == backend)
+            {
+                return;
+            }
+        }
+
+        if (source_)
+        {
+            source_->Stop();
+            source_.reset();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            backend_ = std::move(backend);
+            // What the old backend's devices did says nothing about the new one's
+            for (auto &entry : targets_)
+            {
+                Target &target = entry.second;
+                target.failures = 0;
+                target.retryAt = Clock::time_point();
+                target.corrections.clear();
+                target.rateLimitReported = false;
+            }
+            pending_ = true;
+        }
+        wake_.notify_all();
+
+        source_ = std::move(source);
+        if (source_ && !source_->Start([this](DisplaySignal)
+                                       { Notify(); }))
+        {
+            source_.reset();
+        }
+    }
+
+    void DisplayReconciler::Notify()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_ = true;
+            lastSignal_ = Clock::now();
+        }
+        wake_.notify_all();
+    }
+
+    std::chrono::steady_clock::time_point DisplayReconciler::NextRetry(std::chrono::steady_clock::time_point now) const
+    {
+        Clock::time_point retryAt = Clock::time_point::max();
+        for (const auto &entry : targets_)
+        {
+            if (entry.second.failures > 0 && entry.second.retryAt > now)
+            {
+                retryAt = std::min(retryAt, entry.second.retryAt);
+            }
+        }
+        return retryAt;
+    }
+
+    ReconcilerStats DisplayReconciler::Stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ReconcilerStats stats = stats_;
+        stats.devices = targets_.size();
+        return stats;
+    }
+
+    void DisplayReconciler::Run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Clock::time_point nextPass = Clock::now();
+        Clock::time_point retryAt = Clock::time_point::max();
+
+        while (!stopping_)
+        {
+            // Signals arrive in bursts while a mode-set settles; check once it is over
+            Clock::time_point due = std::min(nextPass, retryAt);
+            if (pending_)
+            {
+                due = std::min(due, lastSignal_ + kDefaultCoalesceWindow);
+            }
+            if (Clock::now() < due)
+            {
+                wake_.wait_until(lock, due);
+                continue;
+            }
+
+            pending_ = false;
+            std::chrono::milliseconds interval = options_.interval;
+            lock.unlock();
+
+            retryAt = Reconcile();
+
+            lock.lock();
+            nextPass = Clock::now() + interval;
+        }
+    }
+
+    Clock::time_point DisplayReconciler::Reconcile()
+    {
+        MONITORRES_TIME_PHASE("reconcile");
+
+        std::vector<std::pair<std::string, DesiredDisplayState>> wanted;
+        ReconcilerOptions options;
+        std::shared_ptr<DisplayBackend> backend;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.passes++;
+            options = options_;
+            backend = backend_;
+            wanted.reserve(targets_.size());
+            for (const auto &entry : targets_)
+            {
+                wanted.emplace_back(entry.first, entry.second.desired);
+            }
+        }
+
+        // The device list is only read when a state pins the primary display
+        std::string primaryId;
+        if (std::any_of(wanted.begin(), wanted.end(), [](const std::pair<std::string, DesiredDisplayState> &entry)
+                        { return entry.second.hasPrimary; }))
+        {
+            DisplayDevice device;
+            for (uint32_t i = 0; backend->EnumDevice(i, device); i++)
+            {
+                if (device.stateFlags & kDevicePrimary)
+                {
+                    primaryId = device.id;
+                    break;
+                }
+            }
+        }
+
+        std::vector<Correction> drifted;
+        std::vector<const std::string *> settled;
+        for (const auto &entry : wanted)
+        {
+            DisplayMode mode;
+            // A disconnected device is corrected once it is back
+            if (!backend->GetCurrentMode(entry.first, mode))
+            {
+                continue;
+            }
+            if (!Drifted(entry.second, mode, entry.first == primaryId))
+            {
+                settled.push_back(&entry.first);
+                continue;
+            }
+
+            Correction correction;
+            correction.id = entry.first;
+            correction.from = mode;
+            drifted.push_back(std::move(correction));
+        }
+
+        {
+            // A device back in its desired state ends its streak of failures
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const std::string *id : settled)
+            {
+                auto target = targets_.find(*id);
+                if (target != targets_.end())
+                {
+                    target->second.failures = 0;
+                }
+            }
+        }
+
+        if (drifted.empty())
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return NextRetry(Clock::now());
+        }
+
+        // Drift is rare, so the full state it takes to restage a device is read only now
+        Topology live = CaptureTopology(*backend);
+        for (auto &correction : drifted)
+        {
+            auto device = std::find_if(live.begin(), live.end(), [&](const TopologyDevice &candidate)
+                                       { return candidate.id == correction.id; });
+            const DesiredDisplayState *desired = nullptr;
+            for (const auto &entry : wanted)
+            {
+                if (entry.first == correction.id)
+                {
+                    desired = &entry.second;
+                }
+            }
+            if (device != live.end())
+            {
+                correction.target = TargetState(*backend, correction.id, *desired, *device);
+            }
+        }
+
+        std::vector<ReconcileEvent> events;
+        Topology batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Clock::time_point now = Clock::now();
+            for (auto &correction : drifted)
+            {
+                auto target = targets_.find(correction.id);
+                if (target == targets_.end() || correction.target.id.empty())
+                {
+                    // Cleared or disconnected since it was checked
+                    continue;
+                }
+
+                Target &state = target->second;
+                stats_.drifted++;
+                if (state.failures > 0 && now < state.retryAt)
+                {
+                    stats_.backedOff++;
+                    continue;
+                }
+
+                while (!state.corrections.empty() && now - state.corrections.front() >= kRateLimitWindow)
+                {
+                    state.corrections.pop_front();
+                }
+                if (state.corrections.size() >= options.maxCorrectionsPerMinute)
+                {
+                    stats_.rateLimited++;
+                    if (!state.rateLimitReported)
+                    {
+                        state.rateLimitReported = true;
+                        ReconcileEvent event;
+                        event.kind = ReconcileEvent::Kind::RateLimited;
+                        event.id = correction.id;
+                        event.from = correction.from;
+                        event.to = correction.target.mode;
+                        event.failures = state.failures;
+                        event.retryAfter = std::chrono::duration_cast<std::chrono::milliseconds>(state.corrections.front() + kRateLimitWindow - now);
+                        event.message = "Monitor " + correction.id + " drifted again after " + std::to_string(state.corrections.size()) + " corrections in a minute";
+                        events.push_back(std::move(event));
+                    }
+                    continue;
+                }
+
+                state.corrections.push_back(now);
+                state.rateLimitReported = false;
+                correction.attempted = true;
+                batch.push_back(correction.target);
+            }
+        }
+
+        // Apply every drifted device in one mode-set; one that rejects its state leaves the batch
+        while (!batch.empty())
+        {
+            TopologyRestoreResult result = RestoreTopology(*backend, batch);
+            if (result.code == kDispChangeSuccessful)
+            {
+                for (auto &correction : drifted)
+                {
+                    correction.applied = std::find(result.changed.begin(), result.changed.end(), correction.id) != result.changed.end();
+                }
+                break;
+            }
+
+            for (auto &correction : drifted)
+            {
+                if (correction.attempted && (result.failedId.empty() || correction.id == result.failedId))
+                {
+                    correction.code = result.code;
+                    correction.message = result.message;
+                }
+            }
+            if (result.failedId.empty())
+            {
+                break;
+            }
+            batch.erase(std::remove_if(batch.begin(), batch.end(), [&](const TopologyDevice &device)
+                                       { return device.id == result.failedId; }),
+                        batch.end());
+        }
+
+        Clock::time_point retryAt;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Clock::time_point now = Clock::now();
+            for (const auto &correction : drifted)
+            {
+                auto target = targets_.find(correction.id);
+                if (!correction.attempted || target == targets_.end())
+                {
+                    continue;
+                }
+
+                Target &state = target->second;
+                ReconcileEvent event;
+                event.id = correction.id;
+                event.from = correction.from;
+                event.to = correction.target.mode;
+                event.code = correction.code;
+                if (correction.code == kDispChangeSuccessful && !correction.applied)
+                {
+                    // Back in its desired state before the mode-set
+                    state.failures = 0;
+                    continue;
+                }
+                if (correction.code == kDispChangeSuccessful)
+                {
+                    stats_.corrected++;
+                    state.failures = 0;
+                    event.kind = ReconcileEvent::Kind::Corrected;
+                    event.message = DescribeDisplayChangeCode(correction.code);
+                }
+                else
+                {
+                    stats_.failed++;
+                    state.failures++;
+                    // minBackoff doubled per further failure, capped at maxBackoff
+                    std::chrono::milliseconds backoff = options.minBackoff;
+                    for (uint32_t i = 1; i < state.failures && backoff < options.maxBackoff; i++)
+                    {
+                        backoff *= 2;
+                    }
+                    backoff = std::min(backoff, options.maxBackoff);
+                    state.retryAt = now + backoff;
+
+                    event.kind = ReconcileEvent::Kind::Failed;
+                    event.message = correction.message;
+                    event.failures = state.failures;
+                    event.retryAfter = backoff;
+                }
+                events.push_back(std::move(event));
+            }
+            retryAt = NextRetry(now);
+        }
+
+        for (const auto &event : events)
+        {
+            onEvent_(event);
+        }
+        return retryAt;
+    }
+}
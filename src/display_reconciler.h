@@ -0,0 +1,183 @@
+#ifndef MONITORRES_DISPLAY_RECONCILER_H_
+#define MONITORRES_DISPLAY_RECONCILER_H_
+
+#include "display_backend.h"
+#include "display_events.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace monitorres
+{
+    // The state a device is kept in. Fields without their has* flag set are
+    // not reconciled and keep whatever the device runs.
+    struct DesiredDisplayState
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Only compared when hasRefreshRate is set; a correction otherwise
+        // uses the supported rate closest to the current one
+        uint32_t refreshRate = 0;
+        bool hasRefreshRate = false;
+        int32_t positionX = 0;
+        int32_t positionY = 0;
+        bool hasPosition = false;
+        bool primary = false;
+        bool hasPrimary = false;
+    };
+
+    // Timing of the reconciler
+    struct ReconcilerOptions
+    {
+        // How often devices are checked when no display signal arrives; the
+        // only check for backends without an event source
+        std::chrono::milliseconds interval{1000};
+        // Wait before retrying a device whose correction failed, doubling
+        // with every further failure up to maxBackoff
+        std::chrono::milliseconds minBackoff{1000};
+        std::chrono::milliseconds maxBackoff{60000};
+        // Corrections of one device allowed in any 60 second window; drift
+        // beyond that is left alone until the window has room again
+        uint32_t maxCorrectionsPerMinute = 6;
+    };
+
+    // What the reconciler did about one drifted device
+    struct ReconcileEvent
+    {
+        enum class Kind
+        {
+            // The desired state was applied
+            Corrected,
+            // The correction failed; it is retried after retryAfter
+            Failed,
+            // The device drifted again after maxCorrectionsPerMinute
+            // corrections; reported once per window
+            RateLimited
+        };
+
+        Kind kind = Kind::Corrected;
+        std::string id;
+        // The state the device drifted to and the state it was put back in
+        DisplayMode from;
+        DisplayMode to;
+        long code = kDispChangeSuccessful;
+        std::string message;
+        // Consecutive failed corrections of the device, this one included
+        uint32_t failures = 0;
+        std::chrono::milliseconds retryAfter{0};
+    };
+
+    // Counters of a reconciler
+    struct ReconcilerStats
+    {
+        // Passes over the desired devices
+        uint64_t passes = 0;
+        // Devices found drifted, counted once per pass
+        uint64_t drifted = 0;
+        uint64_t corrected = 0;
+        uint64_t failed = 0;
+        // Drifted devices skipped because of the rate limit
+        uint64_t rateLimited = 0;
+        // Drifted devices skipped because they were backing off after a failure
+        uint64_t backedOff = 0;
+        // Devices with a desired state
+        size_t devices = 0;
+    };
+
+    // Keeps devices in a desired state. Runs a thread that checks each
+    // device with a desired state after display signals have gone quiet and
+    // at least every interval. A check reads only the current mode of each
+    // device, plus the device list when a state pins the primary display.
+    // Drifted devices are put back with RestoreTopology, in a single mode-set
+    // covering all of them; a device that rejects its state is backed off
+    // and the others are retried without it.
+    class DisplayReconciler
+    {
+    public:
+        using EventCallback = std::function<void(const ReconcileEvent &)>;
+
+        DisplayReconciler(std::shared_ptr<DisplayBackend> backend, EventCallback onEvent);
+        ~DisplayReconciler();
+
+        DisplayReconciler(const DisplayReconciler &) = delete;
+        DisplayReconciler &operator=(const DisplayReconciler &) = delete;
+
+        // Check state against the modes the device lists and keep the device
+        // in it from the next pass on; returns false with a reason if the
+        // device does not support the mode
+        bool SetDesired(const std::string &id, const DesiredDisplayState &state, std::string &error);
+
+        // Stop reconciling a device; returns false if it had no desired state
+        bool ClearDesired(const std::string &id);
+        void ClearAll();
+
+        // Number of devices with a desired state
+        size_t Size();
+
+        // Takes effect on the next pass
+        void SetOptions(const ReconcilerOptions &options);
+
+        // Start the thread and listen to source, which may be null
+        void Start(std::shared_ptr<DisplayEventSource> source);
+        void Stop();
+
+        // Reconcile on backend from now on, listening to source instead;
+        // failures, backoff and rate limits start over. Safe to call from any
+        // thread, but not concurrently with Start or Stop.
+        void Rebind(std::shared_ptr<DisplayBackend> backend, std::shared_ptr<DisplayEventSource> source);
+
+        // Run a pass soon, as if a display signal had arrived; safe to call from any thread
+        void Notify();
+
+        ReconcilerStats Stats();
+
+    private:
+        // A device with a desired state
+        struct Target
+        {
+            DesiredDisplayState desired;
+            uint32_t failures = 0;
+            std::chrono::steady_clock::time_point retryAt;
+            // Start times of the corrections in the last 60 seconds
+            std::deque<std::chrono::steady_clock::time_point> corrections;
+            // Set once the rate limit was reported, until the window has room
+            bool rateLimitReported = false;
+        };
+
+        void Run();
+
+        // Check every target and correct the drifted ones; returns the
+        // earliest time a backed off target may be retried
+        std::chrono::steady_clock::time_point Reconcile();
+
+        // Caller must hold mutex_; the earliest future time a failed target may be retried
+        std::chrono::steady_clock::time_point NextRetry(std::chrono::steady_clock::time_point now) const;
+
+        // Guarded by mutex_; passes work on a copy
+        std::shared_ptr<DisplayBackend> backend_;
+        EventCallback onEvent_;
+        std::shared_ptr<DisplayEventSource> source_;
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::map<std::string, Target> targets_;
+        ReconcilerOptions options_;
+        ReconcilerStats stats_;
+        bool stopping_ = false;
+        // Set by Notify and SetDesired until the next pass starts
+        bool pending_ = false;
+        std::chrono::steady_clock::time_point lastSignal_;
+
+        std::thread thread_;
+    };
+}
+
+#endif
@@ -0,0 +1,389 @@
+#include "display_reconciler_wrap.h"
+
+#include "marshal.h"
+#include "monitorres_addon.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        const char *ReconcileEventType(ReconcileEvent::Kind kind)
+        {
+            switch (kind)
+            {
+            case ReconcileEvent::Kind::Corrected:
+                return "corrected";
+            case ReconcileEvent::Kind::Failed:
+                return "failed";
+            case ReconcileEvent::Kind::RateLimited:
+                return "rateLimited";
+            }
+            return "";
+        }
+
+        Napi::Object SettingsToValue(Napi::Env env, const DisplayMode &mode)
+        {
+            napi_value position[] = {
+                Napi::Number::New(env, mode.positionX),
+                Napi::Number::New(env, mode.positionY)};
+            napi_value settings[] = {
+                Napi::Number::New(env, mode.width),
+                Napi::Number::New(env, mode.height),
+                Napi::Number::New(env, mode.refreshRate),
+                Napi::Number::New(env, mode.bitsPerPixel),
+                Napi::Number::New(env, mode.orientation),
+                NewShapedObject(env, ObjectShape::Position, position)};
+            return NewShapedObject(env, ObjectShape::MonitorSettings, settings);
+        }
+
+        void CallEventCallback(Napi::Env env, Napi::Function callback, ReconcileEvent *event)
+        {
+            std::unique_ptr<ReconcileEvent> owned(event);
+            if (env == nullptr || callback.IsEmpty() || !CanCallIntoJs(env))
+            {
+                return;
+            }
+
+            napi_value values[] = {
+                Napi::String::New(env, ReconcileEventType(event->kind)),
+                Napi::String::New(env, event->id),
+                SettingsToValue(env, event->from),
+                SettingsToValue(env, event->to),
+                Napi::Number::New(env, event->code),
+                Napi::String::New(env, event->message),
+                Napi::Number::New(env, event->failures),
+                Napi::Number::New(env, static_cast<double>(event->retryAfter.count()))};
+
+            callback.Call({NewShapedObject(env, ObjectShape::ReconcileEvent, values)});
+        }
+
+        void AddStats(ReconcilerStats &total, const ReconcilerStats &stats)
+        {
+            total.passes += stats.passes;
+            total.drifted += stats.drifted;
+            total.corrected += stats.corrected;
+            total.failed += stats.failed;
+            total.rateLimited += stats.rateLimited;
+            total.backedOff += stats.backedOff;
+        }
+
+        // Read a positive number of milliseconds from an options object, throwing if it is not one
+        bool ReadMilliseconds(Napi::Env env, Napi::Object options, const char *name, std::chrono::milliseconds &value)
+        {
+            Napi::Value field = options.Get(name);
+            if (field.IsUndefined())
+            {
+                return true;
+            }
+            if (!field.IsNumber() || field.As<Napi::Number>().DoubleValue() < 1)
+            {
+                Napi::TypeError::New(env, std::string(name) + " must be a positive number of milliseconds").ThrowAsJavaScriptException();
+                return false;
+            }
+            value = std::chrono::milliseconds(field.As<Napi::Number>().Uint32Value());
+            return true;
+        }
+
+        // Read the state argument of setDesiredState, throwing if it is invalid
+        bool ParseDesiredState(Napi::Env env, Napi::Value value, DesiredDisplayState &state)
+        {
+            if (!value.IsObject())
+            {
+                Napi::TypeError::New(env, "Desired state must be an object with width and height").ThrowAsJavaScriptException();
+                return false;
+            }
+
+            Napi::Object object = value.As<Napi::Object>();
+            Napi::Value width = object.Get("width");
+            Napi::Value height = object.Get("height");
+            if (!width.IsNumber() || !height.IsNumber() ||
+                width.As<Napi::Number>().DoubleValue() < 1 || height.As<Napi::Number>().DoubleValue() < 1)
+            {
+                Napi::TypeError::New(env, "Width and height must be positive numbers").ThrowAsJavaScriptException();
+                return false;
+            }
+            state.width = width.As<Napi::Number>().Uint32Value();
+            state.height = height.As<Napi::Number>().Uint32Value();
+
+            Napi::Value refreshRate = object.Get("refreshRate");
+            if (!refreshRate.IsUndefined())
+            {
+                if (!refreshRate.IsNumber())
+                {
+                    Napi::TypeError::New(env, "Refresh rate must be a number").ThrowAsJavaScriptException();
+                    return false;
+                }
+                state.refreshRate = refreshRate.As<Napi::Number>().Uint32Value();
+                state.hasRefreshRate = true;
+            }
+
+            Napi::Value position = object.Get("position");
+            if (!position.IsUndefined())
+            {
+                Napi::Value x = position.IsObject() ? position.As<Napi::Object>().Get("x") : env.Undefined();
+                Napi::Value y = position.IsObject() ? position.As<Napi::Object>().Get("y") : env.Undefined();
+                if (!x.IsNumber() || !y.IsNumber())
+                {
+                    Napi::TypeError::New(env, "Position must be an object with numbers x and y").ThrowAsJavaScriptException();
+                    return false;
+                }
+                state.positionX = x.As<Napi::Number>().Int32Value();
+                state.positionY = y.As<Napi::Number>().Int32Value();
+                state.hasPosition = true;
+            }
+
+            Napi::Value primary = object.Get("primary");
+            if (!primary.IsUndefined())
+            {
+                if (!primary.IsBoolean())
+                {
+                    Napi::TypeError::New(env, "Primary must be a boolean").ThrowAsJavaScriptException();
+                    return false;
+                }
+                state.primary = primary.As<Napi::Boolean>().Value();
+                state.hasPrimary = true;
+            }
+            return true;
+        }
+    }
+
+    ReconcilerState::~ReconcilerState()
+    {
+        StopReconciler();
+    }
+
+    bool ReconcilerState::SetDesired(Napi::Env env, std::shared_ptr<DisplayBackend> backend, Napi::Function callback,
+                                     const std::string &id, const DesiredDisplayState &state, std::string &error)
+    {
+        if (!reconciler_)
+        {
+            eventCallback_ = Napi::ThreadSafeFunction::New(env, callback, "monitorres:reconcile", 0, 1);
+
+            reconciler_.reset(new DisplayReconciler(backend, [this](const ReconcileEvent &event)
+                                                    {
+                ReconcileEvent *queued = new ReconcileEvent(event);
+                if (eventCallback_.NonBlockingCall(queued, CallEventCallback) != napi_ok)
+                {
+                    delete queued;
+                } }));
+            reconciler_->SetOptions(options_);
+            reconciler_->Start(backend->CreateEventSource());
+            backendListener_ = AddDisplayBackendListener([this](const std::shared_ptr<DisplayBackend> &active)
+                                                          { reconciler_->Rebind(active, active->CreateEventSource()); });
+
+            cleanupHook_ = env.AddCleanupHook(OnEnvironmentCleanup, this);
+        }
+
+        if (!reconciler_->SetDesired(id, state, error))
+        {
+            if (reconciler_->Size() == 0)
+            {
+                Stop(env);
+            }
+            return false;
+        }
+        return true;
+    }
+
+    void ReconcilerState::ClearDesired(Napi::Env env, const std::string &id)
+    {
+        if (!reconciler_)
+        {
+            return;
+        }
+
+        if (id.empty())
+        {
+            reconciler_->ClearAll();
+        }
+        else
+        {
+            reconciler_->ClearDesired(id);
+        }
+
+        if (reconciler_->Size() == 0)
+        {
+            Stop(env);
+        }
+    }
+
+    void ReconcilerState::SetOptions(const ReconcilerOptions &options)
+    {
+        options_ = options;
+        if (reconciler_)
+        {
+            reconciler_->SetOptions(options);
+        }
+    }
+
+    ReconcilerStats ReconcilerState::Stats()
+    {
+        ReconcilerStats stats = finished_;
+        if (reconciler_)
+        {
+            ReconcilerStats running = reconciler_->Stats();
+            AddStats(stats, running);
+            stats.devices = running.devices;
+        }
+        return stats;
+    }
+
+    void ReconcilerState::Stop(Napi::Env env)
+    {
+        if (!cleanupHook_.IsEmpty())
+        {
+            cleanupHook_.Remove(env);
+            cleanupHook_ = Napi::Env::CleanupHook<void (*)(ReconcilerState *), ReconcilerState>();
+        }
+        StopReconciler();
+    }
+
+    void ReconcilerState::StopReconciler()
+    {
+        if (!reconciler_)
+        {
+            return;
+        }
+
+        // No swap can move the reconciler once this returns
+        RemoveDisplayBackendListener(backendListener_);
+        backendListener_ = 0;
+
+        // Joins the reconciler thread, so nothing queues calls after this
+        reconciler_->Stop();
+        AddStats(finished_, reconciler_->Stats());
+        reconciler_.reset();
+        eventCallback_.Release();
+    }
+
+    void ReconcilerState::OnEnvironmentCleanup(ReconcilerState *state)
+    {
+        state->StopReconciler();
+    }
+
+    Napi::Value SetDesiredState(const Napi::CallbackInfo &info)
+    {
+        MONITORRES_TIME_EXPORT("setDesiredState");
+        Napi::Env env = info.Env();
+
+        try
+        {
+            if (info.Length() < 3 || !info[0].IsString() || !info[2].IsFunction())
+            {
+                Napi::TypeError::New(env, "Expected a monitor ID, a desired state and a callback function").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+
+            std::string id = info[0].As<Napi::String>().Utf8Value();
+            if (id.empty())
+            {
+                Napi::TypeError::New(env, "Monitor ID must not be empty").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+
+            DesiredDisplayState state;
+            if (!ParseDesiredState(env, info[1], state))
+            {
+                return env.Null();
+            }
+
+            std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+            if (!backend)
+            {
+                return env.Null();
+            }
+
+            std::string error;
+            if (!MonitorresAddon::Of(env).Reconciler().SetDesired(env, backend, info[2].As<Napi::Function>(), id, state, error))
+            {
+                Napi::Error::New(env, error).ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            return env.Undefined();
+        }
+        catch (const std::exception &e)
+        {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value ClearDesiredState(const Napi::CallbackInfo &info)
+    {
+        MONITORRES_TIME_EXPORT("clearDesiredState");
+        Napi::Env env = info.Env();
+
+        std::string id;
+        if (info.Length() >= 1 && !info[0].IsUndefined())
+        {
+            if (!info[0].IsString())
+            {
+                Napi::TypeError::New(env, "Monitor ID must be a string").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            id = info[0].As<Napi::String>().Utf8Value();
+        }
+
+        MonitorresAddon::Of(env).Reconciler().ClearDesired(env, id);
+        return env.Undefined();
+    }
+
+    Napi::Value SetReconcilerOptions(const Napi::CallbackInfo &info)
+    {
+        MONITORRES_TIME_EXPORT("setReconcilerOptions");
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsObject())
+        {
+            Napi::TypeError::New(env, "Expected an options object").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::Object object = info[0].As<Napi::Object>();
+        ReconcilerOptions options;
+        if (!ReadMilliseconds(env, object, "intervalMs", options.interval) ||
+            !ReadMilliseconds(env, object, "minBackoffMs", options.minBackoff) ||
+            !ReadMilliseconds(env, object, "maxBackoffMs", options.maxBackoff))
+        {
+            return env.Null();
+        }
+
+        Napi::Value maxCorrections = object.Get("maxCorrectionsPerMinute");
+        if (!maxCorrections.IsUndefined())
+        {
+            if (!maxCorrections.IsNumber() || maxCorrections.As<Napi::Number>().DoubleValue() < 1)
+            {
+                Napi::TypeError::New(env, "maxCorrectionsPerMinute must be a positive number").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            options.maxCorrectionsPerMinute = maxCorrections.As<Napi::Number>().Uint32Value();
+        }
+
+        if (options.maxBackoff < options.minBackoff)
+        {
+            Napi::RangeError::New(env, "maxBackoffMs must not be less than minBackoffMs").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        MonitorresAddon::Of(env).Reconciler().SetOptions(options);
+        return env.Undefined();
+    }
+
+    Napi::Value GetReconcilerStats(const Napi::CallbackInfo &info)
+    {
+        MONITORRES_TIME_EXPORT("getReconcilerStats");
+        Napi::Env env = info.Env();
+
+        ReconcilerStats stats = MonitorresAddon::Of(env).Reconciler().Stats();
+
+        Napi::Object result = NewObject(env);
+        result.Set("devices", Napi::Number::New(env, static_cast<double>(stats.devices)));
+        result.Set("passes", Napi::Number::New(env, static_cast<double>(stats.passes)));
+        result.Set("drifted", Napi::Number::New(env, static_cast<double>(stats.drifted)));
+        result.Set("corrected", Napi::Number::New(env, static_cast<double>(stats.corrected)));
+        result.Set("failed", Napi::Number::New(env, static_cast<double>(stats.failed)));
+        result.Set("rateLimited", Napi::Number::New(env, static_cast<double>(stats.rateLimited)));
+        result.Set("backedOff", Napi::Number::New(env, static_cast<double>(stats.backedOff)));
+        return result;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef MONITORRES_DISPLAY_RECONCILER_WRAP_H_
+#define MONITORRES_DISPLAY_RECONCILER_WRAP_H_
+
+#include <napi.h>
+
+#include <memory>
+#include <string>
+
+#include "display_reconciler.h"
+
+namespace monitorres
+{
+    // The display reconciler of one environment, owned by its
+    // MonitorresAddon. It runs while at least one device has a desired
+    // state and keeps the environment's event loop alive meanwhile. When
+    // the active backend is replaced, it moves to the new one.
+    class ReconcilerState
+    {
+    public:
+        ~ReconcilerState();
+
+        // Keep a device in state, starting the reconciler on backend with
+        // callback for its events if it is not running; returns false with
+        // a reason if the device does not support the mode
+        bool SetDesired(Napi::Env env, std::shared_ptr<DisplayBackend> backend, Napi::Function callback,
+                        const std::string &id, const DesiredDisplayState &state, std::string &error);
+
+        // Stop reconciling a device, or every device if id is empty; the
+        // reconciler stops with the last device
+        void ClearDesired(Napi::Env env, const std::string &id);
+
+        void SetOptions(const ReconcilerOptions &options);
+
+        // Counters of every reconciler this environment ran
+        ReconcilerStats Stats();
+
+    private:
+        void Stop(Napi::Env env);
+
+        // Stop the reconciler thread and release the callback
+        void StopReconciler();
+
+        static void OnEnvironmentCleanup(ReconcilerState *state);
+
+        std::unique_ptr<DisplayReconciler> reconciler_;
+        // Moves the reconciler to a new active backend; 0 while it is stopped
+        uint64_t backendListener_ = 0;
+        Napi::ThreadSafeFunction eventCallback_;
+        ReconcilerOptions options_;
+        // Counters of the reconcilers stopped so far
+        ReconcilerStats finished_;
+        // Stops the reconciler thread before the environment goes away
+        Napi::Env::CleanupHook<void (*)(ReconcilerState *), ReconcilerState> cleanupHook_;
+    };
+
+    // setDesiredState(monitorId, state, callback): keep a monitor in a mode,
+    // calling callback on the JS thread with each correction
+    Napi::Value SetDesiredState(const Napi::CallbackInfo &info);
+
+    // clearDesiredState([monitorId]): stop keeping one or every monitor in its mode
+    Napi::Value ClearDesiredState(const Napi::CallbackInfo &info);
+
+    // setReconcilerOptions(options): set the interval, backoff and rate limit of the reconciler
+    Napi::Value SetReconcilerOptions(const Napi::CallbackInfo &info);
+
+    // getReconcilerStats(): get the counters of the reconciler
+    Napi::Value GetReconcilerStats(const Napi::CallbackInfo &info);
+}
+
+#endif
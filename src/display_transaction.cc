@@ -0,0 +1,100 @@
+#include "display_transaction.h"
+
+#include <mutex>
+
+#include "desktop_layout.h"
+#include "mode_table.h"
+#include "stats.h"
+
+namespace monitorres
+{
+    ModeChangeResult DisplayTransaction::Add(DisplayBackend &backend, const ModeChangeRequest &request)
+    {
+        ModeChangePlan plan = PlanModeChange(backend, request);
+        if (plan.resolved)
+        {
+            return plan.result;
+        }
+
+        ModeChangeResult result;
+        result.actualRefreshRate = plan.target.refreshRate;
+        if (plan.usesClosestRefreshRate)
+        {
+            result.status = ModeChangeResult::Status::AppliedClosestRefreshRate;
+            result.message = "Will use closest available refresh rate: " + std::to_string(plan.target.refreshRate) + "Hz instead of requested " +
+                             std::to_string(plan.request.refreshRate) + "Hz. Available rates: " + plan.availableRatesStr;
+        }
+
+        // Both spellings of the primary stage a single change
+        plan.request.id = ResolveDeviceId(backend, request.id);
+        for (auto &staged : plans_)
+        {
+            if (staged.request.id == plan.request.id)
+            {
+                staged = std::move(plan);
+                return result;
+            }
+        }
+
+        plans_.push_back(std::move(plan));
+        return result;
+    }
+
+    TransactionResult DisplayTransaction::Commit(DisplayBackend &backend)
+    {
+        MONITORRES_TIME_PHASE("commitTransaction");
+        TransactionResult result;
+        if (plans_.empty())
+        {
+            // Committing would also apply changes staged by someone else
+            result.message = DescribeDisplayChangeCode(result.code);
+            return result;
+        }
+
+        std::lock_guard<std::timed_mutex> lock(ModeChangeMutex());
+        std::vector<std::pair<std::string, DisplayMode>> previousModes;
+
+        for (const auto &plan : plans_)
+        {
+            const std::string &id = plan.request.id;
+
+            DisplayMode previous;
+            bool hasPrevious = backend.GetCurrentMode(id, previous);
+
+            long code = backend.StageMode(id, plan.target);
+            if (code != kDispChangeSuccessful)
+            {
+                if (code == kDispChangeBadMode)
+                {
+                    ModeTables().Invalidate(backend, id);
+                }
+
+                // Put the registry back the way it was for the devices already staged
+                for (const auto &entry : previousModes)
+                {
+                    backend.StageMode(entry.first, entry.second);
+                }
+
+                result.code = code;
+                result.failedId = id;
+                result.message = "Monitor " + id + " rejected " +
+                                 std::to_string(plan.target.width) + "x" + std::to_string(plan.target.height) + "@" +
+                                 std::to_string(plan.target.refreshRate) + "Hz: " + DescribeDisplayChangeCode(code);
+                plans_.clear();
+                return result;
+            }
+
+            if (hasPrevious)
+            {
+                previousModes.emplace_back(id, previous);
+            }
+        }
+
+        plans_.clear();
+
+        result.code = backend.CommitStagedModes();
+        DesktopLayouts().Invalidate();
+        result.message = DescribeDisplayChangeCode(result.code);
+        return result;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef MONITORRES_DISPLAY_TRANSACTION_H_
+#define MONITORRES_DISPLAY_TRANSACTION_H_
+
+#include <string>
+#include <vector>
+
+#include "mode_change.h"
+
+namespace monitorres
+{
+    struct TransactionResult
+    {
+        long code = kDispChangeSuccessful;
+        std::string message;
+        // Device that rejected its mode; empty if the failure was not device specific
+        std::string failedId;
+    };
+
+    // Mode changes for several devices that are applied in one mode-set.
+    //
+    // Changes are validated against the mode tables when they are added. On
+    // commit every change is staged with the backend and the staged set is
+    // applied at once, so a multi-monitor change costs a single mode-set.
+    class DisplayTransaction
+    {
+    public:
+        // Validate a change and add it, replacing an earlier change for the
+        // same device. Rejected and failed changes are not added.
+        ModeChangeResult Add(DisplayBackend &backend, const ModeChangeRequest &request);
+
+        // Stage and apply every change, then clear the transaction. If a
+        // device rejects its change, the devices staged before it are
+        // restaged with their previous modes and nothing is applied.
+        TransactionResult Commit(DisplayBackend &backend);
+
+        void Clear() { plans_.clear(); }
+        size_t Size() const { return plans_.size(); }
+
+    private:
+        std::vector<ModeChangePlan> plans_;
+    };
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include "display_transaction_wrap.h"
+
+#include "marshal.h"
+
+namespace monitorres
+{
+    Napi::Function DisplayTransactionWrap::DefineClass(Napi::Env env)
+    {
+        return Napi::ObjectWrap<DisplayTransactionWrap>::DefineClass(
+            env,
+            "DisplayTransaction",
+            {InstanceMethod("set", &DisplayTransactionWrap::Set),
+             InstanceMethod("commit", &DisplayTransactionWrap::Commit),
+             InstanceMethod("discard", &DisplayTransactionWrap::Discard),
+             InstanceAccessor("size", &DisplayTransactionWrap::GetSize, nullptr)});
+    }
+
+    DisplayTransactionWrap::DisplayTransactionWrap(const Napi::CallbackInfo &info)
+        : Napi::ObjectWrap<DisplayTransactionWrap>(info)
+    {
+    }
+
+    // Validate a monitor's change and stage it in the transaction
+    Napi::Value DisplayTransactionWrap::Set(const Napi::CallbackInfo &info)
+    {
+        MONITORRES_TIME_EXPORT("DisplayTransaction.set");
+        Napi::Env env = info.Env();
+
+        try
+        {
+            ModeChangeRequest request;
+            if (!ParseMonitorModeArguments(info, request))
+            {
+                return env.Null();
+            }
+
+            std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+            if (!backend)
+            {
+                return env.Null();
+            }
+
+            ModeChangeResult result = transaction_.Add(*backend, request);
+            if (result.status == ModeChangeResult::Status::Failed)
+            {
+                Napi::Error::New(env, result.message).ThrowAsJavaScriptException();
+                return env.Null();
+            }
+
+            return ModeChangeResultToValue(env, result);
+        }
+        catch (const std::exception &e)
+        {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // Apply every staged change in one mode-set
+    Napi::Value DisplayTransactionWrap::Commit(const Napi::CallbackInfo &info)
+    {
+        MONITORRES_TIME_EXPORT("DisplayTransaction.commit");
+        Napi::Env env = info.Env();
+
+        try
+        {
+            std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+            if (!backend)
+            {
+                return env.Null();
+            }
+
+            TransactionResult result = transaction_.Commit(*backend);
+            if (result.code == kDispChangeSuccessful)
+            {
+                return Napi::Boolean::New(env, true);
+            }
+
+            Napi::Object error = NewObject(env);
+            error.Set("code", Napi::Number::New(env, result.code));
+            error.Set("message", Napi::String::New(env, result.message));
+            if (!result.failedId.empty())
+            {
+                error.Set("monitorId", Napi::String::New(env, result.failedId));
+            }
+            return error;
+        }
+        catch (const std::exception &e)
+        {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    // Drop every staged change
+    Napi::Value DisplayTransactionWrap::Discard(const Napi::CallbackInfo &info)
+    {
+        transaction_.Clear();
+        return info.Env().Undefined();
+    }
+
+    Napi::Value DisplayTransactionWrap::GetSize(const Napi::CallbackInfo &info)
+    {
+        return Napi::Number::New(info.Env(), static_cast<double>(transaction_.Size()));
+    }
+}
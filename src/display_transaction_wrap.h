@@ -0,0 +1,29 @@
+#ifndef MONITORRES_DISPLAY_TRANSACTION_WRAP_H_
+#define MONITORRES_DISPLAY_TRANSACTION_WRAP_H_
+
+#include <napi.h>
+
+#include "display_transaction.h"
+
+namespace monitorres
+{
+    // JS class DisplayTransaction: stage changes for several monitors with
+    // set() and apply them in one mode-set with commit()
+    class DisplayTransactionWrap : public Napi::ObjectWrap<DisplayTransactionWrap>
+    {
+    public:
+        static Napi::Function DefineClass(Napi::Env env);
+
+        explicit DisplayTransactionWrap(const Napi::CallbackInfo &info);
+
+    private:
+        Napi::Value Set(const Napi::CallbackInfo &info);
+        Napi::Value Commit(const Napi::CallbackInfo &info);
+        Napi::Value Discard(const Napi::CallbackInfo &info);
+        Napi::Value GetSize(const Napi::CallbackInfo &info);
+
+        DisplayTransaction transaction_;
+    };
+}
+
+#endif
@@ -0,0 +1,172 @@
+#include "display_watcher_wrap.h"
+
+#include "marshal.h"
+#include "monitorres_addon.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        Napi::Array ToStringArray(Napi::Env env, const std::vector<std::string> &values)
+        {
+            Napi::Array array = NewArray(env, values.size());
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                array.Set(static_cast<uint32_t>(i), Napi::String::New(env, values[i]));
+            }
+            return array;
+        }
+
+        void CallChangeCallback(Napi::Env env, Napi::Function callback, DisplayChangeEvent *event)
+        {
+            std::unique_ptr<DisplayChangeEvent> owned(event);
+            if (env == nullptr || callback.IsEmpty() || !CanCallIntoJs(env))
+            {
+                return;
+            }
+
+            std::vector<std::string> ids;
+            ids.insert(ids.end(), event->added.begin(), event->added.end());
+            ids.insert(ids.end(), event->removed.begin(), event->removed.end());
+            ids.insert(ids.end(), event->changed.begin(), event->changed.end());
+
+            napi_value values[] = {
+                ToStringArray(env, ids),
+                ToStringArray(env, event->added),
+                ToStringArray(env, event->removed),
+                ToStringArray(env, event->changed),
+                Napi::Number::New(env, event->signals)};
+
+            callback.Call({NewShapedObject(env, ObjectShape::DisplayChangeEvent, values)});
+        }
+    }
+
+    DisplayWatcherState::~DisplayWatcherState()
+    {
+        StopWatcher();
+    }
+
+    bool DisplayWatcherState::Start(Napi::Env env, std::shared_ptr<DisplayBackend> backend, Napi::Function callback)
+    {
+        Stop(env);
+
+        changeCallback_ = Napi::ThreadSafeFunction::New(env, callback, "monitorres:displayChange", 0, 1);
+
+        watcher_.reset(new DisplayChangeWatcher(backend, [this](const DisplayChangeEvent &event)
+                                                {
+            DisplayChangeEvent *queued = new DisplayChangeEvent(event);
+            if (changeCallback_.NonBlockingCall(queued, CallChangeCallback) != napi_ok)
+            {
+                delete queued;
+            } }));
+        watcher_->SetCoalesceWindow(coalesceWindow_);
+
+        if (!watcher_->Start(backend->CreateEventSource()))
+        {
+            watcher_.reset();
+            changeCallback_.Release();
+            return false;
+        }
+        backendListener_ = AddDisplayBackendListener([this](const std::shared_ptr<DisplayBackend> &active)
+                                                      { watcher_->Rebind(active, active->CreateEventSource()); });
+
+        cleanupHook_ = env.AddCleanupHook(OnEnvironmentCleanup, this);
+        return true;
+    }
+
+    void DisplayWatcherState::Stop(Napi::Env env)
+    {
+        if (!cleanupHook_.IsEmpty())
+        {
+            cleanupHook_.Remove(env);
+            cleanupHook_ = Napi::Env::CleanupHook<void (*)(DisplayWatcherState *), DisplayWatcherState>();
+        }
+        StopWatcher();
+    }
+
+    void DisplayWatcherState::SetCoalesceWindow(std::chrono::milliseconds window)
+    {
+        coalesceWindow_ = window;
+        if (watcher_)
+        {
+            watcher_->SetCoalesceWindow(window);
+        }
+    }
+
+    void DisplayWatcherState::StopWatcher()
+    {
+        if (!watcher_)
+        {
+            return;
+        }
+
+        // No swap can move the watcher once this returns
+        RemoveDisplayBackendListener(backendListener_);
+        backendListener_ = 0;
+
+        // Joins the watcher thread, so nothing queues calls after this
+        watcher_->Stop();
+        watcher_.reset();
+        changeCallback_.Release();
+    }
+
+    void DisplayWatcherState::OnEnvironmentCleanup(DisplayWatcherState *state)
+    {
+        state->StopWatcher();
+    }
+
+    Napi::Value StartDisplayWatcher(const Napi::CallbackInfo &info)
+    {
+        MONITORRES_TIME_EXPORT("startDisplayWatcher");
+        Napi::Env env = info.Env();
+
+        try
+        {
+            if (info.Length() < 1 || !info[0].IsFunction())
+            {
+                Napi::TypeError::New(env, "Expected a callback function").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+
+            std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+            if (!backend)
+            {
+                return env.Null();
+            }
+
+            if (!MonitorresAddon::Of(env).Watcher().Start(env, backend, info[0].As<Napi::Function>()))
+            {
+                Napi::Error::New(env, "Failed to start listening for display changes").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            return env.Undefined();
+        }
+        catch (const std::exception &e)
+        {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value StopDisplayWatcher(const Napi::CallbackInfo &info)
+    {
+        MONITORRES_TIME_EXPORT("stopDisplayWatcher");
+        MonitorresAddon::Of(info.Env()).Watcher().Stop(info.Env());
+        return info.Env().Undefined();
+    }
+
+    Napi::Value SetDisplayChangeCoalescing(const Napi::CallbackInfo &info)
+    {
+        MONITORRES_TIME_EXPORT("setDisplayChangeCoalescing");
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber() || info[0].As<Napi::Number>().DoubleValue() < 0)
+        {
+            Napi::TypeError::New(env, "Expected a non-negative number of milliseconds").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        MonitorresAddon::Of(env).Watcher().SetCoalesceWindow(std::chrono::milliseconds(info[0].As<Napi::Number>().Uint32Value()));
+        return env.Undefined();
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef MONITORRES_DISPLAY_WATCHER_WRAP_H_
+#define MONITORRES_DISPLAY_WATCHER_WRAP_H_
+
+#include <napi.h>
+
+#include <chrono>
+#include <memory>
+
+#include "display_events.h"
+
+namespace monitorres
+{
+    // The display watcher of one environment, owned by its MonitorresAddon,
+    // so the main thread and each worker subscribe independently. When the
+    // active backend is replaced, it moves to the new one.
+    class DisplayWatcherState
+    {
+    public:
+        ~DisplayWatcherState();
+
+        // Start watching backend, replacing a running watcher; false if the
+        // backend cannot report display changes
+        bool Start(Napi::Env env, std::shared_ptr<DisplayBackend> backend, Napi::Function callback);
+
+        // Stop watching; no callback runs afterwards
+        void Stop(Napi::Env env);
+
+        void SetCoalesceWindow(std::chrono::milliseconds window);
+
+    private:
+        // Stop the watcher thread and release the callback
+        void StopWatcher();
+
+        static void OnEnvironmentCleanup(DisplayWatcherState *state);
+
+        std::unique_ptr<DisplayChangeWatcher> watcher_;
+        // Moves the watcher to a new active backend; 0 while it is stopped
+        uint64_t backendListener_ = 0;
+        Napi::ThreadSafeFunction changeCallback_;
+        std::chrono::milliseconds coalesceWindow_ = kDefaultCoalesceWindow;
+        // Stops the watcher thread before the environment goes away
+        Napi::Env::CleanupHook<void (*)(DisplayWatcherState *), DisplayWatcherState> cleanupHook_;
+    };
+
+    // startDisplayWatcher(callback): watch the active backend for display
+    // changes and call callback on the JS thread with each coalesced event
+    Napi::Value StartDisplayWatcher(const Napi::CallbackInfo &info);
+
+    // stopDisplayWatcher(): stop watching; no callback runs afterwards
+    Napi::Value StopDisplayWatcher(const Napi::CallbackInfo &info);
+
+    // setDisplayChangeCoalescing(ms): set the quiet period that ends a burst of display messages
+    Napi::Value SetDisplayChangeCoalescing(const Napi::CallbackInfo &info);
+}
+
+#endif
@@ -0,0 +1,398 @@
+#ifndef _WIN32
+
+#include "display_backend.h"
+#include "display_events.h"
+#include "edid.h"
+#include "stats.h"
+
+#include <dirent.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+namespace monitorres
+{
+    namespace
+    {
+        // Bits per pixel of the XRGB8888 framebuffers DRM drivers scan out by default
+        const uint32_t kDrmBitsPerPixel = 32;
+
+        struct DrmConnector
+        {
+            DisplayDevice device;
+            std::vector<DisplayMode> modes;
+        };
+
+        // Read a whole sysfs attribute; returns an empty string if it does not exist
+        std::string ReadAttribute(const std::string &path)
+        {
+            std::ifstream file(path, std::ios::binary);
+            return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        // Read a one-word attribute such as status or enabled
+        std::string ReadWord(const std::string &path)
+        {
+            std::string value = ReadAttribute(path);
+            value.erase(std::find_if(value.begin(), value.end(), [](char c)
+                                     { return c == '\n' || c == ' '; }),
+                        value.end());
+            return value;
+        }
+
+        // Connector directories are named card<N>-<type>-<index>, e.g. card0-HDMI-A-1
+        bool IsConnectorName(const std::string &name)
+        {
+            if (name.compare(0, 4, "card") != 0)
+            {
+                return false;
+            }
+
+            size_t i = 4;
+            while (i < name.size() && name[i] >= '0' && name[i] <= '9')
+            {
+                i++;
+            }
+            return i > 4 && i + 1 < name.size() && name[i] == '-';
+        }
+
+        // Parse the modes attribute, one WIDTHxHEIGHT per line with the
+        // preferred mode first. The kernel does not list refresh rates, so
+        // they are reported as 0.
+        std::vector<DisplayMode> ParseModes(const std::string &text)
+        {
+            std::vector<DisplayMode> modes;
+
+            size_t start = 0;
+            while (start < text.size())
+            {
+                size_t end = text.find('\n', start);
+                if (end == std::string::npos)
+                {
+                    end = text.size();
+                }
+
+                unsigned int width = 0;
+                unsigned int height = 0;
+                if (sscanf(text.substr(start, end - start).c_str(), "%ux%u", &width, &height) == 2)
+                {
+                    DisplayMode mode;
+                    mode.width = width;
+                    mode.height = height;
+                    mode.bitsPerPixel = kDrmBitsPerPixel;
+                    modes.push_back(mode);
+                }
+                start = end + 1;
+            }
+
+            return modes;
+        }
+
+        // Build a PnP style id (MONITOR\GSM5B08) from the vendor and product
+        // of the EDID, like the DeviceID Windows reports
+        std::string EdidDeviceId(const std::string &bytes)
+        {
+            std::shared_ptr<const EdidInfo> edid = Edids().Get(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+            if (!edid)
+            {
+                return "";
+            }
+
+            char product[8];
+            snprintf(product, sizeof(product), "%04X", edid->productCode);
+            return "MONITOR\\" + edid->manufacturer + product;
+        }
+
+        // Backend that reads connectors from the DRM class in sysfs. It needs
+        // neither a display server nor DRM master, but sysfs is read-only, so
+        // it can list monitors and modes and cannot change them.
+        class DrmDisplayBackend : public DisplayBackend
+        {
+        public:
+            explicit DrmDisplayBackend(std::string sysfsRoot)
+                : root_(std::move(sysfsRoot))
+            {
+            }
+
+            bool EnumDevice(uint32_t index, DisplayDevice &device) override
+            {
+                MONITORRES_COUNT_OS_CALL(EnumDisplayDevices);
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                // Index 0 starts a new enumeration, so rescan for hotplugged connectors
+                if (index == 0)
+                {
+                    Scan();
+                }
+
+                if (index >= connectors_.size())
+                {
+                    return false;
+                }
+
+                device = connectors_[index].device;
+                return true;
+            }
+
+            bool GetCurrentMode(const std::string &id, DisplayMode &mode) override
+            {
+                MONITORRES_COUNT_OS_CALL(EnumDisplaySettings);
+                std::lock_guard<std::mutex> lock(mutex_);
+                Scan();
+
+                // sysfs does not expose the CRTC's mode; an enabled connector
+                // is driven at its preferred mode unless a compositor changed it
+                const DrmConnector *connector = FindConnector(id);
+                if (connector == nullptr || connector->modes.empty() || !(connector->device.stateFlags & kDeviceActive))
+                {
+                    return false;
+                }
+
+                mode = connector->modes.front();
+                return true;
+            }
+
+            bool GetRegistryMode(const std::string &id, DisplayMode &mode) override
+            {
+                // Nothing is stored apart from the mode the connector runs
+                return GetCurrentMode(id, mode);
+            }
+
+            bool EnumMode(const std::string &id, uint32_t index, DisplayMode &mode) override
+            {
+                MONITORRES_COUNT_OS_CALL(EnumDisplaySettings);
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                // The mode table enumerates from index 0 upwards; only reread the list then
+                if (index == 0 || connectors_.empty())
+                {
+                    Scan();
+                }
+
+                const DrmConnector *connector = FindConnector(id);
+                if (connector == nullptr || index >= connector->modes.size())
+                {
+                    return false;
+                }
+
+                mode = connector->modes[index];
+                return true;
+            }
+
+            long ApplyMode(const std::string &id, const DisplayMode &mode, bool updateRegistry) override
+            {
+                (void)id;
+                (void)mode;
+                (void)updateRegistry;
+                return kDispChangeFailed;
+            }
+
+            long StageMode(const std::string &id, const DisplayMode &mode) override
+            {
+                (void)id;
+                (void)mode;
+                return kDispChangeFailed;
+            }
+
+            long StageDeviceState(const std::string &id, const DisplayMode &mode, bool primary) override
+            {
+                (void)id;
+                (void)mode;
+                (void)primary;
+                return kDispChangeFailed;
+            }
+
+            long CommitStagedModes() override
+            {
+                return kDispChangeFailed;
+            }
+
+            bool GetSystemDpi(int &dpiX, int &dpiY) override
+            {
+                // DRM has no DPI setting; report the default display servers assume
+                dpiX = 96;
+                dpiY = 96;
+                return true;
+            }
+
+            bool GetMonitorGeometry(const std::string &id, MonitorGeometry &geometry) override
+            {
+                DisplayMode mode;
+                if (!GetCurrentMode(id, mode))
+                {
+                    return false;
+                }
+
+                // Without a display server there is no scaling and no taskbar
+                MONITORRES_COUNT_OS_CALL(GetMonitorInfo);
+                geometry = MonitorGeometry();
+                geometry.bounds.x = mode.positionX;
+                geometry.bounds.y = mode.positionY;
+                geometry.bounds.width = static_cast<int32_t>(mode.width);
+                geometry.bounds.height = static_cast<int32_t>(mode.height);
+                geometry.workArea = geometry.bounds;
+
+                std::vector<uint8_t> edidBytes;
+                if (GetEdid(id, edidBytes))
+                {
+                    std::shared_ptr<const EdidInfo> edid = Edids().Get(edidBytes);
+                    if (edid)
+                    {
+                        EdidPanelDpi(*edid, mode.width, mode.height, mode.orientation, geometry.rawDpiX, geometry.rawDpiY);
+                    }
+                }
+                return true;
+            }
+
+            bool GetEdid(const std::string &id, std::vector<uint8_t> &edid) override
+            {
+                std::string path;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (connectors_.empty())
+                    {
+                        Scan();
+                    }
+
+                    const DrmConnector *connector = FindConnector(id);
+                    if (connector == nullptr)
+                    {
+                        return false;
+                    }
+                    path = connector->device.deviceKey;
+                }
+
+                // Disconnected connectors have an empty edid attribute
+                std::string bytes = ReadAttribute(path + "/edid");
+                if (bytes.empty())
+                {
+                    return false;
+                }
+
+                edid.assign(bytes.begin(), bytes.end());
+                return true;
+            }
+
+            bool GetDriverVersion(const std::string &id, std::string &version) override
+            {
+                std::string path;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (connectors_.empty())
+                    {
+                        Scan();
+                    }
+
+                    const DrmConnector *connector = FindConnector(id);
+                    if (connector == nullptr)
+                    {
+                        return false;
+                    }
+                    path = connector->device.deviceKey;
+                }
+
+                // DRM drivers ship with the kernel: the driver the card is bound
+                // to plus the kernel release identify the code that lists modes
+                std::string card = path.substr(0, path.find('-', path.rfind('/')));
+                char driver[256];
+                ssize_t length = readlink((card + "/device/driver").c_str(), driver, sizeof(driver) - 1);
+                std::string name = length > 0 ? std::string(driver, length) : std::string();
+
+                struct utsname system;
+                version = name.substr(name.rfind('/') + 1) + " " + (uname(&system) == 0 ? system.release : "");
+                return true;
+            }
+
+            std::shared_ptr<DisplayEventSource> CreateEventSource() override
+            {
+                return nullptr;
+            }
+
+        private:
+            // Caller must hold mutex_
+            void Scan()
+            {
+                connectors_.clear();
+
+                DIR *dir = opendir(root_.c_str());
+                if (dir == nullptr)
+                {
+                    return;
+                }
+
+                std::vector<std::string> names;
+                while (struct dirent *entry = readdir(dir))
+                {
+                    std::string name = entry->d_name;
+                    if (IsConnectorName(name))
+                    {
+                        names.push_back(name);
+                    }
+                }
+                closedir(dir);
+
+                // readdir order is arbitrary; keep indices stable between scans
+                std::sort(names.begin(), names.end());
+
+                bool hasPrimary = false;
+                for (const auto &name : names)
+                {
+                    std::string path = root_ + "/" + name;
+
+                    DrmConnector connector;
+                    connector.device.id = name;
+                    connector.device.name = name.substr(name.find('-') + 1);
+                    connector.device.deviceId = EdidDeviceId(ReadAttribute(path + "/edid"));
+                    connector.device.deviceKey = path;
+
+                    // Connectors without an enabled attribute are driven whenever connected
+                    std::string enabled = ReadWord(path + "/enabled");
+                    if (ReadWord(path + "/status") == "connected" && enabled != "disabled")
+                    {
+                        connector.device.stateFlags = kDeviceActive;
+
+                        // DRM has no primary display; the first active connector stands in for it
+                        if (!hasPrimary)
+                        {
+                            connector.device.stateFlags |= kDevicePrimary;
+                            hasPrimary = true;
+                        }
+                    }
+
+                    connector.modes = ParseModes(ReadAttribute(path + "/modes"));
+                    connectors_.push_back(std::move(connector));
+                }
+            }
+
+            // Caller must hold mutex_
+            const DrmConnector *FindConnector(const std::string &id) const
+            {
+                for (const auto &connector : connectors_)
+                {
+                    if (id.empty() ? (connector.device.stateFlags & kDevicePrimary) != 0 : connector.device.id == id)
+                    {
+                        return &connector;
+                    }
+                }
+                return nullptr;
+            }
+
+            std::string root_;
+            std::mutex mutex_;
+            std::vector<DrmConnector> connectors_;
+        };
+    }
+
+    std::shared_ptr<DisplayBackend> CreateDrmDisplayBackend(const std::string &sysfsRoot)
+    {
+        return std::make_shared<DrmDisplayBackend>(sysfsRoot);
+    }
+}
+
+#endif
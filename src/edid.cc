@@ -0,0 +1,351 @@
+#include "edid.h"
+
+#include <cstring>
+
+namespace monitorres
+{
+    namespace
+    {
+        const uint8_t kEdidHeader[8] = {0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00};
+
+        // Offsets of the four 18 byte descriptors of the base block
+        const size_t kBaseDescriptorOffsets[4] = {54, 72, 90, 108};
+        const size_t kDescriptorSize = 18;
+
+        const uint8_t kCeaExtensionTag = 0x02;
+        const uint8_t kDisplayIdExtensionTag = 0x70;
+
+        // DisplayID 1.3 Type I and DisplayID 2.0 Type VII detailed timing data blocks
+        const uint8_t kDisplayIdTypeITimingTag = 0x03;
+        const uint8_t kDisplayIdTypeVIITimingTag = 0x22;
+        const size_t kDisplayIdTimingSize = 20;
+
+        // Stop caching new EDIDs past this many; a machine sees a handful of monitors
+        const size_t kMaxCachedEdids = 64;
+
+        bool ChecksumValid(const uint8_t *block)
+        {
+            uint8_t sum = 0;
+            for (size_t i = 0; i < kEdidBlockSize; i++)
+            {
+                sum = static_cast<uint8_t>(sum + block[i]);
+            }
+            return sum == 0;
+        }
+
+        uint32_t RefreshRate(uint64_t pixelClockHz, uint32_t horizontalTotal, uint32_t verticalTotal)
+        {
+            uint64_t pixelsPerFrame = static_cast<uint64_t>(horizontalTotal) * verticalTotal;
+            if (pixelsPerFrame == 0)
+            {
+                return 0;
+            }
+            return static_cast<uint32_t>((pixelClockHz + pixelsPerFrame / 2) / pixelsPerFrame);
+        }
+
+        // Text of a display descriptor: up to 13 bytes ended by a line feed and padded with spaces
+        std::string DescriptorText(const uint8_t *descriptor)
+        {
+            std::string text(reinterpret_cast<const char *>(descriptor + 5), 13);
+            size_t end = text.find('\n');
+            if (end != std::string::npos)
+            {
+                text.erase(end);
+            }
+            text.erase(text.find_last_not_of(' ') + 1);
+            return text;
+        }
+
+        // Parse an 18 byte detailed timing descriptor; returns false if it is a display descriptor
+        bool ParseDetailedTiming(const uint8_t *descriptor, EdidTiming &timing, uint32_t &widthMm, uint32_t &heightMm)
+        {
+            uint32_t pixelClock = descriptor[0] | (descriptor[1] << 8);
+            if (pixelClock == 0)
+            {
+                return false;
+            }
+
+            uint32_t horizontalActive = descriptor[2] | ((descriptor[4] & 0xF0) << 4);
+            uint32_t horizontalBlank = descriptor[3] | ((descriptor[4] & 0x0F) << 8);
+            uint32_t verticalActive = descriptor[5] | ((descriptor[7] & 0xF0) << 4);
+            uint32_t verticalBlank = descriptor[6] | ((descriptor[7] & 0x0F) << 8);
+
+            timing.pixelClockKHz = pixelClock * 10;
+            timing.interlaced = (descriptor[17] & 0x80) != 0;
+            timing.width = horizontalActive;
+            // Interlaced timings describe one field
+            timing.height = timing.interlaced ? verticalActive * 2 : verticalActive;
+            timing.refreshRate = RefreshRate(static_cast<uint64_t>(pixelClock) * 10000, horizontalActive + horizontalBlank, verticalActive + verticalBlank);
+
+            widthMm = descriptor[12] | ((descriptor[14] & 0xF0) << 4);
+            heightMm = descriptor[13] | ((descriptor[14] & 0x0F) << 8);
+            return true;
+        }
+
+        void ParseBaseBlock(const uint8_t *block, EdidInfo &info)
+        {
+            uint16_t vendor = static_cast<uint16_t>((block[8] << 8) | block[9]);
+            info.manufacturer.push_back(static_cast<char>('@' + ((vendor >> 10) & 0x1F)));
+            info.manufacturer.push_back(static_cast<char>('@' + ((vendor >> 5) & 0x1F)));
+            info.manufacturer.push_back(static_cast<char>('@' + (vendor & 0x1F)));
+
+            info.productCode = static_cast<uint16_t>(block[10] | (block[11] << 8));
+            info.serialNumber = static_cast<uint32_t>(block[12]) |
+                                (static_cast<uint32_t>(block[13]) << 8) |
+                                (static_cast<uint32_t>(block[14]) << 16) |
+                                (static_cast<uint32_t>(block[15]) << 24);
+
+            // Week 0xFF marks the year as a model year
+            if (block[16] != 0xFF)
+            {
+                info.manufactureWeek = block[16];
+                info.manufactureYear = block[17] + 1990;
+            }
+
+            info.versionMajor = block[18];
+            info.versionMinor = block[19];
+
+            // Image size in centimeters; the preferred timing usually has it in millimeters
+            info.widthMm = block[21] * 10;
+            info.heightMm = block[22] * 10;
+
+            for (size_t i = 0; i < 4; i++)
+            {
+                const uint8_t *descriptor = block + kBaseDescriptorOffsets[i];
+
+                EdidTiming timing;
+                uint32_t widthMm = 0;
+                uint32_t heightMm = 0;
+                if (ParseDetailedTiming(descriptor, timing, widthMm, heightMm))
+                {
+                    // EDID 1.3 and later always put the preferred timing first
+                    if (i == 0)
+                    {
+                        info.hasPreferredTiming = true;
+                        if (widthMm > 0 && heightMm > 0)
+                        {
+                            info.widthMm = widthMm;
+                            info.heightMm = heightMm;
+                        }
+                    }
+                    info.timings.push_back(timing);
+                    continue;
+                }
+
+                switch (descriptor[3])
+                {
+                case 0xFF:
+                    info.serial = DescriptorText(descriptor);
+                    break;
+                case 0xFC:
+                    info.name = DescriptorText(descriptor);
+                    break;
+                }
+            }
+        }
+
+        // CEA-861 extension: detailed timings follow the data block collection
+        void ParseCeaExtension(const uint8_t *block, EdidInfo &info)
+        {
+            size_t offset = block[2];
+            if (offset < 4)
+            {
+                return;
+            }
+
+            // The last byte is the checksum
+            for (; offset + kDescriptorSize < kEdidBlockSize; offset += kDescriptorSize)
+            {
+                EdidTiming timing;
+                uint32_t widthMm = 0;
+                uint32_t heightMm = 0;
+                if (!ParseDetailedTiming(block + offset, timing, widthMm, heightMm))
+                {
+                    break;
+                }
+                info.timings.push_back(timing);
+            }
+        }
+
+        // DisplayID Type I and Type VII timings share a layout; pixel clocks
+        // are in 10 kHz and 1 kHz units respectively
+        void ParseDisplayIdTiming(const uint8_t *descriptor, uint32_t pixelClockUnitKHz, EdidInfo &info)
+        {
+            EdidTiming timing;
+
+            uint32_t pixelClock = (descriptor[0] | (descriptor[1] << 8) | (descriptor[2] << 16)) + 1;
+            uint32_t horizontalActive = (descriptor[4] | (descriptor[5] << 8)) + 1;
+            uint32_t horizontalBlank = (descriptor[6] | (descriptor[7] << 8)) + 1;
+            uint32_t verticalActive = (descriptor[12] | (descriptor[13] << 8)) + 1;
+            uint32_t verticalBlank = (descriptor[14] | (descriptor[15] << 8)) + 1;
+
+            timing.pixelClockKHz = pixelClock * pixelClockUnitKHz;
+            timing.interlaced = (descriptor[3] & 0x10) != 0;
+            timing.width = horizontalActive;
+            timing.height = timing.interlaced ? verticalActive * 2 : verticalActive;
+            timing.refreshRate = RefreshRate(static_cast<uint64_t>(timing.pixelClockKHz) * 1000, horizontalActive + horizontalBlank, verticalActive + verticalBlank);
+
+            // A preferred DisplayID timing only wins if the base block had none
+            bool preferred = (descriptor[3] & 0x80) != 0;
+            if (preferred && !info.hasPreferredTiming)
+            {
+                info.hasPreferredTiming = true;
+                info.timings.insert(info.timings.begin(), timing);
+            }
+            else
+            {
+                info.timings.push_back(timing);
+            }
+        }
+
+        void ParseDisplayIdExtension(const uint8_t *block, EdidInfo &info)
+        {
+            // Section header: version, payload length, product type, extension count
+            size_t end = 5 + static_cast<size_t>(block[2]);
+            if (end > kEdidBlockSize - 1)
+            {
+                end = kEdidBlockSize - 1;
+            }
+
+            size_t offset = 5;
+            while (offset + 3 <= end)
+            {
+                uint8_t tag = block[offset];
+                size_t length = block[offset + 2];
+                const uint8_t *payload = block + offset + 3;
+                if (offset + 3 + length > end)
+                {
+                    break;
+                }
+
+                if (tag == kDisplayIdTypeITimingTag || tag == kDisplayIdTypeVIITimingTag)
+                {
+                    uint32_t unitKHz = tag == kDisplayIdTypeITimingTag ? 10 : 1;
+                    for (size_t i = 0; i + kDisplayIdTimingSize <= length; i += kDisplayIdTimingSize)
+                    {
+                        ParseDisplayIdTiming(payload + i, unitKHz, info);
+                    }
+                }
+
+                offset += 3 + length;
+            }
+        }
+    }
+
+    bool ParseEdid(const uint8_t *data, size_t size, EdidInfo &info)
+    {
+        if (size < kEdidBlockSize || memcmp(data, kEdidHeader, sizeof(kEdidHeader)) != 0 || !ChecksumValid(data))
+        {
+            return false;
+        }
+
+        info = EdidInfo();
+        ParseBaseBlock(data, info);
+
+        // Byte 126 counts the extension blocks; trust the bytes actually present
+        size_t extensions = data[126];
+        for (size_t i = 1; i <= extensions && (i + 1) * kEdidBlockSize <= size; i++)
+        {
+            const uint8_t *block = data + i * kEdidBlockSize;
+            if (!ChecksumValid(block))
+            {
+                continue;
+            }
+
+            switch (block[0])
+            {
+            case kCeaExtensionTag:
+                ParseCeaExtension(block, info);
+                break;
+            case kDisplayIdExtensionTag:
+                ParseDisplayIdExtension(block, info);
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    uint64_t HashEdid(const std::vector<uint8_t> &edid)
+    {
+        // FNV-1a over 64 bit words; EDIDs are multiples of 128 bytes
+        const uint64_t prime = 1099511628211ULL;
+        uint64_t hash = 14695981039346656037ULL ^ edid.size();
+
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= edid.size(); i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, edid.data() + i, sizeof(word));
+            hash = (hash ^ word) * prime;
+        }
+        for (; i < edid.size(); i++)
+        {
+            hash = (hash ^ edid[i]) * prime;
+        }
+        return hash;
+    }
+
+    bool EdidPanelDpi(const EdidInfo &edid, uint32_t width, uint32_t height, uint32_t orientation, uint32_t &dpiX, uint32_t &dpiY)
+    {
+        if (edid.widthMm == 0 || edid.heightMm == 0)
+        {
+            return false;
+        }
+
+        // The image size is given for the panel's native landscape orientation
+        bool rotated = orientation == 1 || orientation == 3;
+        uint32_t widthMm = rotated ? edid.heightMm : edid.widthMm;
+        uint32_t heightMm = rotated ? edid.widthMm : edid.heightMm;
+
+        dpiX = static_cast<uint32_t>(width * 25.4 / widthMm + 0.5);
+        dpiY = static_cast<uint32_t>(height * 25.4 / heightMm + 0.5);
+        return true;
+    }
+
+    std::shared_ptr<const EdidInfo> EdidCache::Get(const std::vector<uint8_t> &edid)
+    {
+        uint64_t hash = HashEdid(edid);
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto range = entries_.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (it->second.edid == edid)
+                {
+                    return it->second.info;
+                }
+            }
+        }
+
+        // Parse without the lock; a racing parse of the same bytes is harmless
+        std::shared_ptr<EdidInfo> info = std::make_shared<EdidInfo>();
+        if (!ParseEdid(edid.data(), edid.size(), *info))
+        {
+            info.reset();
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto range = entries_.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            // Another thread won the race; hand out its copy so all callers share one
+            if (it->second.edid == edid)
+            {
+                return it->second.info;
+            }
+        }
+
+        if (entries_.size() < kMaxCachedEdids)
+        {
+            entries_.emplace(hash, Entry{edid, info});
+        }
+        return info;
+    }
+
+    EdidCache &Edids()
+    {
+        static EdidCache cache;
+        return cache;
+    }
+}
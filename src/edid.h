@@ -0,0 +1,92 @@
+#ifndef MONITORRES_EDID_H_
+#define MONITORRES_EDID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace monitorres
+{
+    // Size of the EDID base block and of each extension block
+    const size_t kEdidBlockSize = 128;
+
+    // A detailed timing from the base block, a CEA-861 extension or a DisplayID extension
+    struct EdidTiming
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Rounded to the nearest Hz
+        uint32_t refreshRate = 0;
+        uint32_t pixelClockKHz = 0;
+        bool interlaced = false;
+    };
+
+    // The fields of an EDID the addon reports
+    struct EdidInfo
+    {
+        // Three letter PNP vendor id, e.g. GSM
+        std::string manufacturer;
+        uint16_t productCode = 0;
+        uint32_t serialNumber = 0;
+        // Display product serial number descriptor
+        std::string serial;
+        // Display product name descriptor
+        std::string name;
+        // 0 if unspecified or if the year is a model year
+        uint32_t manufactureWeek = 0;
+        uint32_t manufactureYear = 0;
+        uint32_t versionMajor = 0;
+        uint32_t versionMinor = 0;
+        // Physical image size; 0 if unknown (projectors)
+        uint32_t widthMm = 0;
+        uint32_t heightMm = 0;
+        // Whether timings holds a preferred timing; it is then the first entry
+        bool hasPreferredTiming = false;
+        std::vector<EdidTiming> timings;
+    };
+
+    // Parse an EDID with its extension blocks. Returns false if the base
+    // block is missing, has a bad header or fails its checksum. Extension
+    // blocks that fail their checksum are skipped.
+    bool ParseEdid(const uint8_t *data, size_t size, EdidInfo &info);
+
+    // FNV-1a hash of raw EDID bytes
+    uint64_t HashEdid(const std::vector<uint8_t> &edid);
+
+    // Pixel density of a panel showing width x height pixels in an
+    // orientation (0-3, as in DEVMODE), from the image size the EDID
+    // reports. Returns false if it reports none.
+    bool EdidPanelDpi(const EdidInfo &edid, uint32_t width, uint32_t height, uint32_t orientation, uint32_t &dpiX, uint32_t &dpiY);
+
+    // Memoizes parsed EDIDs by content, so monitors are only parsed the first
+    // time they are seen. Monitors report the same bytes on every query.
+    // Lookups share a reader lock, so threads only wait for each other when
+    // a new EDID is added.
+    class EdidCache
+    {
+    public:
+        // Get the parsed EDID, or nullptr if it cannot be parsed
+        std::shared_ptr<const EdidInfo> Get(const std::vector<uint8_t> &edid);
+
+    private:
+        struct Entry
+        {
+            std::vector<uint8_t> edid;
+            std::shared_ptr<const EdidInfo> info;
+        };
+
+        std::shared_mutex mutex_;
+        // Keyed by FNV-1a hash; entries keep the bytes to rule out collisions
+        std::unordered_multimap<uint64_t, Entry> entries_;
+    };
+
+    // The process-wide EDID cache
+    EdidCache &Edids();
+}
+
+#endif
@@ -0,0 +1,46 @@
+#include "inventory.h"
+
+#include <stdexcept>
+#include <string>
+
+#include "monitorres_core.h"
+#include "stats.h"
+#include "worker_pool.h"
+
+namespace monitorres
+{
+    Inventory TakeInventory(DisplayBackend &backend)
+    {
+        MONITORRES_TIME_PHASE("takeInventory");
+
+        MonitorSnapshot snapshot = TakeMonitorSnapshot(backend);
+
+        // Each iteration only writes its own slots, so the fan-out needs no locks
+        Inventory inventory(snapshot.size());
+        std::vector<std::string> errors(snapshot.size());
+        auto readMonitor = [&](size_t i)
+        {
+            InventoryMonitor &monitor = inventory[i];
+            monitor.state = std::move(snapshot[i]);
+            try
+            {
+                monitor.edid = GetMonitorEdid(backend, monitor.state.device.id);
+                monitor.modes = ModeTables().Get(backend, monitor.state.device.id);
+            }
+            catch (const std::exception &e)
+            {
+                errors[i] = "Failed to read monitor " + monitor.state.device.id + ": " + e.what();
+            }
+        };
+        SharedWorkerPool().Run(snapshot.size(), readMonitor);
+
+        for (const auto &error : errors)
+        {
+            if (!error.empty())
+            {
+                throw std::runtime_error(error);
+            }
+        }
+        return inventory;
+    }
+}
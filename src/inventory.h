@@ -0,0 +1,33 @@
+#ifndef MONITORRES_INVENTORY_H_
+#define MONITORRES_INVENTORY_H_
+
+#include "display_backend.h"
+#include "edid.h"
+#include "mode_table.h"
+#include "monitor_snapshot.h"
+
+#include <memory>
+#include <vector>
+
+namespace monitorres
+{
+    // An active monitor with its EDID and mode list
+    struct InventoryMonitor
+    {
+        MonitorState state;
+        // nullptr if the monitor reports no EDID or it does not parse
+        std::shared_ptr<const EdidInfo> edid;
+        std::shared_ptr<const ModeTable> modes;
+    };
+
+    // Every active monitor, in enumeration order
+    using Inventory = std::vector<InventoryMonitor>;
+
+    // Snapshot the active monitors, then read the EDID and mode list of each
+    // one in parallel on the shared worker pool. Mode lists come from the
+    // mode table cache, so only monitors it does not hold are enumerated.
+    // Throws std::runtime_error if reading a monitor failed.
+    Inventory TakeInventory(DisplayBackend &backend);
+}
+
+#endif
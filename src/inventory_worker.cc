@@ -0,0 +1,61 @@
+#include "inventory_worker.h"
+
+#include "marshal.h"
+
+namespace monitorres
+{
+    InventoryWorker::InventoryWorker(Napi::Env env, std::shared_ptr<DisplayBackend> backend)
+        : Napi::AsyncWorker(env, "monitorres:inventory"),
+          deferred_(Napi::Promise::Deferred::New(env)),
+          backend_(std::move(backend))
+    {
+    }
+
+    Napi::Promise InventoryWorker::Promise() const
+    {
+        return deferred_.Promise();
+    }
+
+    void InventoryWorker::Execute()
+    {
+        try
+        {
+            inventory_ = TakeInventory(*backend_);
+        }
+        catch (const std::exception &e)
+        {
+            SetError(e.what());
+        }
+    }
+
+    void InventoryWorker::OnOK()
+    {
+        Napi::Env env = Env();
+        Napi::HandleScope scope(env);
+
+        Napi::Array monitors = NewArray(env, inventory_.size());
+        Napi::Object modes = NewObject(env);
+        for (size_t i = 0; i < inventory_.size(); i++)
+        {
+            const InventoryMonitor &monitor = inventory_[i];
+            monitors.Set(static_cast<uint32_t>(i), MonitorToValue(env, monitor.state, monitor.edid.get()));
+
+            const std::vector<DisplayMode> &list = monitor.modes->Modes();
+            Napi::Array values = NewArray(env, list.size());
+            for (size_t j = 0; j < list.size(); j++)
+            {
+                values.Set(static_cast<uint32_t>(j), ModeToValue(env, list[j]));
+            }
+            modes.Set(monitor.state.device.id, values);
+        }
+
+        napi_value fields[] = {monitors, modes};
+        deferred_.Resolve(NewShapedObject(env, ObjectShape::Inventory, fields));
+    }
+
+    void InventoryWorker::OnError(const Napi::Error &error)
+    {
+        Napi::HandleScope scope(Env());
+        deferred_.Reject(error.Value());
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef MONITORRES_INVENTORY_WORKER_H_
+#define MONITORRES_INVENTORY_WORKER_H_
+
+#include <napi.h>
+
+#include <memory>
+
+#include "monitorres_core.h"
+
+namespace monitorres
+{
+    // Takes a full inventory off the JS thread and settles a promise with
+    // { monitors, modes }: the objects getAllMonitors returns, and each
+    // monitor's mode list keyed by its id
+    class InventoryWorker : public Napi::AsyncWorker
+    {
+    public:
+        InventoryWorker(Napi::Env env, std::shared_ptr<DisplayBackend> backend);
+
+        Napi::Promise Promise() const;
+
+    protected:
+        void Execute() override;
+        void OnOK() override;
+        void OnError(const Napi::Error &error) override;
+
+    private:
+        Napi::Promise::Deferred deferred_;
+        std::shared_ptr<DisplayBackend> backend_;
+        Inventory inventory_;
+    };
+}
+
+#endif
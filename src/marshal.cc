@@ -0,0 +1,670 @@
+#include "marshal.h"
+
+#include <cstdio>
+
+namespace monitorres
+{
+    // Helper function to tell whether env still runs JS
+    bool CanCallIntoJs(Napi::Env env)
+    {
+        napi_value probe;
+        return napi_create_object(env, &probe) == napi_ok && napi_define_properties(env, probe, 0, nullptr) == napi_ok;
+    }
+
+    // Helper function to get the active display backend, throwing if the platform has none
+    std::shared_ptr<DisplayBackend> RequireBackend(Napi::Env env)
+    {
+        std::shared_ptr<DisplayBackend> backend = GetDisplayBackend();
+        if (!backend)
+        {
+            Napi::Error::New(env, "No display backend is available on this platform. Call useSimulatedBackend() to use a simulated one").ThrowAsJavaScriptException();
+        }
+        return backend;
+    }
+
+    namespace
+    {
+        uint32_t RangeBound(Napi::Value value)
+        {
+            double bound = value.As<Napi::Number>().DoubleValue();
+            return bound >= UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(bound);
+        }
+
+        // Read a range constraint: a number for an exact value or {min, max}
+        bool ParseModeRange(Napi::Env env, Napi::Object constraints, const char *name, ModeRange &range)
+        {
+            Napi::Value value = constraints.Get(name);
+            if (value.IsUndefined())
+            {
+                return true;
+            }
+
+            if (value.IsNumber() && value.As<Napi::Number>().DoubleValue() >= 0)
+            {
+                range.min = range.max = RangeBound(value);
+                return true;
+            }
+
+            if (value.IsObject())
+            {
+                Napi::Object bounds = value.As<Napi::Object>();
+                Napi::Value min = bounds.Get("min");
+                Napi::Value max = bounds.Get("max");
+                bool minValid = min.IsUndefined() || (min.IsNumber() && min.As<Napi::Number>().DoubleValue() >= 0);
+                bool maxValid = max.IsUndefined() || (max.IsNumber() && max.As<Napi::Number>().DoubleValue() >= 0);
+                if (minValid && maxValid)
+                {
+                    if (!min.IsUndefined())
+                    {
+                        range.min = RangeBound(min);
+                    }
+                    if (!max.IsUndefined())
+                    {
+                        range.max = RangeBound(max);
+                    }
+                    return true;
+                }
+            }
+
+            Napi::TypeError::New(env, std::string("constraints.") + name + " must be a non-negative number or {min, max}").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        // Read an aspect ratio given as a number or a "16:9" string; returns 0 if it is neither
+        double ParseAspectRatio(Napi::Value value)
+        {
+            if (value.IsNumber())
+            {
+                double ratio = value.As<Napi::Number>().DoubleValue();
+                return ratio > 0 ? ratio : 0;
+            }
+
+            if (value.IsString())
+            {
+                std::string text = value.As<Napi::String>().Utf8Value();
+                unsigned width = 0;
+                unsigned height = 0;
+                char end = 0;
+                if (sscanf(text.c_str(), "%u:%u%c", &width, &height, &end) == 2 && width > 0 && height > 0)
+                {
+                    return static_cast<double>(width) / height;
+                }
+            }
+
+            return 0;
+        }
+
+        bool ParseAspectRatioConstraint(Napi::Env env, Napi::Object constraints, ModeConstraints &query)
+        {
+            Napi::Value value = constraints.Get("aspectRatio");
+            if (value.IsUndefined())
+            {
+                return true;
+            }
+
+            if (value.IsNumber() || value.IsString())
+            {
+                double ratio = ParseAspectRatio(value);
+                if (ratio > 0)
+                {
+                    query.minAspectRatio = ratio * (1 - kAspectRatioTolerance);
+                    query.maxAspectRatio = ratio * (1 + kAspectRatioTolerance);
+                    return true;
+                }
+            }
+            else if (value.IsObject())
+            {
+                Napi::Value min = value.As<Napi::Object>().Get("min");
+                Napi::Value max = value.As<Napi::Object>().Get("max");
+                query.minAspectRatio = ParseAspectRatio(min);
+                query.maxAspectRatio = ParseAspectRatio(max);
+                if ((min.IsUndefined() || query.minAspectRatio > 0) && (max.IsUndefined() || query.maxAspectRatio > 0))
+                {
+                    return true;
+                }
+            }
+
+            Napi::TypeError::New(env, "constraints.aspectRatio must be a ratio such as 1.78 or '16:9', or {min, max} of ratios").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        bool ParseRankField(const std::string &name, ModeRankField &field)
+        {
+            static const struct
+            {
+                const char *name;
+                ModeRankField field;
+            } kFields[] = {
+                {"native", ModeRankField::Native},
+                {"current", ModeRankField::Current},
+                {"width", ModeRankField::Width},
+                {"height", ModeRankField::Height},
+                {"area", ModeRankField::Area},
+                {"refreshRate", ModeRankField::RefreshRate},
+                {"bitsPerPixel", ModeRankField::BitsPerPixel}};
+
+            for (const auto &entry : kFields)
+            {
+                if (name == entry.name)
+                {
+                    field = entry.field;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool ParseRankKey(Napi::Value value, ModeRankKey &key)
+        {
+            if (value.IsString())
+            {
+                return ParseRankField(value.As<Napi::String>().Utf8Value(), key.field);
+            }
+
+            if (!value.IsObject())
+            {
+                return false;
+            }
+
+            Napi::Object entry = value.As<Napi::Object>();
+            Napi::Value name = entry.Get("key");
+            Napi::Value order = entry.Get("order");
+            if (!name.IsString() || !ParseRankField(name.As<Napi::String>().Utf8Value(), key.field))
+            {
+                return false;
+            }
+
+            if (order.IsUndefined())
+            {
+                return true;
+            }
+            if (!order.IsString())
+            {
+                return false;
+            }
+
+            std::string direction = order.As<Napi::String>().Utf8Value();
+            key.ascending = direction == "asc";
+            return direction == "asc" || direction == "desc";
+        }
+    }
+
+    bool ParseModeQuery(Napi::Env env, Napi::Value constraints, Napi::Value ranking, ModeQuery &query)
+    {
+        if (!constraints.IsObject())
+        {
+            Napi::TypeError::New(env, "Constraints must be an object").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        Napi::Object bounds = constraints.As<Napi::Object>();
+        if (!ParseModeRange(env, bounds, "width", query.constraints.width) ||
+            !ParseModeRange(env, bounds, "height", query.constraints.height) ||
+            !ParseModeRange(env, bounds, "refreshRate", query.constraints.refreshRate) ||
+            !ParseModeRange(env, bounds, "bitsPerPixel", query.constraints.bitsPerPixel) ||
+            !ParseAspectRatioConstraint(env, bounds, query.constraints))
+        {
+            return false;
+        }
+
+        if (ranking.IsUndefined())
+        {
+            return true;
+        }
+
+        if (!ranking.IsArray() || ranking.As<Napi::Array>().Length() > kMaxModeRankKeys)
+        {
+            Napi::TypeError::New(env, "Ranking must be an array of at most " + std::to_string(kMaxModeRankKeys) + " keys").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        Napi::Array keys = ranking.As<Napi::Array>();
+        for (uint32_t i = 0; i < keys.Length(); i++)
+        {
+            ModeRankKey key;
+            if (!ParseRankKey(keys.Get(i), key))
+            {
+                Napi::TypeError::New(env,
+                                     "Ranking keys must be 'native', 'current', 'width', 'height', 'area', 'refreshRate' or 'bitsPerPixel', "
+                                     "or {key, order} with order 'asc' or 'desc'")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+            query.ranking.push_back(key);
+        }
+
+        return true;
+    }
+
+    // Helper function to read the arguments of setMonitorResolution(id, width, height, [refreshRate])
+    // or setMonitorResolution(id, constraints, [ranking])
+    bool ParseMonitorModeArguments(const Napi::CallbackInfo &info, ModeChangeRequest &request)
+    {
+        Napi::Env env = info.Env();
+
+        if (info.Length() >= 2 && info[0].IsString() && info[1].IsObject())
+        {
+            request.id = info[0].As<Napi::String>().Utf8Value();
+            request.updateRegistry = true;
+            request.hasQuery = true;
+            return ParseModeQuery(env, info[1], info.Length() >= 3 ? info[2] : env.Undefined(), request.query);
+        }
+
+        if (info.Length() < 3)
+        {
+            Napi::TypeError::New(env, "Wrong number of arguments. Expected monitor ID, width, and height").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        if (!info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber())
+        {
+            Napi::TypeError::New(env, "Invalid argument types. Expected string, number, number").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        request.id = info[0].As<Napi::String>().Utf8Value();
+        request.width = info[1].As<Napi::Number>().Int32Value();
+        request.height = info[2].As<Napi::Number>().Int32Value();
+        request.updateRegistry = true;
+
+        // Override with user-specified refresh rate if provided
+        if (info.Length() >= 4 && !info[3].IsUndefined() && info[3].IsNumber())
+        {
+            request.refreshRate = info[3].As<Napi::Number>().Int32Value();
+            request.hasRefreshRate = true;
+        }
+
+        return true;
+    }
+
+    Napi::Value ModeChangeResultToValue(Napi::Env env, const ModeChangeResult &result)
+    {
+        switch (result.status)
+        {
+        case ModeChangeResult::Status::Applied:
+            return Napi::Boolean::New(env, true);
+
+        case ModeChangeResult::Status::AppliedClosestRefreshRate:
+        {
+            napi_value values[] = {
+                Napi::Boolean::New(env, true),
+                Napi::String::New(env, result.message),
+                Napi::Number::New(env, result.actualRefreshRate)};
+            return NewShapedObject(env, ObjectShape::ModeChangeSuccess, values);
+        }
+
+        default:
+        {
+            napi_value values[] = {
+                Napi::Number::New(env, result.code),
+                Napi::String::New(env, result.message)};
+            return NewShapedObject(env, ObjectShape::ModeChangeError, values);
+        }
+        }
+    }
+
+    Napi::Object ModeToValue(Napi::Env env, const DisplayMode &mode)
+    {
+        napi_value values[] = {
+            Napi::Number::New(env, mode.width),
+            Napi::Number::New(env, mode.height),
+            Napi::Number::New(env, mode.refreshRate),
+            Napi::Number::New(env, mode.bitsPerPixel)};
+        return NewShapedObject(env, ObjectShape::Mode, values);
+    }
+
+    namespace
+    {
+        // Fields in the order object_shapes.cc declares them
+        enum MonitorField
+        {
+            kMonitorId,
+            kMonitorName,
+            kMonitorDeviceId,
+            kMonitorDeviceKey,
+            kMonitorStateFlags,
+            kMonitorAttachedToDesktop,
+            kMonitorPrimaryDevice,
+            kMonitorCurrentSettings,
+            kMonitorEdid
+        };
+
+        enum MonitorSettingsField
+        {
+            kSettingsWidth,
+            kSettingsHeight,
+            kSettingsRefreshRate,
+            kSettingsBitsPerPixel,
+            kSettingsOrientation,
+            kSettingsPosition
+        };
+
+        enum EdidField
+        {
+            kEdidManufacturer,
+            kEdidProductCode,
+            kEdidSerialNumber,
+            kEdidSerial,
+            kEdidName,
+            kEdidManufactureWeek,
+            kEdidManufactureYear,
+            kEdidVersion,
+            kEdidWidthMm,
+            kEdidHeightMm,
+            kEdidPreferredTiming,
+            kEdidTimings
+        };
+
+        // Values of the fields a mask selects, gathered in field order
+        class ShapeValues
+        {
+        public:
+            explicit ShapeValues(uint32_t fields) : fields_(fields) {}
+
+            bool Wants(uint32_t field) const { return (fields_ & (1u << field)) != 0; }
+
+            void Add(napi_value value) { values_[count_++] = value; }
+
+            const napi_value *Data() const { return values_; }
+
+        private:
+            uint32_t fields_;
+            napi_value values_[32];
+            uint32_t count_ = 0;
+        };
+
+        uint32_t FieldMask(ObjectShape shape)
+        {
+            return (1u << ShapeFieldCount(shape)) - 1;
+        }
+
+        // Bit offsets of each mask in a packed projection
+        const uint32_t kPackedSettingsShift = 9;
+        const uint32_t kPackedPositionShift = 15;
+        const uint32_t kPackedEdidShift = 17;
+
+        // Select the field a path names, where a path ending at a nested
+        // object selects all of it
+        bool SelectMonitorField(const std::string &path, MonitorProjection &projection)
+        {
+            size_t dot = path.find('.');
+            int field = ShapeFieldIndex(ObjectShape::Monitor, path.substr(0, dot).c_str());
+            if (field < 0)
+            {
+                return false;
+            }
+            projection.monitor |= 1u << field;
+
+            bool whole = dot == std::string::npos;
+            std::string rest = whole ? std::string() : path.substr(dot + 1);
+            if (field == kMonitorEdid)
+            {
+                if (whole)
+                {
+                    projection.edid = FieldMask(ObjectShape::Edid);
+                    return true;
+                }
+                int edidField = ShapeFieldIndex(ObjectShape::Edid, rest.c_str());
+                projection.edid |= edidField < 0 ? 0 : 1u << edidField;
+                return edidField >= 0;
+            }
+
+            if (field != kMonitorCurrentSettings)
+            {
+                return whole;
+            }
+
+            if (whole)
+            {
+                projection.settings = FieldMask(ObjectShape::MonitorSettings);
+                projection.position = FieldMask(ObjectShape::Position);
+                return true;
+            }
+
+            dot = rest.find('.');
+            int settingsField = ShapeFieldIndex(ObjectShape::MonitorSettings, rest.substr(0, dot).c_str());
+            if (settingsField < 0)
+            {
+                return false;
+            }
+            projection.settings |= 1u << settingsField;
+
+            if (settingsField != kSettingsPosition)
+            {
+                return dot == std::string::npos;
+            }
+            if (dot == std::string::npos)
+            {
+                projection.position = FieldMask(ObjectShape::Position);
+                return true;
+            }
+
+            int positionField = ShapeFieldIndex(ObjectShape::Position, rest.substr(dot + 1).c_str());
+            projection.position |= positionField < 0 ? 0 : 1u << positionField;
+            return positionField >= 0;
+        }
+    }
+
+    uint32_t MonitorProjection::Pack() const
+    {
+        return (monitor & FieldMask(ObjectShape::Monitor)) |
+               ((settings & FieldMask(ObjectShape::MonitorSettings)) << kPackedSettingsShift) |
+               ((position & FieldMask(ObjectShape::Position)) << kPackedPositionShift) |
+               ((edid & FieldMask(ObjectShape::Edid)) << kPackedEdidShift);
+    }
+
+    MonitorProjection MonitorProjection::Unpack(uint32_t packed)
+    {
+        MonitorProjection projection;
+        projection.monitor = packed & FieldMask(ObjectShape::Monitor);
+        projection.settings = (packed >> kPackedSettingsShift) & FieldMask(ObjectShape::MonitorSettings);
+        projection.position = (packed >> kPackedPositionShift) & FieldMask(ObjectShape::Position);
+        projection.edid = (packed >> kPackedEdidShift) & FieldMask(ObjectShape::Edid);
+        return projection;
+    }
+
+    bool CompileMonitorProjection(Napi::Env env, Napi::Value fields, MonitorProjection &projection)
+    {
+        if (!fields.IsArray())
+        {
+            Napi::TypeError::New(env, "Fields must be an array of field paths").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        projection.monitor = projection.settings = projection.position = projection.edid = 0;
+
+        Napi::Array paths = fields.As<Napi::Array>();
+        for (uint32_t i = 0; i < paths.Length(); i++)
+        {
+            Napi::Value path = paths.Get(i);
+            if (!path.IsString())
+            {
+                Napi::TypeError::New(env, "Fields must be an array of field paths").ThrowAsJavaScriptException();
+                return false;
+            }
+
+            std::string name = path.As<Napi::String>().Utf8Value();
+            if (!SelectMonitorField(name, projection))
+            {
+                Napi::TypeError::New(env, "Unknown monitor field '" + name + "'").ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    Napi::Object MonitorToValue(Napi::Env env, DisplayBackend &backend, const MonitorState &state, const MonitorProjection &projection)
+    {
+        std::shared_ptr<const EdidInfo> edid;
+        if (projection.monitor & (1u << kMonitorEdid))
+        {
+            edid = GetMonitorEdid(backend, state.device.id);
+        }
+        return MonitorToValue(env, state, edid.get(), projection);
+    }
+
+    Napi::Object MonitorToValue(Napi::Env env, const MonitorState &state, const EdidInfo *edid, const MonitorProjection &projection)
+    {
+        const DisplayDevice &displayDevice = state.device;
+
+        ShapeValues values(projection.monitor);
+        if (values.Wants(kMonitorId))
+        {
+            values.Add(Napi::String::New(env, displayDevice.id));
+        }
+        if (values.Wants(kMonitorName))
+        {
+            values.Add(Napi::String::New(env, displayDevice.name));
+        }
+        if (values.Wants(kMonitorDeviceId))
+        {
+            values.Add(Napi::String::New(env, displayDevice.deviceId));
+        }
+        if (values.Wants(kMonitorDeviceKey))
+        {
+            values.Add(Napi::String::New(env, displayDevice.deviceKey));
+        }
+        if (values.Wants(kMonitorStateFlags))
+        {
+            values.Add(Napi::Number::New(env, displayDevice.stateFlags));
+        }
+        if (values.Wants(kMonitorAttachedToDesktop))
+        {
+            values.Add(Napi::Boolean::New(env, displayDevice.stateFlags & kDeviceAttachedToDesktop));
+        }
+        if (values.Wants(kMonitorPrimaryDevice))
+        {
+            values.Add(Napi::Boolean::New(env, displayDevice.stateFlags & kDevicePrimary));
+        }
+
+        // Always present, null without a mode, so every monitor has one shape
+        if (values.Wants(kMonitorCurrentSettings))
+        {
+            if (state.hasMode)
+            {
+                const DisplayMode &mode = state.mode;
+
+                ShapeValues settings(projection.settings);
+                if (settings.Wants(kSettingsWidth))
+                {
+                    settings.Add(Napi::Number::New(env, mode.width));
+                }
+                if (settings.Wants(kSettingsHeight))
+                {
+                    settings.Add(Napi::Number::New(env, mode.height));
+                }
+                if (settings.Wants(kSettingsRefreshRate))
+                {
+                    settings.Add(Napi::Number::New(env, mode.refreshRate));
+                }
+                if (settings.Wants(kSettingsBitsPerPixel))
+                {
+                    settings.Add(Napi::Number::New(env, mode.bitsPerPixel));
+                }
+                if (settings.Wants(kSettingsOrientation))
+                {
+                    settings.Add(Napi::Number::New(env, mode.orientation));
+                }
+                if (settings.Wants(kSettingsPosition))
+                {
+                    ShapeValues position(projection.position);
+                    if (position.Wants(0))
+                    {
+                        position.Add(Napi::Number::New(env, mode.positionX));
+                    }
+                    if (position.Wants(1))
+                    {
+                        position.Add(Napi::Number::New(env, mode.positionY));
+                    }
+                    settings.Add(NewShapedObject(env, ObjectShape::Position, position.Data(), projection.position));
+                }
+
+                values.Add(NewShapedObject(env, ObjectShape::MonitorSettings, settings.Data(), projection.settings));
+            }
+            else
+            {
+                values.Add(env.Null());
+            }
+        }
+
+        if (values.Wants(kMonitorEdid))
+        {
+            values.Add(edid ? Napi::Value(EdidToValue(env, *edid, projection.edid)) : env.Null());
+        }
+
+        return NewShapedObject(env, ObjectShape::Monitor, values.Data(), projection.monitor);
+    }
+
+    Napi::Object EdidToValue(Napi::Env env, const EdidInfo &edid, uint32_t fields)
+    {
+        ShapeValues values(fields);
+        if (values.Wants(kEdidManufacturer))
+        {
+            values.Add(Napi::String::New(env, edid.manufacturer));
+        }
+        if (values.Wants(kEdidProductCode))
+        {
+            values.Add(Napi::Number::New(env, edid.productCode));
+        }
+        if (values.Wants(kEdidSerialNumber))
+        {
+            values.Add(Napi::Number::New(env, edid.serialNumber));
+        }
+        if (values.Wants(kEdidSerial))
+        {
+            values.Add(Napi::String::New(env, edid.serial));
+        }
+        if (values.Wants(kEdidName))
+        {
+            values.Add(Napi::String::New(env, edid.name));
+        }
+        if (values.Wants(kEdidManufactureWeek))
+        {
+            values.Add(Napi::Number::New(env, edid.manufactureWeek));
+        }
+        if (values.Wants(kEdidManufactureYear))
+        {
+            values.Add(Napi::Number::New(env, edid.manufactureYear));
+        }
+        if (values.Wants(kEdidVersion))
+        {
+            values.Add(Napi::String::New(env, std::to_string(edid.versionMajor) + "." + std::to_string(edid.versionMinor)));
+        }
+        if (values.Wants(kEdidWidthMm))
+        {
+            values.Add(Napi::Number::New(env, edid.widthMm));
+        }
+        if (values.Wants(kEdidHeightMm))
+        {
+            values.Add(Napi::Number::New(env, edid.heightMm));
+        }
+
+        if (values.Wants(kEdidPreferredTiming) || values.Wants(kEdidTimings))
+        {
+            Napi::Array timings = NewArray(env, edid.timings.size());
+            for (size_t i = 0; i < edid.timings.size(); i++)
+            {
+                const EdidTiming &timing = edid.timings[i];
+                napi_value timingValues[] = {
+                    Napi::Number::New(env, timing.width),
+                    Napi::Number::New(env, timing.height),
+                    Napi::Number::New(env, timing.refreshRate),
+                    Napi::Number::New(env, timing.pixelClockKHz),
+                    Napi::Boolean::New(env, timing.interlaced)};
+                timings.Set(static_cast<uint32_t>(i), NewShapedObject(env, ObjectShape::EdidTiming, timingValues));
+            }
+
+            if (values.Wants(kEdidPreferredTiming))
+            {
+                values.Add(edid.hasPreferredTiming ? timings.Get(0u) : env.Null());
+            }
+            if (values.Wants(kEdidTimings))
+            {
+                values.Add(timings);
+            }
+        }
+
+        return NewShapedObject(env, ObjectShape::Edid, values.Data(), fields);
+    }
+}
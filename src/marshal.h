@@ -0,0 +1,80 @@
+#ifndef MONITORRES_MARSHAL_H_
+#define MONITORRES_MARSHAL_H_
+
+#include <napi.h>
+
+#include "monitorres_core.h"
+#include "object_shapes.h"
+#include "stats.h"
+
+namespace monitorres
+{
+    // Create a JS object or array, counted in getStats().jsObjects
+    inline Napi::Object NewObject(Napi::Env env)
+    {
+        MONITORRES_COUNT_JS_OBJECTS(1);
+        return Napi::Object::New(env);
+    }
+
+    inline Napi::Array NewArray(Napi::Env env, size_t length = 0)
+    {
+        MONITORRES_COUNT_JS_OBJECTS(1);
+        return Napi::Array::New(env, length);
+    }
+
+    // Whether env still runs JS. A terminating worker's loop can deliver one
+    // more thread-safe function call, and node-addon-api aborts the process
+    // when a call into JS fails then; napi_define_properties fails first.
+    bool CanCallIntoJs(Napi::Env env);
+
+    // Get the active display backend, throwing if the platform has none
+    std::shared_ptr<DisplayBackend> RequireBackend(Napi::Env env);
+
+    // Read the constraints and optional ranking of a mode query, throwing and
+    // returning false if they are invalid
+    bool ParseModeQuery(Napi::Env env, Napi::Value constraints, Napi::Value ranking, ModeQuery &query);
+
+    // Read the arguments of setMonitorResolution(id, width, height, [refreshRate])
+    // or setMonitorResolution(id, constraints, [ranking]), throwing and
+    // returning false if they are invalid
+    bool ParseMonitorModeArguments(const Napi::CallbackInfo &info, ModeChangeRequest &request);
+
+    // Convert the outcome of a mode change into the value the set functions
+    // return: true, a success object carrying the refresh rate actually used,
+    // or an error object with code and message. Failed results are not
+    // handled here since callers report them as exceptions.
+    Napi::Value ModeChangeResultToValue(Napi::Env env, const ModeChangeResult &result);
+
+    // Build the {width, height, refreshRate, bitsPerPixel} object of a mode
+    Napi::Object ModeToValue(Napi::Env env, const DisplayMode &mode);
+
+    // Fields of the monitor objects to build, as masks over the fields of
+    // each nested shape. Packs into the 32 bit number compileMonitorFields
+    // returns, so a projection is compiled once and passed back as is.
+    struct MonitorProjection
+    {
+        uint32_t monitor = kAllFields;
+        uint32_t settings = kAllFields;
+        uint32_t position = kAllFields;
+        uint32_t edid = kAllFields;
+
+        uint32_t Pack() const;
+        static MonitorProjection Unpack(uint32_t packed);
+    };
+
+    // Compile field paths such as 'id' or 'currentSettings.position.x' into a
+    // projection, throwing and returning false if a path names no field
+    bool CompileMonitorProjection(Napi::Env env, Napi::Value fields, MonitorProjection &projection);
+
+    // Build the monitor object getAllMonitors reports for an active monitor;
+    // the EDID is only read when the projection asks for it
+    Napi::Object MonitorToValue(Napi::Env env, DisplayBackend &backend, const MonitorState &state, const MonitorProjection &projection = MonitorProjection());
+
+    // Build the same object from an EDID read beforehand; nullptr if there is none
+    Napi::Object MonitorToValue(Napi::Env env, const MonitorState &state, const EdidInfo *edid, const MonitorProjection &projection = MonitorProjection());
+
+    // Convert a parsed EDID into the edid field of a monitor
+    Napi::Object EdidToValue(Napi::Env env, const EdidInfo &edid, uint32_t fields = kAllFields);
+}
+
+#endif
@@ -0,0 +1,249 @@
+#include "mode_change.h"
+
+#include <vector>
+
+#include "desktop_layout.h"
+#include "mode_table.h"
+#include "stats.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        ModeChangeResult Rejected(long code, const std::string &message)
+        {
+            ModeChangeResult result;
+            result.status = ModeChangeResult::Status::Rejected;
+            result.code = code;
+            result.message = message;
+            return result;
+        }
+
+        bool SameMode(const DisplayMode &a, const DisplayMode &b)
+        {
+            return a.width == b.width && a.height == b.height && a.refreshRate == b.refreshRate;
+        }
+
+        // Validate a request against the modes of a device running current
+        ModeChangePlan PlanWithModes(const ModeChangeRequest &request, const DisplayMode &current, const ModeTable &modes)
+        {
+            ModeChangePlan plan;
+            plan.request = request;
+
+            // A constraint query picks the exact mode to ask for
+            if (request.hasQuery)
+            {
+                std::vector<DisplayMode> best = FindBestModes(modes, request.query, &current, 1);
+                if (best.empty())
+                {
+                    plan.resolved = true;
+                    plan.result = Rejected(kDispChangeBadMode, "No supported mode matches the constraints");
+                    return plan;
+                }
+
+                plan.request.width = static_cast<int>(best[0].width);
+                plan.request.height = static_cast<int>(best[0].height);
+                plan.request.refreshRate = static_cast<int>(best[0].refreshRate);
+                plan.request.hasRefreshRate = true;
+            }
+
+            const ModeChangeRequest &resolved = plan.request;
+
+            // Default to current refresh rate if not specified
+            int refreshRate = resolved.hasRefreshRate ? resolved.refreshRate : static_cast<int>(current.refreshRate);
+            plan.request.refreshRate = refreshRate;
+
+            // Validate that the requested mode is supported
+            bool isResolutionSupported = modes.HasResolution(resolved.width, resolved.height);
+            bool isModeSupported = modes.HasMode(resolved.width, resolved.height, refreshRate);
+
+            plan.target = current;
+            plan.target.width = resolved.width;
+            plan.target.height = resolved.height;
+            plan.target.refreshRate = refreshRate;
+
+            // If custom refresh rate was specified but not supported, try with the closest available refresh rate
+            if (resolved.hasRefreshRate && !isModeSupported && isResolutionSupported)
+            {
+                plan.target.refreshRate = modes.ClosestRefreshRate(resolved.width, resolved.height, refreshRate);
+                plan.usesClosestRefreshRate = true;
+
+                // Create a string of available refresh rates
+                std::vector<uint32_t> availableRefreshRates = modes.RefreshRates(resolved.width, resolved.height);
+                for (size_t i = 0; i < availableRefreshRates.size(); i++)
+                {
+                    plan.availableRatesStr += std::to_string(availableRefreshRates[i]);
+                    if (i < availableRefreshRates.size() - 1)
+                        plan.availableRatesStr += ", ";
+                }
+                plan.unchanged = SameMode(plan.target, current);
+                return plan;
+            }
+
+            if (!isResolutionSupported)
+            {
+                plan.resolved = true;
+                plan.result = Rejected(kDispChangeBadMode,
+                                       "The requested resolution is not supported. "
+                                       "Width: " +
+                                           std::to_string(resolved.width) +
+                                           ", Height: " + std::to_string(resolved.height));
+                return plan;
+            }
+
+            if (!isModeSupported && resolved.hasRefreshRate)
+            {
+                plan.resolved = true;
+                plan.result = Rejected(kDispChangeBadMode,
+                                       "The requested refresh rate is not supported for this resolution. "
+                                       "Width: " +
+                                           std::to_string(resolved.width) +
+                                           ", Height: " + std::to_string(resolved.height) +
+                                           ", Refresh Rate: " + std::to_string(refreshRate));
+                return plan;
+            }
+
+            plan.unchanged = SameMode(plan.target, current);
+            return plan;
+        }
+    }
+
+    ModeChangePlan PlanModeChange(DisplayBackend &backend, const ModeChangeRequest &request)
+    {
+        MONITORRES_TIME_PHASE("planModeChange");
+
+        // First get the current settings to preserve other values
+        DisplayMode current;
+        if (!backend.GetCurrentMode(request.id, current))
+        {
+            ModeChangePlan plan;
+            plan.request = request;
+            plan.resolved = true;
+            plan.result.status = ModeChangeResult::Status::Failed;
+            plan.result.code = kDispChangeFailed;
+            plan.result.message = "Failed to get current display settings";
+            return plan;
+        }
+
+        bool enumerated = false;
+        std::shared_ptr<const ModeTable> modes = ModeTables().Get(backend, request.id, &enumerated);
+        ModeChangePlan plan = PlanWithModes(request, current, *modes);
+
+        // A cached list can miss the modes of a monitor whose hotplug the
+        // backend did not signal, so enumerate once more before rejecting
+        if (plan.resolved && plan.result.code == kDispChangeBadMode && !enumerated)
+        {
+            ModeTables().Invalidate(backend, request.id);
+            modes = ModeTables().Get(backend, request.id);
+            plan = PlanWithModes(request, current, *modes);
+        }
+
+        // A mode that is live but not stored, e.g. one applied without
+        // updateRegistry, still has to be written
+        DisplayMode stored;
+        if (plan.unchanged && plan.request.updateRegistry &&
+            (!backend.GetRegistryMode(request.id, stored) || !SameMode(plan.target, stored)))
+        {
+            plan.unchanged = false;
+        }
+        return plan;
+    }
+
+    ModeChangeResult ApplyModeChange(DisplayBackend &backend, const ModeChangePlan &plan)
+    {
+        if (plan.resolved)
+        {
+            return plan.result;
+        }
+
+        const ModeChangeRequest &request = plan.request;
+        long code = kDispChangeSuccessful;
+        if (!plan.unchanged)
+        {
+            {
+                MONITORRES_TIME_PHASE("applyMode");
+                code = backend.ApplyMode(request.id, plan.target, request.updateRegistry);
+            }
+
+            if (code == kDispChangeSuccessful)
+            {
+                DesktopLayouts().Invalidate();
+            }
+        }
+
+        // The driver rejecting a mode it listed means the cached list is stale
+        if (code == kDispChangeBadMode)
+        {
+            ModeTables().Invalidate(backend, request.id);
+        }
+
+        if (plan.usesClosestRefreshRate)
+        {
+            int closestRefreshRate = plan.target.refreshRate;
+            if (code != kDispChangeSuccessful)
+            {
+                return Rejected(code,
+                                "The requested refresh rate (" + std::to_string(request.refreshRate) + "Hz) is not supported for resolution " +
+                                    std::to_string(request.width) + "x" + std::to_string(request.height) + ". " +
+                                    "Available refresh rates: " + plan.availableRatesStr + ". " +
+                                    "Attempted to use closest rate (" + std::to_string(closestRefreshRate) + "Hz) but failed.");
+            }
+
+            // Success with closest refresh rate
+            ModeChangeResult result;
+            result.status = ModeChangeResult::Status::AppliedClosestRefreshRate;
+            result.message = "Used closest available refresh rate: " + std::to_string(closestRefreshRate) + "Hz instead of requested " +
+                             std::to_string(request.refreshRate) + "Hz. Available rates: " + plan.availableRatesStr;
+            result.actualRefreshRate = closestRefreshRate;
+            result.unchanged = plan.unchanged;
+            return result;
+        }
+
+        if (code != kDispChangeSuccessful)
+        {
+            return Rejected(code, DescribeDisplayChangeCode(code));
+        }
+
+        ModeChangeResult result;
+        result.actualRefreshRate = plan.target.refreshRate;
+        result.unchanged = plan.unchanged;
+        return result;
+    }
+
+    ModeChangeResult ChangeDisplayMode(DisplayBackend &backend, const ModeChangeRequest &request)
+    {
+        std::lock_guard<std::timed_mutex> lock(ModeChangeMutex());
+        return ApplyModeChange(backend, PlanModeChange(backend, request));
+    }
+
+    std::timed_mutex &ModeChangeMutex()
+    {
+        static std::timed_mutex mutex;
+        return mutex;
+    }
+
+    const char *DescribeDisplayChangeCode(long code)
+    {
+        switch (code)
+        {
+        case kDispChangeSuccessful:
+            return "The display settings change was successful";
+        case kDispChangeBadDualView:
+            return "The settings change was unsuccessful because the system is DualView capable";
+        case kDispChangeBadFlags:
+            return "An invalid set of flags was passed";
+        case kDispChangeBadMode:
+            return "The graphics mode is not supported";
+        case kDispChangeBadParam:
+            return "An invalid parameter was passed";
+        case kDispChangeFailed:
+            return "The display driver failed the specified graphics mode";
+        case kDispChangeNotUpdated:
+            return "Unable to write settings to the registry";
+        case kDispChangeRestart:
+            return "The computer must be restarted for the graphics mode to work";
+        default:
+            return "Unknown error";
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef MONITORRES_MODE_CHANGE_H_
+#define MONITORRES_MODE_CHANGE_H_
+
+#include "display_backend.h"
+#include "mode_query.h"
+
+#include <mutex>
+#include <string>
+
+namespace monitorres
+{
+    struct ModeChangeRequest
+    {
+        // Device to change; empty for the primary display
+        std::string id;
+        int width = 0;
+        int height = 0;
+        // Only used when hasRefreshRate is set, otherwise the current rate is kept
+        int refreshRate = 0;
+        bool hasRefreshRate = false;
+        bool updateRegistry = false;
+        // When set, the best mode matching query replaces width, height and
+        // refresh rate; see FindBestModes
+        bool hasQuery = false;
+        ModeQuery query;
+    };
+
+    struct ModeChangeResult
+    {
+        enum class Status
+        {
+            // The requested mode was applied
+            Applied,
+            // The closest supported refresh rate was applied instead
+            AppliedClosestRefreshRate,
+            // The mode was not applied; code and message describe why
+            Rejected,
+            // The current settings could not be read; message describes why
+            Failed
+        };
+
+        Status status = Status::Applied;
+        long code = kDispChangeSuccessful;
+        std::string message;
+        int actualRefreshRate = 0;
+        // The device already ran the mode, so no mode-set was made
+        bool unchanged = false;
+    };
+
+    // A validated mode change that is ready to be applied
+    struct ModeChangePlan
+    {
+        ModeChangeRequest request;
+        DisplayMode target;
+        // Set when validation already decided the outcome and nothing must be applied
+        bool resolved = false;
+        ModeChangeResult result;
+        bool usesClosestRefreshRate = false;
+        std::string availableRatesStr;
+        // Set when target matches the mode the device was running at planning
+        // time and, for a request with updateRegistry, the mode stored for it
+        bool unchanged = false;
+    };
+
+    // Validate a request against the modes the device reports. This does all
+    // the enumeration work but does not change anything.
+    ModeChangePlan PlanModeChange(DisplayBackend &backend, const ModeChangeRequest &request);
+
+    // Apply a plan produced by PlanModeChange. A plan whose target the
+    // device already runs, and has stored if the request updates the
+    // registry, succeeds without calling the driver.
+    ModeChangeResult ApplyModeChange(DisplayBackend &backend, const ModeChangePlan &plan);
+
+    // Validate and apply in one step while holding ModeChangeMutex()
+    ModeChangeResult ChangeDisplayMode(DisplayBackend &backend, const ModeChangeRequest &request);
+
+    // Serializes mode changes process-wide so concurrent callers never
+    // interleave their validation and mode-set
+    std::timed_mutex &ModeChangeMutex();
+
+    // Get the human readable description of a DisplayChangeCode
+    const char *DescribeDisplayChangeCode(long code);
+}
+
+#endif
@@ -0,0 +1,334 @@
+#include "mode_change_scheduler.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace monitorres
+{
+    namespace
+    {
+        // How often a waiter whose change has not started rechecks whether it should stop
+        const std::chrono::milliseconds kStopPollInterval(10);
+    }
+
+    // A request waiting in a batch
+    struct QueuedModeChange
+    {
+        uint64_t serial = 0;
+        ModeChangeRequest request;
+        ModeChangeCompletion onDone;
+    };
+
+    struct ModeChangeBatch
+    {
+        std::shared_ptr<DisplayBackend> backend;
+        // The device's own id, also for requests that address the primary with an empty one
+        std::string id;
+        // In arrival order
+        std::vector<QueuedModeChange> requests;
+        // When the batch stops taking requests
+        std::chrono::steady_clock::time_point due;
+        bool started = false;
+        bool done = false;
+        // One per request once done
+        std::vector<ModeChangeResult> results;
+    };
+
+    namespace
+    {
+        // Validate the requests of a batch and apply the last one the device
+        // supports, setting applied to its index (requests.size() if none).
+        // Requests the device rejects get their own result and the other
+        // supported ones that of the applied change; coalesced counts those.
+        std::vector<ModeChangeResult> ApplyBatch(DisplayBackend &backend, const std::vector<QueuedModeChange> &requests,
+                                                 size_t &applied, uint64_t &coalesced)
+        {
+            std::vector<ModeChangeResult> results(requests.size());
+            std::vector<bool> supported(requests.size(), false);
+
+            // Validation enumerates mode lists, so it runs before taking
+            // ModeChangeMutex; the applied request is validated again under it
+            applied = requests.size();
+            for (size_t i = requests.size(); i-- > 0;)
+            {
+                ModeChangePlan plan = PlanModeChange(backend, requests[i].request);
+                if (plan.resolved)
+                {
+                    results[i] = plan.result;
+                    continue;
+                }
+
+                supported[i] = true;
+                if (applied == requests.size())
+                {
+                    applied = i;
+                }
+            }
+            if (applied == requests.size())
+            {
+                return results;
+            }
+
+            // A request folded into this change may have asked for the mode to be stored
+            ModeChangeRequest request = requests[applied].request;
+            for (size_t i = 0; i < applied; i++)
+            {
+                request.updateRegistry = request.updateRegistry || (supported[i] && requests[i].request.updateRegistry);
+            }
+
+            results[applied] = ChangeDisplayMode(backend, request);
+            for (size_t i = 0; i < applied; i++)
+            {
+                if (supported[i])
+                {
+                    results[i] = results[applied];
+                    coalesced++;
+                }
+            }
+            return results;
+        }
+    }
+
+    ModeChangeScheduler::~ModeChangeScheduler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+
+        for (auto &thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    ModeChangeTicket ModeChangeScheduler::Submit(std::shared_ptr<DisplayBackend> backend, ModeChangeRequest request, bool immediate,
+                                                 ModeChangeCompletion onDone)
+    {
+        // Both spellings of the primary share its batches and its queue
+        std::string id = ResolveDeviceId(*backend, request.id);
+
+        auto now = std::chrono::steady_clock::now();
+        ModeChangeTicket ticket;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.requests++;
+
+            for (const auto &batch : open_)
+            {
+                if (batch->backend == backend && batch->id == id)
+                {
+                    ticket.batch = batch;
+                    break;
+                }
+            }
+
+            if (!ticket.batch)
+            {
+                ticket.batch = std::make_shared<ModeChangeBatch>();
+                ticket.batch->backend = std::move(backend);
+                ticket.batch->id = std::move(id);
+                ticket.batch->due = now + std::chrono::milliseconds(coalesceMs_.load());
+                open_.push_back(ticket.batch);
+            }
+
+            if (immediate)
+            {
+                ticket.batch->due = std::min(ticket.batch->due, now);
+            }
+
+            ticket.serial = ++serial_;
+            QueuedModeChange queued;
+            queued.serial = ticket.serial;
+            queued.request = std::move(request);
+            queued.onDone = std::move(onDone);
+            ticket.batch->requests.push_back(std::move(queued));
+
+            // A thread per device with work, so one device's slow mode-set
+            // does not hold up the others
+            if (threads_.size() < std::min(kMaxModeChangeThreads, open_.size() + running_.size()))
+            {
+                threads_.emplace_back(&ModeChangeScheduler::Run, this);
+            }
+        }
+        wake_.notify_all();
+
+        return ticket;
+    }
+
+    bool ModeChangeScheduler::Wait(const ModeChangeTicket &ticket, const std::function<bool()> &shouldStop, ModeChangeResult &result)
+    {
+        ModeChangeBatch &batch = *ticket.batch;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!batch.done)
+        {
+            // The batch cannot start while the lock is held
+            if (!batch.started && shouldStop())
+            {
+                RemoveRequest(ticket);
+                return false;
+            }
+
+            done_.wait_for(lock, kStopPollInterval);
+        }
+
+        for (size_t i = 0; i < batch.requests.size(); i++)
+        {
+            if (batch.requests[i].serial == ticket.serial)
+            {
+                result = batch.results[i];
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool ModeChangeScheduler::Withdraw(const ModeChangeTicket &ticket)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ticket.batch->started)
+        {
+            return false;
+        }
+
+        RemoveRequest(ticket);
+        return true;
+    }
+
+    void ModeChangeScheduler::RemoveRequest(const ModeChangeTicket &ticket)
+    {
+        auto &requests = ticket.batch->requests;
+        requests.erase(std::remove_if(requests.begin(), requests.end(), [&ticket](const QueuedModeChange &queued)
+                                      { return queued.serial == ticket.serial; }),
+                       requests.end());
+        if (requests.empty())
+        {
+            open_.erase(std::remove(open_.begin(), open_.end(), ticket.batch), open_.end());
+        }
+
+        stats_.withdrawn++;
+    }
+
+    ModeChangeResult ModeChangeScheduler::Change(std::shared_ptr<DisplayBackend> backend, ModeChangeRequest request)
+    {
+        ModeChangeResult result;
+        Wait(Submit(std::move(backend), std::move(request), true), []
+             { return false; },
+             result);
+        return result;
+    }
+
+    ModeChangeStats ModeChangeScheduler::Stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    bool ModeChangeScheduler::DeviceBusy(const ModeChangeBatch &batch) const
+    {
+        for (const auto &running : running_)
+        {
+            if (running->backend == batch.backend && running->id == batch.id)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ModeChangeScheduler::Run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (!stopping_)
+        {
+            // Batches fall due in the order they were opened unless an
+            // immediate request moved one forward; a batch waits while a
+            // change to its device runs, and keeps taking requests meanwhile
+            auto next = open_.end();
+            for (auto it = open_.begin(); it != open_.end(); ++it)
+            {
+                if ((next == open_.end() || (*it)->due < (*next)->due) && !DeviceBusy(**it))
+                {
+                    next = it;
+                }
+            }
+            if (next == open_.end())
+            {
+                wake_.wait(lock);
+                continue;
+            }
+            if (std::chrono::steady_clock::now() < (*next)->due)
+            {
+                wake_.wait_until(lock, (*next)->due);
+                continue;
+            }
+
+            std::shared_ptr<ModeChangeBatch> batch = *next;
+            open_.erase(next);
+            running_.push_back(batch);
+            batch->started = true;
+            lock.unlock();
+
+            std::vector<ModeChangeResult> results;
+            size_t applied = 0;
+            uint64_t coalesced = 0;
+            try
+            {
+                results = ApplyBatch(*batch->backend, batch->requests, applied, coalesced);
+            }
+            catch (const std::exception &e)
+            {
+                ModeChangeResult failed;
+                failed.status = ModeChangeResult::Status::Failed;
+                failed.code = kDispChangeFailed;
+                failed.message = e.what();
+                results.assign(batch->requests.size(), failed);
+                applied = results.size();
+                coalesced = 0;
+            }
+
+            lock.lock();
+            stats_.coalesced += coalesced;
+            if (applied < results.size())
+            {
+                const ModeChangeResult &result = results[applied];
+                if (result.unchanged)
+                {
+                    stats_.unchanged++;
+                }
+                else if (result.status == ModeChangeResult::Status::Applied ||
+                         result.status == ModeChangeResult::Status::AppliedClosestRefreshRate)
+                {
+                    stats_.applied++;
+                }
+            }
+            running_.erase(std::remove(running_.begin(), running_.end(), batch), running_.end());
+            batch->results = std::move(results);
+            batch->done = true;
+            done_.notify_all();
+            // The device's next batch may be waiting for this one
+            wake_.notify_all();
+
+            // A done batch no longer changes, so its completions run without the lock
+            lock.unlock();
+            for (size_t i = 0; i < batch->requests.size(); i++)
+            {
+                if (batch->requests[i].onDone)
+                {
+                    batch->requests[i].onDone(batch->results[i]);
+                }
+            }
+            lock.lock();
+        }
+    }
+
+    ModeChangeScheduler &ModeChanges()
+    {
+        static ModeChangeScheduler scheduler;
+        return scheduler;
+    }
+}
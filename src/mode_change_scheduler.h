@@ -0,0 +1,127 @@
+#ifndef MONITORRES_MODE_CHANGE_SCHEDULER_H_
+#define MONITORRES_MODE_CHANGE_SCHEDULER_H_
+
+#include "display_backend.h"
+#include "mode_change.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace monitorres
+{
+    // Counters of the mode change scheduler
+    struct ModeChangeStats
+    {
+        // Changes submitted
+        uint64_t requests = 0;
+        // Mode-sets the driver applied
+        uint64_t applied = 0;
+        // Changes skipped because the device already ran the mode
+        uint64_t unchanged = 0;
+        // Requests folded into a later request for the same device; a
+        // request the device rejects is never folded
+        uint64_t coalesced = 0;
+        // Requests cancelled or timed out before their change started
+        uint64_t withdrawn = 0;
+    };
+
+    // A group of requests for one device that is applied as a single change
+    struct ModeChangeBatch;
+
+    // Called on a scheduler thread with the result of a request once its change is done
+    using ModeChangeCompletion = std::function<void(const ModeChangeResult &)>;
+
+    // A submitted request; pass to ModeChangeScheduler::Wait
+    struct ModeChangeTicket
+    {
+        std::shared_ptr<ModeChangeBatch> batch;
+        uint64_t serial = 0;
+    };
+
+    // Most threads applying changes at once, each for a different device
+    const size_t kMaxModeChangeThreads = 8;
+
+    // Queues mode changes per device and applies them on its own threads:
+    // one change at a time per device, changes to different devices side by
+    // side. Requests for a device that arrive within the coalescing window
+    // of the first one, or while an earlier change to it is still being
+    // applied, form a batch. Every request of a batch is validated; the last
+    // one the device supports is applied, the ones it rejects get their own
+    // rejection, and the other supported ones get that change's result. A
+    // change to the mode the device already runs skips the mode-set (see
+    // ApplyModeChange). The mode-sets themselves still take
+    // ModeChangeMutex() one at a time.
+    class ModeChangeScheduler
+    {
+    public:
+        ModeChangeScheduler() = default;
+        ~ModeChangeScheduler();
+
+        ModeChangeScheduler(const ModeChangeScheduler &) = delete;
+        ModeChangeScheduler &operator=(const ModeChangeScheduler &) = delete;
+
+        // Queue a request. An immediate one ends the coalescing window of
+        // its batch, so it and the requests before it are applied next.
+        // onDone, if set, is called with the request's result instead of
+        // anyone having to Wait for it.
+        ModeChangeTicket Submit(std::shared_ptr<DisplayBackend> backend, ModeChangeRequest request, bool immediate,
+                                ModeChangeCompletion onDone = nullptr);
+
+        // Take a request out of its batch if its change has not started; its
+        // onDone is then never called. Returns false once the change started.
+        bool Withdraw(const ModeChangeTicket &ticket);
+
+        // Wait for the result of a request. Until its change starts,
+        // shouldStop is polled; when it returns true the request is taken
+        // out of its batch and Wait returns false. Once started, the change
+        // runs to completion and its real outcome is reported.
+        bool Wait(const ModeChangeTicket &ticket, const std::function<bool()> &shouldStop, ModeChangeResult &result);
+
+        // Submit an immediate request and wait for it
+        ModeChangeResult Change(std::shared_ptr<DisplayBackend> backend, ModeChangeRequest request);
+
+        // How long a batch stays open for more requests; takes effect on the next batch
+        void SetCoalesceWindow(std::chrono::milliseconds window) { coalesceMs_.store(window.count()); }
+
+        ModeChangeStats Stats();
+
+    private:
+        void Run();
+
+        // Caller must hold mutex_; whether a change to the batch's device is running
+        bool DeviceBusy(const ModeChangeBatch &batch) const;
+
+        // Caller must hold mutex_; take a request out of its batch, which has not started
+        void RemoveRequest(const ModeChangeTicket &ticket);
+
+        std::atomic<long long> coalesceMs_{0};
+
+        std::mutex mutex_;
+        // Wakes the scheduler threads
+        std::condition_variable wake_;
+        // Wakes waiters when a batch completes
+        std::condition_variable done_;
+        // Batches still taking requests, in the order they were opened
+        std::vector<std::shared_ptr<ModeChangeBatch>> open_;
+        // Batches being applied, at most one per device
+        std::vector<std::shared_ptr<ModeChangeBatch>> running_;
+        uint64_t serial_ = 0;
+        bool stopping_ = false;
+        ModeChangeStats stats_;
+        // Started by Submit as batches for more devices are waiting
+        std::vector<std::thread> threads_;
+    };
+
+    // The process-wide mode change scheduler
+    ModeChangeScheduler &ModeChanges();
+}
+
+#endif
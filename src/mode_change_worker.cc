@@ -0,0 +1,260 @@
+#include "mode_change_worker.h"
+
+#include <mutex>
+
+#include "marshal.h"
+
+namespace monitorres
+{
+    struct ModeChangeWorker::Completion
+    {
+        std::mutex mutex;
+        Napi::ThreadSafeFunction function;
+        // Set by the finalizer, after which function must not be used
+        bool finalized = false;
+
+        // Release the scheduler's hold on function, from any thread
+        void Release()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!finalized)
+            {
+                function.Release();
+            }
+        }
+    };
+
+    ModeChangeWorker::ModeChangeWorker(Napi::Env env,
+                                       std::shared_ptr<DisplayBackend> backend,
+                                       ModeChangeRequest request,
+                                       uint32_t timeoutMs)
+        : env_(env),
+          deferred_(Napi::Promise::Deferred::New(env)),
+          backend_(std::move(backend)),
+          request_(std::move(request)),
+          timeoutMs_(timeoutMs)
+    {
+    }
+
+    Napi::Promise ModeChangeWorker::Promise() const
+    {
+        return deferred_.Promise();
+    }
+
+    bool ModeChangeWorker::WatchSignal(Napi::Object signal)
+    {
+        Napi::Env env = env_;
+
+        Napi::Value addEventListener = signal.Get("addEventListener");
+        if (!addEventListener.IsFunction())
+        {
+            Napi::TypeError::New(env, "options.signal must be an AbortSignal").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        if (signal.Get("aborted").ToBoolean().Value())
+        {
+            aborted_ = true;
+            return true;
+        }
+
+        // Removed before the worker goes away, so the listener never sees a deleted worker
+        Napi::Function listener = Napi::Function::New(env, [this](const Napi::CallbackInfo &info)
+                                                      { Stop(Outcome::Cancelled); });
+
+        addEventListener.As<Napi::Function>().Call(signal, {Napi::String::New(env, "abort"), listener});
+        signal_ = Napi::Persistent(signal);
+        abortListener_ = Napi::Persistent(listener);
+        return true;
+    }
+
+    void ModeChangeWorker::StartTimer()
+    {
+        Napi::Env env = env_;
+
+        Napi::Value setTimeout = env.Global().Get("setTimeout");
+        if (!setTimeout.IsFunction())
+        {
+            return;
+        }
+
+        // Cleared before the worker goes away, like the abort listener
+        Napi::Function onTimeout = Napi::Function::New(env, [this](const Napi::CallbackInfo &info)
+                                                       { Stop(Outcome::TimedOut); });
+
+        Napi::Value timer = setTimeout.As<Napi::Function>().Call({onTimeout, Napi::Number::New(env, timeoutMs_)});
+        if (timer.IsObject())
+        {
+            timer_ = Napi::Persistent(timer.As<Napi::Object>());
+        }
+        else if (timer.IsNumber())
+        {
+            timerId_ = timer.As<Napi::Number>().DoubleValue();
+        }
+    }
+
+    void ModeChangeWorker::Unwatch()
+    {
+        Napi::Env env = env_;
+
+        if (!signal_.IsEmpty())
+        {
+            Napi::Object signal = signal_.Value();
+            Napi::Value removeEventListener = signal.Get("removeEventListener");
+            if (removeEventListener.IsFunction())
+            {
+                removeEventListener.As<Napi::Function>().Call(signal, {Napi::String::New(env, "abort"), abortListener_.Value()});
+            }
+
+            signal_.Reset();
+            abortListener_.Reset();
+        }
+
+        if (!timer_.IsEmpty() || timerId_ >= 0)
+        {
+            Napi::Value clearTimeout = env.Global().Get("clearTimeout");
+            if (clearTimeout.IsFunction())
+            {
+                Napi::Value timer = timer_.IsEmpty() ? Napi::Value(Napi::Number::New(env, timerId_)) : Napi::Value(timer_.Value());
+                clearTimeout.As<Napi::Function>().Call({timer});
+            }
+
+            timer_.Reset();
+            timerId_ = -1;
+        }
+    }
+
+    void ModeChangeWorker::Schedule()
+    {
+        Napi::Env env = env_;
+
+        if (aborted_)
+        {
+            Reject(Outcome::Cancelled);
+            delete this;
+            return;
+        }
+
+        completion_ = std::make_shared<Completion>();
+        completion_->function = Napi::ThreadSafeFunction::New(env, Napi::Function(), "monitorres:modeChange", 0, 1, this,
+                                                              [](Napi::Env env, ModeChangeWorker *worker)
+                                                              { OnFinalize(env, worker); });
+
+        // Runs on the scheduler thread that applied the change. The worker
+        // lives until the function is finalized, which waits for this call.
+        std::shared_ptr<Completion> completion = completion_;
+        ModeChangeCompletion onDone = [completion, this](const ModeChangeResult &result)
+        {
+            std::lock_guard<std::mutex> lock(completion->mutex);
+            if (completion->finalized)
+            {
+                return;
+            }
+
+            ModeChangeResult *queued = new ModeChangeResult(result);
+            napi_status status = completion->function.NonBlockingCall(queued, [this](Napi::Env env, Napi::Function, ModeChangeResult *result)
+                                                                      {
+                std::unique_ptr<ModeChangeResult> owned(result);
+                if (env != nullptr && CanCallIntoJs(env))
+                {
+                    Resolve(*owned);
+                } });
+            if (status != napi_ok)
+            {
+                delete queued;
+            }
+            completion->function.Release();
+        };
+
+        ticket_ = ModeChanges().Submit(backend_, std::move(request_), false, std::move(onDone));
+
+        // Waiting for the coalescing window and other changes counts against the timeout
+        if (timeoutMs_ > 0)
+        {
+            StartTimer();
+        }
+    }
+
+    void ModeChangeWorker::Stop(Outcome outcome)
+    {
+        if (settled_)
+        {
+            return;
+        }
+
+        // A change that already started cannot be interrupted; it completes
+        // in the background and its result is dropped
+        bool withdrawn = ModeChanges().Withdraw(ticket_);
+        Reject(outcome);
+        if (withdrawn)
+        {
+            // The scheduler never calls a withdrawn request back
+            completion_->Release();
+        }
+    }
+
+    void ModeChangeWorker::Resolve(const ModeChangeResult &result)
+    {
+        if (settled_)
+        {
+            return;
+        }
+
+        Napi::Env env = env_;
+        Napi::HandleScope scope(env);
+
+        settled_ = true;
+        Unwatch();
+
+        if (result.status == ModeChangeResult::Status::Failed)
+        {
+            deferred_.Reject(Napi::Error::New(env, result.message).Value());
+            return;
+        }
+
+        deferred_.Resolve(ModeChangeResultToValue(env, result));
+    }
+
+    void ModeChangeWorker::Reject(Outcome outcome)
+    {
+        if (settled_)
+        {
+            return;
+        }
+
+        Napi::Env env = env_;
+        Napi::HandleScope scope(env);
+
+        settled_ = true;
+        Unwatch();
+
+        if (outcome == Outcome::Cancelled)
+        {
+            Napi::Error error = Napi::Error::New(env, "The operation was aborted");
+            error.Set("name", Napi::String::New(env, "AbortError"));
+            error.Set("code", Napi::String::New(env, "ABORT_ERR"));
+            deferred_.Reject(error.Value());
+            return;
+        }
+
+        Napi::Error error = Napi::Error::New(env, "The display mode change timed out after " + std::to_string(timeoutMs_) + "ms");
+        error.Set("code", Napi::String::New(env, "ETIMEDOUT"));
+        deferred_.Reject(error.Value());
+    }
+
+    void ModeChangeWorker::OnFinalize(Napi::Env env, ModeChangeWorker *worker)
+    {
+        {
+            std::lock_guard<std::mutex> lock(worker->completion_->mutex);
+            worker->completion_->finalized = true;
+        }
+
+        // Also runs when the environment shuts down with the change pending
+        if (!worker->settled_ && env != nullptr && CanCallIntoJs(env))
+        {
+            Napi::HandleScope scope(env);
+            worker->Unwatch();
+        }
+        delete worker;
+    }
+}
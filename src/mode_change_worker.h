@@ -0,0 +1,87 @@
+#ifndef MONITORRES_MODE_CHANGE_WORKER_H_
+#define MONITORRES_MODE_CHANGE_WORKER_H_
+
+#include <napi.h>
+
+#include <cstdint>
+#include <memory>
+
+#include "mode_change_scheduler.h"
+
+namespace monitorres
+{
+    // Queues a mode change on ModeChanges() and settles a promise with the
+    // same values the synchronous set functions return. The scheduler
+    // thread that applies the change hands its result to the JS thread
+    // through a ThreadSafeFunction, so no libuv pool thread waits for it.
+    //
+    // The change can be cancelled through an AbortSignal and bounded by a
+    // timeout. Either rejects the promise at once. Before the scheduler
+    // starts the change, that also takes the request out of its batch;
+    // after, the mode-set completes in the background.
+    //
+    // Deletes itself once the scheduler is done with it.
+    class ModeChangeWorker
+    {
+    public:
+        ModeChangeWorker(Napi::Env env,
+                         std::shared_ptr<DisplayBackend> backend,
+                         ModeChangeRequest request,
+                         uint32_t timeoutMs);
+
+        ModeChangeWorker(const ModeChangeWorker &) = delete;
+        ModeChangeWorker &operator=(const ModeChangeWorker &) = delete;
+
+        Napi::Promise Promise() const;
+
+        // Cancel the change when signal aborts. Returns false (with a pending
+        // JS exception) if signal is not an AbortSignal.
+        bool WatchSignal(Napi::Object signal);
+
+        // Submit the change to the scheduler. Changes enter the scheduler in
+        // call order. The worker must not be touched afterwards.
+        void Schedule();
+
+    private:
+        enum class Outcome
+        {
+            Cancelled,
+            TimedOut
+        };
+
+        // The ThreadSafeFunction the scheduler reports through; shared with
+        // the completion so it is never called once finalized
+        struct Completion;
+
+        // Reject because of outcome, withdrawing the change unless it already started
+        void Stop(Outcome outcome);
+
+        // Settle the promise, unless that already happened
+        void Resolve(const ModeChangeResult &result);
+        void Reject(Outcome outcome);
+
+        // Remove the abort listener and clear the timeout
+        void Unwatch();
+
+        void StartTimer();
+
+        static void OnFinalize(Napi::Env env, ModeChangeWorker *worker);
+
+        Napi::Env env_;
+        Napi::Promise::Deferred deferred_;
+        std::shared_ptr<DisplayBackend> backend_;
+        ModeChangeRequest request_;
+        ModeChangeTicket ticket_;
+        uint32_t timeoutMs_;
+        bool aborted_ = false;
+        bool settled_ = false;
+        std::shared_ptr<Completion> completion_;
+        Napi::ObjectReference signal_;
+        Napi::FunctionReference abortListener_;
+        // What setTimeout returned: an object in Node, a number elsewhere
+        Napi::ObjectReference timer_;
+        double timerId_ = -1;
+    };
+}
+
+#endif
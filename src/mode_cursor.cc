@@ -0,0 +1,66 @@
+#include "mode_cursor.h"
+
+#include <algorithm>
+
+#include "stats.h"
+
+namespace monitorres
+{
+    ModeCursor::ModeCursor(std::shared_ptr<DisplayBackend> backend, std::string id)
+        : backend_(std::move(backend)), id_(std::move(id))
+    {
+    }
+
+    std::vector<DisplayMode> ModeCursor::Next(uint32_t count)
+    {
+        MONITORRES_TIME_PHASE("readModeBatch");
+        std::vector<DisplayMode> batch;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!started_)
+        {
+            // Decided on the first batch, so a cursor created before the
+            // table was cached still picks it up
+            table_ = ModeTables().Peek(id_);
+            started_ = true;
+        }
+
+        if (table_)
+        {
+            const std::vector<DisplayMode> &modes = table_->Modes();
+            uint32_t end = static_cast<uint32_t>(std::min<size_t>(modes.size(), static_cast<size_t>(position_) + count));
+            if (!closed_.load() && position_ < end)
+            {
+                batch.assign(modes.begin() + position_, modes.begin() + end);
+                position_ = end;
+            }
+            return batch;
+        }
+
+        batch.reserve(std::min(count, kDefaultModeBatchSize));
+        DisplayMode mode;
+        while (!exhausted_ && batch.size() < count && !closed_.load())
+        {
+            if (!backend_->EnumMode(id_, position_, mode))
+            {
+                exhausted_ = true;
+                // The full list was never held, so seen_ can go now
+                seen_ = std::unordered_set<uint64_t>();
+                break;
+            }
+            position_++;
+
+            // Same rule as ModeTable: the first bit depth reported wins
+            if (seen_.insert(PackModeKey(mode.width, mode.height, mode.refreshRate, 0)).second)
+            {
+                batch.push_back(mode);
+            }
+        }
+        return batch;
+    }
+
+    void ModeCursor::Close()
+    {
+        closed_.store(true);
+    }
+}
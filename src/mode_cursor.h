@@ -0,0 +1,59 @@
+#ifndef MONITORRES_MODE_CURSOR_H_
+#define MONITORRES_MODE_CURSOR_H_
+
+#include "display_backend.h"
+#include "mode_table.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace monitorres
+{
+    // Modes a cursor reads per batch unless told otherwise, and the most it reads
+    const uint32_t kDefaultModeBatchSize = 256;
+    const uint32_t kMaxModeBatchSize = 65536;
+
+    // Reads the mode list of a device a batch at a time, yielding the modes
+    // of ModeTable::Modes() in the same order. A table already in the mode
+    // cache is served from there; otherwise the backend is enumerated only
+    // as far as the batches asked for, and nothing is cached. Apart from one
+    // batch, only the keys of the modes yielded so far are kept.
+    //
+    // Next() may be called from any thread; calls are serialized.
+    class ModeCursor
+    {
+    public:
+        ModeCursor(std::shared_ptr<DisplayBackend> backend, std::string id);
+
+        // Get up to count more modes; empty once the list is exhausted or
+        // the cursor is closed
+        std::vector<DisplayMode> Next(uint32_t count);
+
+        // Stop reading, also ending a Next() running on another thread
+        // after its current mode
+        void Close();
+
+    private:
+        std::shared_ptr<DisplayBackend> backend_;
+        std::string id_;
+        std::atomic<bool> closed_{false};
+
+        // Guards the members below
+        std::mutex mutex_;
+        bool started_ = false;
+        bool exhausted_ = false;
+        // Cached table being served, or nullptr while enumerating
+        std::shared_ptr<const ModeTable> table_;
+        // Position in table_ or the backend's mode index
+        uint32_t position_ = 0;
+        // Width/height/refresh rate keys yielded while enumerating
+        std::unordered_set<uint64_t> seen_;
+    };
+}
+
+#endif
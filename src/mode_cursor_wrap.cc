@@ -0,0 +1,163 @@
+#include "mode_cursor_wrap.h"
+
+#include <string>
+#include <vector>
+
+#include "marshal.h"
+#include "stats.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        // Reads one batch off the JS thread and settles a promise with an
+        // array of modes, or null once the list is exhausted
+        class ModeBatchWorker : public Napi::AsyncWorker
+        {
+        public:
+            ModeBatchWorker(Napi::Env env, std::shared_ptr<ModeCursor> cursor, uint32_t count)
+                : Napi::AsyncWorker(env, "monitorres:modeBatch"),
+                  deferred_(Napi::Promise::Deferred::New(env)),
+                  cursor_(std::move(cursor)),
+                  count_(count)
+            {
+            }
+
+            Napi::Promise Promise() const
+            {
+                return deferred_.Promise();
+            }
+
+        protected:
+            void Execute() override
+            {
+                try
+                {
+                    batch_ = cursor_->Next(count_);
+                }
+                catch (const std::exception &e)
+                {
+                    SetError(e.what());
+                }
+            }
+
+            void OnOK() override
+            {
+                Napi::Env env = Env();
+                Napi::HandleScope scope(env);
+
+                if (batch_.empty())
+                {
+                    deferred_.Resolve(env.Null());
+                    return;
+                }
+
+                Napi::Array values = NewArray(env, batch_.size());
+                for (size_t i = 0; i < batch_.size(); i++)
+                {
+                    values.Set(static_cast<uint32_t>(i), ModeToValue(env, batch_[i]));
+                }
+                deferred_.Resolve(values);
+            }
+
+            void OnError(const Napi::Error &error) override
+            {
+                Napi::HandleScope scope(Env());
+                deferred_.Reject(error.Value());
+            }
+
+        private:
+            Napi::Promise::Deferred deferred_;
+            std::shared_ptr<ModeCursor> cursor_;
+            uint32_t count_;
+            std::vector<DisplayMode> batch_;
+        };
+    }
+
+    Napi::Function ModeCursorWrap::DefineClass(Napi::Env env)
+    {
+        return Napi::ObjectWrap<ModeCursorWrap>::DefineClass(
+            env,
+            "ModeCursor",
+            {InstanceMethod("next", &ModeCursorWrap::Next),
+             InstanceMethod("close", &ModeCursorWrap::Close)});
+    }
+
+    ModeCursorWrap::ModeCursorWrap(const Napi::CallbackInfo &info)
+        : Napi::ObjectWrap<ModeCursorWrap>(info)
+    {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString())
+        {
+            Napi::TypeError::New(env, "Monitor ID must be a string").ThrowAsJavaScriptException();
+            return;
+        }
+
+        if (info.Length() >= 2 && !info[1].IsUndefined())
+        {
+            if (!info[1].IsObject())
+            {
+                Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+                return;
+            }
+
+            Napi::Value batchSize = info[1].As<Napi::Object>().Get("batchSize");
+            if (!batchSize.IsUndefined())
+            {
+                double value = batchSize.IsNumber() ? batchSize.As<Napi::Number>().DoubleValue() : 0;
+                if (value < 1 || value > kMaxModeBatchSize || value != static_cast<uint32_t>(value))
+                {
+                    Napi::TypeError::New(env, "options.batchSize must be an integer from 1 to " + std::to_string(kMaxModeBatchSize)).ThrowAsJavaScriptException();
+                    return;
+                }
+                batchSize_ = static_cast<uint32_t>(value);
+            }
+        }
+
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return;
+        }
+
+        cursor_ = std::make_shared<ModeCursor>(backend, info[0].As<Napi::String>().Utf8Value());
+    }
+
+    ModeCursorWrap::~ModeCursorWrap()
+    {
+        if (cursor_)
+        {
+            cursor_->Close();
+        }
+    }
+
+    // Read the next batch of modes off the JS thread
+    Napi::Value ModeCursorWrap::Next(const Napi::CallbackInfo &info)
+    {
+        MONITORRES_TIME_EXPORT("ModeCursor.next");
+        Napi::Env env = info.Env();
+
+        if (!cursor_)
+        {
+            Napi::Error::New(env, "Mode cursor was not created").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        ModeBatchWorker *worker = new ModeBatchWorker(env, cursor_, batchSize_);
+        Napi::Promise promise = worker->Promise();
+        worker->Queue();
+        return promise;
+    }
+
+    // Stop reading; a batch being read ends early and later ones resolve with null
+    Napi::Value ModeCursorWrap::Close(const Napi::CallbackInfo &info)
+    {
+        MONITORRES_TIME_EXPORT("ModeCursor.close");
+        if (cursor_)
+        {
+            cursor_->Close();
+        }
+        return info.Env().Undefined();
+    }
+}
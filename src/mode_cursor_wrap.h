@@ -0,0 +1,34 @@
+#ifndef MONITORRES_MODE_CURSOR_WRAP_H_
+#define MONITORRES_MODE_CURSOR_WRAP_H_
+
+#include <napi.h>
+
+#include <memory>
+
+#include "mode_cursor.h"
+
+namespace monitorres
+{
+    // JS class ModeCursor(monitorId, [options]): read a monitor's modes
+    // with next(), which resolves with the next batch off the JS thread or
+    // null at the end, and stop early with close(). iterateModes wraps it
+    // in an async iterator.
+    class ModeCursorWrap : public Napi::ObjectWrap<ModeCursorWrap>
+    {
+    public:
+        static Napi::Function DefineClass(Napi::Env env);
+
+        explicit ModeCursorWrap(const Napi::CallbackInfo &info);
+        ~ModeCursorWrap() override;
+
+    private:
+        Napi::Value Next(const Napi::CallbackInfo &info);
+        Napi::Value Close(const Napi::CallbackInfo &info);
+
+        // Shared with the batch being read, which may outlive this object
+        std::shared_ptr<ModeCursor> cursor_;
+        uint32_t batchSize_ = kDefaultModeBatchSize;
+    };
+}
+
+#endif
@@ -0,0 +1,233 @@
+#include "mode_query.h"
+
+#include <algorithm>
+
+namespace monitorres
+{
+    namespace
+    {
+        const ModeRankKey kDefaultRanking[] = {
+            {ModeRankField::Area, false},
+            {ModeRankField::RefreshRate, false},
+            {ModeRankField::BitsPerPixel, false}};
+
+        // A candidate key and the score of each ranking criterion, higher is better
+        struct RankedKey
+        {
+            uint64_t key;
+            int64_t scores[kMaxModeRankKeys];
+        };
+
+        class Ranker
+        {
+        public:
+            Ranker(const ModeTable &table, const std::vector<ModeRankKey> &ranking, const DisplayMode *current)
+                : table_(table), current_(current)
+            {
+                const ModeRankKey *keys = ranking.empty() ? kDefaultRanking : ranking.data();
+                keyCount_ = ranking.empty() ? sizeof(kDefaultRanking) / sizeof(kDefaultRanking[0]) : std::min(ranking.size(), kMaxModeRankKeys);
+                std::copy(keys, keys + keyCount_, keys_);
+            }
+
+            RankedKey Score(uint64_t key) const
+            {
+                RankedKey ranked;
+                ranked.key = key;
+                for (size_t i = 0; i < keyCount_; i++)
+                {
+                    ranked.scores[i] = FieldScore(keys_[i], ModeKeyWidth(key), ModeKeyHeight(key), ModeKeyRefreshRate(key), ModeKeyBitsPerPixel(key));
+                }
+                return ranked;
+            }
+
+            // Best score any key of a resolution with refresh rates from
+            // minRefreshRate to maxRefreshRate could reach
+            RankedKey Bound(const ModeResolution &resolution, uint32_t minRefreshRate, uint32_t maxRefreshRate) const
+            {
+                RankedKey bound;
+                bound.key = PackModeKey(resolution.width, resolution.height, maxRefreshRate, kModeKeyComponentMax);
+                for (size_t i = 0; i < keyCount_; i++)
+                {
+                    const ModeRankKey &key = keys_[i];
+                    switch (key.field)
+                    {
+                    case ModeRankField::Current:
+                        bound.scores[i] = current_ != nullptr && resolution.width == current_->width && resolution.height == current_->height;
+                        break;
+                    case ModeRankField::RefreshRate:
+                        bound.scores[i] = key.ascending ? -static_cast<int64_t>(minRefreshRate) : maxRefreshRate;
+                        break;
+                    case ModeRankField::BitsPerPixel:
+                        bound.scores[i] = key.ascending ? 0 : kModeKeyComponentMax;
+                        break;
+                    default:
+                        bound.scores[i] = FieldScore(key, resolution.width, resolution.height, 0, 0);
+                        break;
+                    }
+                }
+                return bound;
+            }
+
+            // Whether a ranks before b; the larger mode wins full ties so results are stable
+            bool Better(const RankedKey &a, const RankedKey &b) const
+            {
+                for (size_t i = 0; i < keyCount_; i++)
+                {
+                    if (a.scores[i] != b.scores[i])
+                    {
+                        return a.scores[i] > b.scores[i];
+                    }
+                }
+                return a.key > b.key;
+            }
+
+        private:
+            int64_t FieldScore(const ModeRankKey &key, uint32_t width, uint32_t height, uint32_t refreshRate, uint32_t bitsPerPixel) const
+            {
+                int64_t value = 0;
+                switch (key.field)
+                {
+                case ModeRankField::Native:
+                    return width == table_.NativeWidth() && height == table_.NativeHeight();
+                case ModeRankField::Current:
+                    return current_ != nullptr &&
+                           width == current_->width &&
+                           height == current_->height &&
+                           refreshRate == current_->refreshRate;
+                case ModeRankField::Width:
+                    value = width;
+                    break;
+                case ModeRankField::Height:
+                    value = height;
+                    break;
+                case ModeRankField::Area:
+                    value = static_cast<int64_t>(width) * height;
+                    break;
+                case ModeRankField::RefreshRate:
+                    value = refreshRate;
+                    break;
+                case ModeRankField::BitsPerPixel:
+                    value = bitsPerPixel;
+                    break;
+                }
+                return key.ascending ? -value : value;
+            }
+
+            const ModeTable &table_;
+            const DisplayMode *current_;
+            ModeRankKey keys_[kMaxModeRankKeys];
+            size_t keyCount_;
+        };
+
+        bool AspectRatioAllowed(const ModeConstraints &constraints, uint32_t width, uint32_t height)
+        {
+            if (constraints.minAspectRatio > 0 && width < constraints.minAspectRatio * height)
+            {
+                return false;
+            }
+            if (constraints.maxAspectRatio > 0 && width > constraints.maxAspectRatio * height)
+            {
+                return false;
+            }
+            return true;
+        }
+    }
+
+    std::vector<DisplayMode> FindBestModes(const ModeTable &table, const ModeQuery &query, const DisplayMode *current, size_t count)
+    {
+        std::vector<DisplayMode> modes;
+        if (count == 0)
+        {
+            return modes;
+        }
+
+        const ModeConstraints &constraints = query.constraints;
+        const std::vector<uint64_t> &keys = table.Keys();
+        const std::vector<ModeResolution> &resolutions = table.Resolutions();
+        Ranker ranker(table, query.ranking, current);
+
+        uint32_t minRefreshRate = std::min(constraints.refreshRate.min, kModeKeyComponentMax);
+        uint32_t maxRefreshRate = std::min(constraints.refreshRate.max, kModeKeyComponentMax);
+
+        // Best candidates so far, best first. count is small, so insertion
+        // beats a heap, and a fixed array keeps the query free of allocations
+        // until the result is built.
+        RankedKey best[kMaxBestModes];
+        size_t bestCount = 0;
+        count = std::min(count, kMaxBestModes);
+
+        // Resolutions are sorted by width, so the width range is two binary
+        // searches. Walk it from the largest resolution down, since rankings
+        // mostly prefer large modes and an early full list prunes the rest.
+        auto byWidth = [](const ModeResolution &resolution, uint32_t width)
+        { return resolution.width < width; };
+        auto first = std::lower_bound(resolutions.begin(), resolutions.end(), constraints.width.min, byWidth);
+        auto last = constraints.width.max >= kModeKeyComponentMax
+                        ? resolutions.end()
+                        : std::lower_bound(first, resolutions.end(), constraints.width.max + 1, byWidth);
+
+        for (auto resolution = last; resolution != first;)
+        {
+            --resolution;
+            if (!constraints.height.Contains(resolution->height) ||
+                !AspectRatioAllowed(constraints, resolution->width, resolution->height))
+            {
+                continue;
+            }
+
+            // Within a resolution keys are sorted by refresh rate, then bits per pixel
+            auto begin = keys.begin() + resolution->firstKey;
+            auto end = keys.begin() + resolution->lastKey;
+            uint32_t lowestRefreshRate = std::max(ModeKeyRefreshRate(*begin), minRefreshRate);
+            uint32_t highestRefreshRate = std::min(ModeKeyRefreshRate(*(end - 1)), maxRefreshRate);
+            if (lowestRefreshRate > highestRefreshRate)
+            {
+                continue;
+            }
+
+            // Skip the whole resolution if not even its best case makes the list
+            if (bestCount == count && !ranker.Better(ranker.Bound(*resolution, lowestRefreshRate, highestRefreshRate), best[count - 1]))
+            {
+                continue;
+            }
+
+            auto it = std::lower_bound(begin, end, PackModeKey(resolution->width, resolution->height, lowestRefreshRate, 0));
+            auto stop = std::upper_bound(it, end, PackModeKey(resolution->width, resolution->height, highestRefreshRate, kModeKeyComponentMax));
+
+            for (; it != stop; ++it)
+            {
+                if (!constraints.bitsPerPixel.Contains(ModeKeyBitsPerPixel(*it)))
+                {
+                    continue;
+                }
+
+                RankedKey candidate = ranker.Score(*it);
+                if (bestCount == count && !ranker.Better(candidate, best[count - 1]))
+                {
+                    continue;
+                }
+
+                // A full list drops its last candidate to make room
+                RankedKey *position = std::upper_bound(best, best + bestCount, candidate,
+                                                       [&ranker](const RankedKey &a, const RankedKey &b)
+                                                       { return ranker.Better(a, b); });
+                bestCount = std::min(bestCount + 1, count);
+                std::move_backward(position, best + bestCount - 1, best + bestCount);
+                *position = candidate;
+            }
+        }
+
+        modes.reserve(bestCount);
+        for (size_t i = 0; i < bestCount; i++)
+        {
+            const RankedKey &ranked = best[i];
+            DisplayMode mode;
+            mode.width = ModeKeyWidth(ranked.key);
+            mode.height = ModeKeyHeight(ranked.key);
+            mode.refreshRate = ModeKeyRefreshRate(ranked.key);
+            mode.bitsPerPixel = ModeKeyBitsPerPixel(ranked.key);
+            modes.push_back(mode);
+        }
+        return modes;
+    }
+}
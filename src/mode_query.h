@@ -0,0 +1,84 @@
+#ifndef MONITORRES_MODE_QUERY_H_
+#define MONITORRES_MODE_QUERY_H_
+
+#include "display_backend.h"
+#include "mode_table.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace monitorres
+{
+    // Relative tolerance of an exact aspect ratio constraint, so 1366x768
+    // still counts as 16:9
+    const double kAspectRatioTolerance = 0.01;
+
+    // Runners-up findBestMode reports by default, and the most it accepts
+    const uint32_t kDefaultModeAlternatives = 4;
+    const uint32_t kMaxModeAlternatives = 64;
+
+    // Most modes one FindBestModes call returns: the best and its alternatives
+    const size_t kMaxBestModes = kMaxModeAlternatives + 1;
+
+    // Inclusive range of a mode field
+    struct ModeRange
+    {
+        uint32_t min = 0;
+        uint32_t max = UINT32_MAX;
+
+        bool Contains(uint32_t value) const { return value >= min && value <= max; }
+    };
+
+    // Ranges a mode must fall in. Aspect ratios are width / height; a bound
+    // of 0 leaves that side open.
+    struct ModeConstraints
+    {
+        ModeRange width;
+        ModeRange height;
+        ModeRange refreshRate;
+        ModeRange bitsPerPixel;
+        double minAspectRatio = 0;
+        double maxAspectRatio = 0;
+    };
+
+    enum class ModeRankField
+    {
+        // Modes at the panel's native resolution first
+        Native,
+        // Modes equal to the current width, height and refresh rate first
+        Current,
+        Width,
+        Height,
+        Area,
+        RefreshRate,
+        BitsPerPixel
+    };
+
+    // Longest ranking a query can use
+    const size_t kMaxModeRankKeys = 8;
+
+    // One criterion of a ranking. Numeric fields prefer higher values unless
+    // ascending is set; Native and Current ignore it.
+    struct ModeRankKey
+    {
+        ModeRankField field;
+        bool ascending = false;
+    };
+
+    struct ModeQuery
+    {
+        ModeConstraints constraints;
+        // Criteria in order of precedence, at most kMaxModeRankKeys; later
+        // ones only break ties of earlier ones. Empty ranks by area, refresh
+        // rate, then bits per pixel.
+        std::vector<ModeRankKey> ranking;
+    };
+
+    // Get up to count modes of a table that satisfy the query's constraints,
+    // best first; count is capped at kMaxBestModes. current is only needed when the ranking uses Current. The
+    // returned modes only carry width, height, refresh rate and bits per pixel.
+    std::vector<DisplayMode> FindBestModes(const ModeTable &table, const ModeQuery &query, const DisplayMode *current, size_t count);
+}
+
+#endif
@@ -0,0 +1,356 @@
+#include "mode_table.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_set>
+
+#include "edid.h"
+#include "mode_table_file.h"
+#include "stats.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        bool IsKeyComponent(int value)
+        {
+            return value > 0 && static_cast<uint32_t>(value) <= kModeKeyComponentMax;
+        }
+    }
+
+    ModeTable::ModeTable(const std::vector<DisplayMode> &enumerated, uint32_t nativeWidth, uint32_t nativeHeight)
+    {
+        std::unordered_set<uint64_t> seen;
+        seen.reserve(enumerated.size());
+        keys_.reserve(enumerated.size());
+
+        for (const auto &mode : enumerated)
+        {
+            keys_.push_back(PackModeKey(mode.width, mode.height, mode.refreshRate, mode.bitsPerPixel));
+
+            // Keep the first mode reported for each width/height/refresh rate
+            if (seen.insert(PackModeKey(mode.width, mode.height, mode.refreshRate, 0)).second)
+            {
+                modes_.push_back(mode);
+            }
+        }
+
+        std::sort(keys_.begin(), keys_.end());
+        keys_.erase(std::unique(keys_.begin(), keys_.end()), keys_.end());
+
+        // Group the keys by resolution so queries can skip whole resolutions
+        uint64_t largestArea = 0;
+        bool nativeListed = false;
+        for (uint32_t i = 0; i < keys_.size(); i++)
+        {
+            uint32_t width = ModeKeyWidth(keys_[i]);
+            uint32_t height = ModeKeyHeight(keys_[i]);
+            if (resolutions_.empty() || resolutions_.back().width != width || resolutions_.back().height != height)
+            {
+                resolutions_.push_back(ModeResolution{width, height, i, i});
+
+                uint64_t area = static_cast<uint64_t>(width) * height;
+                if (area > largestArea)
+                {
+                    largestArea = area;
+                    nativeWidth_ = width;
+                    nativeHeight_ = height;
+                }
+                nativeListed = nativeListed || (width == nativeWidth && height == nativeHeight);
+            }
+            resolutions_.back().lastKey = i + 1;
+        }
+
+        if (nativeListed)
+        {
+            nativeWidth_ = nativeWidth;
+            nativeHeight_ = nativeHeight;
+        }
+    }
+
+    ModeTable::ModeTable(std::vector<DisplayMode> modes, std::vector<uint64_t> keys, std::vector<ModeResolution> resolutions, uint32_t nativeWidth, uint32_t nativeHeight)
+        : modes_(std::move(modes)),
+          keys_(std::move(keys)),
+          resolutions_(std::move(resolutions)),
+          nativeWidth_(nativeWidth),
+          nativeHeight_(nativeHeight)
+    {
+    }
+
+    std::shared_ptr<const ModeTable> ModeTable::Enumerate(DisplayBackend &backend, const std::string &id)
+    {
+        MONITORRES_TIME_PHASE("enumerateModes");
+        std::vector<DisplayMode> enumerated;
+        DisplayMode mode;
+
+        uint32_t modeIndex = 0;
+        while (backend.EnumMode(id, modeIndex++, mode))
+        {
+            enumerated.push_back(mode);
+        }
+
+        // The EDID's preferred timing is the panel's native resolution
+        uint32_t nativeWidth = 0;
+        uint32_t nativeHeight = 0;
+        std::vector<uint8_t> edidBytes;
+        if (backend.GetEdid(id, edidBytes))
+        {
+            std::shared_ptr<const EdidInfo> edid = Edids().Get(edidBytes);
+            if (edid && edid->hasPreferredTiming)
+            {
+                nativeWidth = edid->timings[0].width;
+                nativeHeight = edid->timings[0].height;
+            }
+        }
+
+        return std::make_shared<const ModeTable>(enumerated, nativeWidth, nativeHeight);
+    }
+
+    std::pair<std::vector<uint64_t>::const_iterator, std::vector<uint64_t>::const_iterator>
+    ModeTable::ResolutionRange(int width, int height) const
+    {
+        if (!IsKeyComponent(width) || !IsKeyComponent(height))
+        {
+            return std::make_pair(keys_.end(), keys_.end());
+        }
+
+        auto first = std::lower_bound(keys_.begin(), keys_.end(), PackModeKey(width, height, 0, 0));
+        auto last = std::upper_bound(first, keys_.end(), PackModeKey(width, height, kModeKeyComponentMax, kModeKeyComponentMax));
+        return std::make_pair(first, last);
+    }
+
+    bool ModeTable::HasResolution(int width, int height) const
+    {
+        auto range = ResolutionRange(width, height);
+        return range.first != range.second;
+    }
+
+    bool ModeTable::HasMode(int width, int height, int refreshRate) const
+    {
+        if (refreshRate < 0 || static_cast<uint32_t>(refreshRate) > kModeKeyComponentMax)
+        {
+            return false;
+        }
+
+        auto range = ResolutionRange(width, height);
+        auto it = std::lower_bound(range.first, range.second, PackModeKey(width, height, refreshRate, 0));
+        return it != range.second && ModeKeyRefreshRate(*it) == static_cast<uint32_t>(refreshRate);
+    }
+
+    std::vector<uint32_t> ModeTable::RefreshRates(int width, int height) const
+    {
+        std::vector<uint32_t> refreshRates;
+
+        auto range = ResolutionRange(width, height);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            uint32_t refreshRate = ModeKeyRefreshRate(*it);
+            if (refreshRates.empty() || refreshRates.back() != refreshRate)
+            {
+                refreshRates.push_back(refreshRate);
+            }
+        }
+
+        return refreshRates;
+    }
+
+    uint32_t ModeTable::ClosestRefreshRate(int width, int height, int refreshRate) const
+    {
+        auto range = ResolutionRange(width, height);
+        if (range.first == range.second)
+        {
+            return 0;
+        }
+
+        uint32_t target = static_cast<uint32_t>(std::max(0, std::min(refreshRate, static_cast<int>(kModeKeyComponentMax))));
+        auto above = std::lower_bound(range.first, range.second, PackModeKey(width, height, target, 0));
+
+        if (above == range.first)
+        {
+            return ModeKeyRefreshRate(*above);
+        }
+
+        uint32_t below = ModeKeyRefreshRate(*(above - 1));
+        if (above == range.second)
+        {
+            return below;
+        }
+
+        uint32_t aboveRate = ModeKeyRefreshRate(*above);
+        return abs(static_cast<int>(aboveRate) - refreshRate) < abs(static_cast<int>(below) - refreshRate) ? aboveRate : below;
+    }
+
+    std::shared_ptr<const ModeTable> ModeTableCache::Load(DisplayBackend &backend, const std::string &id)
+    {
+        // The mode table file, when open, skips enumerating devices that have
+        // not changed since it was written. The empty id follows the primary
+        // display, so it is never stored there.
+        ModeTableFile &file = PersistentModeTables();
+        if (id.empty() || !file.Enabled())
+        {
+            return ModeTable::Enumerate(backend, id);
+        }
+
+        ModeTableKey key = ReadModeTableKey(backend, id);
+        std::shared_ptr<const ModeTable> table = file.Find(key);
+        if (!table)
+        {
+            table = ModeTable::Enumerate(backend, id);
+            file.Save(key, table);
+        }
+        return table;
+    }
+
+    void ModeTableCache::Publish(std::shared_ptr<const TableMap> tables)
+    {
+        std::atomic_store(&tables_, std::move(tables));
+    }
+
+    std::shared_ptr<const ModeTable> ModeTableCache::Peek(const std::string &id)
+    {
+        std::shared_ptr<const TableMap> tables = std::atomic_load(&tables_);
+        auto it = tables->find(id);
+        if (it == tables->end())
+        {
+            return nullptr;
+        }
+
+        hits_++;
+        return it->second;
+    }
+
+    std::shared_ptr<const ModeTable> ModeTableCache::Get(DisplayBackend &backend, const std::string &id, bool *enumerated)
+    {
+        std::shared_ptr<const TableMap> tables = std::atomic_load(&tables_);
+        auto it = tables->find(id);
+        if (it != tables->end())
+        {
+            hits_++;
+            return it->second;
+        }
+
+        std::promise<std::shared_ptr<const ModeTable>> promise;
+        std::shared_future<std::shared_ptr<const ModeTable>> pending;
+        uint64_t generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            // Published while this thread waited for the lock
+            tables = std::atomic_load(&tables_);
+            it = tables->find(id);
+            if (it != tables->end())
+            {
+                hits_++;
+                return it->second;
+            }
+
+            auto running = pending_.find(id);
+            if (running != pending_.end())
+            {
+                pending = running->second.table;
+            }
+            else
+            {
+                generation = generation_;
+                pending_.emplace(id, Pending{generation, promise.get_future().share()});
+            }
+        }
+
+        if (enumerated != nullptr)
+        {
+            *enumerated = true;
+        }
+
+        if (pending.valid())
+        {
+            coalesced_++;
+            return pending.get();
+        }
+
+        // Enumerate without the lock; this is the slow part
+        misses_++;
+        std::shared_ptr<const ModeTable> table;
+        try
+        {
+            table = Load(backend, id);
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto running = pending_.find(id);
+                if (running != pending_.end() && running->second.generation == generation)
+                {
+                    pending_.erase(running);
+                }
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto running = pending_.find(id);
+            if (running != pending_.end() && running->second.generation == generation)
+            {
+                pending_.erase(running);
+            }
+
+            if (generation == generation_)
+            {
+                std::shared_ptr<TableMap> next = std::make_shared<TableMap>(*tables_);
+                (*next)[id] = table;
+                Publish(std::move(next));
+            }
+        }
+        promise.set_value(table);
+        return table;
+    }
+
+    void ModeTableCache::Invalidate(DisplayBackend &backend, const std::string &id)
+    {
+        // Resolved outside the lock; only the empty id asks the backend
+        std::string resolved = ResolveDeviceId(backend, id);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<TableMap> next = std::make_shared<TableMap>(*tables_);
+        next->erase(resolved);
+        // The primary display is also cached under the empty id
+        next->erase("");
+        Publish(std::move(next));
+        // Lookups from now on must not wait for an enumeration that started before
+        pending_.erase(resolved);
+        pending_.erase("");
+        generation_++;
+        invalidations_++;
+
+        // A table the device rejected a mode of must not come back from the file either
+        PersistentModeTables().Forget(resolved);
+    }
+
+    void ModeTableCache::InvalidateAll()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Publish(std::make_shared<const TableMap>());
+        pending_.clear();
+        generation_++;
+        invalidations_++;
+    }
+
+    ModeCacheStats ModeTableCache::Stats()
+    {
+        ModeCacheStats stats;
+        stats.hits = hits_;
+        stats.misses = misses_;
+        stats.coalesced = coalesced_;
+        stats.invalidations = invalidations_;
+        stats.entries = std::atomic_load(&tables_)->size();
+        return stats;
+    }
+
+    ModeTableCache &ModeTables()
+    {
+        static ModeTableCache cache;
+        return cache;
+    }
+}
@@ -0,0 +1,166 @@
+#ifndef MONITORRES_MODE_TABLE_H_
+#define MONITORRES_MODE_TABLE_H_
+
+#include "display_backend.h"
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace monitorres
+{
+    // Largest value a component of a packed mode key can hold
+    const uint32_t kModeKeyComponentMax = 0xFFFF;
+
+    // Pack a mode into a key ordered by width, height, refresh rate, then bits per pixel
+    inline uint64_t PackModeKey(uint32_t width, uint32_t height, uint32_t refreshRate, uint32_t bitsPerPixel)
+    {
+        return (static_cast<uint64_t>(width & kModeKeyComponentMax) << 48) |
+               (static_cast<uint64_t>(height & kModeKeyComponentMax) << 32) |
+               (static_cast<uint64_t>(refreshRate & kModeKeyComponentMax) << 16) |
+               static_cast<uint64_t>(bitsPerPixel & kModeKeyComponentMax);
+    }
+
+    inline uint32_t ModeKeyWidth(uint64_t key) { return static_cast<uint32_t>(key >> 48) & kModeKeyComponentMax; }
+    inline uint32_t ModeKeyHeight(uint64_t key) { return static_cast<uint32_t>(key >> 32) & kModeKeyComponentMax; }
+    inline uint32_t ModeKeyRefreshRate(uint64_t key) { return static_cast<uint32_t>(key >> 16) & kModeKeyComponentMax; }
+    inline uint32_t ModeKeyBitsPerPixel(uint64_t key) { return static_cast<uint32_t>(key) & kModeKeyComponentMax; }
+
+    // A distinct resolution of a mode table and its range of Keys()
+    struct ModeResolution
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t firstKey;
+        uint32_t lastKey;
+    };
+
+    // The mode list of one device, enumerated once and indexed for lookups
+    class ModeTable
+    {
+    public:
+        // nativeWidth and nativeHeight give the panel's native resolution;
+        // when it is 0 or not in the list, the largest resolution is used
+        explicit ModeTable(const std::vector<DisplayMode> &enumerated, uint32_t nativeWidth = 0, uint32_t nativeHeight = 0);
+
+        // Take the arrays of an existing table, e.g. read back from a mode
+        // table file, without sorting or deduplicating them again
+        ModeTable(std::vector<DisplayMode> modes, std::vector<uint64_t> keys, std::vector<ModeResolution> resolutions, uint32_t nativeWidth, uint32_t nativeHeight);
+
+        // Enumerate every mode the backend reports for a device
+        static std::shared_ptr<const ModeTable> Enumerate(DisplayBackend &backend, const std::string &id);
+
+        // Modes in enumeration order, one per width/height/refresh rate
+        // combination (the first bit depth reported wins)
+        const std::vector<DisplayMode> &Modes() const { return modes_; }
+
+        // Distinct packed keys in ascending order
+        const std::vector<uint64_t> &Keys() const { return keys_; }
+
+        // Distinct resolutions in ascending order, each with its keys
+        const std::vector<ModeResolution> &Resolutions() const { return resolutions_; }
+
+        uint32_t NativeWidth() const { return nativeWidth_; }
+        uint32_t NativeHeight() const { return nativeHeight_; }
+
+        bool HasResolution(int width, int height) const;
+        bool HasMode(int width, int height, int refreshRate) const;
+
+        // Distinct refresh rates available at a resolution, ascending
+        std::vector<uint32_t> RefreshRates(int width, int height) const;
+
+        // Refresh rate at a resolution closest to the requested one, lower
+        // rate on ties; 0 if the resolution is not supported
+        uint32_t ClosestRefreshRate(int width, int height, int refreshRate) const;
+
+    private:
+        // Range of keys at a resolution
+        std::pair<std::vector<uint64_t>::const_iterator, std::vector<uint64_t>::const_iterator>
+        ResolutionRange(int width, int height) const;
+
+        std::vector<DisplayMode> modes_;
+        std::vector<uint64_t> keys_;
+        std::vector<ModeResolution> resolutions_;
+        uint32_t nativeWidth_ = 0;
+        uint32_t nativeHeight_ = 0;
+    };
+
+    struct ModeCacheStats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        // Misses that waited for an enumeration of the same device already
+        // running on another thread instead of starting their own
+        uint64_t coalesced = 0;
+        uint64_t invalidations = 0;
+        size_t entries = 0;
+    };
+
+    // Process-wide cache of mode tables keyed by device id. Tables stay valid
+    // until the display configuration changes or the cache is invalidated.
+    //
+    // Safe to use from any number of threads. The tables are published as an
+    // immutable map that writers copy and swap, so hits take no lock; a miss
+    // enumerates once however many threads ask for the device meanwhile.
+    class ModeTableCache
+    {
+    public:
+        // Get the table of a device, enumerating it on a miss; enumerated,
+        // if given, is set when the table was not cached yet
+        std::shared_ptr<const ModeTable> Get(DisplayBackend &backend, const std::string &id, bool *enumerated = nullptr);
+
+        // Get the table of a device if it is cached, without enumerating;
+        // counts a hit if it is
+        std::shared_ptr<const ModeTable> Peek(const std::string &id);
+
+        // Drop the table of a device, here and in the mode table file. The
+        // empty id stands for the primary display, which is cached under
+        // both its own id and the empty one.
+        void Invalidate(DisplayBackend &backend, const std::string &id);
+        void InvalidateAll();
+
+        ModeCacheStats Stats();
+
+    private:
+        using TableMap = std::map<std::string, std::shared_ptr<const ModeTable>>;
+
+        // An enumeration in progress
+        struct Pending
+        {
+            // generation_ when it started; an invalidation since makes it stale
+            uint64_t generation;
+            std::shared_future<std::shared_ptr<const ModeTable>> table;
+        };
+
+        // Read a device's table from the mode table file or the backend
+        static std::shared_ptr<const ModeTable> Load(DisplayBackend &backend, const std::string &id);
+
+        // Caller must hold mutex_; replace the published tables. Writers
+        // modify a copy, since readers may hold the old map for as long as
+        // they like.
+        void Publish(std::shared_ptr<const TableMap> tables);
+
+        // Never modified once published; read with std::atomic_load, or
+        // directly by a writer holding mutex_
+        std::shared_ptr<const TableMap> tables_ = std::make_shared<const TableMap>();
+        // Serializes writers of tables_ and guards the members below
+        std::mutex mutex_;
+        std::map<std::string, Pending> pending_;
+        // Bumped by every invalidation so enumerations that raced with one are not cached
+        uint64_t generation_ = 0;
+        std::atomic<uint64_t> hits_{0};
+        std::atomic<uint64_t> misses_{0};
+        std::atomic<uint64_t> coalesced_{0};
+        std::atomic<uint64_t> invalidations_{0};
+    };
+
+    // The process-wide mode table cache
+    ModeTableCache &ModeTables();
+}
+
+#endif
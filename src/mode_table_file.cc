@@ -0,0 +1,533 @@
+#include "mode_table_file.h"
+
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "edid.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace monitorres
+{
+    namespace
+    {
+        const char kFileMagic[4] = {'M', 'R', 'M', 'T'};
+        // Written in native byte order; a file from a machine of the other order does not match
+        const uint32_t kByteOrderMark = 0x01020304;
+
+        struct FileHeader
+        {
+            char magic[4];
+            uint32_t byteOrder;
+            uint32_t version;
+            uint32_t entryCount;
+            uint64_t size;
+            // Of every byte after the header
+            uint64_t checksum;
+        };
+
+        // Offsets are from the start of the file, counts are in elements
+        struct FileEntry
+        {
+            uint64_t edidHash;
+            uint32_t idOffset;
+            uint32_t idLength;
+            uint32_t driverOffset;
+            uint32_t driverLength;
+            uint32_t orientation;
+            uint32_t modesOffset;
+            uint32_t modeCount;
+            uint32_t keysOffset;
+            uint32_t keyCount;
+            uint32_t resolutionsOffset;
+            uint32_t resolutionCount;
+            uint32_t nativeWidth;
+            uint32_t nativeHeight;
+            uint32_t reserved;
+        };
+
+        static_assert(sizeof(FileHeader) == 32, "FileHeader must have no padding");
+        static_assert(sizeof(FileEntry) == 64, "FileEntry must have no padding");
+        static_assert(sizeof(DisplayMode) == 28 && std::is_trivially_copyable<DisplayMode>::value, "DisplayMode is stored as is");
+        static_assert(sizeof(ModeResolution) == 16 && std::is_trivially_copyable<ModeResolution>::value, "ModeResolution is stored as is");
+
+        uint64_t Checksum(const uint8_t *data, size_t size)
+        {
+            // FNV-1a over 64 bit words
+            const uint64_t prime = 1099511628211ULL;
+            uint64_t hash = 14695981039346656037ULL ^ size;
+
+            size_t i = 0;
+            for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+            {
+                uint64_t word;
+                memcpy(&word, data + i, sizeof(word));
+                hash = (hash ^ word) * prime;
+            }
+            for (; i < size; i++)
+            {
+                hash = (hash ^ data[i]) * prime;
+            }
+            return hash;
+        }
+
+        // Whether count elements of elementSize bytes at offset lie inside the file
+        bool InFile(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+        {
+            return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+        }
+
+        FileEntry ReadEntry(const uint8_t *record)
+        {
+            FileEntry entry;
+            memcpy(&entry, record, sizeof(entry));
+            return entry;
+        }
+
+        // Append bytes at an 8 byte aligned offset, returning the offset
+        uint32_t Append(std::vector<uint8_t> &out, const void *data, size_t size)
+        {
+            out.resize((out.size() + 7) & ~static_cast<size_t>(7));
+            uint32_t offset = static_cast<uint32_t>(out.size());
+            const uint8_t *bytes = static_cast<const uint8_t *>(data);
+            out.insert(out.end(), bytes, bytes + size);
+            return offset;
+        }
+
+        std::vector<uint8_t> SerializeEntries(const std::vector<std::pair<ModeTableKey, std::shared_ptr<const ModeTable>>> &tables)
+        {
+            std::vector<uint8_t> out(sizeof(FileHeader) + tables.size() * sizeof(FileEntry));
+
+            for (size_t i = 0; i < tables.size(); i++)
+            {
+                const ModeTableKey &key = tables[i].first;
+                const ModeTable &table = *tables[i].second;
+
+                FileEntry entry = {};
+                entry.edidHash = key.edidHash;
+                entry.idOffset = Append(out, key.id.data(), key.id.size());
+                entry.idLength = static_cast<uint32_t>(key.id.size());
+                entry.driverOffset = Append(out, key.driverVersion.data(), key.driverVersion.size());
+                entry.driverLength = static_cast<uint32_t>(key.driverVersion.size());
+                entry.orientation = key.orientation;
+                entry.modesOffset = Append(out, table.Modes().data(), table.Modes().size() * sizeof(DisplayMode));
+                entry.modeCount = static_cast<uint32_t>(table.Modes().size());
+                entry.keysOffset = Append(out, table.Keys().data(), table.Keys().size() * sizeof(uint64_t));
+                entry.keyCount = static_cast<uint32_t>(table.Keys().size());
+                entry.resolutionsOffset = Append(out, table.Resolutions().data(), table.Resolutions().size() * sizeof(ModeResolution));
+                entry.resolutionCount = static_cast<uint32_t>(table.Resolutions().size());
+                entry.nativeWidth = table.NativeWidth();
+                entry.nativeHeight = table.NativeHeight();
+                memcpy(out.data() + sizeof(FileHeader) + i * sizeof(FileEntry), &entry, sizeof(entry));
+            }
+
+            FileHeader header = {};
+            memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+            header.byteOrder = kByteOrderMark;
+            header.version = kModeTableFileVersion;
+            header.entryCount = static_cast<uint32_t>(tables.size());
+            header.size = out.size();
+            header.checksum = Checksum(out.data() + sizeof(FileHeader), out.size() - sizeof(FileHeader));
+            memcpy(out.data(), &header, sizeof(header));
+            return out;
+        }
+
+        bool WriteFile(const std::string &path, const std::vector<uint8_t> &bytes)
+        {
+            FILE *file = fopen(path.c_str(), "wb");
+            if (file == nullptr)
+            {
+                return false;
+            }
+
+            bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+            return fclose(file) == 0 && written;
+        }
+
+        bool ReplaceFile(const std::string &from, const std::string &to)
+        {
+#ifdef _WIN32
+            return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+            return rename(from.c_str(), to.c_str()) == 0;
+#endif
+        }
+    }
+
+    ModeTableKey ReadModeTableKey(DisplayBackend &backend, const std::string &id)
+    {
+        ModeTableKey key;
+        key.id = id;
+
+        std::vector<uint8_t> edid;
+        if (backend.GetEdid(id, edid))
+        {
+            key.edidHash = HashEdid(edid);
+        }
+
+        backend.GetDriverVersion(id, key.driverVersion);
+
+        DisplayMode current;
+        if (backend.GetCurrentMode(id, current))
+        {
+            key.orientation = current.orientation;
+        }
+        return key;
+    }
+
+    bool ModeTableFile::Mapping::Open(const std::string &path)
+    {
+        Close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        HANDLE section = NULL;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 ||
+            (section = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        void *view = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+        if (view == NULL)
+        {
+            CloseHandle(section);
+            CloseHandle(file);
+            return false;
+        }
+
+        file_ = file;
+        section_ = section;
+        data_ = static_cast<const uint8_t *>(view);
+        size_ = static_cast<size_t>(size.QuadPart);
+        return true;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        void *view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (view == MAP_FAILED)
+        {
+            return false;
+        }
+
+        data_ = static_cast<const uint8_t *>(view);
+        size_ = static_cast<size_t>(info.st_size);
+        return true;
+#endif
+    }
+
+    void ModeTableFile::Mapping::Close()
+    {
+        if (data_ == nullptr)
+        {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+        CloseHandle(section_);
+        CloseHandle(file_);
+        file_ = nullptr;
+        section_ = nullptr;
+#else
+        munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    ModeTableFile::~ModeTableFile()
+    {
+        Flush();
+    }
+
+    bool ModeTableFile::Open(const std::string &path)
+    {
+        Flush();
+
+        // A Save from another thread may start a writer after the flush;
+        // the generation keeps it away from the mapping opened here
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation_++;
+        dirty_ = false;
+        path_ = path;
+        entries_.clear();
+        mapping_.Close();
+        stats_ = ModeTableFileStats();
+        stats_.path = path;
+
+        if (path.empty() || !mapping_.Open(path))
+        {
+            return false;
+        }
+
+        if (!ReadMapping())
+        {
+            stats_.errors++;
+            entries_.clear();
+            mapping_.Close();
+            return false;
+        }
+        return true;
+    }
+
+    bool ModeTableFile::ReadMapping()
+    {
+        const uint8_t *data = mapping_.Data();
+        size_t size = mapping_.Size();
+
+        FileHeader header;
+        if (size < sizeof(header))
+        {
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+
+        if (memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 ||
+            header.byteOrder != kByteOrderMark ||
+            header.version != kModeTableFileVersion ||
+            header.size != size ||
+            !InFile(sizeof(header), header.entryCount, sizeof(FileEntry), size) ||
+            header.checksum != Checksum(data + sizeof(header), size - sizeof(header)))
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < header.entryCount; i++)
+        {
+            const uint8_t *record = data + sizeof(header) + i * sizeof(FileEntry);
+            FileEntry entry = ReadEntry(record);
+            if (!InFile(entry.idOffset, entry.idLength, 1, size) ||
+                !InFile(entry.driverOffset, entry.driverLength, 1, size) ||
+                !InFile(entry.modesOffset, entry.modeCount, sizeof(DisplayMode), size) ||
+                !InFile(entry.keysOffset, entry.keyCount, sizeof(uint64_t), size) ||
+                !InFile(entry.resolutionsOffset, entry.resolutionCount, sizeof(ModeResolution), size))
+            {
+                return false;
+            }
+
+            // Lookups binary search the keys and index them through the resolutions
+            uint64_t previousKey = 0;
+            for (uint32_t k = 0; k < entry.keyCount; k++)
+            {
+                uint64_t modeKey;
+                memcpy(&modeKey, data + entry.keysOffset + k * sizeof(uint64_t), sizeof(modeKey));
+                if (k > 0 && modeKey <= previousKey)
+                {
+                    return false;
+                }
+                previousKey = modeKey;
+            }
+            for (uint32_t r = 0; r < entry.resolutionCount; r++)
+            {
+                ModeResolution resolution;
+                memcpy(&resolution, data + entry.resolutionsOffset + r * sizeof(ModeResolution), sizeof(resolution));
+                if (resolution.firstKey >= resolution.lastKey || resolution.lastKey > entry.keyCount)
+                {
+                    return false;
+                }
+            }
+
+            Entry indexed;
+            indexed.key.id.assign(reinterpret_cast<const char *>(data + entry.idOffset), entry.idLength);
+            indexed.key.edidHash = entry.edidHash;
+            indexed.key.driverVersion.assign(reinterpret_cast<const char *>(data + entry.driverOffset), entry.driverLength);
+            indexed.key.orientation = entry.orientation;
+            indexed.record = record;
+            std::string id = indexed.key.id;
+            entries_[id] = std::move(indexed);
+        }
+
+        stats_.entries = entries_.size();
+        return true;
+    }
+
+    void ModeTableFile::Materialize(Entry &entry)
+    {
+        if (entry.table || entry.record == nullptr)
+        {
+            return;
+        }
+
+        const uint8_t *data = mapping_.Data();
+        FileEntry record = ReadEntry(entry.record);
+
+        std::vector<DisplayMode> modes(record.modeCount);
+        memcpy(modes.data(), data + record.modesOffset, modes.size() * sizeof(DisplayMode));
+        std::vector<uint64_t> keys(record.keyCount);
+        memcpy(keys.data(), data + record.keysOffset, keys.size() * sizeof(uint64_t));
+        std::vector<ModeResolution> resolutions(record.resolutionCount);
+        memcpy(resolutions.data(), data + record.resolutionsOffset, resolutions.size() * sizeof(ModeResolution));
+
+        entry.table = std::make_shared<const ModeTable>(std::move(modes), std::move(keys), std::move(resolutions), record.nativeWidth, record.nativeHeight);
+        entry.record = nullptr;
+    }
+
+    bool ModeTableFile::Enabled()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !path_.empty();
+    }
+
+    std::shared_ptr<const ModeTable> ModeTableFile::Find(const ModeTableKey &key)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key.id);
+        if (path_.empty() || it == entries_.end() || !(it->second.key == key))
+        {
+            stats_.misses++;
+            return nullptr;
+        }
+
+        Materialize(it->second);
+        stats_.hits++;
+        return it->second.table;
+    }
+
+    void ModeTableFile::Save(const ModeTableKey &key, std::shared_ptr<const ModeTable> table)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (path_.empty())
+        {
+            return;
+        }
+
+        Entry &entry = entries_[key.id];
+        entry.key = key;
+        entry.table = std::move(table);
+        entry.record = nullptr;
+        stats_.entries = entries_.size();
+        ScheduleWrite();
+    }
+
+    void ModeTableFile::Forget(const std::string &id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entries_.erase(id) == 0)
+        {
+            return;
+        }
+        stats_.entries = entries_.size();
+        ScheduleWrite();
+    }
+
+    void ModeTableFile::ScheduleWrite()
+    {
+        dirty_ = true;
+        if (writing_)
+        {
+            // The running writer picks the change up before it exits
+            return;
+        }
+
+        writing_ = true;
+        if (writer_.joinable())
+        {
+            writer_.join();
+        }
+        writer_ = std::thread(&ModeTableFile::WriteLoop, this);
+    }
+
+    void ModeTableFile::WriteLoop()
+    {
+        for (;;)
+        {
+            std::string path;
+            uint64_t generation;
+            std::vector<std::pair<ModeTableKey, std::shared_ptr<const ModeTable>>> tables;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!dirty_ || path_.empty())
+                {
+                    writing_ = false;
+                    return;
+                }
+                dirty_ = false;
+                path = path_;
+                generation = generation_;
+
+                // Every entry is copied out so the old mapping can go when the file is replaced
+                for (auto &entry : entries_)
+                {
+                    Materialize(entry.second);
+                    tables.emplace_back(entry.second.key, entry.second.table);
+                }
+            }
+
+            // Serialize and write without the lock; lookups keep being answered
+            std::string temporary = path + ".tmp";
+            bool written = WriteFile(temporary, SerializeEntries(tables));
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (generation != generation_)
+            {
+                // Open ran meanwhile; its entries may point into the new
+                // mapping, and the file it read is the one to keep
+                remove(temporary.c_str());
+                continue;
+            }
+
+            mapping_.Close();
+            if (written && ReplaceFile(temporary, path))
+            {
+                stats_.writes++;
+            }
+            else
+            {
+                remove(temporary.c_str());
+                stats_.errors++;
+            }
+        }
+    }
+
+    void ModeTableFile::Flush()
+    {
+        std::thread writer;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            writer = std::move(writer_);
+        }
+        if (writer.joinable())
+        {
+            writer.join();
+        }
+    }
+
+    ModeTableFileStats ModeTableFile::Stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    ModeTableFile &PersistentModeTables()
+    {
+        static ModeTableFile file;
+        return file;
+    }
+}
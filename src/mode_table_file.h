@@ -0,0 +1,143 @@
+#ifndef MONITORRES_MODE_TABLE_FILE_H_
+#define MONITORRES_MODE_TABLE_FILE_H_
+
+#include "display_backend.h"
+#include "mode_table.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace monitorres
+{
+    // Version of the file ModeTableFile writes; files of other versions are ignored
+    const uint32_t kModeTableFileVersion = 1;
+
+    // What a device's mode list depends on: it only changes with the
+    // monitor, its orientation or the driver
+    struct ModeTableKey
+    {
+        std::string id;
+        uint64_t edidHash = 0;
+        std::string driverVersion;
+        uint32_t orientation = 0;
+
+        bool operator==(const ModeTableKey &other) const
+        {
+            return id == other.id && edidHash == other.edidHash && driverVersion == other.driverVersion && orientation == other.orientation;
+        }
+    };
+
+    // Read the key of a device; a handful of calls where enumerating its
+    // modes can take thousands
+    ModeTableKey ReadModeTableKey(DisplayBackend &backend, const std::string &id);
+
+    struct ModeTableFileStats
+    {
+        std::string path;
+        // Tables read from the file or recorded for it
+        size_t entries = 0;
+        // Lookups answered from the file
+        uint64_t hits = 0;
+        // Lookups with no entry or a key that no longer matches
+        uint64_t misses = 0;
+        // Times the file was rewritten
+        uint64_t writes = 0;
+        // Files that were corrupt, of another version or could not be written
+        uint64_t errors = 0;
+    };
+
+    // Opt-in persistent cache of mode tables: a flat file holding each
+    // table's finished arrays, keyed by ModeTableKey. The file is memory
+    // mapped and checked against its checksum when opened, and tables are
+    // copied straight out of the mapping without enumerating or sorting.
+    // New or changed tables are written back by a background thread, which
+    // replaces the file atomically. A missing, corrupt or foreign file is
+    // ignored, so lookups fall back to live enumeration.
+    class ModeTableFile
+    {
+    public:
+        ~ModeTableFile();
+
+        // Use the file at path, reading it if it is valid; an empty path
+        // turns the file off. Pending writes to the previous file finish
+        // first. Returns false if path held no usable file.
+        bool Open(const std::string &path);
+
+        bool Enabled();
+
+        // Get the table stored for a key; nullptr if there is none or the
+        // key no longer matches
+        std::shared_ptr<const ModeTable> Find(const ModeTableKey &key);
+
+        // Record a table and schedule a rewrite of the file
+        void Save(const ModeTableKey &key, std::shared_ptr<const ModeTable> table);
+
+        // Drop the entry of a device so its modes are enumerated again
+        void Forget(const std::string &id);
+
+        // Wait for a pending rewrite
+        void Flush();
+
+        ModeTableFileStats Stats();
+
+    private:
+        struct Entry
+        {
+            ModeTableKey key;
+            // Null until read out of the mapping
+            std::shared_ptr<const ModeTable> table;
+            // Record of the entry in the mapping; nullptr for tables recorded by Save
+            const uint8_t *record = nullptr;
+        };
+
+        // Read-only view of a whole file
+        class Mapping
+        {
+        public:
+            ~Mapping() { Close(); }
+            bool Open(const std::string &path);
+            void Close();
+            const uint8_t *Data() const { return data_; }
+            size_t Size() const { return size_; }
+
+        private:
+            const uint8_t *data_ = nullptr;
+            size_t size_ = 0;
+#ifdef _WIN32
+            void *file_ = nullptr;
+            void *section_ = nullptr;
+#endif
+        };
+
+        // Caller must hold mutex_; index the entries of a mapped file, false if it is not valid
+        bool ReadMapping();
+
+        // Caller must hold mutex_; copy a table out of the mapping
+        void Materialize(Entry &entry);
+
+        // Caller must hold mutex_; mark the file dirty and start the writer if it is idle
+        void ScheduleWrite();
+
+        void WriteLoop();
+
+        std::mutex mutex_;
+        std::string path_;
+        Mapping mapping_;
+        // Bumped by Open; a writer only unmaps the mapping it copied every entry out of
+        uint64_t generation_ = 0;
+        std::map<std::string, Entry> entries_;
+        ModeTableFileStats stats_;
+        bool dirty_ = false;
+        bool writing_ = false;
+        std::thread writer_;
+    };
+
+    // The process-wide mode table file, off until opened
+    ModeTableFile &PersistentModeTables();
+}
+
+#endif
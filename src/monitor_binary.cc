@@ -0,0 +1,160 @@
+#include "monitor_binary.h"
+
+#include <cstring>
+
+#include "monitorres_core.h"
+#include "stats.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        const uint8_t kMonitorBinaryMagic[4] = {'M', 'R', 'M', 'I'};
+
+        // Strings each record refers to
+        const size_t kRecordStrings = 7;
+
+        void PutU16(uint8_t *out, uint16_t value)
+        {
+            out[0] = static_cast<uint8_t>(value);
+            out[1] = static_cast<uint8_t>(value >> 8);
+        }
+
+        void PutU32(uint8_t *out, uint32_t value)
+        {
+            for (size_t i = 0; i < 4; i++)
+            {
+                out[i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+        size_t Align4(size_t size)
+        {
+            return (size + 3) & ~static_cast<size_t>(3);
+        }
+    }
+
+    MonitorBinaryWriter::MonitorBinaryWriter(const MonitorSnapshot &snapshot, const std::vector<std::shared_ptr<const EdidInfo>> &edids, uint64_t generation)
+        : snapshot_(snapshot), edids_(edids), generation_(generation)
+    {
+        static const std::string empty;
+        Intern(empty);
+
+        references_.reserve(snapshot.size() * kRecordStrings);
+        for (size_t i = 0; i < snapshot.size(); i++)
+        {
+            const DisplayDevice &device = snapshot[i].device;
+            references_.push_back(Intern(device.id));
+            references_.push_back(Intern(device.name));
+            references_.push_back(Intern(device.deviceId));
+            references_.push_back(Intern(device.deviceKey));
+
+            const EdidInfo *edid = i < edids.size() ? edids[i].get() : nullptr;
+            references_.push_back(edid ? Intern(edid->manufacturer) : 0);
+            references_.push_back(edid ? Intern(edid->name) : 0);
+            references_.push_back(edid ? Intern(edid->serial) : 0);
+        }
+
+        stringsOffset_ = kMonitorBinaryHeaderSize + static_cast<uint32_t>(snapshot.size()) * kMonitorBinaryRecordSize;
+        size_ = Align4(stringsOffset_ + 4 + (strings_.size() + 1) * 4 + stringBytes_);
+    }
+
+    uint32_t MonitorBinaryWriter::Intern(const std::string &value)
+    {
+        auto inserted = indexes_.emplace(value, static_cast<uint32_t>(strings_.size()));
+        if (inserted.second)
+        {
+            // Keys of an unordered_map keep their address
+            strings_.push_back(&inserted.first->first);
+            stringBytes_ += static_cast<uint32_t>(value.size());
+        }
+        return inserted.first->second;
+    }
+
+    void MonitorBinaryWriter::Write(uint8_t *out) const
+    {
+        MONITORRES_TIME_PHASE("writeMonitorsBinary");
+        memset(out, 0, size_);
+
+        memcpy(out, kMonitorBinaryMagic, sizeof(kMonitorBinaryMagic));
+        PutU16(out + 4, kMonitorBinaryFormatVersion);
+        PutU16(out + 6, static_cast<uint16_t>(kMonitorBinaryHeaderSize));
+        PutU32(out + 8, static_cast<uint32_t>(snapshot_.size()));
+        PutU32(out + 12, kMonitorBinaryRecordSize);
+        PutU32(out + 16, kMonitorBinaryHeaderSize);
+        PutU32(out + 20, stringsOffset_);
+        PutU32(out + 24, static_cast<uint32_t>(size_));
+        PutU32(out + 28, static_cast<uint32_t>(generation_));
+
+        for (size_t i = 0; i < snapshot_.size(); i++)
+        {
+            const MonitorState &state = snapshot_[i];
+            const EdidInfo *edid = i < edids_.size() ? edids_[i].get() : nullptr;
+            const uint32_t *references = &references_[i * kRecordStrings];
+            uint8_t *record = out + kMonitorBinaryHeaderSize + i * kMonitorBinaryRecordSize;
+
+            uint32_t flags = 0;
+            flags |= state.hasMode ? kMonitorBinaryHasMode : 0;
+            flags |= edid ? kMonitorBinaryHasEdid : 0;
+            flags |= (state.device.stateFlags & kDevicePrimary) ? kMonitorBinaryPrimary : 0;
+            flags |= (state.device.stateFlags & kDeviceAttachedToDesktop) ? kMonitorBinaryAttached : 0;
+            flags |= edid && edid->hasPreferredTiming ? kMonitorBinaryHasPreferredTiming : 0;
+            flags |= edid && edid->hasPreferredTiming && edid->timings.front().interlaced ? kMonitorBinaryPreferredInterlaced : 0;
+
+            for (size_t j = 0; j < 4; j++)
+            {
+                PutU32(record + 4 * j, references[j]);
+            }
+            PutU32(record + 16, state.device.stateFlags);
+            PutU32(record + 20, flags);
+
+            if (state.hasMode)
+            {
+                PutU32(record + 24, state.mode.width);
+                PutU32(record + 28, state.mode.height);
+                PutU32(record + 32, state.mode.refreshRate);
+                PutU32(record + 36, state.mode.bitsPerPixel);
+                PutU32(record + 40, state.mode.orientation);
+                PutU32(record + 44, static_cast<uint32_t>(state.mode.positionX));
+                PutU32(record + 48, static_cast<uint32_t>(state.mode.positionY));
+            }
+
+            if (edid)
+            {
+                PutU32(record + 52, references[4]);
+                PutU32(record + 56, references[5]);
+                PutU32(record + 60, references[6]);
+                PutU32(record + 64, edid->productCode);
+                PutU32(record + 68, edid->serialNumber);
+                PutU32(record + 72, edid->manufactureWeek);
+                PutU32(record + 76, edid->manufactureYear);
+                PutU32(record + 80, (edid->versionMajor << 8) | edid->versionMinor);
+                PutU32(record + 84, edid->widthMm);
+                PutU32(record + 88, edid->heightMm);
+
+                if (edid->hasPreferredTiming)
+                {
+                    const EdidTiming &timing = edid->timings.front();
+                    PutU32(record + 92, timing.width);
+                    PutU32(record + 96, timing.height);
+                    PutU32(record + 100, timing.refreshRate);
+                    PutU32(record + 104, timing.pixelClockKHz);
+                }
+            }
+        }
+
+        uint8_t *table = out + stringsOffset_;
+        PutU32(table, static_cast<uint32_t>(strings_.size()));
+        uint8_t *offsets = table + 4;
+        uint8_t *bytes = offsets + (strings_.size() + 1) * 4;
+
+        uint32_t offset = 0;
+        for (size_t i = 0; i < strings_.size(); i++)
+        {
+            PutU32(offsets + 4 * i, offset);
+            memcpy(bytes + offset, strings_[i]->data(), strings_[i]->size());
+            offset += static_cast<uint32_t>(strings_[i]->size());
+        }
+        PutU32(offsets + 4 * strings_.size(), offset);
+    }
+}
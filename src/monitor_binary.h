@@ -0,0 +1,82 @@
+#ifndef MONITORRES_MONITOR_BINARY_H_
+#define MONITORRES_MONITOR_BINARY_H_
+
+#include "edid.h"
+#include "monitor_snapshot.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace monitorres
+{
+    // Version of the layout MonitorBinaryWriter writes. Fields may be
+    // appended to the records without a new version; readers step over
+    // records by the record size in the header.
+    const uint16_t kMonitorBinaryFormatVersion = 1;
+
+    const uint32_t kMonitorBinaryHeaderSize = 32;
+    const uint32_t kMonitorBinaryRecordSize = 112;
+
+    // Bits of a record's flags field
+    const uint32_t kMonitorBinaryHasMode = 0x01;
+    const uint32_t kMonitorBinaryHasEdid = 0x02;
+    const uint32_t kMonitorBinaryPrimary = 0x04;
+    const uint32_t kMonitorBinaryAttached = 0x08;
+    const uint32_t kMonitorBinaryHasPreferredTiming = 0x10;
+    const uint32_t kMonitorBinaryPreferredInterlaced = 0x20;
+
+    // Lays out monitors as getAllMonitorsBinary returns them. Every field is
+    // little-endian and 4-byte aligned:
+    //
+    //   Header, 32 bytes: "MRMI", u16 version, u16 header size, u32 monitor
+    //   count, u32 record size, u32 records offset, u32 string table
+    //   offset, u32 total size, u32 low bits of the snapshot generation.
+    //
+    //   Records, one per monitor, of u32 fields unless noted: id, name,
+    //   deviceId, deviceKey, stateFlags, flags, width, height, refreshRate,
+    //   bitsPerPixel, orientation, i32 x, i32 y, then from the EDID
+    //   manufacturer, name, serial, productCode, serialNumber, week, year,
+    //   version (major << 8 | minor), widthMm, heightMm and the preferred
+    //   timing's width, height, refreshRate and pixelClockKHz, then 4
+    //   reserved bytes. Strings are indexes into the string table; mode and
+    //   EDID fields are 0 when flags says there is none.
+    //
+    //   String table: u32 count, count + 1 u32 offsets into the bytes that
+    //   follow, then the UTF-8 bytes. String 0 is the empty string, and each
+    //   distinct string is stored once.
+    class MonitorBinaryWriter
+    {
+    public:
+        // edids holds the parsed EDID of each monitor of snapshot, nullptr
+        // where there is none. Both must outlive the writer.
+        MonitorBinaryWriter(const MonitorSnapshot &snapshot, const std::vector<std::shared_ptr<const EdidInfo>> &edids, uint64_t generation);
+
+        // Bytes Write produces
+        size_t Size() const { return size_; }
+
+        // Write the layout into out, which holds Size() bytes
+        void Write(uint8_t *out) const;
+
+    private:
+        uint32_t Intern(const std::string &value);
+
+        const MonitorSnapshot &snapshot_;
+        const std::vector<std::shared_ptr<const EdidInfo>> &edids_;
+        uint64_t generation_;
+        // Distinct strings in table order and their indexes
+        std::vector<const std::string *> strings_;
+        std::unordered_map<std::string, uint32_t> indexes_;
+        // String indexes of each record: id, name, deviceId, deviceKey,
+        // then manufacturer, name and serial of the EDID
+        std::vector<uint32_t> references_;
+        uint32_t stringBytes_ = 0;
+        uint32_t stringsOffset_ = 0;
+        size_t size_ = 0;
+    };
+}
+
+#endif
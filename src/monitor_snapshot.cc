@@ -0,0 +1,138 @@
+#include "monitor_snapshot.h"
+
+#include "desktop_layout.h"
+#include "stats.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        // Generations a poller can fall behind and still get a diff
+        const size_t kMaxSnapshotHistory = 16;
+
+        bool SameMode(const DisplayMode &a, const DisplayMode &b)
+        {
+            return a.width == b.width &&
+                   a.height == b.height &&
+                   a.refreshRate == b.refreshRate &&
+                   a.bitsPerPixel == b.bitsPerPixel &&
+                   a.orientation == b.orientation &&
+                   a.positionX == b.positionX &&
+                   a.positionY == b.positionY;
+        }
+    }
+
+    MonitorSnapshot TakeMonitorSnapshot(DisplayBackend &backend)
+    {
+        MONITORRES_TIME_PHASE("takeMonitorSnapshot");
+        MonitorSnapshot snapshot;
+
+        MonitorState state;
+        for (uint32_t i = 0; backend.EnumDevice(i, state.device); i++)
+        {
+            if (state.device.stateFlags & kDeviceActive)
+            {
+                state.hasMode = backend.GetCurrentMode(state.device.id, state.mode);
+                snapshot.push_back(state);
+            }
+        }
+
+        return snapshot;
+    }
+
+    const MonitorState *FindMonitorState(const MonitorSnapshot &snapshot, const std::string &id)
+    {
+        for (const auto &monitor : snapshot)
+        {
+            if (monitor.device.id == id)
+            {
+                return &monitor;
+            }
+        }
+        return nullptr;
+    }
+
+    MonitorSnapshotDiff DiffMonitorSnapshots(const MonitorSnapshot &previous, const MonitorSnapshot &next)
+    {
+        MonitorSnapshotDiff diff;
+
+        for (const auto &monitor : next)
+        {
+            const MonitorState *before = FindMonitorState(previous, monitor.device.id);
+            if (before == nullptr)
+            {
+                diff.added.push_back(monitor.device.id);
+            }
+            else if (before->device.stateFlags != monitor.device.stateFlags ||
+                     before->device.deviceId != monitor.device.deviceId ||
+                     before->hasMode != monitor.hasMode ||
+                     (monitor.hasMode && !SameMode(before->mode, monitor.mode)))
+            {
+                diff.changed.push_back(monitor.device.id);
+            }
+        }
+
+        for (const auto &monitor : previous)
+        {
+            if (FindMonitorState(next, monitor.device.id) == nullptr)
+            {
+                diff.removed.push_back(monitor.device.id);
+            }
+        }
+
+        return diff;
+    }
+
+    uint64_t MonitorSnapshotHistory::Update(MonitorSnapshot snapshot, std::shared_ptr<const MonitorSnapshot> &latest)
+    {
+        // Steady state: the topology did not move, keep the generation
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            if (!entries_.empty() && DiffMonitorSnapshots(*entries_.back().snapshot, snapshot).Empty())
+            {
+                latest = entries_.back().snapshot;
+                return generation_;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+
+        // Another thread may have recorded the same change meanwhile
+        if (!entries_.empty() && DiffMonitorSnapshots(*entries_.back().snapshot, snapshot).Empty())
+        {
+            latest = entries_.back().snapshot;
+            return generation_;
+        }
+
+        // A poller saw a change the layout may predate
+        DesktopLayouts().Invalidate();
+
+        generation_++;
+        entries_.push_back(Entry{generation_, std::make_shared<const MonitorSnapshot>(std::move(snapshot))});
+        if (entries_.size() > kMaxSnapshotHistory)
+        {
+            entries_.pop_front();
+        }
+        latest = entries_.back().snapshot;
+        return generation_;
+    }
+
+    std::shared_ptr<const MonitorSnapshot> MonitorSnapshotHistory::Get(uint64_t generation)
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        for (const auto &entry : entries_)
+        {
+            if (entry.generation == generation)
+            {
+                return entry.snapshot;
+            }
+        }
+        return nullptr;
+    }
+
+    MonitorSnapshotHistory &MonitorSnapshots()
+    {
+        static MonitorSnapshotHistory history;
+        return history;
+    }
+}
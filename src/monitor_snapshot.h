@@ -0,0 +1,77 @@
+#ifndef MONITORRES_MONITOR_SNAPSHOT_H_
+#define MONITORRES_MONITOR_SNAPSHOT_H_
+
+#include "display_backend.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace monitorres
+{
+    // An active monitor and its current mode
+    struct MonitorState
+    {
+        DisplayDevice device;
+        bool hasMode = false;
+        DisplayMode mode;
+    };
+
+    // Every active monitor, in enumeration order
+    using MonitorSnapshot = std::vector<MonitorState>;
+
+    // Monitors that differ between two snapshots
+    struct MonitorSnapshotDiff
+    {
+        std::vector<std::string> added;
+        std::vector<std::string> removed;
+        // State flags, device id, mode, position or orientation changed
+        std::vector<std::string> changed;
+
+        bool Empty() const { return added.empty() && removed.empty() && changed.empty(); }
+    };
+
+    MonitorSnapshot TakeMonitorSnapshot(DisplayBackend &backend);
+
+    MonitorSnapshotDiff DiffMonitorSnapshots(const MonitorSnapshot &previous, const MonitorSnapshot &next);
+
+    // Find a monitor in a snapshot; nullptr if it is not there
+    const MonitorState *FindMonitorState(const MonitorSnapshot &snapshot, const std::string &id);
+
+    // Recent snapshots numbered by a generation that increases whenever the
+    // topology changes, so pollers can ask what changed since the snapshot
+    // they last saw instead of rebuilding every monitor. Polls that find the
+    // topology unchanged only take a reader lock.
+    class MonitorSnapshotHistory
+    {
+    public:
+        // Record snapshot, starting a new generation if it differs from the
+        // latest one; returns the latest generation and its snapshot
+        uint64_t Update(MonitorSnapshot snapshot, std::shared_ptr<const MonitorSnapshot> &latest);
+
+        // Get the snapshot of a generation; nullptr if it is unknown or has
+        // fallen out of the history
+        std::shared_ptr<const MonitorSnapshot> Get(uint64_t generation);
+
+    private:
+        struct Entry
+        {
+            uint64_t generation;
+            std::shared_ptr<const MonitorSnapshot> snapshot;
+        };
+
+        std::shared_mutex mutex_;
+        // Oldest first; generation 0 is never used, so callers can start from it
+        std::deque<Entry> entries_;
+        uint64_t generation_ = 0;
+    };
+
+    // The process-wide snapshot history behind getMonitorsSince
+    MonitorSnapshotHistory &MonitorSnapshots();
+}
+
+#endif
@@ -1,75 +1,185 @@
 #include <napi.h>
-#include <windows.h>
 #include <iostream>
 #include <string>
-#include <set>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "allocation_counters.h"
+#include "display_reconciler_wrap.h"
+#include "display_transaction_wrap.h"
+#include "display_watcher_wrap.h"
+#include "inventory_worker.h"
+#include "marshal.h"
+#include "mode_change_worker.h"
+#include "mode_cursor_wrap.h"
+#include "monitorres_addon.h"
+#include "monitorres_core.h"
+#include "stats.h"
+
+using namespace monitorres;
+
+// The simulated backend installed by useSimulatedBackend, kept for its
+// counters. Shared by every environment, so it is read and replaced with
+// std::atomic_load and std::atomic_store.
+std::shared_ptr<SimulatedDisplayBackend> simulatedBackend;
+
+// The recording started by startBackendRecording and the replay backend
+// installed by useReplayBackend; like simulatedBackend, shared by every
+// environment
+std::shared_ptr<RecordingDisplayBackend> backendRecorder;
+std::shared_ptr<ReplayDisplayBackend> replayBackend;
+
+// Helper function to get the simulated backend if it is the active one,
+// possibly behind a recording
+std::shared_ptr<SimulatedDisplayBackend> ActiveSimulatedBackend()
+{
+    std::shared_ptr<SimulatedDisplayBackend> simulated = std::atomic_load(&simulatedBackend);
+    if (!simulated)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<DisplayBackend> active = GetDisplayBackend();
+    std::shared_ptr<RecordingDisplayBackend> recorder = std::atomic_load(&backendRecorder);
+    if (recorder && active == recorder)
+    {
+        active = recorder->Inner();
+    }
+    return active == simulated ? simulated : nullptr;
+}
+
+// Helper function to report the outcome of a synchronous mode change
+Napi::Value ModeChangeResultToReturnValue(Napi::Env env, const ModeChangeResult &result)
+{
+    if (result.status == ModeChangeResult::Status::Failed)
+    {
+        Napi::Error::New(env, result.message).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return ModeChangeResultToValue(env, result);
+}
+
+// Helper function to read the arguments of setAllScreenResolutions(width, height, [refreshRate])
+// or setAllScreenResolutions(constraints, [ranking])
+bool ParseAllScreensModeArguments(const Napi::CallbackInfo &info, ModeChangeRequest &request)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() >= 1 && info[0].IsObject())
+    {
+        request.hasQuery = true;
+        return ParseModeQuery(env, info[0], info.Length() >= 2 ? info[1] : env.Undefined(), request.query);
+    }
+
+    if (info.Length() < 2)
+    {
+        Napi::TypeError::New(env, "Wrong number of arguments. Expected width and height").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    if (!info[0].IsNumber() || !info[1].IsNumber())
+    {
+        Napi::TypeError::New(env, "Width and height must be numbers").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    request.width = info[0].As<Napi::Number>().Int32Value();
+    request.height = info[1].As<Napi::Number>().Int32Value();
+
+    // Override with user-specified refresh rate if provided
+    if (info.Length() >= 3 && !info[2].IsUndefined() && info[2].IsNumber())
+    {
+        request.refreshRate = info[2].As<Napi::Number>().Int32Value();
+        request.hasRefreshRate = true;
+    }
+
+    return true;
+}
 
-// Helper function to get detailed error information
-Napi::Value GetDetailedError(Napi::Env env, long errorCode)
-{
-    Napi::Object error = Napi::Object::New(env);
-    error.Set("code", Napi::Number::New(env, errorCode));
-
-    switch (errorCode)
-    {
-    case DISP_CHANGE_SUCCESSFUL:
-        error.Set("message", Napi::String::New(env, "The display settings change was successful"));
-        break;
-    case DISP_CHANGE_BADDUALVIEW:
-        error.Set("message", Napi::String::New(env, "The settings change was unsuccessful because the system is DualView capable"));
-        break;
-    case DISP_CHANGE_BADFLAGS:
-        error.Set("message", Napi::String::New(env, "An invalid set of flags was passed"));
-        break;
-    case DISP_CHANGE_BADMODE:
-        error.Set("message", Napi::String::New(env, "The graphics mode is not supported"));
-        break;
-    case DISP_CHANGE_BADPARAM:
-        error.Set("message", Napi::String::New(env, "An invalid parameter was passed"));
-        break;
-    case DISP_CHANGE_FAILED:
-        error.Set("message", Napi::String::New(env, "The display driver failed the specified graphics mode"));
-        break;
-    case DISP_CHANGE_NOTUPDATED:
-        error.Set("message", Napi::String::New(env, "Unable to write settings to the registry"));
-        break;
-    case DISP_CHANGE_RESTART:
-        error.Set("message", Napi::String::New(env, "The computer must be restarted for the graphics mode to work"));
-        break;
-    default:
-        error.Set("message", Napi::String::New(env, "Unknown error"));
-    }
-
-    return error;
+// Helper function to start an asynchronous mode change with the options object at optionsIndex
+Napi::Value StartModeChange(const Napi::CallbackInfo &info, ModeChangeRequest request, size_t optionsIndex)
+{
+    Napi::Env env = info.Env();
+
+    std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+    if (!backend)
+    {
+        return env.Null();
+    }
+
+    uint32_t timeoutMs = 0;
+    Napi::Object signal;
+    if (info.Length() > optionsIndex && !info[optionsIndex].IsUndefined())
+    {
+        if (!info[optionsIndex].IsObject())
+        {
+            Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::Object options = info[optionsIndex].As<Napi::Object>();
+        Napi::Value timeout = options.Get("timeout");
+        if (!timeout.IsUndefined())
+        {
+            if (!timeout.IsNumber() || timeout.As<Napi::Number>().DoubleValue() < 0)
+            {
+                Napi::TypeError::New(env, "options.timeout must be a non-negative number").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            timeoutMs = timeout.As<Napi::Number>().Uint32Value();
+        }
+
+        Napi::Value signalValue = options.Get("signal");
+        if (!signalValue.IsUndefined())
+        {
+            if (!signalValue.IsObject())
+            {
+                Napi::TypeError::New(env, "options.signal must be an AbortSignal").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            signal = signalValue.As<Napi::Object>();
+        }
+    }
+
+    ModeChangeWorker *worker = new ModeChangeWorker(env, backend, std::move(request), timeoutMs);
+    if (!signal.IsEmpty() && !worker->WatchSignal(signal))
+    {
+        delete worker;
+        return env.Null();
+    }
+
+    Napi::Promise promise = worker->Promise();
+    worker->Schedule();
+    return promise;
 }
 
 // Get the current screen resolution
 Napi::Value GetScreenResolution(const Napi::CallbackInfo &info)
 {
+    MONITORRES_TIME_EXPORT("getScreenResolution");
     Napi::Env env = info.Env();
 
     try
     {
-        DEVMODE devMode;
-        ZeroMemory(&devMode, sizeof(DEVMODE));
-        devMode.dmSize = sizeof(DEVMODE);
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
+        }
+
+        DisplayMode mode;
 
         // Get current screen settings
-        if (!EnumDisplaySettings(NULL, ENUM_CURRENT_SETTINGS, &devMode))
+        if (!backend->GetCurrentMode("", mode))
         {
             Napi::Error::New(env, "Failed to get display settings").ThrowAsJavaScriptException();
             return env.Null();
         }
 
-        Napi::Object result = Napi::Object::New(env);
-        result.Set("width", Napi::Number::New(env, devMode.dmPelsWidth));
-        result.Set("height", Napi::Number::New(env, devMode.dmPelsHeight));
-        result.Set("refreshRate", Napi::Number::New(env, devMode.dmDisplayFrequency));
-        result.Set("bitsPerPixel", Napi::Number::New(env, devMode.dmBitsPerPel));
-
-        return result;
+        return ModeToValue(env, mode);
     }
     catch (const std::exception &e)
     {
@@ -81,6 +191,7 @@ Napi::Value GetScreenResolution(const Napi::CallbackInfo &info)
 // Get the resolution of a specific monitor
 Napi::Value GetMonitorResolution(const Napi::CallbackInfo &info)
 {
+    MONITORRES_TIME_EXPORT("getMonitorResolution");
     Napi::Env env = info.Env();
 
     try
@@ -99,24 +210,22 @@ Napi::Value GetMonitorResolution(const Napi::CallbackInfo &info)
 
         std::string id = info[0].As<Napi::String>().Utf8Value();
 
-        DEVMODE devMode;
-        ZeroMemory(&devMode, sizeof(DEVMODE));
-        devMode.dmSize = sizeof(DEVMODE);
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
+        }
+
+        DisplayMode mode;
 
         // Get current screen settings for the specified monitor
-        if (!EnumDisplaySettings(id.c_str(), ENUM_CURRENT_SETTINGS, &devMode))
+        if (!backend->GetCurrentMode(id, mode))
         {
             Napi::Error::New(env, "Failed to get display settings for the specified monitor").ThrowAsJavaScriptException();
             return env.Null();
         }
 
-        Napi::Object result = Napi::Object::New(env);
-        result.Set("width", Napi::Number::New(env, devMode.dmPelsWidth));
-        result.Set("height", Napi::Number::New(env, devMode.dmPelsHeight));
-        result.Set("refreshRate", Napi::Number::New(env, devMode.dmDisplayFrequency));
-        result.Set("bitsPerPixel", Napi::Number::New(env, devMode.dmBitsPerPel));
-
-        return result;
+        return ModeToValue(env, mode);
     }
     catch (const std::exception &e)
     {
@@ -128,170 +237,216 @@ Napi::Value GetMonitorResolution(const Napi::CallbackInfo &info)
 // Set the resolution for all screens
 Napi::Value SetAllScreenResolutions(const Napi::CallbackInfo &info)
 {
+    MONITORRES_TIME_EXPORT("setAllScreenResolutions");
     Napi::Env env = info.Env();
 
     try
     {
-        if (info.Length() < 2)
+        ModeChangeRequest request;
+        if (!ParseAllScreensModeArguments(info, request))
         {
-            Napi::TypeError::New(env, "Wrong number of arguments. Expected width and height").ThrowAsJavaScriptException();
             return env.Null();
         }
 
-        if (!info[0].IsNumber() || !info[1].IsNumber())
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
         {
-            Napi::TypeError::New(env, "Width and height must be numbers").ThrowAsJavaScriptException();
             return env.Null();
         }
 
-        int width = info[0].As<Napi::Number>().Int32Value();
-        int height = info[1].As<Napi::Number>().Int32Value();
+        return ModeChangeResultToReturnValue(env, ModeChanges().Change(backend, std::move(request)));
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
 
-        // First get the current settings to preserve other values
-        DEVMODE currentDevMode;
-        ZeroMemory(&currentDevMode, sizeof(DEVMODE));
-        currentDevMode.dmSize = sizeof(DEVMODE);
+// Set the resolution for all screens without blocking the event loop
+Napi::Value SetAllScreenResolutionsAsync(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("setAllScreenResolutionsAsync");
+    Napi::Env env = info.Env();
 
-        if (!EnumDisplaySettings(NULL, ENUM_CURRENT_SETTINGS, &currentDevMode))
+    try
+    {
+        ModeChangeRequest request;
+        if (!ParseAllScreensModeArguments(info, request))
         {
-            Napi::Error::New(env, "Failed to get current display settings").ThrowAsJavaScriptException();
             return env.Null();
         }
 
-        // Default to current refresh rate if not specified
-        int refreshRate = currentDevMode.dmDisplayFrequency;
-        bool customRefreshRate = false;
+        // Options follow the ranking when constraints are used
+        size_t optionsIndex = request.hasQuery ? 2 : 3;
+        return StartModeChange(info, std::move(request), optionsIndex);
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Get information about all connected monitors
+Napi::Value GetAllMonitors(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("getAllMonitors");
+    Napi::Env env = info.Env();
 
-        // Override with user-specified refresh rate if provided
-        if (info.Length() >= 3 && !info[2].IsUndefined() && info[2].IsNumber())
+    try
+    {
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
         {
-            refreshRate = info[2].As<Napi::Number>().Int32Value();
-            customRefreshRate = true;
+            return env.Null();
         }
 
-        // Validate that the requested mode is supported
-        bool isModeSupported = false;
-        bool isResolutionSupported = false;
-        int closestRefreshRate = 0;
-        std::vector<int> availableRefreshRates;
+        // A projection compiled by compileMonitorFields limits the fields built
+        MonitorProjection projection;
+        if (info.Length() >= 1 && !info[0].IsUndefined())
+        {
+            if (!info[0].IsNumber())
+            {
+                Napi::TypeError::New(env, "Projection must be a number returned by compileMonitorFields").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            projection = MonitorProjection::Unpack(info[0].As<Napi::Number>().Uint32Value());
+        }
 
-        DEVMODE testMode;
-        ZeroMemory(&testMode, sizeof(DEVMODE));
-        testMode.dmSize = sizeof(DEVMODE);
+        // Only active devices are included
+        MonitorSnapshot snapshot = TakeMonitorSnapshot(*backend);
 
-        int modeIndex = 0;
-        while (EnumDisplaySettings(NULL, modeIndex++, &testMode))
+        Napi::Array monitors = NewArray(env, snapshot.size());
+        for (size_t i = 0; i < snapshot.size(); i++)
         {
-            // Check if the resolution matches
-            if (testMode.dmPelsWidth == width && testMode.dmPelsHeight == height)
-            {
-                isResolutionSupported = true;
-                availableRefreshRates.push_back(testMode.dmDisplayFrequency);
+            monitors.Set(static_cast<uint32_t>(i), MonitorToValue(env, *backend, snapshot[i], projection));
+        }
 
-                // Check if the refresh rate matches exactly
-                if (testMode.dmDisplayFrequency == refreshRate)
-                {
-                    isModeSupported = true;
-                    break;
-                }
+        return monitors;
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
 
-                // Keep track of the closest refresh rate
-                if (closestRefreshRate == 0 ||
-                    abs(static_cast<int>(testMode.dmDisplayFrequency) - static_cast<int>(refreshRate)) <
-                        abs(static_cast<int>(closestRefreshRate) - static_cast<int>(refreshRate)))
-                {
-                    closestRefreshRate = testMode.dmDisplayFrequency;
-                }
-            }
+// Get every active monitor with its EDID as one ArrayBuffer in the layout
+// of monitor_binary.h, written in place without building any JS objects
+Napi::Value GetAllMonitorsBinary(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("getAllMonitorsBinary");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
         }
 
-        // If custom refresh rate was specified but not supported, try with the closest available refresh rate
-        if (customRefreshRate && !isModeSupported && isResolutionSupported)
+        std::shared_ptr<const MonitorSnapshot> latest;
+        uint64_t generation = MonitorSnapshots().Update(TakeMonitorSnapshot(*backend), latest);
+
+        std::vector<std::shared_ptr<const EdidInfo>> edids;
+        edids.reserve(latest->size());
+        for (const auto &state : *latest)
         {
-            // Create new settings based on current ones with the closest refresh rate
-            DEVMODE newDevMode = currentDevMode;
-            newDevMode.dmPelsWidth = width;
-            newDevMode.dmPelsHeight = height;
-            newDevMode.dmDisplayFrequency = closestRefreshRate;
-            newDevMode.dmFields = DM_PELSWIDTH | DM_PELSHEIGHT | DM_DISPLAYFREQUENCY;
+            edids.push_back(GetMonitorEdid(*backend, state.device.id));
+        }
 
-            // Sort refresh rates for better error message
-            std::sort(availableRefreshRates.begin(), availableRefreshRates.end());
+        // A plain ArrayBuffer rather than an external one, so it can be
+        // transferred to workers
+        MonitorBinaryWriter writer(*latest, edids, generation);
+        MONITORRES_COUNT_JS_OBJECTS(1);
+        Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(env, writer.Size());
+        writer.Write(static_cast<uint8_t *>(buffer.Data()));
 
-            // Create a string of available refresh rates
-            std::string availableRatesStr = "";
-            for (size_t i = 0; i < availableRefreshRates.size(); i++)
-            {
-                availableRatesStr += std::to_string(availableRefreshRates[i]);
-                if (i < availableRefreshRates.size() - 1)
-                    availableRatesStr += ", ";
-            }
+        return buffer;
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Compile monitor field paths into the projection getAllMonitors takes
+Napi::Value CompileMonitorFields(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("compileMonitorFields");
+    Napi::Env env = info.Env();
 
-            // Apply the settings with the closest refresh rate
-            long result = ChangeDisplaySettings(&newDevMode, 0);
+    MonitorProjection projection;
+    if (!CompileMonitorProjection(env, info.Length() >= 1 ? info[0] : env.Undefined(), projection))
+    {
+        return env.Null();
+    }
 
-            if (result != DISP_CHANGE_SUCCESSFUL)
-            {
-                Napi::Object error = Napi::Object::New(env);
-                error.Set("code", Napi::Number::New(env, result));
-                error.Set("message", Napi::String::New(env,
-                                                       "The requested refresh rate (" + std::to_string(refreshRate) + "Hz) is not supported for resolution " +
-                                                           std::to_string(width) + "x" + std::to_string(height) + ". " +
-                                                           "Available refresh rates: " + availableRatesStr + ". " +
-                                                           "Attempted to use closest rate (" + std::to_string(closestRefreshRate) + "Hz) but failed."));
-                return error;
-            }
+    return Napi::Number::New(env, projection.Pack());
+}
 
-            // Success with closest refresh rate
-            Napi::Object result_obj = Napi::Object::New(env);
-            result_obj.Set("success", Napi::Boolean::New(env, true));
-            result_obj.Set("message", Napi::String::New(env,
-                                                        "Used closest available refresh rate: " + std::to_string(closestRefreshRate) + "Hz instead of requested " +
-                                                            std::to_string(refreshRate) + "Hz. Available rates: " + availableRatesStr));
-            result_obj.Set("actualRefreshRate", Napi::Number::New(env, closestRefreshRate));
-            return result_obj;
+// Get the monitors that changed since a generation returned by an earlier call
+Napi::Value GetMonitorsSince(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("getMonitorsSince");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        if (info.Length() >= 1 && !info[0].IsUndefined() && !info[0].IsNumber())
+        {
+            Napi::TypeError::New(env, "Generation must be a number").ThrowAsJavaScriptException();
+            return env.Null();
         }
+        uint64_t since = info.Length() >= 1 && info[0].IsNumber() ? static_cast<uint64_t>(info[0].As<Napi::Number>().Int64Value()) : 0;
 
-        if (!isResolutionSupported)
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
         {
-            Napi::Object error = Napi::Object::New(env);
-            error.Set("code", Napi::Number::New(env, DISP_CHANGE_BADMODE));
-            error.Set("message", Napi::String::New(env,
-                                                   "The requested resolution is not supported. "
-                                                   "Width: " +
-                                                       std::to_string(width) +
-                                                       ", Height: " + std::to_string(height)));
-            return error;
+            return env.Null();
         }
 
-        if (!isModeSupported && customRefreshRate)
+        std::shared_ptr<const MonitorSnapshot> latest;
+        uint64_t generation = MonitorSnapshots().Update(TakeMonitorSnapshot(*backend), latest);
+
+        // Steady state: nothing to build
+        if (since == generation)
         {
-            Napi::Object error = Napi::Object::New(env);
-            error.Set("code", Napi::Number::New(env, DISP_CHANGE_BADMODE));
-            error.Set("message", Napi::String::New(env,
-                                                   "The requested refresh rate is not supported for this resolution. "
-                                                   "Width: " +
-                                                       std::to_string(width) +
-                                                       ", Height: " + std::to_string(height) +
-                                                       ", Refresh Rate: " + std::to_string(refreshRate)));
-            return error;
+            return env.Null();
         }
 
-        // Create new settings based on current ones
-        DEVMODE newDevMode = currentDevMode;
-        newDevMode.dmPelsWidth = width;
-        newDevMode.dmPelsHeight = height;
-        newDevMode.dmDisplayFrequency = refreshRate;
-        newDevMode.dmFields = DM_PELSWIDTH | DM_PELSHEIGHT | DM_DISPLAYFREQUENCY;
+        // A generation that fell out of the history (or 0) gets everything, flagged as a full snapshot
+        std::shared_ptr<const MonitorSnapshot> previous = MonitorSnapshots().Get(since);
+        MonitorSnapshotDiff diff = DiffMonitorSnapshots(previous ? *previous : MonitorSnapshot(), *latest);
+
+        Napi::Array added = NewArray(env, diff.added.size());
+        for (size_t i = 0; i < diff.added.size(); i++)
+        {
+            added.Set(static_cast<uint32_t>(i), MonitorToValue(env, *backend, *FindMonitorState(*latest, diff.added[i])));
+        }
 
-        long result = ChangeDisplaySettings(&newDevMode, 0);
+        Napi::Array changed = NewArray(env, diff.changed.size());
+        for (size_t i = 0; i < diff.changed.size(); i++)
+        {
+            changed.Set(static_cast<uint32_t>(i), MonitorToValue(env, *backend, *FindMonitorState(*latest, diff.changed[i])));
+        }
 
-        if (result != DISP_CHANGE_SUCCESSFUL)
+        Napi::Array removed = NewArray(env, diff.removed.size());
+        for (size_t i = 0; i < diff.removed.size(); i++)
         {
-            return GetDetailedError(env, result);
+            removed.Set(static_cast<uint32_t>(i), Napi::String::New(env, diff.removed[i]));
         }
 
-        return Napi::Boolean::New(env, true);
+        napi_value values[] = {
+            Napi::Number::New(env, static_cast<double>(generation)),
+            Napi::Boolean::New(env, !previous),
+            added,
+            removed,
+            changed};
+        return NewShapedObject(env, ObjectShape::MonitorChanges, values);
     }
     catch (const std::exception &e)
     {
@@ -300,63 +455,46 @@ Napi::Value SetAllScreenResolutions(const Napi::CallbackInfo &info)
     }
 }
 
-// Get information about all connected monitors
-Napi::Value GetAllMonitors(const Napi::CallbackInfo &info)
+// Get every active monitor and its mode list in one call, reading the
+// monitors in parallel off the JS thread
+Napi::Value GetFullInventory(const Napi::CallbackInfo &info)
 {
+    MONITORRES_TIME_EXPORT("getFullInventory");
     Napi::Env env = info.Env();
 
-    try
+    std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+    if (!backend)
     {
-        Napi::Array monitors = Napi::Array::New(env);
+        return env.Null();
+    }
 
-        // First, enumerate all display devices
-        DISPLAY_DEVICE displayDevice;
-        ZeroMemory(&displayDevice, sizeof(DISPLAY_DEVICE));
-        displayDevice.cb = sizeof(DISPLAY_DEVICE);
+    InventoryWorker *worker = new InventoryWorker(env, backend);
+    Napi::Promise promise = worker->Promise();
+    worker->Queue();
+    return promise;
+}
+
+// Set the resolution for a specific monitor
+Napi::Value SetMonitorResolution(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("setMonitorResolution");
+    Napi::Env env = info.Env();
 
-        int monitorIndex = 0;
-        for (DWORD i = 0; EnumDisplayDevices(NULL, i, &displayDevice, 0); i++)
+    try
+    {
+        ModeChangeRequest request;
+        if (!ParseMonitorModeArguments(info, request))
         {
-            // Only include active devices
-            if (displayDevice.StateFlags & DISPLAY_DEVICE_ACTIVE)
-            {
-                Napi::Object monitor = Napi::Object::New(env);
-                monitor.Set("id", Napi::String::New(env, displayDevice.DeviceName));
-                monitor.Set("name", Napi::String::New(env, displayDevice.DeviceString));
-                monitor.Set("deviceId", Napi::String::New(env, displayDevice.DeviceID));
-                monitor.Set("deviceKey", Napi::String::New(env, displayDevice.DeviceKey));
-                monitor.Set("stateFlags", Napi::Number::New(env, displayDevice.StateFlags));
-                monitor.Set("attachedToDesktop", Napi::Boolean::New(env, displayDevice.StateFlags & DISPLAY_DEVICE_ATTACHED_TO_DESKTOP));
-                monitor.Set("primaryDevice", Napi::Boolean::New(env, displayDevice.StateFlags & DISPLAY_DEVICE_PRIMARY_DEVICE));
-
-                // Get current settings for this device
-                DEVMODE devMode;
-                ZeroMemory(&devMode, sizeof(DEVMODE));
-                devMode.dmSize = sizeof(DEVMODE);
-
-                if (EnumDisplaySettings(displayDevice.DeviceName, ENUM_CURRENT_SETTINGS, &devMode))
-                {
-                    Napi::Object settings = Napi::Object::New(env);
-                    settings.Set("width", Napi::Number::New(env, devMode.dmPelsWidth));
-                    settings.Set("height", Napi::Number::New(env, devMode.dmPelsHeight));
-                    settings.Set("refreshRate", Napi::Number::New(env, devMode.dmDisplayFrequency));
-                    settings.Set("bitsPerPixel", Napi::Number::New(env, devMode.dmBitsPerPel));
-                    settings.Set("orientation", Napi::Number::New(env, devMode.dmDisplayOrientation));
-
-                    // Get position information
-                    Napi::Object position = Napi::Object::New(env);
-                    position.Set("x", Napi::Number::New(env, devMode.dmPosition.x));
-                    position.Set("y", Napi::Number::New(env, devMode.dmPosition.y));
-                    settings.Set("position", position);
-
-                    monitor.Set("currentSettings", settings);
-                }
+            return env.Null();
+        }
 
-                monitors.Set(monitorIndex++, monitor);
-            }
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
         }
 
-        return monitors;
+        return ModeChangeResultToReturnValue(env, ModeChanges().Change(backend, std::move(request)));
     }
     catch (const std::exception &e)
     {
@@ -365,171 +503,112 @@ Napi::Value GetAllMonitors(const Napi::CallbackInfo &info)
     }
 }
 
-// Set the resolution for a specific monitor
-Napi::Value SetMonitorResolution(const Napi::CallbackInfo &info)
+// Set the resolution for a specific monitor without blocking the event loop
+Napi::Value SetMonitorResolutionAsync(const Napi::CallbackInfo &info)
 {
+    MONITORRES_TIME_EXPORT("setMonitorResolutionAsync");
     Napi::Env env = info.Env();
 
     try
     {
-        if (info.Length() < 3)
+        ModeChangeRequest request;
+        if (!ParseMonitorModeArguments(info, request))
         {
-            Napi::TypeError::New(env, "Wrong number of arguments. Expected monitor ID, width, and height").ThrowAsJavaScriptException();
             return env.Null();
         }
 
-        if (!info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber())
+        size_t optionsIndex = request.hasQuery ? 3 : 4;
+        return StartModeChange(info, std::move(request), optionsIndex);
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Find the modes of a monitor that best satisfy constraints and a ranking
+Napi::Value FindBestMode(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("findBestMode");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        if (info.Length() < 2)
         {
-            Napi::TypeError::New(env, "Invalid argument types. Expected string, number, number").ThrowAsJavaScriptException();
+            Napi::TypeError::New(env, "Wrong number of arguments. Expected monitor ID and constraints").ThrowAsJavaScriptException();
             return env.Null();
         }
 
-        std::string id = info[0].As<Napi::String>().Utf8Value();
-        int width = info[1].As<Napi::Number>().Int32Value();
-        int height = info[2].As<Napi::Number>().Int32Value();
-
-        // First get the current settings to preserve other values
-        DEVMODE currentDevMode;
-        ZeroMemory(&currentDevMode, sizeof(DEVMODE));
-        currentDevMode.dmSize = sizeof(DEVMODE);
-
-        if (!EnumDisplaySettings(id.c_str(), ENUM_CURRENT_SETTINGS, &currentDevMode))
+        if (!info[0].IsString())
         {
-            Napi::Error::New(env, "Failed to get current display settings").ThrowAsJavaScriptException();
+            Napi::TypeError::New(env, "Monitor ID must be a string").ThrowAsJavaScriptException();
             return env.Null();
         }
 
-        // Default to current refresh rate if not specified
-        int refreshRate = currentDevMode.dmDisplayFrequency;
-        bool customRefreshRate = false;
+        std::string id = info[0].As<Napi::String>().Utf8Value();
 
-        // Override with user-specified refresh rate if provided
-        if (info.Length() >= 4 && !info[3].IsUndefined() && info[3].IsNumber())
+        ModeQuery query;
+        if (!ParseModeQuery(env, info[1], info.Length() >= 3 ? info[2] : env.Undefined(), query))
         {
-            refreshRate = info[3].As<Napi::Number>().Int32Value();
-            customRefreshRate = true;
+            return env.Null();
         }
 
-        // Create new settings based on current ones
-        DEVMODE newDevMode = currentDevMode;
-        newDevMode.dmPelsWidth = width;
-        newDevMode.dmPelsHeight = height;
-        newDevMode.dmDisplayFrequency = refreshRate;
-        newDevMode.dmFields = DM_PELSWIDTH | DM_PELSHEIGHT | DM_DISPLAYFREQUENCY;
-
-        // Validate that the requested mode is supported
-        bool isModeSupported = false;
-        bool isResolutionSupported = false;
-        int closestRefreshRate = 0;
-        std::vector<int> availableRefreshRates;
-
-        DEVMODE testMode;
-        ZeroMemory(&testMode, sizeof(DEVMODE));
-        testMode.dmSize = sizeof(DEVMODE);
-
-        int modeIndex = 0;
-        while (EnumDisplaySettings(id.c_str(), modeIndex++, &testMode))
+        uint32_t alternatives = kDefaultModeAlternatives;
+        if (info.Length() >= 4 && !info[3].IsUndefined())
         {
-            // Check if the resolution matches
-            if (testMode.dmPelsWidth == width && testMode.dmPelsHeight == height)
+            if (!info[3].IsObject())
             {
-                isResolutionSupported = true;
-                availableRefreshRates.push_back(testMode.dmDisplayFrequency);
-
-                // Check if the refresh rate matches exactly
-                if (testMode.dmDisplayFrequency == refreshRate)
-                {
-                    isModeSupported = true;
-                    break;
-                }
+                Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+                return env.Null();
+            }
 
-                // Keep track of the closest refresh rate
-                if (closestRefreshRate == 0 ||
-                    abs(static_cast<int>(testMode.dmDisplayFrequency) - static_cast<int>(refreshRate)) <
-                        abs(static_cast<int>(closestRefreshRate) - static_cast<int>(refreshRate)))
+            Napi::Value value = info[3].As<Napi::Object>().Get("alternatives");
+            if (!value.IsUndefined())
+            {
+                if (!value.IsNumber() || value.As<Napi::Number>().DoubleValue() < 0 || value.As<Napi::Number>().DoubleValue() > kMaxModeAlternatives)
                 {
-                    closestRefreshRate = testMode.dmDisplayFrequency;
+                    Napi::TypeError::New(env, "options.alternatives must be a number from 0 to " + std::to_string(kMaxModeAlternatives)).ThrowAsJavaScriptException();
+                    return env.Null();
                 }
+                alternatives = value.As<Napi::Number>().Uint32Value();
             }
         }
 
-        // If custom refresh rate was specified but not supported, try with the closest available refresh rate
-        if (customRefreshRate && !isModeSupported && isResolutionSupported)
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
         {
-            // Use the closest refresh rate instead
-            newDevMode.dmDisplayFrequency = closestRefreshRate;
-
-            // Sort refresh rates for better error message
-            std::sort(availableRefreshRates.begin(), availableRefreshRates.end());
-
-            // Create a string of available refresh rates
-            std::string availableRatesStr = "";
-            for (size_t i = 0; i < availableRefreshRates.size(); i++)
-            {
-                availableRatesStr += std::to_string(availableRefreshRates[i]);
-                if (i < availableRefreshRates.size() - 1)
-                    availableRatesStr += ", ";
-            }
-
-            // Apply the settings with the closest refresh rate
-            long result = ChangeDisplaySettingsEx(id.c_str(), &newDevMode, NULL, CDS_UPDATEREGISTRY, NULL);
-
-            if (result != DISP_CHANGE_SUCCESSFUL)
-            {
-                Napi::Object error = Napi::Object::New(env);
-                error.Set("code", Napi::Number::New(env, result));
-                error.Set("message", Napi::String::New(env,
-                                                       "The requested refresh rate (" + std::to_string(refreshRate) + "Hz) is not supported for resolution " +
-                                                           std::to_string(width) + "x" + std::to_string(height) + ". " +
-                                                           "Available refresh rates: " + availableRatesStr + ". " +
-                                                           "Attempted to use closest rate (" + std::to_string(closestRefreshRate) + "Hz) but failed."));
-                return error;
-            }
-
-            // Success with closest refresh rate
-            Napi::Object result_obj = Napi::Object::New(env);
-            result_obj.Set("success", Napi::Boolean::New(env, true));
-            result_obj.Set("message", Napi::String::New(env,
-                                                        "Used closest available refresh rate: " + std::to_string(closestRefreshRate) + "Hz instead of requested " +
-                                                            std::to_string(refreshRate) + "Hz. Available rates: " + availableRatesStr));
-            result_obj.Set("actualRefreshRate", Napi::Number::New(env, closestRefreshRate));
-            return result_obj;
+            return env.Null();
         }
 
-        if (!isResolutionSupported)
+        // The current mode is only read when the ranking asks for it
+        DisplayMode current;
+        const DisplayMode *currentMode = nullptr;
+        for (const auto &key : query.ranking)
         {
-            Napi::Object error = Napi::Object::New(env);
-            error.Set("code", Napi::Number::New(env, DISP_CHANGE_BADMODE));
-            error.Set("message", Napi::String::New(env,
-                                                   "The requested resolution is not supported. "
-                                                   "Width: " +
-                                                       std::to_string(width) +
-                                                       ", Height: " + std::to_string(height)));
-            return error;
+            if (key.field == ModeRankField::Current)
+            {
+                currentMode = backend->GetCurrentMode(id, current) ? &current : nullptr;
+                break;
+            }
         }
 
-        if (!isModeSupported && customRefreshRate)
+        std::shared_ptr<const ModeTable> modes = ModeTables().Get(*backend, id);
+        std::vector<DisplayMode> best = FindBestModes(*modes, query, currentMode, alternatives + 1);
+        if (best.empty())
         {
-            Napi::Object error = Napi::Object::New(env);
-            error.Set("code", Napi::Number::New(env, DISP_CHANGE_BADMODE));
-            error.Set("message", Napi::String::New(env,
-                                                   "The requested refresh rate is not supported for this resolution. "
-                                                   "Width: " +
-                                                       std::to_string(width) +
-                                                       ", Height: " + std::to_string(height) +
-                                                       ", Refresh Rate: " + std::to_string(refreshRate)));
-            return error;
+            return env.Null();
         }
 
-        // Apply the settings
-        long result = ChangeDisplaySettingsEx(id.c_str(), &newDevMode, NULL, CDS_UPDATEREGISTRY, NULL);
-
-        if (result != DISP_CHANGE_SUCCESSFUL)
+        Napi::Array others = NewArray(env, best.size() - 1);
+        for (size_t i = 1; i < best.size(); i++)
         {
-            return GetDetailedError(env, result);
+            others.Set(static_cast<uint32_t>(i - 1), ModeToValue(env, best[i]));
         }
 
-        return Napi::Boolean::New(env, true);
+        napi_value values[] = {ModeToValue(env, best[0]), others};
+        return NewShapedObject(env, ObjectShape::BestMode, values);
     }
     catch (const std::exception &e)
     {
@@ -541,6 +620,7 @@ Napi::Value SetMonitorResolution(const Napi::CallbackInfo &info)
 // Get all available resolutions for a specific monitor
 Napi::Value GetAvailableResolutions(const Napi::CallbackInfo &info)
 {
+    MONITORRES_TIME_EXPORT("getAvailableResolutions");
     Napi::Env env = info.Env();
 
     try
@@ -558,49 +638,22 @@ Napi::Value GetAvailableResolutions(const Napi::CallbackInfo &info)
         }
 
         std::string id = info[0].As<Napi::String>().Utf8Value();
-        Napi::Array resolutions = Napi::Array::New(env);
-
-        DEVMODE devMode;
-        ZeroMemory(&devMode, sizeof(DEVMODE));
-        devMode.dmSize = sizeof(DEVMODE);
-
-        int modeIndex = 0;
-        int resIndex = 0;
-        std::set<std::string> uniqueResolutions;                             // To avoid duplicates
-        std::vector<std::tuple<int, int, int>> uniqueResolutionsWithRefresh; // width, height, refresh rate
 
-        while (EnumDisplaySettings(id.c_str(), modeIndex++, &devMode))
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
         {
-            std::string resolution = std::to_string(devMode.dmPelsWidth) + "x" + std::to_string(devMode.dmPelsHeight);
-            std::tuple<int, int, int> resWithRefresh = std::make_tuple(
-                devMode.dmPelsWidth,
-                devMode.dmPelsHeight,
-                devMode.dmDisplayFrequency);
+            return env.Null();
+        }
 
-            // Check if this exact resolution+refresh rate combination is already in our list
-            bool isDuplicate = false;
-            for (const auto &existing : uniqueResolutionsWithRefresh)
-            {
-                if (std::get<0>(existing) == devMode.dmPelsWidth &&
-                    std::get<1>(existing) == devMode.dmPelsHeight &&
-                    std::get<2>(existing) == devMode.dmDisplayFrequency)
-                {
-                    isDuplicate = true;
-                    break;
-                }
-            }
+        Napi::Array resolutions = NewArray(env);
 
-            if (!isDuplicate)
-            {
-                Napi::Object resObj = Napi::Object::New(env);
-                resObj.Set("width", Napi::Number::New(env, devMode.dmPelsWidth));
-                resObj.Set("height", Napi::Number::New(env, devMode.dmPelsHeight));
-                resObj.Set("refreshRate", Napi::Number::New(env, devMode.dmDisplayFrequency));
-                resObj.Set("bitsPerPixel", Napi::Number::New(env, devMode.dmBitsPerPel));
-                resolutions.Set(resIndex++, resObj);
-
-                uniqueResolutionsWithRefresh.push_back(resWithRefresh);
-            }
+        // Modes come from the cached table, already deduplicated by width, height and refresh rate
+        std::shared_ptr<const ModeTable> modes = ModeTables().Get(*backend, id);
+
+        uint32_t resIndex = 0;
+        for (const auto &mode : modes->Modes())
+        {
+            resolutions.Set(resIndex++, ModeToValue(env, mode));
         }
 
         return resolutions;
@@ -612,30 +665,63 @@ Napi::Value GetAvailableResolutions(const Napi::CallbackInfo &info)
     }
 }
 
-// Get system DPI settings
-Napi::Value GetSystemDPI(const Napi::CallbackInfo &info)
+// Get all available resolutions for a specific monitor as typed array columns
+Napi::Value GetAvailableResolutionsPacked(const Napi::CallbackInfo &info)
 {
+    MONITORRES_TIME_EXPORT("getAvailableResolutionsPacked");
     Napi::Env env = info.Env();
 
     try
     {
-        HDC hdc = GetDC(NULL);
-        if (hdc == NULL)
+        if (info.Length() < 1)
         {
-            Napi::Error::New(env, "Failed to get device context").ThrowAsJavaScriptException();
+            Napi::TypeError::New(env, "Wrong number of arguments. Expected monitor ID").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        if (!info[0].IsString())
+        {
+            Napi::TypeError::New(env, "Monitor ID must be a string").ThrowAsJavaScriptException();
             return env.Null();
         }
 
-        int dpiX = GetDeviceCaps(hdc, LOGPIXELSX);
-        int dpiY = GetDeviceCaps(hdc, LOGPIXELSY);
+        std::string id = info[0].As<Napi::String>().Utf8Value();
 
-        ReleaseDC(NULL, hdc);
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
+        }
 
-        Napi::Object result = Napi::Object::New(env);
-        result.Set("x", Napi::Number::New(env, dpiX));
-        result.Set("y", Napi::Number::New(env, dpiY));
+        // The table's keys are already sorted and unique, so they map straight onto the columns
+        std::shared_ptr<const ModeTable> modes = ModeTables().Get(*backend, id);
+        const std::vector<uint64_t> &keys = modes->Keys();
+        size_t count = keys.size();
+
+        // One buffer holds the four columns back to back
+        // The buffer and its four typed arrays
+        MONITORRES_COUNT_JS_OBJECTS(5);
+        Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(env, count * 4 * sizeof(uint32_t));
+        uint32_t *widths = static_cast<uint32_t *>(buffer.Data());
+        uint32_t *heights = widths + count;
+        uint32_t *refreshRates = heights + count;
+        uint32_t *bitsPerPixel = refreshRates + count;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            widths[i] = ModeKeyWidth(keys[i]);
+            heights[i] = ModeKeyHeight(keys[i]);
+            refreshRates[i] = ModeKeyRefreshRate(keys[i]);
+            bitsPerPixel[i] = ModeKeyBitsPerPixel(keys[i]);
+        }
 
-        return result;
+        napi_value values[] = {
+            Napi::Number::New(env, static_cast<double>(count)),
+            Napi::Uint32Array::New(env, count, buffer, 0),
+            Napi::Uint32Array::New(env, count, buffer, count * sizeof(uint32_t)),
+            Napi::Uint32Array::New(env, count, buffer, 2 * count * sizeof(uint32_t)),
+            Napi::Uint32Array::New(env, count, buffer, 3 * count * sizeof(uint32_t))};
+        return NewShapedObject(env, ObjectShape::PackedModes, values);
     }
     catch (const std::exception &e)
     {
@@ -644,8 +730,1065 @@ Napi::Value GetSystemDPI(const Napi::CallbackInfo &info)
     }
 }
 
-// Initialize the module
-Napi::Object Init(Napi::Env env, Napi::Object exports)
+// Capture the full state of every active device as a compact blob
+Napi::Value CaptureDisplayTopology(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("captureTopology");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
+        }
+
+        std::vector<uint8_t> blob = SerializeTopology(CaptureTopology(*backend));
+        MONITORRES_COUNT_JS_OBJECTS(1);
+        return Napi::Buffer<uint8_t>::Copy(env, blob.data(), blob.size());
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Apply the devices of a captured topology that differ from the live state in one mode-set
+Napi::Value RestoreDisplayTopology(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("restoreTopology");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        if (info.Length() < 1 || !info[0].IsTypedArray() || info[0].As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array)
+        {
+            Napi::TypeError::New(env, "Topology must be a Buffer or Uint8Array returned by captureTopology").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::Uint8Array blob = info[0].As<Napi::Uint8Array>();
+        Topology topology;
+        std::string error;
+        if (!DeserializeTopology(blob.Data(), blob.ByteLength(), topology, error))
+        {
+            Napi::TypeError::New(env, "Invalid topology: " + error).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
+        }
+
+        TopologyRestoreResult result = RestoreTopology(*backend, topology);
+        if (result.code != kDispChangeSuccessful)
+        {
+            Napi::Object errorObj = NewObject(env);
+            errorObj.Set("code", Napi::Number::New(env, result.code));
+            errorObj.Set("message", Napi::String::New(env, result.message));
+            if (!result.failedId.empty())
+            {
+                errorObj.Set("monitorId", Napi::String::New(env, result.failedId));
+            }
+            return errorObj;
+        }
+
+        Napi::Array changed = NewArray(env, result.changed.size());
+        for (size_t i = 0; i < result.changed.size(); i++)
+        {
+            changed.Set(static_cast<uint32_t>(i), Napi::String::New(env, result.changed[i]));
+        }
+
+        Napi::Array missing = NewArray(env, result.missing.size());
+        for (size_t i = 0; i < result.missing.size(); i++)
+        {
+            missing.Set(static_cast<uint32_t>(i), Napi::String::New(env, result.missing[i]));
+        }
+
+        napi_value values[] = {changed, missing};
+        return NewShapedObject(env, ObjectShape::TopologyRestore, values);
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Get system DPI settings
+Napi::Value GetSystemDPI(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("getSystemDPI");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
+        }
+
+        int dpiX = 0;
+        int dpiY = 0;
+        if (!backend->GetSystemDpi(dpiX, dpiY))
+        {
+            Napi::Error::New(env, "Failed to get device context").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        napi_value values[] = {Napi::Number::New(env, dpiX), Napi::Number::New(env, dpiY)};
+        return NewShapedObject(env, ObjectShape::Position, values);
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Helper function to read a coordinate of the virtual desktop, rounding down
+bool ParseDesktopCoordinate(Napi::Value value, int32_t &coordinate)
+{
+    if (!value.IsNumber())
+    {
+        return false;
+    }
+
+    double number = std::floor(value.As<Napi::Number>().DoubleValue());
+    if (!(number >= INT32_MIN && number <= INT32_MAX))
+    {
+        return false;
+    }
+    coordinate = static_cast<int32_t>(number);
+    return true;
+}
+
+// Helper function to read the 'none', 'primary' or 'nearest' policy of a monitor lookup
+bool ParseMonitorFallback(Napi::Env env, Napi::Value value, MonitorFallback &fallback)
+{
+    fallback = MonitorFallback::None;
+    if (value.IsUndefined())
+    {
+        return true;
+    }
+
+    // Compare the whole string; a fixed buffer would cut 'nearestXYZ' down to 'nearest'
+    if (value.IsString())
+    {
+        std::string policy = value.As<Napi::String>().Utf8Value();
+        if (policy == "none")
+        {
+            return true;
+        }
+        if (policy == "primary")
+        {
+            fallback = MonitorFallback::Primary;
+            return true;
+        }
+        if (policy == "nearest")
+        {
+            fallback = MonitorFallback::Nearest;
+            return true;
+        }
+    }
+
+    Napi::TypeError::New(env, "Policy must be 'none', 'primary' or 'nearest'").ThrowAsJavaScriptException();
+    return false;
+}
+
+// Helper function to build a { x, y, width, height } object
+Napi::Object DesktopRectToValue(Napi::Env env, const DesktopRect &rect)
+{
+    napi_value values[] = {
+        Napi::Number::New(env, rect.x),
+        Napi::Number::New(env, rect.y),
+        Napi::Number::New(env, rect.width),
+        Napi::Number::New(env, rect.height)};
+    return NewShapedObject(env, ObjectShape::DesktopRect, values);
+}
+
+// Get the index in getDesktopLayout().monitors of the monitor containing a point
+Napi::Value MonitorFromPoint(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("monitorFromPoint");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        int32_t x = 0;
+        int32_t y = 0;
+        if (info.Length() < 2 || !ParseDesktopCoordinate(info[0], x) || !ParseDesktopCoordinate(info[1], y))
+        {
+            Napi::TypeError::New(env, "Expected x and y coordinates").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        MonitorFallback fallback;
+        if (!ParseMonitorFallback(env, info.Length() >= 3 ? info[2] : env.Undefined(), fallback))
+        {
+            return env.Null();
+        }
+
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
+        }
+
+        return Napi::Number::New(env, DesktopLayouts().Get(*backend)->MonitorFromPoint(x, y, fallback));
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Get the index in getDesktopLayout().monitors of the monitor sharing the largest area with a rect
+Napi::Value MonitorFromRect(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("monitorFromRect");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        DesktopRect rect;
+        bool valid = info.Length() >= 1 && info[0].IsObject();
+        if (valid)
+        {
+            Napi::Object object = info[0].As<Napi::Object>();
+            valid = ParseDesktopCoordinate(object.Get("x"), rect.x) &&
+                    ParseDesktopCoordinate(object.Get("y"), rect.y) &&
+                    ParseDesktopCoordinate(object.Get("width"), rect.width) &&
+                    ParseDesktopCoordinate(object.Get("height"), rect.height);
+        }
+        if (!valid)
+        {
+            Napi::TypeError::New(env, "Expected a { x, y, width, height } rect").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        MonitorFallback fallback;
+        if (!ParseMonitorFallback(env, info.Length() >= 2 ? info[1] : env.Undefined(), fallback))
+        {
+            return env.Null();
+        }
+
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
+        }
+
+        return Napi::Number::New(env, DesktopLayouts().Get(*backend)->MonitorFromRect(rect, fallback));
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Get the monitors the lookups index into and the bounding box of the virtual desktop
+Napi::Value GetDesktopLayout(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("getDesktopLayout");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
+        }
+
+        std::shared_ptr<const DesktopLayout> layout = DesktopLayouts().Get(*backend);
+        const std::vector<DesktopMonitor> &monitors = layout->Monitors();
+
+        Napi::Array monitorValues = NewArray(env, monitors.size());
+        for (size_t i = 0; i < monitors.size(); i++)
+        {
+            const DesktopRect &rect = monitors[i].rect;
+            napi_value monitor[] = {
+                Napi::Number::New(env, rect.x),
+                Napi::Number::New(env, rect.y),
+                Napi::Number::New(env, rect.width),
+                Napi::Number::New(env, rect.height),
+                Napi::String::New(env, monitors[i].id),
+                Napi::Boolean::New(env, monitors[i].primary)};
+            monitorValues.Set(static_cast<uint32_t>(i), NewShapedObject(env, ObjectShape::DesktopMonitor, monitor));
+        }
+
+        napi_value values[] = {
+            Napi::Number::New(env, static_cast<double>(layout->Generation())),
+            DesktopRectToValue(env, layout->Bounds()),
+            Napi::Number::New(env, layout->Primary()),
+            monitorValues};
+        return NewShapedObject(env, ObjectShape::DesktopLayout, values);
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Get the bounds, work area, DPI and mode of every monitor of the desktop
+// layout in one call, in the order of getDesktopLayout().monitors. Read
+// again only after the layout is rebuilt.
+Napi::Value GetDisplayGeometry(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("getDisplayGeometry");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
+        }
+
+        std::shared_ptr<const DisplayGeometry> display = DisplayGeometries().Get(*backend);
+        const std::vector<MonitorGeometryState> &monitors = display->monitors;
+
+        Napi::Array result = NewArray(env, monitors.size());
+        for (size_t i = 0; i < monitors.size(); i++)
+        {
+            const MonitorGeometryState &monitor = monitors[i];
+            const MonitorGeometry &geometry = monitor.geometry;
+            napi_value values[] = {
+                Napi::String::New(env, monitor.id),
+                Napi::Boolean::New(env, monitor.primary),
+                Napi::Number::New(env, geometry.bounds.x),
+                Napi::Number::New(env, geometry.bounds.y),
+                Napi::Number::New(env, geometry.bounds.width),
+                Napi::Number::New(env, geometry.bounds.height),
+                Napi::Number::New(env, geometry.workArea.x),
+                Napi::Number::New(env, geometry.workArea.y),
+                Napi::Number::New(env, geometry.workArea.width),
+                Napi::Number::New(env, geometry.workArea.height),
+                Napi::Number::New(env, geometry.effectiveDpiX),
+                Napi::Number::New(env, geometry.effectiveDpiY),
+                Napi::Number::New(env, geometry.rawDpiX),
+                Napi::Number::New(env, geometry.rawDpiY),
+                Napi::Number::New(env, geometry.effectiveDpiX / 96.0),
+                Napi::Number::New(env, monitor.mode.orientation),
+                Napi::Number::New(env, monitor.mode.refreshRate),
+                Napi::Number::New(env, monitor.mode.bitsPerPixel)};
+            result.Set(static_cast<uint32_t>(i), NewShapedObject(env, ObjectShape::MonitorGeometry, values));
+        }
+
+        return result;
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Drop cached mode lists so the next query re-enumerates them
+Napi::Value InvalidateModeCache(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("invalidateModeCache");
+    Napi::Env env = info.Env();
+
+    if (info.Length() >= 1 && !info[0].IsUndefined())
+    {
+        if (!info[0].IsString())
+        {
+            Napi::TypeError::New(env, "Monitor ID must be a string").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        // Without a backend nothing can have been cached
+        std::shared_ptr<DisplayBackend> backend = GetDisplayBackend();
+        if (backend)
+        {
+            ModeTables().Invalidate(*backend, info[0].As<Napi::String>().Utf8Value());
+        }
+        return env.Undefined();
+    }
+
+    ModeTables().InvalidateAll();
+    return env.Undefined();
+}
+
+// Set how long a mode change waits for more requests to the same monitor
+Napi::Value SetModeChangeCoalescing(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("setModeChangeCoalescing");
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber() || info[0].As<Napi::Number>().DoubleValue() < 0)
+    {
+        Napi::TypeError::New(env, "Expected a non-negative number of milliseconds").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    ModeChanges().SetCoalesceWindow(std::chrono::milliseconds(info[0].As<Napi::Number>().Uint32Value()));
+    return env.Undefined();
+}
+
+// Get the counters of the mode change scheduler
+Napi::Value GetModeChangeStats(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("getModeChangeStats");
+    Napi::Env env = info.Env();
+
+    ModeChangeStats stats = ModeChanges().Stats();
+
+    napi_value values[] = {
+        Napi::Number::New(env, static_cast<double>(stats.requests)),
+        Napi::Number::New(env, static_cast<double>(stats.applied)),
+        Napi::Number::New(env, static_cast<double>(stats.unchanged)),
+        Napi::Number::New(env, static_cast<double>(stats.coalesced)),
+        Napi::Number::New(env, static_cast<double>(stats.withdrawn)),
+        Napi::Number::New(env, static_cast<double>(stats.unchanged + stats.coalesced))};
+    return NewShapedObject(env, ObjectShape::ModeChangeStats, values);
+}
+
+// Get the hit/miss counters of the mode list cache
+Napi::Value GetModeCacheStats(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("getModeCacheStats");
+    Napi::Env env = info.Env();
+
+    ModeCacheStats stats = ModeTables().Stats();
+
+    Napi::Value fileResult = env.Null();
+    ModeTableFile &file = PersistentModeTables();
+    if (file.Enabled())
+    {
+        ModeTableFileStats fileStats = file.Stats();
+        napi_value fileValues[] = {
+            Napi::String::New(env, fileStats.path),
+            Napi::Number::New(env, static_cast<double>(fileStats.entries)),
+            Napi::Number::New(env, static_cast<double>(fileStats.hits)),
+            Napi::Number::New(env, static_cast<double>(fileStats.misses)),
+            Napi::Number::New(env, static_cast<double>(fileStats.writes)),
+            Napi::Number::New(env, static_cast<double>(fileStats.errors))};
+        fileResult = NewShapedObject(env, ObjectShape::ModeCacheFileStats, fileValues);
+    }
+
+    napi_value values[] = {
+        Napi::Number::New(env, static_cast<double>(stats.hits)),
+        Napi::Number::New(env, static_cast<double>(stats.misses)),
+        Napi::Number::New(env, static_cast<double>(stats.coalesced)),
+        Napi::Number::New(env, static_cast<double>(stats.invalidations)),
+        Napi::Number::New(env, static_cast<double>(stats.entries)),
+        fileResult};
+    return NewShapedObject(env, ObjectShape::ModeCacheStats, values);
+}
+
+// Persist mode lists to a file that later processes read instead of
+// enumerating; null turns it off once pending writes are done
+Napi::Value SetModeCacheFile(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("setModeCacheFile");
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !(info[0].IsString() || info[0].IsNull()))
+    {
+        Napi::TypeError::New(env, "Path must be a string or null").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    try
+    {
+        std::string path = info[0].IsString() ? info[0].As<Napi::String>().Utf8Value() : std::string();
+        bool loaded = PersistentModeTables().Open(path);
+
+        // Tables already in memory may predate the file, so the next lookups go through it
+        ModeTables().InvalidateAll();
+        return Napi::Boolean::New(env, loaded);
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Helper function to read a { width, height, refreshRate, bitsPerPixel } object
+DisplayMode ParseSimulatedMode(Napi::Object object)
+{
+    DisplayMode mode;
+    mode.width = object.Get("width").ToNumber().Uint32Value();
+    mode.height = object.Get("height").ToNumber().Uint32Value();
+    mode.refreshRate = object.Get("refreshRate").ToNumber().Uint32Value();
+    mode.bitsPerPixel = object.Has("bitsPerPixel") ? object.Get("bitsPerPixel").ToNumber().Uint32Value() : 32;
+    return mode;
+}
+
+// Helper function to read a simulated monitor description; index numbers the default id
+SimulatedMonitor ParseSimulatedMonitor(Napi::Object monitorConfig, uint32_t index)
+{
+    SimulatedMonitor monitor;
+
+    monitor.device.id = monitorConfig.Has("id") ? monitorConfig.Get("id").ToString().Utf8Value() : "\\\\.\\DISPLAY" + std::to_string(index + 1);
+    monitor.device.name = monitorConfig.Has("name") ? monitorConfig.Get("name").ToString().Utf8Value() : "Simulated Display";
+    monitor.device.deviceId = "SIMULATED\\DISPLAY" + std::to_string(index + 1);
+    monitor.device.stateFlags = kDeviceActive;
+    bool primary = monitorConfig.Has("primary") ? monitorConfig.Get("primary").ToBoolean().Value() : index == 0;
+    if (primary)
+    {
+        monitor.device.stateFlags |= kDevicePrimary;
+    }
+
+    monitor.current = ParseSimulatedMode(monitorConfig);
+    if (monitorConfig.Has("position"))
+    {
+        Napi::Object position = monitorConfig.Get("position").ToObject();
+        monitor.current.positionX = position.Get("x").ToNumber().Int32Value();
+        monitor.current.positionY = position.Get("y").ToNumber().Int32Value();
+    }
+
+    if (monitorConfig.Has("dpi"))
+    {
+        Napi::Object dpi = monitorConfig.Get("dpi").ToObject();
+        monitor.dpiX = dpi.Get("x").ToNumber().Uint32Value();
+        monitor.dpiY = dpi.Has("y") ? dpi.Get("y").ToNumber().Uint32Value() : monitor.dpiX;
+    }
+
+    if (monitorConfig.Has("rawDpi"))
+    {
+        Napi::Object rawDpi = monitorConfig.Get("rawDpi").ToObject();
+        monitor.rawDpiX = rawDpi.Get("x").ToNumber().Uint32Value();
+        monitor.rawDpiY = rawDpi.Has("y") ? rawDpi.Get("y").ToNumber().Uint32Value() : monitor.rawDpiX;
+    }
+
+    if (monitorConfig.Has("workAreaInsets"))
+    {
+        Napi::Object insets = monitorConfig.Get("workAreaInsets").ToObject();
+        monitor.workAreaInsets.left = insets.Has("left") ? insets.Get("left").ToNumber().Uint32Value() : 0;
+        monitor.workAreaInsets.top = insets.Has("top") ? insets.Get("top").ToNumber().Uint32Value() : 0;
+        monitor.workAreaInsets.right = insets.Has("right") ? insets.Get("right").ToNumber().Uint32Value() : 0;
+        monitor.workAreaInsets.bottom = insets.Has("bottom") ? insets.Get("bottom").ToNumber().Uint32Value() : 0;
+    }
+
+    if (monitorConfig.Has("edid"))
+    {
+        Napi::Value edidValue = monitorConfig.Get("edid");
+        if (!edidValue.IsTypedArray() || edidValue.As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array)
+        {
+            throw std::invalid_argument("monitor.edid must be a Buffer or Uint8Array");
+        }
+
+        Napi::Uint8Array edid = edidValue.As<Napi::Uint8Array>();
+        monitor.edid.assign(edid.Data(), edid.Data() + edid.ByteLength());
+    }
+
+    if (monitorConfig.Has("modes"))
+    {
+        Napi::Array modes = monitorConfig.Get("modes").As<Napi::Array>();
+        for (uint32_t j = 0; j < modes.Length(); j++)
+        {
+            monitor.modes.push_back(ParseSimulatedMode(modes.Get(j).ToObject()));
+        }
+    }
+    else
+    {
+        monitor.modes.push_back(monitor.current);
+    }
+
+    return monitor;
+}
+
+// Replace the system display backend with a simulated one
+Napi::Value UseSimulatedBackend(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("useSimulatedBackend");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        SimulatedBackendOptions options;
+
+        if (info.Length() >= 1 && !info[0].IsUndefined())
+        {
+            if (!info[0].IsObject())
+            {
+                Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+
+            Napi::Object config = info[0].As<Napi::Object>();
+
+            if (config.Has("applyLatencyMs"))
+            {
+                options.applyLatencyMs = config.Get("applyLatencyMs").ToNumber().Uint32Value();
+            }
+
+            if (config.Has("modeListLatencyMs"))
+            {
+                options.modeListLatencyMs = config.Get("modeListLatencyMs").ToNumber().Uint32Value();
+            }
+
+            if (config.Has("signalsPerModeSet"))
+            {
+                options.signalsPerModeSet = config.Get("signalsPerModeSet").ToNumber().Uint32Value();
+            }
+
+            if (config.Has("dpi"))
+            {
+                Napi::Object dpi = config.Get("dpi").ToObject();
+                options.dpiX = dpi.Get("x").ToNumber().Int32Value();
+                options.dpiY = dpi.Get("y").ToNumber().Int32Value();
+            }
+
+            if (config.Has("monitorCount") || config.Has("modeCount"))
+            {
+                uint32_t monitorCount = config.Has("monitorCount") ? config.Get("monitorCount").ToNumber().Uint32Value() : 1;
+                uint32_t modeCount = config.Has("modeCount") ? config.Get("modeCount").ToNumber().Uint32Value() : kMinGeneratedModes;
+                options.monitors = SimulatedDisplayBackend::GenerateMonitors(monitorCount, modeCount);
+            }
+            else if (config.Has("monitors"))
+            {
+                if (!config.Get("monitors").IsArray())
+                {
+                    Napi::TypeError::New(env, "options.monitors must be an array").ThrowAsJavaScriptException();
+                    return env.Null();
+                }
+
+                Napi::Array monitors = config.Get("monitors").As<Napi::Array>();
+                for (uint32_t i = 0; i < monitors.Length(); i++)
+                {
+                    options.monitors.push_back(ParseSimulatedMonitor(monitors.Get(i).ToObject(), i));
+                }
+            }
+        }
+
+        std::shared_ptr<SimulatedDisplayBackend> simulated = std::make_shared<SimulatedDisplayBackend>(std::move(options));
+        std::atomic_store(&simulatedBackend, simulated);
+        SetDisplayBackend(simulated);
+        return env.Undefined();
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Switch back to the display backend of the platform
+Napi::Value UseSystemBackend(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("useSystemBackend");
+    std::atomic_store(&simulatedBackend, std::shared_ptr<SimulatedDisplayBackend>());
+    SetDisplayBackend(nullptr);
+    return info.Env().Undefined();
+}
+
+// Read monitors from the DRM connectors under a sysfs directory, e.g. a fixture tree
+Napi::Value UseDrmBackend(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("useDrmBackend");
+    Napi::Env env = info.Env();
+
+#ifdef _WIN32
+    Napi::Error::New(env, "The DRM backend is only available on Linux").ThrowAsJavaScriptException();
+    return env.Null();
+#else
+    std::string sysfsRoot = kDefaultSysfsRoot;
+
+    if (info.Length() >= 1 && !info[0].IsUndefined())
+    {
+        if (!info[0].IsObject())
+        {
+            Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::Object config = info[0].As<Napi::Object>();
+        if (config.Has("sysfsRoot"))
+        {
+            sysfsRoot = config.Get("sysfsRoot").ToString().Utf8Value();
+        }
+    }
+
+    std::atomic_store(&simulatedBackend, std::shared_ptr<SimulatedDisplayBackend>());
+    SetDisplayBackend(CreateDrmDisplayBackend(sysfsRoot));
+    return env.Undefined();
+#endif
+}
+
+// Inject display changes into the active simulated backend
+Napi::Value SimulateDisplayChange(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("simulateDisplayChange");
+    Napi::Env env = info.Env();
+
+    try
+    {
+        std::shared_ptr<SimulatedDisplayBackend> simulated = ActiveSimulatedBackend();
+        if (!simulated)
+        {
+            Napi::Error::New(env, "The simulated backend is not active").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        // One display message unless the options say otherwise, with or without them
+        uint32_t signals = 1;
+        if (info.Length() >= 1 && !info[0].IsUndefined())
+        {
+            if (!info[0].IsObject())
+            {
+                Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+
+            Napi::Object options = info[0].As<Napi::Object>();
+            if (options.Has("signals"))
+            {
+                signals = options.Get("signals").ToNumber().Uint32Value();
+            }
+
+            if (options.Has("disconnect") && !simulated->Disconnect(options.Get("disconnect").ToString().Utf8Value()))
+            {
+                Napi::Error::New(env, "No simulated monitor with that ID").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+
+            if (options.Has("connect"))
+            {
+                DisplayDevice device;
+                uint32_t count = 0;
+                while (simulated->EnumDevice(count, device))
+                {
+                    count++;
+                }
+                simulated->Connect(ParseSimulatedMonitor(options.Get("connect").ToObject(), count));
+            }
+        }
+
+        simulated->RaiseSignals(DisplaySignal::ModeChanged, signals);
+        return env.Undefined();
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Get the counters of the active simulated backend
+Napi::Value GetSimulatedBackendStats(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("getSimulatedBackendStats");
+    Napi::Env env = info.Env();
+
+    std::shared_ptr<SimulatedDisplayBackend> simulated = ActiveSimulatedBackend();
+    if (!simulated)
+    {
+        Napi::Error::New(env, "The simulated backend is not active").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    SimulatedBackendStats stats = simulated->Stats();
+
+    napi_value values[] = {
+        Napi::Number::New(env, static_cast<double>(stats.modeSets)),
+        Napi::Number::New(env, static_cast<double>(stats.stagedModes)),
+        Napi::Number::New(env, static_cast<double>(stats.commits))};
+    return NewShapedObject(env, ObjectShape::SimulatedBackendStats, values);
+}
+
+// Record every call to the active backend into a trace file
+Napi::Value StartBackendRecording(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("startBackendRecording");
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::TypeError::New(env, "Path must be a string").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    try
+    {
+        std::shared_ptr<RecordingDisplayBackend> recorder = std::atomic_load(&backendRecorder);
+        if (recorder && GetDisplayBackend() == recorder)
+        {
+            Napi::Error::New(env, "A backend recording is already in progress").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::shared_ptr<DisplayBackend> backend = RequireBackend(env);
+        if (!backend)
+        {
+            return env.Null();
+        }
+
+        // Replacing the backend drops cached mode lists, so the trace holds their enumeration
+        recorder = std::make_shared<RecordingDisplayBackend>(backend, info[0].As<Napi::String>().Utf8Value());
+        std::atomic_store(&backendRecorder, recorder);
+        SetDisplayBackend(recorder);
+        return env.Undefined();
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Finish the trace file and go back to the backend that was recorded
+Napi::Value StopBackendRecording(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("stopBackendRecording");
+    Napi::Env env = info.Env();
+
+    std::shared_ptr<RecordingDisplayBackend> recorder = std::atomic_exchange(&backendRecorder, std::shared_ptr<RecordingDisplayBackend>());
+    if (!recorder)
+    {
+        Napi::Error::New(env, "No backend recording is in progress").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    recorder->Close();
+    // Unless another backend was selected in the meantime
+    if (GetDisplayBackend() == recorder)
+    {
+        SetDisplayBackend(recorder->Inner());
+    }
+
+    TraceRecorderStats stats = recorder->Stats();
+
+    napi_value values[] = {
+        Napi::String::New(env, stats.path),
+        Napi::Number::New(env, static_cast<double>(stats.calls)),
+        Napi::Number::New(env, static_cast<double>(stats.bytes)),
+        Napi::Number::New(env, static_cast<double>(stats.errors))};
+    return NewShapedObject(env, ObjectShape::RecordingStats, values);
+}
+
+// Replace the system display backend with one answering from a trace file
+Napi::Value UseReplayBackend(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("useReplayBackend");
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::TypeError::New(env, "Path must be a string").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    try
+    {
+        ReplayBackendOptions options;
+        if (info.Length() >= 2 && !info[1].IsUndefined())
+        {
+            if (!info[1].IsObject())
+            {
+                Napi::TypeError::New(env, "Options must be an object").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+
+            Napi::Object config = info[1].As<Napi::Object>();
+            if (config.Has("latency"))
+            {
+                options.latency = config.Get("latency").ToBoolean().Value();
+            }
+        }
+
+        DisplayTrace trace;
+        std::string error;
+        if (!ReadDisplayTrace(info[0].As<Napi::String>().Utf8Value(), trace, error))
+        {
+            Napi::Error::New(env, "Invalid trace: " + error).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::shared_ptr<ReplayDisplayBackend> replay = std::make_shared<ReplayDisplayBackend>(trace, options);
+        std::atomic_store(&replayBackend, replay);
+        std::atomic_store(&simulatedBackend, std::shared_ptr<SimulatedDisplayBackend>());
+        SetDisplayBackend(replay);
+        return env.Undefined();
+    }
+    catch (const std::exception &e)
+    {
+        Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+}
+
+// Get the counters of the active replay backend
+Napi::Value GetReplayBackendStats(const Napi::CallbackInfo &info)
+{
+    MONITORRES_TIME_EXPORT("getReplayBackendStats");
+    Napi::Env env = info.Env();
+
+    std::shared_ptr<ReplayDisplayBackend> replay = std::atomic_load(&replayBackend);
+    if (!replay || GetDisplayBackend() != replay)
+    {
+        Napi::Error::New(env, "The replay backend is not active").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    ReplayBackendStats stats = replay->Stats();
+
+    napi_value values[] = {
+        Napi::Number::New(env, static_cast<double>(stats.records)),
+        Napi::Number::New(env, static_cast<double>(stats.calls)),
+        Napi::Number::New(env, static_cast<double>(stats.unanswered))};
+    return NewShapedObject(env, ObjectShape::ReplayBackendStats, values);
+}
+
+// Get the addon's native allocation counters; null unless built with --monitorres_bench=1
+Napi::Value GetNativeAllocationStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+#ifdef MONITORRES_ALLOCATION_COUNTERS
+    AllocationCounters counters = GetAllocationCounters();
+
+    napi_value values[] = {
+        Napi::Number::New(env, static_cast<double>(counters.allocations)),
+        Napi::Number::New(env, static_cast<double>(counters.bytes))};
+    return NewShapedObject(env, ObjectShape::AllocationStats, values);
+#else
+    return env.Null();
+#endif
+}
+
+#ifdef MONITORRES_STATS
+// Helper function to convert the histograms of a scope into { name: { count, ... } }
+Napi::Object HistogramsToValue(Napi::Env env, StatsScope scope)
+{
+    Napi::Object result = Napi::Object::New(env);
+    for (const LatencyHistogram *histogram : AddonStats().Histograms(scope))
+    {
+        LatencySnapshot snapshot = histogram->Read();
+        if (snapshot.count == 0)
+        {
+            continue;
+        }
+
+        // Non-empty buckets as [upper bound in ns, count]; the top bucket's bound is the maximum
+        Napi::Array buckets = Napi::Array::New(env);
+        uint32_t bucketIndex = 0;
+        for (size_t i = 0; i < kLatencyBuckets; i++)
+        {
+            if (snapshot.buckets[i] == 0)
+            {
+                continue;
+            }
+
+            Napi::Array bucket = Napi::Array::New(env, 2);
+            double bound = i + 1 < kLatencyBuckets ? static_cast<double>(uint64_t(1) << (i + 1)) : static_cast<double>(snapshot.maxNs);
+            bucket.Set(0u, Napi::Number::New(env, bound));
+            bucket.Set(1u, Napi::Number::New(env, static_cast<double>(snapshot.buckets[i])));
+            buckets.Set(bucketIndex++, bucket);
+        }
+
+        Napi::Object entry = Napi::Object::New(env);
+        entry.Set("count", Napi::Number::New(env, static_cast<double>(snapshot.count)));
+        entry.Set("totalNs", Napi::Number::New(env, static_cast<double>(snapshot.totalNs)));
+        entry.Set("meanNs", Napi::Number::New(env, static_cast<double>(snapshot.totalNs) / snapshot.count));
+        entry.Set("maxNs", Napi::Number::New(env, static_cast<double>(snapshot.maxNs)));
+        entry.Set("p50Ns", Napi::Number::New(env, static_cast<double>(snapshot.Quantile(0.5))));
+        entry.Set("p90Ns", Napi::Number::New(env, static_cast<double>(snapshot.Quantile(0.9))));
+        entry.Set("p99Ns", Napi::Number::New(env, static_cast<double>(snapshot.Quantile(0.99))));
+        entry.Set("buckets", buckets);
+        result.Set(histogram->Name(), entry);
+    }
+    return result;
+}
+#endif
+
+// Get the addon's latency histograms and call counters; null in builds without them.
+// Objects built here are not counted, so reading the stats does not change them.
+Napi::Value GetStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+#ifdef MONITORRES_STATS
+    StatsRegistry &stats = AddonStats();
+
+    Napi::Object osCalls = Napi::Object::New(env);
+    for (size_t i = 0; i < static_cast<size_t>(OsCall::Count); i++)
+    {
+        OsCall call = static_cast<OsCall>(i);
+        osCalls.Set(OsCallName(call), Napi::Number::New(env, static_cast<double>(stats.OsCalls(call))));
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("exports", HistogramsToValue(env, StatsScope::Export));
+    result.Set("phases", HistogramsToValue(env, StatsScope::Phase));
+    result.Set("osCalls", osCalls);
+    result.Set("jsObjects", Napi::Number::New(env, static_cast<double>(stats.JsObjects())));
+    result.Set("tracing", Napi::Boolean::New(env, stats.Tracing()));
+    return result;
+#else
+    return env.Null();
+#endif
+}
+
+// Zero the histograms and counters
+Napi::Value ResetStats(const Napi::CallbackInfo &info)
+{
+#ifdef MONITORRES_STATS
+    AddonStats().Reset();
+#endif
+    return info.Env().Undefined();
+}
+
+// Start recording every timed span; returns false in builds without stats
+Napi::Value StartTrace(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+#ifdef MONITORRES_STATS
+    size_t maxEvents = kDefaultMaxTraceEvents;
+    if (info.Length() >= 1 && !info[0].IsUndefined())
+    {
+        Napi::Value value = info[0].IsObject() ? info[0].As<Napi::Object>().Get("maxEvents") : env.Null();
+        if (!value.IsUndefined())
+        {
+            if (!value.IsNumber() || value.As<Napi::Number>().DoubleValue() < 1)
+            {
+                Napi::TypeError::New(env, "options.maxEvents must be a positive number").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            maxEvents = static_cast<size_t>(value.As<Napi::Number>().DoubleValue());
+        }
+    }
+
+    AddonStats().StartTrace(maxEvents);
+    return Napi::Boolean::New(env, true);
+#else
+    return Napi::Boolean::New(env, false);
+#endif
+}
+
+// Stop recording spans and get them as Chrome trace event JSON; null if not tracing
+Napi::Value StopTrace(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+#ifdef MONITORRES_STATS
+    if (!AddonStats().Tracing())
+    {
+        return env.Null();
+    }
+    return Napi::String::New(env, AddonStats().StopTrace());
+#else
+    return env.Null();
+#endif
+}
+
+// Initialize the module in an environment
+MonitorresAddon::MonitorresAddon(Napi::Env env, Napi::Object exports)
 {
     exports.Set(
         Napi::String::New(env, "getScreenResolution"),
@@ -653,23 +1796,150 @@ Napi::Object Init(Napi::Env env, Napi::Object exports)
     exports.Set(
         Napi::String::New(env, "setAllScreenResolutions"),
         Napi::Function::New(env, SetAllScreenResolutions));
+    exports.Set(
+        Napi::String::New(env, "setAllScreenResolutionsAsync"),
+        Napi::Function::New(env, SetAllScreenResolutionsAsync));
     exports.Set(
         Napi::String::New(env, "getAllMonitors"),
         Napi::Function::New(env, GetAllMonitors));
+    exports.Set(
+        Napi::String::New(env, "getAllMonitorsBinary"),
+        Napi::Function::New(env, GetAllMonitorsBinary));
+    exports.Set(
+        Napi::String::New(env, "compileMonitorFields"),
+        Napi::Function::New(env, CompileMonitorFields));
+    exports.Set(
+        Napi::String::New(env, "getMonitorsSince"),
+        Napi::Function::New(env, GetMonitorsSince));
+    exports.Set(
+        Napi::String::New(env, "getFullInventory"),
+        Napi::Function::New(env, GetFullInventory));
     exports.Set(
         Napi::String::New(env, "setMonitorResolution"),
         Napi::Function::New(env, SetMonitorResolution));
+    exports.Set(
+        Napi::String::New(env, "setMonitorResolutionAsync"),
+        Napi::Function::New(env, SetMonitorResolutionAsync));
     exports.Set(
         Napi::String::New(env, "getMonitorResolution"),
         Napi::Function::New(env, GetMonitorResolution));
+    exports.Set(
+        Napi::String::New(env, "findBestMode"),
+        Napi::Function::New(env, FindBestMode));
     exports.Set(
         Napi::String::New(env, "getAvailableResolutions"),
         Napi::Function::New(env, GetAvailableResolutions));
+    exports.Set(
+        Napi::String::New(env, "getAvailableResolutionsPacked"),
+        Napi::Function::New(env, GetAvailableResolutionsPacked));
+    exports.Set(
+        Napi::String::New(env, "captureTopology"),
+        Napi::Function::New(env, CaptureDisplayTopology));
+    exports.Set(
+        Napi::String::New(env, "restoreTopology"),
+        Napi::Function::New(env, RestoreDisplayTopology));
     exports.Set(
         Napi::String::New(env, "getSystemDPI"),
         Napi::Function::New(env, GetSystemDPI));
+    exports.Set(
+        Napi::String::New(env, "startDisplayWatcher"),
+        Napi::Function::New(env, StartDisplayWatcher));
+    exports.Set(
+        Napi::String::New(env, "stopDisplayWatcher"),
+        Napi::Function::New(env, StopDisplayWatcher));
+    exports.Set(
+        Napi::String::New(env, "setDisplayChangeCoalescing"),
+        Napi::Function::New(env, SetDisplayChangeCoalescing));
+    exports.Set(
+        Napi::String::New(env, "setDesiredState"),
+        Napi::Function::New(env, SetDesiredState));
+    exports.Set(
+        Napi::String::New(env, "clearDesiredState"),
+        Napi::Function::New(env, ClearDesiredState));
+    exports.Set(
+        Napi::String::New(env, "setReconcilerOptions"),
+        Napi::Function::New(env, SetReconcilerOptions));
+    exports.Set(
+        Napi::String::New(env, "getReconcilerStats"),
+        Napi::Function::New(env, GetReconcilerStats));
+    exports.Set(
+        Napi::String::New(env, "monitorFromPoint"),
+        Napi::Function::New(env, MonitorFromPoint));
+    exports.Set(
+        Napi::String::New(env, "monitorFromRect"),
+        Napi::Function::New(env, MonitorFromRect));
+    exports.Set(
+        Napi::String::New(env, "getDesktopLayout"),
+        Napi::Function::New(env, GetDesktopLayout));
+    exports.Set(
+        Napi::String::New(env, "getDisplayGeometry"),
+        Napi::Function::New(env, GetDisplayGeometry));
+    exports.Set(
+        Napi::String::New(env, "invalidateModeCache"),
+        Napi::Function::New(env, InvalidateModeCache));
+    exports.Set(
+        Napi::String::New(env, "setModeChangeCoalescing"),
+        Napi::Function::New(env, SetModeChangeCoalescing));
+    exports.Set(
+        Napi::String::New(env, "getModeChangeStats"),
+        Napi::Function::New(env, GetModeChangeStats));
+    exports.Set(
+        Napi::String::New(env, "getModeCacheStats"),
+        Napi::Function::New(env, GetModeCacheStats));
+    exports.Set(
+        Napi::String::New(env, "setModeCacheFile"),
+        Napi::Function::New(env, SetModeCacheFile));
+    exports.Set(
+        Napi::String::New(env, "DisplayTransaction"),
+        DisplayTransactionWrap::DefineClass(env));
+    exports.Set(
+        Napi::String::New(env, "ModeCursor"),
+        ModeCursorWrap::DefineClass(env));
+    exports.Set(
+        Napi::String::New(env, "useSimulatedBackend"),
+        Napi::Function::New(env, UseSimulatedBackend));
+    exports.Set(
+        Napi::String::New(env, "useSystemBackend"),
+        Napi::Function::New(env, UseSystemBackend));
+    exports.Set(
+        Napi::String::New(env, "useDrmBackend"),
+        Napi::Function::New(env, UseDrmBackend));
+    exports.Set(
+        Napi::String::New(env, "simulateDisplayChange"),
+        Napi::Function::New(env, SimulateDisplayChange));
+    exports.Set(
+        Napi::String::New(env, "getSimulatedBackendStats"),
+        Napi::Function::New(env, GetSimulatedBackendStats));
+    exports.Set(
+        Napi::String::New(env, "startBackendRecording"),
+        Napi::Function::New(env, StartBackendRecording));
+    exports.Set(
+        Napi::String::New(env, "stopBackendRecording"),
+        Napi::Function::New(env, StopBackendRecording));
+    exports.Set(
+        Napi::String::New(env, "useReplayBackend"),
+        Napi::Function::New(env, UseReplayBackend));
+    exports.Set(
+        Napi::String::New(env, "getReplayBackendStats"),
+        Napi::Function::New(env, GetReplayBackendStats));
+    exports.Set(
+        Napi::String::New(env, "getNativeAllocationStats"),
+        Napi::Function::New(env, GetNativeAllocationStats));
+    exports.Set(
+        Napi::String::New(env, "getStats"),
+        Napi::Function::New(env, GetStats));
+    exports.Set(
+        Napi::String::New(env, "resetStats"),
+        Napi::Function::New(env, ResetStats));
+    exports.Set(
+        Napi::String::New(env, "startTrace"),
+        Napi::Function::New(env, StartTrace));
+    exports.Set(
+        Napi::String::New(env, "stopTrace"),
+        Napi::Function::New(env, StopTrace));
 
-    return exports;
+    // The exports are plain functions; this makes exports the module value
+    DefineAddon(exports, {});
 }
 
-NODE_API_MODULE(monitorres, Init)
\ No newline at end of file
+NODE_API_ADDON(MonitorresAddon)
@@ -0,0 +1,42 @@
+#ifndef MONITORRES_MONITORRES_ADDON_H_
+#define MONITORRES_MONITORRES_ADDON_H_
+
+#include <napi.h>
+
+#include "display_reconciler_wrap.h"
+#include "display_watcher_wrap.h"
+#include "object_shapes.h"
+
+namespace monitorres
+{
+    // The addon as loaded into one environment. The main thread and every
+    // worker_threads Worker that requires the module get their own instance,
+    // holding what is tied to that environment's JS heap: compiled object
+    // constructors, and the display watcher and reconciler with their
+    // callbacks.
+    //
+    // Everything native behind the exports (the active backend, mode tables,
+    // EDIDs, monitor snapshots, stats) is process-wide and safe to use from
+    // all environments at once, so workers share enumeration work instead of
+    // repeating it.
+    class MonitorresAddon : public Napi::Addon<MonitorresAddon>
+    {
+    public:
+        MonitorresAddon(Napi::Env env, Napi::Object exports);
+
+        // The instance of the environment an export was called in
+        static MonitorresAddon &Of(Napi::Env env) { return *env.GetInstanceData<MonitorresAddon>(); }
+
+        ShapeConstructors &Shapes() { return shapes_; }
+        DisplayWatcherState &Watcher() { return watcher_; }
+        ReconcilerState &Reconciler() { return reconciler_; }
+
+    private:
+        ShapeConstructors shapes_;
+        // Declared last so they stop before the constructors they call into go away
+        DisplayWatcherState watcher_;
+        ReconcilerState reconciler_;
+    };
+}
+
+#endif
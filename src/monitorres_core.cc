@@ -0,0 +1,21 @@
+#include "monitorres_core.h"
+
+#include <vector>
+
+#include "stats.h"
+
+namespace monitorres
+{
+    std::shared_ptr<const EdidInfo> GetMonitorEdid(DisplayBackend &backend, const std::string &id)
+    {
+        MONITORRES_TIME_PHASE("readEdid");
+
+        // Parsed once per distinct EDID, then served from the cache
+        std::vector<uint8_t> edid;
+        if (!backend.GetEdid(id, edid))
+        {
+            return nullptr;
+        }
+        return Edids().Get(edid);
+    }
+}
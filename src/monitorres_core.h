@@ -0,0 +1,43 @@
+#ifndef MONITORRES_MONITORRES_CORE_H_
+#define MONITORRES_MONITORRES_CORE_H_
+
+// Everything the addon does, without N-API. Native callers link the
+// monitorres_core library and include this header; the addon's exports only
+// convert arguments and results around the same calls.
+//
+//   std::shared_ptr<DisplayBackend> backend = CreateSystemDisplayBackend();
+//   MonitorSnapshot monitors = TakeMonitorSnapshot(*backend);
+//   ModeChangeResult result = ChangeDisplayMode(*backend, request);
+
+#include "desktop_layout.h"
+#include "display_backend.h"
+#include "display_events.h"
+#include "display_geometry.h"
+#include "display_reconciler.h"
+#include "display_transaction.h"
+#include "edid.h"
+#include "inventory.h"
+#include "mode_change.h"
+#include "mode_change_scheduler.h"
+#include "mode_cursor.h"
+#include "mode_query.h"
+#include "mode_table.h"
+#include "mode_table_file.h"
+#include "monitor_binary.h"
+#include "monitor_snapshot.h"
+#include "simulated_backend.h"
+#include "topology.h"
+#include "trace_backend.h"
+#include "worker_pool.h"
+
+#include <memory>
+#include <string>
+
+namespace monitorres
+{
+    // Get the parsed EDID of the monitor on a device through the EDID cache;
+    // nullptr if the backend has none or it does not parse
+    std::shared_ptr<const EdidInfo> GetMonitorEdid(DisplayBackend &backend, const std::string &id);
+}
+
+#endif
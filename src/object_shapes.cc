@@ -0,0 +1,191 @@
+#include "object_shapes.h"
+
+#include <cstring>
+#include <string>
+
+#include "monitorres_addon.h"
+#include "stats.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        const char *const kModeFields[] = {"width", "height", "refreshRate", "bitsPerPixel"};
+        const char *const kMonitorFields[] = {"id", "name", "deviceId", "deviceKey", "stateFlags", "attachedToDesktop", "primaryDevice", "currentSettings", "edid"};
+        const char *const kMonitorSettingsFields[] = {"width", "height", "refreshRate", "bitsPerPixel", "orientation", "position"};
+        const char *const kPositionFields[] = {"x", "y"};
+        const char *const kEdidFields[] = {"manufacturer", "productCode", "serialNumber", "serial", "name", "manufactureWeek", "manufactureYear", "version", "widthMm", "heightMm", "preferredTiming", "timings"};
+        const char *const kEdidTimingFields[] = {"width", "height", "refreshRate", "pixelClockKHz", "interlaced"};
+        const char *const kModeChangeSuccessFields[] = {"success", "message", "actualRefreshRate"};
+        const char *const kModeChangeErrorFields[] = {"code", "message"};
+        const char *const kBestModeFields[] = {"mode", "alternatives"};
+        const char *const kMonitorChangesFields[] = {"generation", "full", "added", "removed", "changed"};
+        const char *const kDisplayChangeEventFields[] = {"ids", "added", "removed", "changed", "signals"};
+        const char *const kTopologyRestoreFields[] = {"changed", "missing"};
+        const char *const kInventoryFields[] = {"monitors", "modes"};
+        const char *const kMonitorGeometryFields[] = {"id", "primary", "x", "y", "width", "height", "workX", "workY", "workWidth", "workHeight", "dpiX", "dpiY", "rawDpiX", "rawDpiY", "scaleFactor", "orientation", "refreshRate", "bitsPerPixel"};
+        const char *const kReconcileEventFields[] = {"type", "id", "from", "to", "code", "message", "failures", "retryAfter"};
+        const char *const kPackedModesFields[] = {"count", "width", "height", "refreshRate", "bitsPerPixel"};
+        const char *const kDesktopRectFields[] = {"x", "y", "width", "height"};
+        const char *const kDesktopMonitorFields[] = {"x", "y", "width", "height", "id", "primary"};
+        const char *const kDesktopLayoutFields[] = {"generation", "bounds", "primary", "monitors"};
+        const char *const kModeChangeStatsFields[] = {"requests", "applied", "unchanged", "coalesced", "withdrawn", "elided"};
+        const char *const kModeCacheStatsFields[] = {"hits", "misses", "coalesced", "invalidations", "entries", "file"};
+        const char *const kModeCacheFileStatsFields[] = {"path", "entries", "hits", "misses", "writes", "errors"};
+        const char *const kSimulatedBackendStatsFields[] = {"modeSets", "stagedModes", "commits"};
+        const char *const kRecordingStatsFields[] = {"path", "calls", "bytes", "errors"};
+        const char *const kReplayBackendStatsFields[] = {"records", "calls", "unanswered"};
+        const char *const kAllocationStatsFields[] = {"allocations", "bytes"};
+
+        struct ShapeFields
+        {
+            const char *const *names;
+            uint32_t count;
+        };
+
+#define MONITORRES_SHAPE_FIELDS(fields) {fields, static_cast<uint32_t>(sizeof(fields) / sizeof(fields[0]))}
+
+        // In ObjectShape order
+        const ShapeFields kShapes[] = {
+            MONITORRES_SHAPE_FIELDS(kModeFields),
+            MONITORRES_SHAPE_FIELDS(kMonitorFields),
+            MONITORRES_SHAPE_FIELDS(kMonitorSettingsFields),
+            MONITORRES_SHAPE_FIELDS(kPositionFields),
+            MONITORRES_SHAPE_FIELDS(kEdidFields),
+            MONITORRES_SHAPE_FIELDS(kEdidTimingFields),
+            MONITORRES_SHAPE_FIELDS(kModeChangeSuccessFields),
+            MONITORRES_SHAPE_FIELDS(kModeChangeErrorFields),
+            MONITORRES_SHAPE_FIELDS(kBestModeFields),
+            MONITORRES_SHAPE_FIELDS(kMonitorChangesFields),
+            MONITORRES_SHAPE_FIELDS(kDisplayChangeEventFields),
+            MONITORRES_SHAPE_FIELDS(kTopologyRestoreFields),
+            MONITORRES_SHAPE_FIELDS(kInventoryFields),
+            MONITORRES_SHAPE_FIELDS(kMonitorGeometryFields),
+            MONITORRES_SHAPE_FIELDS(kReconcileEventFields),
+            MONITORRES_SHAPE_FIELDS(kPackedModesFields),
+            MONITORRES_SHAPE_FIELDS(kDesktopRectFields),
+            MONITORRES_SHAPE_FIELDS(kDesktopMonitorFields),
+            MONITORRES_SHAPE_FIELDS(kDesktopLayoutFields),
+            MONITORRES_SHAPE_FIELDS(kModeChangeStatsFields),
+            MONITORRES_SHAPE_FIELDS(kModeCacheStatsFields),
+            MONITORRES_SHAPE_FIELDS(kModeCacheFileStatsFields),
+            MONITORRES_SHAPE_FIELDS(kSimulatedBackendStatsFields),
+            MONITORRES_SHAPE_FIELDS(kRecordingStatsFields),
+            MONITORRES_SHAPE_FIELDS(kReplayBackendStatsFields),
+            MONITORRES_SHAPE_FIELDS(kAllocationStatsFields)};
+
+#undef MONITORRES_SHAPE_FIELDS
+
+        static_assert(sizeof(kShapes) / sizeof(kShapes[0]) == static_cast<size_t>(ObjectShape::Count), "kShapes must list every ObjectShape");
+
+        // Constructors of partial shapes kept per environment before the
+        // cache starts over; each distinct field projection needs one
+        const size_t kMaxPartialShapes = 256;
+
+        uint32_t FullMask(const ShapeFields &shape)
+        {
+            return shape.count >= 32 ? UINT32_MAX : (1u << shape.count) - 1;
+        }
+
+        // Source of a constructor taking the selected fields in order, e.g.
+        // (function (v0, v1) { return { width: v0, height: v1 }; })
+        std::string ConstructorSource(const ShapeFields &shape, uint32_t fields)
+        {
+            std::string parameters;
+            std::string properties;
+            uint32_t argument = 0;
+            for (uint32_t i = 0; i < shape.count; i++)
+            {
+                if (!(fields & (1u << i)))
+                {
+                    continue;
+                }
+
+                std::string name = "v" + std::to_string(argument++);
+                parameters += (parameters.empty() ? "" : ", ") + name;
+                properties += (properties.empty() ? " " : ", ") + std::string(shape.names[i]) + ": " + name;
+            }
+            return "(function (" + parameters + ") { return {" + properties + (properties.empty() ? "}; })" : " }; })");
+        }
+
+        Napi::FunctionReference CompileConstructor(Napi::Env env, const ShapeFields &shape, uint32_t fields)
+        {
+            Napi::Value constructor = env.RunScript(ConstructorSource(shape, fields));
+            if (constructor.IsEmpty() || !constructor.IsFunction())
+            {
+                return Napi::FunctionReference();
+            }
+            return Napi::Persistent(constructor.As<Napi::Function>());
+        }
+
+        uint32_t CountFields(uint32_t fields)
+        {
+            uint32_t count = 0;
+            for (; fields != 0; fields &= fields - 1)
+            {
+                count++;
+            }
+            return count;
+        }
+    }
+
+    Napi::Function ShapeConstructors::Get(Napi::Env env, ObjectShape shape, uint32_t fields)
+    {
+        const ShapeFields &shapeFields = kShapes[static_cast<size_t>(shape)];
+        if (fields == FullMask(shapeFields))
+        {
+            Napi::FunctionReference &constructor = full_[static_cast<size_t>(shape)];
+            if (constructor.IsEmpty())
+            {
+                constructor = CompileConstructor(env, shapeFields, fields);
+            }
+            return constructor.Value();
+        }
+
+        uint64_t key = (static_cast<uint64_t>(shape) << 32) | fields;
+        auto it = partial_.find(key);
+        if (it != partial_.end())
+        {
+            return it->second.Value();
+        }
+
+        if (partial_.size() >= kMaxPartialShapes)
+        {
+            partial_.clear();
+        }
+        return partial_.emplace(key, CompileConstructor(env, shapeFields, fields)).first->second.Value();
+    }
+
+    Napi::Object NewShapedObject(Napi::Env env, ObjectShape shape, const napi_value *values, uint32_t fields)
+    {
+        MONITORRES_COUNT_JS_OBJECTS(1);
+
+        fields &= FullMask(kShapes[static_cast<size_t>(shape)]);
+        Napi::Function constructor = MonitorresAddon::Of(env).Shapes().Get(env, shape, fields);
+        if (constructor.IsEmpty())
+        {
+            return Napi::Object();
+        }
+
+        Napi::Value object = constructor.Call(env.Undefined(), CountFields(fields), values);
+        return object.IsEmpty() ? Napi::Object() : object.As<Napi::Object>();
+    }
+
+    uint32_t ShapeFieldCount(ObjectShape shape)
+    {
+        return kShapes[static_cast<size_t>(shape)].count;
+    }
+
+    int ShapeFieldIndex(ObjectShape shape, const char *name)
+    {
+        const ShapeFields &shapeFields = kShapes[static_cast<size_t>(shape)];
+        for (uint32_t i = 0; i < shapeFields.count; i++)
+        {
+            if (strcmp(shapeFields.names[i], name) == 0)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+}
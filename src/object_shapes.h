@@ -0,0 +1,77 @@
+#ifndef MONITORRES_OBJECT_SHAPES_H_
+#define MONITORRES_OBJECT_SHAPES_H_
+
+#include <napi.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace monitorres
+{
+    // Kinds of object the exports return; object_shapes.cc lists the fields
+    // of each in the order their values are passed
+    enum class ObjectShape : uint32_t
+    {
+        Mode,
+        Monitor,
+        MonitorSettings,
+        Position,
+        Edid,
+        EdidTiming,
+        ModeChangeSuccess,
+        ModeChangeError,
+        BestMode,
+        MonitorChanges,
+        DisplayChangeEvent,
+        TopologyRestore,
+        Inventory,
+        MonitorGeometry,
+        ReconcileEvent,
+        PackedModes,
+        DesktopRect,
+        DesktopMonitor,
+        DesktopLayout,
+        ModeChangeStats,
+        ModeCacheStats,
+        ModeCacheFileStats,
+        SimulatedBackendStats,
+        RecordingStats,
+        ReplayBackendStats,
+        AllocationStats,
+        Count
+    };
+
+    // Field mask selecting every field of a shape
+    const uint32_t kAllFields = UINT32_MAX;
+
+    // Build an object of a shape holding the fields selected by a mask, with
+    // one value per selected field in declaration order. Objects are made by
+    // a constructor compiled once per environment for each shape and mask,
+    // so every object of a kind shares one hidden class and no property key
+    // strings are created per object.
+    Napi::Object NewShapedObject(Napi::Env env, ObjectShape shape, const napi_value *values, uint32_t fields = kAllFields);
+
+    // The constructors of one environment, compiled on first use. Owned by
+    // the environment's MonitorresAddon, since compiled functions cannot be
+    // shared between the main thread and workers.
+    class ShapeConstructors
+    {
+    public:
+        // Get the constructor of a shape and mask; empty if it failed to
+        // compile. fields must not select past the shape's last field.
+        Napi::Function Get(Napi::Env env, ObjectShape shape, uint32_t fields);
+
+    private:
+        Napi::FunctionReference full_[static_cast<size_t>(ObjectShape::Count)];
+        // Keyed by shape and mask
+        std::unordered_map<uint64_t, Napi::FunctionReference> partial_;
+    };
+
+    // Number of fields a shape declares
+    uint32_t ShapeFieldCount(ObjectShape shape);
+
+    // Index of a field of a shape by name; -1 if the shape has no such field
+    int ShapeFieldIndex(ObjectShape shape, const char *name);
+}
+
+#endif
@@ -0,0 +1,516 @@
+#include "simulated_backend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "edid.h"
+#include "stats.h"
+
+namespace monitorres
+{
+    SimulatedDisplayBackend::SimulatedDisplayBackend(SimulatedBackendOptions options)
+        : options_(std::move(options))
+    {
+        if (options_.monitors.empty())
+        {
+            options_.monitors = DefaultMonitors();
+        }
+    }
+
+    std::vector<SimulatedMonitor> SimulatedDisplayBackend::DefaultMonitors()
+    {
+        SimulatedMonitor monitor;
+        monitor.device.id = "\\\\.\\DISPLAY1";
+        monitor.device.name = "Simulated Display";
+        monitor.device.deviceId = "SIMULATED\\DISPLAY1";
+        monitor.device.deviceKey = "";
+        monitor.device.stateFlags = kDeviceActive | kDevicePrimary;
+
+        const uint32_t sizes[][2] = {{1280, 720}, {1600, 900}, {1920, 1080}};
+        const uint32_t refreshRates[] = {60, 75, 144};
+        for (const auto &size : sizes)
+        {
+            for (uint32_t refreshRate : refreshRates)
+            {
+                DisplayMode mode;
+                mode.width = size[0];
+                mode.height = size[1];
+                mode.refreshRate = refreshRate;
+                mode.bitsPerPixel = 32;
+                monitor.modes.push_back(mode);
+            }
+        }
+
+        monitor.current.width = 1920;
+        monitor.current.height = 1080;
+        monitor.current.refreshRate = 60;
+        monitor.current.bitsPerPixel = 32;
+
+        return {monitor};
+    }
+
+    std::vector<SimulatedMonitor> SimulatedDisplayBackend::GenerateMonitors(uint32_t monitorCount, uint32_t modeCount)
+    {
+        if (monitorCount < 1 || monitorCount > kMaxGeneratedMonitors)
+        {
+            throw std::invalid_argument("monitorCount must be between 1 and " + std::to_string(kMaxGeneratedMonitors));
+        }
+        if (modeCount < kMinGeneratedModes || modeCount > kMaxGeneratedModes)
+        {
+            throw std::invalid_argument("modeCount must be between " + std::to_string(kMinGeneratedModes) + " and " + std::to_string(kMaxGeneratedModes));
+        }
+
+        // Ten refresh rates per resolution, resolutions growing in 16:9 steps
+        const uint32_t refreshRates[] = {24, 30, 50, 60, 75, 100, 120, 144, 165, 240};
+        const uint32_t rateCount = sizeof(refreshRates) / sizeof(refreshRates[0]);
+
+        std::vector<DisplayMode> modes;
+        modes.reserve(modeCount);
+        for (uint32_t i = 0; i < modeCount; i++)
+        {
+            uint32_t step = i / rateCount;
+
+            DisplayMode mode;
+            mode.width = 640 + 16 * step;
+            mode.height = 360 + 9 * step;
+            mode.refreshRate = refreshRates[i % rateCount];
+            mode.bitsPerPixel = 32;
+            modes.push_back(mode);
+        }
+
+        std::vector<SimulatedMonitor> monitors;
+        for (uint32_t i = 0; i < monitorCount; i++)
+        {
+            SimulatedMonitor monitor;
+            monitor.device.id = "\\\\.\\DISPLAY" + std::to_string(i + 1);
+            monitor.device.name = "Simulated Display";
+            monitor.device.deviceId = "SIMULATED\\DISPLAY" + std::to_string(i + 1);
+            monitor.device.stateFlags = kDeviceActive | (i == 0 ? kDevicePrimary : 0);
+            monitor.modes = modes;
+
+            // Start at the largest 60 Hz mode
+            for (const auto &mode : modes)
+            {
+                if (mode.refreshRate == 60)
+                {
+                    monitor.current = mode;
+                }
+            }
+            monitor.current.positionX = static_cast<int32_t>(i * monitor.current.width);
+
+            monitors.push_back(std::move(monitor));
+        }
+
+        return monitors;
+    }
+
+    SimulatedMonitor *SimulatedDisplayBackend::FindMonitor(const std::string &id)
+    {
+        for (auto &monitor : options_.monitors)
+        {
+            if (id.empty() ? (monitor.device.stateFlags & kDevicePrimary) != 0 : monitor.device.id == id)
+            {
+                return &monitor;
+            }
+        }
+
+        // Without an explicit primary the first monitor stands in for it
+        if (id.empty() && !options_.monitors.empty())
+        {
+            return &options_.monitors.front();
+        }
+        return nullptr;
+    }
+
+    bool SimulatedDisplayBackend::EnumDevice(uint32_t index, DisplayDevice &device)
+    {
+        MONITORRES_COUNT_OS_CALL(EnumDisplayDevices);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index >= options_.monitors.size())
+        {
+            return false;
+        }
+
+        device = options_.monitors[index].device;
+        return true;
+    }
+
+    bool SimulatedDisplayBackend::GetCurrentMode(const std::string &id, DisplayMode &mode)
+    {
+        MONITORRES_COUNT_OS_CALL(EnumDisplaySettings);
+        std::lock_guard<std::mutex> lock(mutex_);
+        SimulatedMonitor *monitor = FindMonitor(id);
+        if (monitor == nullptr)
+        {
+            return false;
+        }
+
+        mode = monitor->current;
+        return true;
+    }
+
+    bool SimulatedDisplayBackend::GetRegistryMode(const std::string &id, DisplayMode &mode)
+    {
+        MONITORRES_COUNT_OS_CALL(EnumDisplaySettings);
+        std::lock_guard<std::mutex> lock(mutex_);
+        SimulatedMonitor *monitor = FindMonitor(id);
+        if (monitor == nullptr)
+        {
+            return false;
+        }
+
+        auto stored = registry_.find(monitor->device.id);
+        mode = stored != registry_.end() ? stored->second : monitor->current;
+        return true;
+    }
+
+    bool SimulatedDisplayBackend::EnumMode(const std::string &id, uint32_t index, DisplayMode &mode)
+    {
+        MONITORRES_COUNT_OS_CALL(EnumDisplaySettings);
+
+        // Outside the lock, so devices are read concurrently as with a real driver
+        if (index == 0 && options_.modeListLatencyMs > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options_.modeListLatencyMs));
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        SimulatedMonitor *monitor = FindMonitor(id);
+        if (monitor == nullptr || index >= monitor->modes.size())
+        {
+            return false;
+        }
+
+        mode = monitor->modes[index];
+        return true;
+    }
+
+    const DisplayMode *SimulatedDisplayBackend::FindMode(const SimulatedMonitor &monitor, const DisplayMode &mode)
+    {
+        for (const auto &supported : monitor.modes)
+        {
+            if (supported.width == mode.width &&
+                supported.height == mode.height &&
+                supported.refreshRate == mode.refreshRate)
+            {
+                return &supported;
+            }
+        }
+        return nullptr;
+    }
+
+    long SimulatedDisplayBackend::ApplyMode(const std::string &id, const DisplayMode &mode, bool updateRegistry)
+    {
+        MONITORRES_COUNT_OS_CALL(ChangeDisplaySettingsEx);
+
+        // Block outside the lock so reads keep flowing during a slow mode-set
+        if (options_.applyLatencyMs > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options_.applyLatencyMs));
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        stats_.modeSets++;
+
+        SimulatedMonitor *monitor = FindMonitor(id);
+        if (monitor == nullptr)
+        {
+            return kDispChangeBadParam;
+        }
+
+        const DisplayMode *supported = FindMode(*monitor, mode);
+        if (supported == nullptr)
+        {
+            return kDispChangeBadMode;
+        }
+
+        if (updateRegistry)
+        {
+            registry_.erase(monitor->device.id);
+        }
+        else
+        {
+            // Until now the device was stored with the mode it ran
+            registry_.emplace(monitor->device.id, monitor->current);
+        }
+
+        monitor->current.width = supported->width;
+        monitor->current.height = supported->height;
+        monitor->current.refreshRate = supported->refreshRate;
+        monitor->current.bitsPerPixel = supported->bitsPerPixel;
+        lock.unlock();
+
+        RaiseSignals(DisplaySignal::ModeChanged, options_.signalsPerModeSet);
+        return kDispChangeSuccessful;
+    }
+
+    long SimulatedDisplayBackend::StageMode(const std::string &id, const DisplayMode &mode)
+    {
+        MONITORRES_COUNT_OS_CALL(ChangeDisplaySettingsEx);
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.stagedModes++;
+
+        SimulatedMonitor *monitor = FindMonitor(id);
+        if (monitor == nullptr)
+        {
+            return kDispChangeBadParam;
+        }
+
+        const DisplayMode *supported = FindMode(*monitor, mode);
+        if (supported == nullptr)
+        {
+            return kDispChangeBadMode;
+        }
+
+        StagedChange change;
+        change.mode = *supported;
+        staged_[monitor->device.id] = change;
+        return kDispChangeSuccessful;
+    }
+
+    long SimulatedDisplayBackend::StageDeviceState(const std::string &id, const DisplayMode &mode, bool primary)
+    {
+        MONITORRES_COUNT_OS_CALL(ChangeDisplaySettingsEx);
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.stagedModes++;
+
+        SimulatedMonitor *monitor = FindMonitor(id);
+        if (monitor == nullptr)
+        {
+            return kDispChangeBadParam;
+        }
+
+        // Portrait orientations report the mode with width and height swapped
+        DisplayMode unrotated = mode;
+        if (mode.orientation % 2 == 1)
+        {
+            std::swap(unrotated.width, unrotated.height);
+        }
+        if (FindMode(*monitor, mode) == nullptr && FindMode(*monitor, unrotated) == nullptr)
+        {
+            return kDispChangeBadMode;
+        }
+
+        StagedChange change;
+        change.mode = mode;
+        change.fullState = true;
+        change.primary = primary;
+        staged_[monitor->device.id] = change;
+        return kDispChangeSuccessful;
+    }
+
+    long SimulatedDisplayBackend::CommitStagedModes()
+    {
+        MONITORRES_COUNT_OS_CALL(ChangeDisplaySettingsEx);
+
+        // One mode-set for everything staged
+        if (options_.applyLatencyMs > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options_.applyLatencyMs));
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        stats_.commits++;
+
+        for (const auto &entry : staged_)
+        {
+            SimulatedMonitor *monitor = FindMonitor(entry.first);
+            if (monitor == nullptr)
+            {
+                continue;
+            }
+
+            // Staged changes are written to the registry
+            registry_.erase(monitor->device.id);
+
+            const StagedChange &change = entry.second;
+            if (!change.fullState)
+            {
+                monitor->current.width = change.mode.width;
+                monitor->current.height = change.mode.height;
+                monitor->current.refreshRate = change.mode.refreshRate;
+                monitor->current.bitsPerPixel = change.mode.bitsPerPixel;
+                continue;
+            }
+
+            monitor->current = change.mode;
+            if (change.primary)
+            {
+                for (auto &other : options_.monitors)
+                {
+                    other.device.stateFlags &= ~kDevicePrimary;
+                }
+                monitor->device.stateFlags |= kDevicePrimary;
+            }
+        }
+        staged_.clear();
+        lock.unlock();
+
+        RaiseSignals(DisplaySignal::ModeChanged, options_.signalsPerModeSet);
+        return kDispChangeSuccessful;
+    }
+
+    bool SimulatedDisplayBackend::GetSystemDpi(int &dpiX, int &dpiY)
+    {
+        MONITORRES_COUNT_OS_CALL(GetDC);
+        std::lock_guard<std::mutex> lock(mutex_);
+        dpiX = options_.dpiX;
+        dpiY = options_.dpiY;
+        return true;
+    }
+
+    bool SimulatedDisplayBackend::GetMonitorGeometry(const std::string &id, MonitorGeometry &geometry)
+    {
+        MONITORRES_COUNT_OS_CALL(GetMonitorInfo);
+        std::lock_guard<std::mutex> lock(mutex_);
+        SimulatedMonitor *monitor = FindMonitor(id);
+        if (monitor == nullptr)
+        {
+            return false;
+        }
+
+        const DisplayMode &mode = monitor->current;
+        geometry = MonitorGeometry();
+        geometry.bounds.x = mode.positionX;
+        geometry.bounds.y = mode.positionY;
+        geometry.bounds.width = static_cast<int32_t>(mode.width);
+        geometry.bounds.height = static_cast<int32_t>(mode.height);
+
+        // Insets wider than the monitor leave an empty work area at its edge
+        const SimulatedInsets &insets = monitor->workAreaInsets;
+        uint32_t left = std::min(insets.left, mode.width);
+        uint32_t top = std::min(insets.top, mode.height);
+        geometry.workArea.x = geometry.bounds.x + static_cast<int32_t>(left);
+        geometry.workArea.y = geometry.bounds.y + static_cast<int32_t>(top);
+        geometry.workArea.width = static_cast<int32_t>(mode.width - std::min(left + insets.right, mode.width));
+        geometry.workArea.height = static_cast<int32_t>(mode.height - std::min(top + insets.bottom, mode.height));
+
+        geometry.effectiveDpiX = monitor->dpiX != 0 ? monitor->dpiX : static_cast<uint32_t>(options_.dpiX);
+        geometry.effectiveDpiY = monitor->dpiY != 0 ? monitor->dpiY : static_cast<uint32_t>(options_.dpiY);
+        geometry.rawDpiX = monitor->rawDpiX;
+        geometry.rawDpiY = monitor->rawDpiY;
+        if (geometry.rawDpiX == 0 && !monitor->edid.empty())
+        {
+            std::shared_ptr<const EdidInfo> edid = Edids().Get(monitor->edid);
+            if (edid)
+            {
+                EdidPanelDpi(*edid, mode.width, mode.height, mode.orientation, geometry.rawDpiX, geometry.rawDpiY);
+            }
+        }
+        return true;
+    }
+
+    bool SimulatedDisplayBackend::GetEdid(const std::string &id, std::vector<uint8_t> &edid)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        SimulatedMonitor *monitor = FindMonitor(id);
+        if (monitor == nullptr || monitor->edid.empty())
+        {
+            return false;
+        }
+
+        edid = monitor->edid;
+        return true;
+    }
+
+    bool SimulatedDisplayBackend::GetDriverVersion(const std::string &id, std::string &version)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (FindMonitor(id) == nullptr)
+        {
+            return false;
+        }
+
+        version = options_.driverVersion;
+        return true;
+    }
+
+    SimulatedBackendStats SimulatedDisplayBackend::Stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    std::shared_ptr<DisplayEventSource> SimulatedDisplayBackend::CreateEventSource()
+    {
+        std::shared_ptr<ManualDisplayEventSource> source = std::make_shared<ManualDisplayEventSource>();
+        std::lock_guard<std::mutex> lock(eventsMutex_);
+        eventSources_.push_back(source);
+        return source;
+    }
+
+    void SimulatedDisplayBackend::Connect(SimulatedMonitor monitor)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            registry_.erase(monitor.device.id);
+            bool replaced = false;
+            for (auto &existing : options_.monitors)
+            {
+                if (existing.device.id == monitor.device.id)
+                {
+                    existing = monitor;
+                    replaced = true;
+                    break;
+                }
+            }
+
+            if (!replaced)
+            {
+                options_.monitors.push_back(std::move(monitor));
+            }
+        }
+
+        RaiseSignals(DisplaySignal::DevicesChanged, 1);
+    }
+
+    bool SimulatedDisplayBackend::Disconnect(const std::string &id)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = std::find_if(options_.monitors.begin(), options_.monitors.end(), [&id](const SimulatedMonitor &monitor)
+                                   { return monitor.device.id == id; });
+            if (it == options_.monitors.end())
+            {
+                return false;
+            }
+
+            options_.monitors.erase(it);
+            staged_.erase(id);
+            registry_.erase(id);
+        }
+
+        RaiseSignals(DisplaySignal::DevicesChanged, 1);
+        return true;
+    }
+
+    void SimulatedDisplayBackend::RaiseSignals(DisplaySignal signal, uint32_t count)
+    {
+        std::vector<std::shared_ptr<ManualDisplayEventSource>> sources;
+        {
+            std::lock_guard<std::mutex> lock(eventsMutex_);
+            for (auto it = eventSources_.begin(); it != eventSources_.end();)
+            {
+                std::shared_ptr<ManualDisplayEventSource> source = it->lock();
+                if (!source)
+                {
+                    it = eventSources_.erase(it);
+                    continue;
+                }
+                sources.push_back(std::move(source));
+                ++it;
+            }
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            for (const auto &source : sources)
+            {
+                source->Raise(signal);
+            }
+        }
+    }
+}
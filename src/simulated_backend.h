@@ -0,0 +1,143 @@
+#ifndef MONITORRES_SIMULATED_BACKEND_H_
+#define MONITORRES_SIMULATED_BACKEND_H_
+
+#include "display_backend.h"
+#include "display_events.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace monitorres
+{
+    // Pixels the taskbar and docked toolbars take from each edge of a monitor
+    struct SimulatedInsets
+    {
+        uint32_t left = 0;
+        uint32_t top = 0;
+        uint32_t right = 0;
+        uint32_t bottom = 0;
+    };
+
+    // One monitor of the simulated display topology
+    struct SimulatedMonitor
+    {
+        DisplayDevice device;
+        DisplayMode current;
+        std::vector<DisplayMode> modes;
+        // Raw EDID; empty if the monitor does not report one
+        std::vector<uint8_t> edid;
+        // Effective DPI; 0 uses the backend's dpiX and dpiY
+        uint32_t dpiX = 0;
+        uint32_t dpiY = 0;
+        // Panel DPI; 0 derives it from the EDID's image size, if any
+        uint32_t rawDpiX = 0;
+        uint32_t rawDpiY = 0;
+        SimulatedInsets workAreaInsets;
+    };
+
+    // Limits of the synthetic topologies GenerateMonitors builds
+    const uint32_t kMaxGeneratedMonitors = 16;
+    const uint32_t kMinGeneratedModes = 10;
+    const uint32_t kMaxGeneratedModes = 10000;
+
+    struct SimulatedBackendOptions
+    {
+        std::vector<SimulatedMonitor> monitors;
+        // Time a mode-set blocks the calling thread, like a driver retraining the link
+        uint32_t applyLatencyMs = 0;
+        // Time reading a mode list blocks before its first mode, like a
+        // driver querying the monitor when EnumDisplaySettings starts over
+        uint32_t modeListLatencyMs = 0;
+        // Display signals raised by each successful mode-set; Windows sends
+        // several messages per mode-set, which the watcher has to coalesce
+        uint32_t signalsPerModeSet = 2;
+        int dpiX = 96;
+        int dpiY = 96;
+        // Reported for every monitor by GetDriverVersion
+        std::string driverVersion = "simulated";
+    };
+
+    // Counters of the work a simulated backend was asked to do
+    struct SimulatedBackendStats
+    {
+        // Immediate mode-sets through ApplyMode
+        uint64_t modeSets = 0;
+        // Changes recorded through StageMode
+        uint64_t stagedModes = 0;
+        // Mode-sets through CommitStagedModes
+        uint64_t commits = 0;
+    };
+
+    // In-memory backend with configurable topology and latency, used to
+    // exercise the addon on machines without a supported display stack
+    class SimulatedDisplayBackend : public DisplayBackend
+    {
+    public:
+        explicit SimulatedDisplayBackend(SimulatedBackendOptions options);
+
+        bool EnumDevice(uint32_t index, DisplayDevice &device) override;
+        bool GetCurrentMode(const std::string &id, DisplayMode &mode) override;
+        bool GetRegistryMode(const std::string &id, DisplayMode &mode) override;
+        bool EnumMode(const std::string &id, uint32_t index, DisplayMode &mode) override;
+        long ApplyMode(const std::string &id, const DisplayMode &mode, bool updateRegistry) override;
+        long StageMode(const std::string &id, const DisplayMode &mode) override;
+        long StageDeviceState(const std::string &id, const DisplayMode &mode, bool primary) override;
+        long CommitStagedModes() override;
+        bool GetSystemDpi(int &dpiX, int &dpiY) override;
+        bool GetMonitorGeometry(const std::string &id, MonitorGeometry &geometry) override;
+        bool GetEdid(const std::string &id, std::vector<uint8_t> &edid) override;
+        bool GetDriverVersion(const std::string &id, std::string &version) override;
+        std::shared_ptr<DisplayEventSource> CreateEventSource() override;
+
+        SimulatedBackendStats Stats();
+
+        // Hotplug a monitor, replacing one with the same id
+        void Connect(SimulatedMonitor monitor);
+        // Unplug a monitor; returns false if there is no such monitor
+        bool Disconnect(const std::string &id);
+
+        // Inject raw display signals as if the operating system had sent them
+        void RaiseSignals(DisplaySignal signal, uint32_t count);
+
+        // Monitor list used when the caller does not describe one: a single
+        // primary 1920x1080 display with a handful of common modes
+        static std::vector<SimulatedMonitor> DefaultMonitors();
+
+        // Synthetic topology for benchmarks: monitorCount monitors side by
+        // side, each listing modeCount distinct modes
+        static std::vector<SimulatedMonitor> GenerateMonitors(uint32_t monitorCount, uint32_t modeCount);
+
+    private:
+        // Caller must hold mutex_
+        SimulatedMonitor *FindMonitor(const std::string &id);
+
+        // Caller must hold mutex_; returns nullptr if monitor does not support mode
+        static const DisplayMode *FindMode(const SimulatedMonitor &monitor, const DisplayMode &mode);
+
+        // A change waiting for CommitStagedModes
+        struct StagedChange
+        {
+            DisplayMode mode;
+            // Set by StageDeviceState: bits per pixel, orientation and
+            // position come from mode, and primary is applied
+            bool fullState = false;
+            bool primary = false;
+        };
+
+        std::mutex mutex_;
+        SimulatedBackendOptions options_;
+        std::map<std::string, StagedChange> staged_;
+        // Stored modes of the devices whose current mode was applied without
+        // updateRegistry; the others are stored with their current mode
+        std::map<std::string, DisplayMode> registry_;
+        SimulatedBackendStats stats_;
+        // One source per watcher, so every environment watching gets the signals
+        std::mutex eventsMutex_;
+        std::vector<std::weak_ptr<ManualDisplayEventSource>> eventSources_;
+    };
+}
+
+#endif
@@ -0,0 +1,253 @@
+#include "stats.h"
+
+#ifdef MONITORRES_STATS
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#if defined(_MSC_VER) && defined(_WIN64)
+#include <intrin.h>
+#endif
+
+namespace monitorres
+{
+    namespace
+    {
+        const char *const kOsCallNames[] = {
+            "EnumDisplayDevices",
+            "EnumDisplaySettings",
+            "ChangeDisplaySettingsEx",
+            "GetDC",
+            "GetMonitorInfo"};
+
+        size_t BucketIndex(uint64_t ns)
+        {
+            // Index of the highest set bit, so bucket i holds [2^i, 2^(i+1))
+            size_t bit = 0;
+#if defined(_MSC_VER) && defined(_WIN64)
+            unsigned long index;
+            _BitScanReverse64(&index, ns | 1);
+            bit = index;
+#elif defined(__GNUC__)
+            bit = 63 - __builtin_clzll(ns | 1);
+#else
+            for (uint64_t rest = ns >> 1; rest != 0; rest >>= 1)
+            {
+                bit++;
+            }
+#endif
+            return bit < kLatencyBuckets ? bit : kLatencyBuckets - 1;
+        }
+
+        // Small per-thread numbers read better in trace viewers than native ids
+        uint32_t CurrentThreadId()
+        {
+            static std::atomic<uint32_t> nextId(1);
+            thread_local uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+
+        void AppendJsonString(std::string &json, const char *text)
+        {
+            json += '"';
+            for (const char *c = text; *c; c++)
+            {
+                if (*c == '"' || *c == '\\')
+                {
+                    json += '\\';
+                }
+                json += *c;
+            }
+            json += '"';
+        }
+    }
+
+    const char *OsCallName(OsCall call)
+    {
+        return kOsCallNames[static_cast<size_t>(call)];
+    }
+
+    uint64_t LatencySnapshot::Quantile(double q) const
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        uint64_t rank = static_cast<uint64_t>(q * (count - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kLatencyBuckets; i++)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+            {
+                // The top bucket is open ended, so the maximum bounds it
+                return i + 1 < kLatencyBuckets ? std::min(uint64_t(1) << (i + 1), maxNs) : maxNs;
+            }
+        }
+        return maxNs;
+    }
+
+    void LatencyHistogram::Record(uint64_t ns)
+    {
+        count_.fetch_add(1, std::memory_order_relaxed);
+        totalNs_.fetch_add(ns, std::memory_order_relaxed);
+        buckets_[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t max = maxNs_.load(std::memory_order_relaxed);
+        while (ns > max && !maxNs_.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    LatencySnapshot LatencyHistogram::Read() const
+    {
+        LatencySnapshot snapshot;
+        snapshot.count = count_.load(std::memory_order_relaxed);
+        snapshot.totalNs = totalNs_.load(std::memory_order_relaxed);
+        snapshot.maxNs = maxNs_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < kLatencyBuckets; i++)
+        {
+            snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+
+    void LatencyHistogram::Reset()
+    {
+        count_.store(0, std::memory_order_relaxed);
+        totalNs_.store(0, std::memory_order_relaxed);
+        maxNs_.store(0, std::memory_order_relaxed);
+        for (auto &bucket : buckets_)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    StatsRegistry::StatsRegistry() : epoch_(std::chrono::steady_clock::now())
+    {
+    }
+
+    LatencyHistogram &StatsRegistry::Histogram(StatsScope scope, const char *name)
+    {
+        std::lock_guard<std::mutex> lock(histogramsMutex_);
+        std::deque<LatencyHistogram> &histograms = histograms_[static_cast<size_t>(scope)];
+
+        // Call sites sharing a name share a histogram
+        for (auto &histogram : histograms)
+        {
+            if (strcmp(histogram.Name(), name) == 0)
+            {
+                return histogram;
+            }
+        }
+
+        histograms.emplace_back(name);
+        return histograms.back();
+    }
+
+    std::vector<const LatencyHistogram *> StatsRegistry::Histograms(StatsScope scope)
+    {
+        std::lock_guard<std::mutex> lock(histogramsMutex_);
+        std::vector<const LatencyHistogram *> result;
+        for (const auto &histogram : histograms_[static_cast<size_t>(scope)])
+        {
+            result.push_back(&histogram);
+        }
+        return result;
+    }
+
+    uint64_t StatsRegistry::Now() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch_).count());
+    }
+
+    void StatsRegistry::RecordSpan(LatencyHistogram &histogram, StatsScope scope, uint64_t startNs, uint64_t durationNs)
+    {
+        histogram.Record(durationNs);
+
+        if (!tracing_.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(traceMutex_);
+        if (trace_.size() < maxTraceEvents_)
+        {
+            trace_.push_back(TraceEvent{histogram.Name(), scope, startNs, durationNs, CurrentThreadId()});
+        }
+        else
+        {
+            droppedTraceEvents_++;
+        }
+    }
+
+    void StatsRegistry::StartTrace(size_t maxEvents)
+    {
+        std::lock_guard<std::mutex> lock(traceMutex_);
+        trace_.clear();
+        trace_.reserve(std::min(maxEvents, kDefaultMaxTraceEvents));
+        maxTraceEvents_ = maxEvents;
+        droppedTraceEvents_ = 0;
+        tracing_.store(true, std::memory_order_relaxed);
+    }
+
+    std::string StatsRegistry::StopTrace()
+    {
+        std::vector<TraceEvent> events;
+        uint64_t dropped;
+        {
+            std::lock_guard<std::mutex> lock(traceMutex_);
+            tracing_.store(false, std::memory_order_relaxed);
+            events.swap(trace_);
+            dropped = droppedTraceEvents_;
+        }
+
+        // Chrome trace event format; timestamps and durations are microseconds
+        std::string json = "{\"traceEvents\":[";
+        char number[64];
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            const TraceEvent &event = events[i];
+            json += i == 0 ? "{\"name\":" : ",\n{\"name\":";
+            AppendJsonString(json, event.name);
+            json += event.scope == StatsScope::Export ? ",\"cat\":\"export\"" : ",\"cat\":\"phase\"";
+            snprintf(number, sizeof(number), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                     event.startNs / 1000.0, event.durationNs / 1000.0, event.threadId);
+            json += number;
+        }
+        snprintf(number, sizeof(number), "],\"otherData\":{\"droppedEvents\":%llu}}", static_cast<unsigned long long>(dropped));
+        json += number;
+        return json;
+    }
+
+    void StatsRegistry::Reset()
+    {
+        {
+            std::lock_guard<std::mutex> lock(histogramsMutex_);
+            for (auto &histograms : histograms_)
+            {
+                for (auto &histogram : histograms)
+                {
+                    histogram.Reset();
+                }
+            }
+        }
+
+        for (auto &calls : osCalls_)
+        {
+            calls.store(0, std::memory_order_relaxed);
+        }
+        jsObjects_.store(0, std::memory_order_relaxed);
+    }
+
+    StatsRegistry &AddonStats()
+    {
+        static StatsRegistry stats;
+        return stats;
+    }
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef MONITORRES_STATS_H_
+#define MONITORRES_STATS_H_
+
+// Instrumentation of the addon's own work: a latency histogram per export
+// and per phase, counters of operating system calls and JS objects, and an
+// optional trace of every timed span. Built when MONITORRES_STATS is defined
+// (binding.gyp's monitorres_stats variable); otherwise the macros below
+// expand to nothing and none of this is compiled.
+
+#ifdef MONITORRES_STATS
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace monitorres
+{
+    // Operating system calls the backends make. The simulated and DRM
+    // backends count the operation that stands in for each call.
+    enum class OsCall
+    {
+        EnumDisplayDevices,
+        EnumDisplaySettings,
+        ChangeDisplaySettingsEx,
+        GetDC,
+        GetMonitorInfo,
+        Count
+    };
+
+    const char *OsCallName(OsCall call);
+
+    // Bucket i counts latencies below 2^(i+1) ns; the last bucket has no upper bound
+    const size_t kLatencyBuckets = 40;
+
+    // Spans a trace keeps when startTrace is not told otherwise
+    const size_t kDefaultMaxTraceEvents = 100000;
+
+    struct LatencySnapshot
+    {
+        uint64_t count = 0;
+        uint64_t totalNs = 0;
+        uint64_t maxNs = 0;
+        uint64_t buckets[kLatencyBuckets] = {};
+
+        // Upper bound of the bucket holding quantile q, in ns
+        uint64_t Quantile(double q) const;
+    };
+
+    // Log-bucketed latency histogram, updated lock-free from any thread
+    class LatencyHistogram
+    {
+    public:
+        explicit LatencyHistogram(const char *name) : name_(name) {}
+
+        const char *Name() const { return name_; }
+
+        void Record(uint64_t ns);
+        LatencySnapshot Read() const;
+        void Reset();
+
+    private:
+        const char *name_;
+        std::atomic<uint64_t> count_{0};
+        std::atomic<uint64_t> totalNs_{0};
+        std::atomic<uint64_t> maxNs_{0};
+        std::atomic<uint64_t> buckets_[kLatencyBuckets] = {};
+    };
+
+    enum class StatsScope
+    {
+        // A JS-visible function, timed from entry to return
+        Export,
+        // Native work inside an export, such as enumerating modes or a mode-set
+        Phase
+    };
+
+    // One timed span, in Chrome trace event terms a complete ("X") event
+    struct TraceEvent
+    {
+        const char *name;
+        StatsScope scope;
+        uint64_t startNs;
+        uint64_t durationNs;
+        uint32_t threadId;
+    };
+
+    class StatsRegistry
+    {
+    public:
+        StatsRegistry();
+
+        // Get the histogram for a name, creating it on first use. Names must
+        // be string literals; the histogram lives as long as the process.
+        LatencyHistogram &Histogram(StatsScope scope, const char *name);
+
+        // Histograms of a scope in registration order
+        std::vector<const LatencyHistogram *> Histograms(StatsScope scope);
+
+        void CountOsCall(OsCall call) { osCalls_[static_cast<size_t>(call)].fetch_add(1, std::memory_order_relaxed); }
+        uint64_t OsCalls(OsCall call) const { return osCalls_[static_cast<size_t>(call)].load(std::memory_order_relaxed); }
+
+        void CountJsObjects(uint64_t count) { jsObjects_.fetch_add(count, std::memory_order_relaxed); }
+        uint64_t JsObjects() const { return jsObjects_.load(std::memory_order_relaxed); }
+
+        // Nanoseconds since the registry was created, the time base of traces
+        uint64_t Now() const;
+
+        // Record a finished span in its histogram and, while tracing, in the trace
+        void RecordSpan(LatencyHistogram &histogram, StatsScope scope, uint64_t startNs, uint64_t durationNs);
+
+        // Start keeping spans, dropping any earlier trace; spans past maxEvents are dropped
+        void StartTrace(size_t maxEvents);
+        bool Tracing() const { return tracing_.load(std::memory_order_relaxed); }
+
+        // Stop tracing and get the trace as Chrome trace event JSON
+        std::string StopTrace();
+
+        // Zero every histogram and counter; a running trace is kept
+        void Reset();
+
+    private:
+        std::chrono::steady_clock::time_point epoch_;
+
+        std::mutex histogramsMutex_;
+        std::deque<LatencyHistogram> histograms_[2];
+
+        std::atomic<uint64_t> osCalls_[static_cast<size_t>(OsCall::Count)] = {};
+        std::atomic<uint64_t> jsObjects_{0};
+
+        std::atomic<bool> tracing_{false};
+        std::mutex traceMutex_;
+        std::vector<TraceEvent> trace_;
+        size_t maxTraceEvents_ = 0;
+        uint64_t droppedTraceEvents_ = 0;
+    };
+
+    // The process-wide statistics behind getStats
+    StatsRegistry &AddonStats();
+
+    // Times the enclosing scope into a histogram
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(LatencyHistogram &histogram, StatsScope scope)
+            : histogram_(histogram), scope_(scope), startNs_(AddonStats().Now()) {}
+
+        ~ScopedTimer()
+        {
+            AddonStats().RecordSpan(histogram_, scope_, startNs_, AddonStats().Now() - startNs_);
+        }
+
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    private:
+        LatencyHistogram &histogram_;
+        StatsScope scope_;
+        uint64_t startNs_;
+    };
+}
+
+#define MONITORRES_STATS_CONCAT_(a, b) a##b
+#define MONITORRES_STATS_CONCAT(a, b) MONITORRES_STATS_CONCAT_(a, b)
+
+// Time the rest of the enclosing scope as export or phase name. The
+// histogram is looked up once per call site.
+#define MONITORRES_STATS_TIME_(scope, name, line)                                                                                   \
+    static ::monitorres::LatencyHistogram &MONITORRES_STATS_CONCAT(monitorresHistogram, line) =                                     \
+        ::monitorres::AddonStats().Histogram(::monitorres::StatsScope::scope, name);                                                \
+    ::monitorres::ScopedTimer MONITORRES_STATS_CONCAT(monitorresTimer, line)(MONITORRES_STATS_CONCAT(monitorresHistogram, line), \
+                                                                             ::monitorres::StatsScope::scope)
+#define MONITORRES_TIME_EXPORT(name) MONITORRES_STATS_TIME_(Export, name, __LINE__)
+#define MONITORRES_TIME_PHASE(name) MONITORRES_STATS_TIME_(Phase, name, __LINE__)
+
+#define MONITORRES_COUNT_OS_CALL(call) ::monitorres::AddonStats().CountOsCall(::monitorres::OsCall::call)
+#define MONITORRES_COUNT_JS_OBJECTS(count) ::monitorres::AddonStats().CountJsObjects(count)
+
+#else
+
+#define MONITORRES_TIME_EXPORT(name) ((void)0)
+#define MONITORRES_TIME_PHASE(name) ((void)0)
+#define MONITORRES_COUNT_OS_CALL(call) ((void)0)
+#define MONITORRES_COUNT_JS_OBJECTS(count) ((void)0)
+
+#endif
+
+#endif
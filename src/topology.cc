@@ -0,0 +1,314 @@
+#include "topology.h"
+
+#include <cstring>
+#include <mutex>
+
+#include "desktop_layout.h"
+#include "mode_change.h"
+#include "mode_table.h"
+#include "monitor_snapshot.h"
+#include "stats.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        const uint8_t kTopologyMagic[4] = {'M', 'R', 'T', 'P'};
+        const size_t kChecksumSize = 4;
+
+        const uint8_t kOrientationMask = 0x03;
+        const uint8_t kPrimaryFlag = 0x04;
+
+        uint32_t Checksum(const uint8_t *data, size_t size)
+        {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < size; i++)
+            {
+                hash = (hash ^ data[i]) * 16777619u;
+            }
+            return hash;
+        }
+
+        void WriteVarint(std::vector<uint8_t> &out, uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                out.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<uint8_t>(value));
+        }
+
+        void WriteSigned(std::vector<uint8_t> &out, int32_t value)
+        {
+            WriteVarint(out, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+        }
+
+        // Bounds-checked reads over a blob
+        class BlobReader
+        {
+        public:
+            BlobReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+            bool ReadByte(uint8_t &value)
+            {
+                if (offset_ >= size_)
+                {
+                    return false;
+                }
+                value = data_[offset_++];
+                return true;
+            }
+
+            bool ReadVarint(uint32_t &value)
+            {
+                uint64_t result = 0;
+                for (uint32_t shift = 0; shift < 35; shift += 7)
+                {
+                    uint8_t byte;
+                    if (!ReadByte(byte))
+                    {
+                        return false;
+                    }
+                    result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                    if (!(byte & 0x80))
+                    {
+                        if (result > UINT32_MAX)
+                        {
+                            return false;
+                        }
+                        value = static_cast<uint32_t>(result);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            bool ReadSigned(int32_t &value)
+            {
+                uint32_t encoded;
+                if (!ReadVarint(encoded))
+                {
+                    return false;
+                }
+                value = static_cast<int32_t>((encoded >> 1) ^ (0u - (encoded & 1)));
+                return true;
+            }
+
+            bool ReadString(std::string &value)
+            {
+                uint32_t length;
+                if (!ReadVarint(length) || length > size_ - offset_)
+                {
+                    return false;
+                }
+                value.assign(reinterpret_cast<const char *>(data_ + offset_), length);
+                offset_ += length;
+                return true;
+            }
+
+            bool AtEnd() const { return offset_ == size_; }
+
+        private:
+            const uint8_t *data_;
+            size_t size_;
+            size_t offset_ = 0;
+        };
+
+        bool SameState(const TopologyDevice &a, const TopologyDevice &b)
+        {
+            return a.mode.width == b.mode.width &&
+                   a.mode.height == b.mode.height &&
+                   a.mode.refreshRate == b.mode.refreshRate &&
+                   a.mode.bitsPerPixel == b.mode.bitsPerPixel &&
+                   a.mode.orientation == b.mode.orientation &&
+                   a.mode.positionX == b.mode.positionX &&
+                   a.mode.positionY == b.mode.positionY &&
+                   a.primary == b.primary;
+        }
+
+        const TopologyDevice *FindDevice(const Topology &topology, const std::string &id)
+        {
+            for (const auto &device : topology)
+            {
+                if (device.id == id)
+                {
+                    return &device;
+                }
+            }
+            return nullptr;
+        }
+    }
+
+    Topology CaptureTopology(DisplayBackend &backend)
+    {
+        Topology topology;
+        for (const auto &state : TakeMonitorSnapshot(backend))
+        {
+            if (!state.hasMode)
+            {
+                continue;
+            }
+
+            TopologyDevice device;
+            device.id = state.device.id;
+            device.mode = state.mode;
+            device.primary = (state.device.stateFlags & kDevicePrimary) != 0;
+            topology.push_back(std::move(device));
+        }
+        return topology;
+    }
+
+    std::vector<uint8_t> SerializeTopology(const Topology &topology)
+    {
+        std::vector<uint8_t> out(kTopologyMagic, kTopologyMagic + sizeof(kTopologyMagic));
+        out.push_back(kTopologyFormatVersion);
+        WriteVarint(out, topology.size());
+
+        for (const auto &device : topology)
+        {
+            WriteVarint(out, device.id.size());
+            out.insert(out.end(), device.id.begin(), device.id.end());
+            WriteVarint(out, device.mode.width);
+            WriteVarint(out, device.mode.height);
+            WriteVarint(out, device.mode.refreshRate);
+            WriteVarint(out, device.mode.bitsPerPixel);
+            out.push_back(static_cast<uint8_t>((device.mode.orientation & kOrientationMask) | (device.primary ? kPrimaryFlag : 0)));
+            WriteSigned(out, device.mode.positionX);
+            WriteSigned(out, device.mode.positionY);
+        }
+
+        uint32_t checksum = Checksum(out.data(), out.size());
+        for (size_t i = 0; i < kChecksumSize; i++)
+        {
+            out.push_back(static_cast<uint8_t>(checksum >> (8 * i)));
+        }
+        return out;
+    }
+
+    bool DeserializeTopology(const uint8_t *data, size_t size, Topology &topology, std::string &error)
+    {
+        if (size < sizeof(kTopologyMagic) + 1 + kChecksumSize || memcmp(data, kTopologyMagic, sizeof(kTopologyMagic)) != 0)
+        {
+            error = "not a topology blob";
+            return false;
+        }
+
+        if (data[sizeof(kTopologyMagic)] != kTopologyFormatVersion)
+        {
+            error = "unsupported version " + std::to_string(data[sizeof(kTopologyMagic)]);
+            return false;
+        }
+
+        size_t payloadSize = size - kChecksumSize;
+        uint32_t checksum = 0;
+        for (size_t i = 0; i < kChecksumSize; i++)
+        {
+            checksum |= static_cast<uint32_t>(data[payloadSize + i]) << (8 * i);
+        }
+        if (checksum != Checksum(data, payloadSize))
+        {
+            error = "checksum mismatch";
+            return false;
+        }
+
+        BlobReader reader(data + sizeof(kTopologyMagic) + 1, payloadSize - sizeof(kTopologyMagic) - 1);
+        uint32_t count;
+        if (!reader.ReadVarint(count))
+        {
+            error = "truncated";
+            return false;
+        }
+
+        Topology parsed;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            TopologyDevice device;
+            uint8_t flags = 0;
+            if (!reader.ReadString(device.id) ||
+                !reader.ReadVarint(device.mode.width) ||
+                !reader.ReadVarint(device.mode.height) ||
+                !reader.ReadVarint(device.mode.refreshRate) ||
+                !reader.ReadVarint(device.mode.bitsPerPixel) ||
+                !reader.ReadByte(flags) ||
+                !reader.ReadSigned(device.mode.positionX) ||
+                !reader.ReadSigned(device.mode.positionY))
+            {
+                error = "truncated";
+                return false;
+            }
+
+            device.mode.orientation = flags & kOrientationMask;
+            device.primary = (flags & kPrimaryFlag) != 0;
+            parsed.push_back(std::move(device));
+        }
+
+        if (!reader.AtEnd())
+        {
+            error = "trailing bytes";
+            return false;
+        }
+
+        topology = std::move(parsed);
+        return true;
+    }
+
+    TopologyRestoreResult RestoreTopology(DisplayBackend &backend, const Topology &topology)
+    {
+        MONITORRES_TIME_PHASE("restoreTopology");
+        TopologyRestoreResult result;
+
+        std::lock_guard<std::timed_mutex> lock(ModeChangeMutex());
+        Topology live = CaptureTopology(backend);
+
+        std::vector<const TopologyDevice *> staged;
+        for (const auto &device : topology)
+        {
+            const TopologyDevice *current = FindDevice(live, device.id);
+            if (current == nullptr)
+            {
+                result.missing.push_back(device.id);
+                continue;
+            }
+            if (SameState(*current, device))
+            {
+                continue;
+            }
+
+            long code = backend.StageDeviceState(device.id, device.mode, device.primary);
+            if (code != kDispChangeSuccessful)
+            {
+                if (code == kDispChangeBadMode)
+                {
+                    ModeTables().Invalidate(backend, device.id);
+                }
+
+                // Put the registry back the way it was for the devices already staged
+                for (const TopologyDevice *previous : staged)
+                {
+                    backend.StageDeviceState(previous->id, previous->mode, previous->primary);
+                }
+
+                result.code = code;
+                result.failedId = device.id;
+                result.message = "Monitor " + device.id + " rejected " +
+                                 std::to_string(device.mode.width) + "x" + std::to_string(device.mode.height) + "@" +
+                                 std::to_string(device.mode.refreshRate) + "Hz: " + DescribeDisplayChangeCode(code);
+                result.changed.clear();
+                return result;
+            }
+
+            staged.push_back(current);
+            result.changed.push_back(device.id);
+        }
+
+        // Committing with nothing staged would apply changes staged by someone else
+        if (!result.changed.empty())
+        {
+            result.code = backend.CommitStagedModes();
+            DesktopLayouts().Invalidate();
+        }
+        result.message = DescribeDisplayChangeCode(result.code);
+        return result;
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef MONITORRES_TOPOLOGY_H_
+#define MONITORRES_TOPOLOGY_H_
+
+#include "display_backend.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace monitorres
+{
+    // Version of the blob SerializeTopology writes
+    const uint8_t kTopologyFormatVersion = 1;
+
+    // The full state of one active device
+    struct TopologyDevice
+    {
+        std::string id;
+        // Resolution, refresh rate, bits per pixel, orientation and position
+        DisplayMode mode;
+        bool primary = false;
+    };
+
+    // Every active device with a current mode, in enumeration order
+    using Topology = std::vector<TopologyDevice>;
+
+    struct TopologyRestoreResult
+    {
+        long code = kDispChangeSuccessful;
+        std::string message;
+        // Device that rejected its state; empty if the failure was not device specific
+        std::string failedId;
+        // Devices whose live state differed and was staged
+        std::vector<std::string> changed;
+        // Devices of the topology that are not active any more; they are skipped
+        std::vector<std::string> missing;
+    };
+
+    Topology CaptureTopology(DisplayBackend &backend);
+
+    // Serialize a topology into a compact blob:
+    //
+    //   "MRTP", version byte, varint device count, then per device:
+    //   varint id length, id bytes, varint width, height, refresh rate and
+    //   bits per pixel, a flags byte (orientation in bits 0-1, primary in
+    //   bit 2), zigzag varint x and y; and a trailing little-endian 32 bit
+    //   FNV-1a checksum of everything before it.
+    //
+    // A blob takes about 20 bytes per device.
+    std::vector<uint8_t> SerializeTopology(const Topology &topology);
+
+    // Parse a blob written by SerializeTopology; returns false with a reason
+    // if it is truncated, corrupt or of an unknown version
+    bool DeserializeTopology(const uint8_t *data, size_t size, Topology &topology, std::string &error);
+
+    // Compare a topology with the live state and stage only the devices that
+    // differ, then apply them in a single mode-set. If a device rejects its
+    // state, the devices staged before it are restaged with their live state
+    // and nothing is applied.
+    TopologyRestoreResult RestoreTopology(DisplayBackend &backend, const Topology &topology);
+}
+
+#endif
@@ -0,0 +1,850 @@
+#include "trace_backend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+#include "display_events.h"
+
+namespace monitorres
+{
+    namespace
+    {
+        const char kTraceMagic[4] = {'M', 'R', 'T', 'R'};
+        // Written in native byte order; a trace from a machine of the other order does not match
+        const uint32_t kByteOrderMark = 0x01020304;
+
+        // Records are written once this much is buffered
+        const size_t kWriteBatchBytes = 64 * 1024;
+
+        struct TraceHeader
+        {
+            char magic[4];
+            uint32_t byteOrder;
+            uint32_t version;
+            uint32_t reserved;
+        };
+
+        // Followed by inputSize bytes of arguments and outputSize bytes of results
+        struct RecordHeader
+        {
+            uint8_t call;
+            uint8_t reserved[3];
+            int32_t result;
+            uint32_t durationUs;
+            uint32_t inputSize;
+            uint32_t outputSize;
+        };
+
+        static_assert(sizeof(TraceHeader) == 16, "TraceHeader must have no padding");
+        static_assert(sizeof(RecordHeader) == 20, "RecordHeader must have no padding");
+        static_assert(sizeof(DisplayMode) == 28 && std::is_trivially_copyable<DisplayMode>::value, "DisplayMode is stored as is");
+
+        // Encodes the arguments or results of a call. Strings and byte
+        // arrays are length prefixed; equal arguments encode to equal bytes,
+        // which is what replay matches calls on.
+        class TraceWriter
+        {
+        public:
+            void U32(uint32_t value) { Raw(&value, sizeof(value)); }
+            void String(const std::string &value)
+            {
+                U32(static_cast<uint32_t>(value.size()));
+                Raw(value.data(), value.size());
+            }
+            void Bytes(const std::vector<uint8_t> &value)
+            {
+                U32(static_cast<uint32_t>(value.size()));
+                Raw(value.data(), value.size());
+            }
+            void Mode(const DisplayMode &mode) { Raw(&mode, sizeof(mode)); }
+            void Geometry(const MonitorGeometry &geometry) { Raw(&geometry, sizeof(geometry)); }
+
+            std::string Take() { return std::move(bytes_); }
+
+        private:
+            void Raw(const void *data, size_t size) { bytes_.append(static_cast<const char *>(data), size); }
+
+            std::string bytes_;
+        };
+
+        // Decodes what TraceWriter encoded; every read fails past the end
+        class TraceReader
+        {
+        public:
+            explicit TraceReader(const std::string &bytes) : bytes_(bytes) {}
+
+            bool U32(uint32_t &value) { return Raw(&value, sizeof(value)); }
+            bool String(std::string &value)
+            {
+                uint32_t size;
+                if (!U32(size) || size > bytes_.size() - offset_)
+                {
+                    return false;
+                }
+                value.assign(bytes_, offset_, size);
+                offset_ += size;
+                return true;
+            }
+            bool Bytes(std::vector<uint8_t> &value)
+            {
+                uint32_t size;
+                if (!U32(size) || size > bytes_.size() - offset_)
+                {
+                    return false;
+                }
+                const uint8_t *data = reinterpret_cast<const uint8_t *>(bytes_.data()) + offset_;
+                value.assign(data, data + size);
+                offset_ += size;
+                return true;
+            }
+            bool Mode(DisplayMode &mode) { return Raw(&mode, sizeof(mode)); }
+            bool Geometry(MonitorGeometry &geometry) { return Raw(&geometry, sizeof(geometry)); }
+
+            bool AtEnd() const { return offset_ == bytes_.size(); }
+
+        private:
+            bool Raw(void *data, size_t size)
+            {
+                if (size > bytes_.size() - offset_)
+                {
+                    return false;
+                }
+                memcpy(data, bytes_.data() + offset_, size);
+                offset_ += size;
+                return true;
+            }
+
+            const std::string &bytes_;
+            size_t offset_ = 0;
+        };
+
+        // Arguments of each call, shared by recording and replay so a replayed
+        // call encodes to the key it was recorded under
+
+        std::string IndexInput(uint32_t index)
+        {
+            TraceWriter writer;
+            writer.U32(index);
+            return writer.Take();
+        }
+
+        std::string IdInput(const std::string &id)
+        {
+            TraceWriter writer;
+            writer.String(id);
+            return writer.Take();
+        }
+
+        std::string IdIndexInput(const std::string &id, uint32_t index)
+        {
+            TraceWriter writer;
+            writer.String(id);
+            writer.U32(index);
+            return writer.Take();
+        }
+
+        // flag is updateRegistry for ApplyMode and primary for StageDeviceState
+        std::string ModeSetInput(const std::string &id, const DisplayMode &mode, bool flag)
+        {
+            TraceWriter writer;
+            writer.String(id);
+            writer.Mode(mode);
+            writer.U32(flag ? 1 : 0);
+            return writer.Take();
+        }
+
+        std::string DeviceOutput(const DisplayDevice &device)
+        {
+            TraceWriter writer;
+            writer.String(device.id);
+            writer.String(device.name);
+            writer.String(device.deviceId);
+            writer.String(device.deviceKey);
+            writer.U32(device.stateFlags);
+            return writer.Take();
+        }
+
+        bool ReadDevice(TraceReader &reader, DisplayDevice &device)
+        {
+            return reader.String(device.id) && reader.String(device.name) && reader.String(device.deviceId) &&
+                   reader.String(device.deviceKey) && reader.U32(device.stateFlags);
+        }
+
+        std::string ModeOutput(const DisplayMode &mode)
+        {
+            TraceWriter writer;
+            writer.Mode(mode);
+            return writer.Take();
+        }
+
+        std::string DpiOutput(int dpiX, int dpiY)
+        {
+            TraceWriter writer;
+            writer.U32(static_cast<uint32_t>(dpiX));
+            writer.U32(static_cast<uint32_t>(dpiY));
+            return writer.Take();
+        }
+
+        std::string GeometryOutput(const MonitorGeometry &geometry)
+        {
+            TraceWriter writer;
+            writer.Geometry(geometry);
+            return writer.Take();
+        }
+
+        std::string EdidOutput(const std::vector<uint8_t> &edid)
+        {
+            TraceWriter writer;
+            writer.Bytes(edid);
+            return writer.Take();
+        }
+
+        std::string DriverVersionOutput(const std::string &version)
+        {
+            TraceWriter writer;
+            writer.String(version);
+            return writer.Take();
+        }
+
+        bool IsModeSet(TraceCall call)
+        {
+            return call == TraceCall::ApplyMode || call == TraceCall::StageMode || call == TraceCall::StageDeviceState ||
+                   call == TraceCall::CommitStagedModes;
+        }
+
+        // Whether the arguments and results of a record decode as its call's
+        bool CheckRecord(const TraceRecord &record)
+        {
+            TraceReader input(record.input);
+            TraceReader output(record.output);
+            std::string id;
+            uint32_t index;
+            DisplayMode mode;
+
+            bool inputValid = false;
+            switch (record.call)
+            {
+            case TraceCall::EnumDevice:
+                inputValid = input.U32(index);
+                break;
+            case TraceCall::GetCurrentMode:
+            case TraceCall::GetRegistryMode:
+            case TraceCall::GetMonitorGeometry:
+            case TraceCall::GetEdid:
+            case TraceCall::GetDriverVersion:
+                inputValid = input.String(id);
+                break;
+            case TraceCall::EnumMode:
+                inputValid = input.String(id) && input.U32(index);
+                break;
+            case TraceCall::ApplyMode:
+            case TraceCall::StageMode:
+            case TraceCall::StageDeviceState:
+                inputValid = input.String(id) && input.Mode(mode) && input.U32(index);
+                break;
+            case TraceCall::CommitStagedModes:
+            case TraceCall::GetSystemDpi:
+                inputValid = true;
+                break;
+            case TraceCall::Signal:
+                inputValid = input.U32(index) && index <= static_cast<uint32_t>(DisplaySignal::DevicesChanged);
+                break;
+            default:
+                return false;
+            }
+            if (!inputValid || !input.AtEnd())
+            {
+                return false;
+            }
+
+            // Mode-sets, signals and failed calls have no results
+            if (IsModeSet(record.call) || record.call == TraceCall::Signal || record.result == 0)
+            {
+                return record.output.empty();
+            }
+
+            bool outputValid = false;
+            DisplayDevice device;
+            std::vector<uint8_t> edid;
+            uint32_t dpiX, dpiY;
+            MonitorGeometry geometry;
+            switch (record.call)
+            {
+            case TraceCall::EnumDevice:
+                outputValid = ReadDevice(output, device);
+                break;
+            case TraceCall::GetCurrentMode:
+            case TraceCall::GetRegistryMode:
+            case TraceCall::EnumMode:
+                outputValid = output.Mode(mode);
+                break;
+            case TraceCall::GetSystemDpi:
+                outputValid = output.U32(dpiX) && output.U32(dpiY);
+                break;
+            case TraceCall::GetMonitorGeometry:
+                outputValid = output.Geometry(geometry);
+                break;
+            case TraceCall::GetEdid:
+                outputValid = output.Bytes(edid);
+                break;
+            case TraceCall::GetDriverVersion:
+                outputValid = output.String(id);
+                break;
+            default:
+                break;
+            }
+            return outputValid && output.AtEnd() && record.result == 1;
+        }
+
+        uint32_t MicrosecondsSince(std::chrono::steady_clock::time_point start)
+        {
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+            return static_cast<uint32_t>(std::min<long long>(elapsed.count(), UINT32_MAX));
+        }
+
+        // Build the record of a finished call
+        TraceRecord MakeRecord(TraceCall call, int32_t result, std::chrono::steady_clock::time_point start, std::string input, std::string output = std::string())
+        {
+            TraceRecord record;
+            record.call = call;
+            record.result = result;
+            record.durationUs = MicrosecondsSince(start);
+            record.input = std::move(input);
+            record.output = std::move(output);
+            return record;
+        }
+    }
+
+    bool ReadDisplayTrace(const std::string &path, DisplayTrace &trace, std::string &error)
+    {
+        trace.clear();
+
+        FILE *file = fopen(path.c_str(), "rb");
+        if (file == nullptr)
+        {
+            error = "Cannot open " + path;
+            return false;
+        }
+
+        std::vector<uint8_t> bytes;
+        uint8_t chunk[64 * 1024];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        {
+            bytes.insert(bytes.end(), chunk, chunk + read);
+        }
+        bool failed = ferror(file) != 0;
+        fclose(file);
+        if (failed)
+        {
+            error = "Cannot read " + path;
+            return false;
+        }
+
+        TraceHeader header;
+        if (bytes.size() < sizeof(header))
+        {
+            error = "File is too short to be a trace";
+            return false;
+        }
+        memcpy(&header, bytes.data(), sizeof(header));
+        if (memcmp(header.magic, kTraceMagic, sizeof(kTraceMagic)) != 0)
+        {
+            error = "File is not a display trace";
+            return false;
+        }
+        if (header.byteOrder != kByteOrderMark)
+        {
+            error = "Trace was recorded on a machine of the other byte order";
+            return false;
+        }
+        if (header.version != kDisplayTraceVersion)
+        {
+            error = "Unsupported trace version " + std::to_string(header.version);
+            return false;
+        }
+
+        size_t offset = sizeof(header);
+        while (bytes.size() - offset >= sizeof(RecordHeader))
+        {
+            RecordHeader recordHeader;
+            memcpy(&recordHeader, bytes.data() + offset, sizeof(recordHeader));
+            offset += sizeof(recordHeader);
+
+            uint64_t payloadSize = static_cast<uint64_t>(recordHeader.inputSize) + recordHeader.outputSize;
+            if (payloadSize > bytes.size() - offset)
+            {
+                // The recording process stopped partway through this record
+                break;
+            }
+
+            TraceRecord record;
+            record.call = static_cast<TraceCall>(recordHeader.call);
+            record.result = recordHeader.result;
+            record.durationUs = recordHeader.durationUs;
+            record.input.assign(reinterpret_cast<const char *>(bytes.data()) + offset, recordHeader.inputSize);
+            offset += recordHeader.inputSize;
+            record.output.assign(reinterpret_cast<const char *>(bytes.data()) + offset, recordHeader.outputSize);
+            offset += recordHeader.outputSize;
+
+            if (!CheckRecord(record))
+            {
+                error = "Trace record " + std::to_string(trace.size()) + " is corrupt";
+                trace.clear();
+                return false;
+            }
+            trace.push_back(std::move(record));
+        }
+        return true;
+    }
+
+    RecordingDisplayBackend::RecordingDisplayBackend(std::shared_ptr<DisplayBackend> inner, const std::string &path)
+        : inner_(std::move(inner))
+    {
+        file_ = fopen(path.c_str(), "wb");
+        if (file_ == nullptr)
+        {
+            throw std::runtime_error("Cannot create trace file " + path);
+        }
+        stats_.path = path;
+
+        TraceHeader header = {};
+        memcpy(header.magic, kTraceMagic, sizeof(kTraceMagic));
+        header.byteOrder = kByteOrderMark;
+        header.version = kDisplayTraceVersion;
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&header);
+        buffer_.assign(bytes, bytes + sizeof(header));
+        stats_.bytes = sizeof(header);
+    }
+
+    RecordingDisplayBackend::~RecordingDisplayBackend()
+    {
+        // The inner source calls back into this
+        if (innerSource_)
+        {
+            innerSource_->Stop();
+        }
+        Close();
+    }
+
+    bool RecordingDisplayBackend::EnumDevice(uint32_t index, DisplayDevice &device)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool found = inner_->EnumDevice(index, device);
+        Append(MakeRecord(TraceCall::EnumDevice, found, start, IndexInput(index), found ? DeviceOutput(device) : std::string()));
+        return found;
+    }
+
+    bool RecordingDisplayBackend::GetCurrentMode(const std::string &id, DisplayMode &mode)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool found = inner_->GetCurrentMode(id, mode);
+        Append(MakeRecord(TraceCall::GetCurrentMode, found, start, IdInput(id), found ? ModeOutput(mode) : std::string()));
+        return found;
+    }
+
+    bool RecordingDisplayBackend::GetRegistryMode(const std::string &id, DisplayMode &mode)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool found = inner_->GetRegistryMode(id, mode);
+        Append(MakeRecord(TraceCall::GetRegistryMode, found, start, IdInput(id), found ? ModeOutput(mode) : std::string()));
+        return found;
+    }
+
+    bool RecordingDisplayBackend::EnumMode(const std::string &id, uint32_t index, DisplayMode &mode)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool found = inner_->EnumMode(id, index, mode);
+        Append(MakeRecord(TraceCall::EnumMode, found, start, IdIndexInput(id, index), found ? ModeOutput(mode) : std::string()));
+        return found;
+    }
+
+    long RecordingDisplayBackend::ApplyMode(const std::string &id, const DisplayMode &mode, bool updateRegistry)
+    {
+        auto start = std::chrono::steady_clock::now();
+        long result = inner_->ApplyMode(id, mode, updateRegistry);
+        Append(MakeRecord(TraceCall::ApplyMode, static_cast<int32_t>(result), start, ModeSetInput(id, mode, updateRegistry)));
+        return result;
+    }
+
+    long RecordingDisplayBackend::StageMode(const std::string &id, const DisplayMode &mode)
+    {
+        auto start = std::chrono::steady_clock::now();
+        long result = inner_->StageMode(id, mode);
+        Append(MakeRecord(TraceCall::StageMode, static_cast<int32_t>(result), start, ModeSetInput(id, mode, false)));
+        return result;
+    }
+
+    long RecordingDisplayBackend::StageDeviceState(const std::string &id, const DisplayMode &mode, bool primary)
+    {
+        auto start = std::chrono::steady_clock::now();
+        long result = inner_->StageDeviceState(id, mode, primary);
+        Append(MakeRecord(TraceCall::StageDeviceState, static_cast<int32_t>(result), start, ModeSetInput(id, mode, primary)));
+        return result;
+    }
+
+    long RecordingDisplayBackend::CommitStagedModes()
+    {
+        auto start = std::chrono::steady_clock::now();
+        long result = inner_->CommitStagedModes();
+        Append(MakeRecord(TraceCall::CommitStagedModes, static_cast<int32_t>(result), start, std::string()));
+        return result;
+    }
+
+    bool RecordingDisplayBackend::GetSystemDpi(int &dpiX, int &dpiY)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool found = inner_->GetSystemDpi(dpiX, dpiY);
+        Append(MakeRecord(TraceCall::GetSystemDpi, found, start, std::string(), found ? DpiOutput(dpiX, dpiY) : std::string()));
+        return found;
+    }
+
+    bool RecordingDisplayBackend::GetMonitorGeometry(const std::string &id, MonitorGeometry &geometry)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool found = inner_->GetMonitorGeometry(id, geometry);
+        Append(MakeRecord(TraceCall::GetMonitorGeometry, found, start, IdInput(id), found ? GeometryOutput(geometry) : std::string()));
+        return found;
+    }
+
+    bool RecordingDisplayBackend::GetEdid(const std::string &id, std::vector<uint8_t> &edid)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool found = inner_->GetEdid(id, edid);
+        Append(MakeRecord(TraceCall::GetEdid, found, start, IdInput(id), found ? EdidOutput(edid) : std::string()));
+        return found;
+    }
+
+    bool RecordingDisplayBackend::GetDriverVersion(const std::string &id, std::string &version)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool found = inner_->GetDriverVersion(id, version);
+        Append(MakeRecord(TraceCall::GetDriverVersion, found, start, IdInput(id), found ? DriverVersionOutput(version) : std::string()));
+        return found;
+    }
+
+    std::shared_ptr<DisplayEventSource> RecordingDisplayBackend::CreateEventSource()
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex_);
+        if (!innerSource_)
+        {
+            innerSource_ = inner_->CreateEventSource();
+            if (innerSource_ && !innerSource_->Start([this](DisplaySignal signal)
+                                                     { OnSignal(signal); }))
+            {
+                innerSource_ = nullptr;
+                return nullptr;
+            }
+        }
+        if (!innerSource_)
+        {
+            return nullptr;
+        }
+
+        auto source = std::make_shared<ManualDisplayEventSource>();
+        eventSources_.push_back(source);
+        return source;
+    }
+
+    void RecordingDisplayBackend::OnSignal(DisplaySignal signal)
+    {
+        Append(MakeRecord(TraceCall::Signal, 1, std::chrono::steady_clock::now(), IndexInput(static_cast<uint32_t>(signal))));
+
+        std::vector<std::shared_ptr<ManualDisplayEventSource>> sources;
+        {
+            std::lock_guard<std::mutex> lock(eventsMutex_);
+            for (auto it = eventSources_.begin(); it != eventSources_.end();)
+            {
+                std::shared_ptr<ManualDisplayEventSource> source = it->lock();
+                if (!source)
+                {
+                    it = eventSources_.erase(it);
+                    continue;
+                }
+                sources.push_back(std::move(source));
+                ++it;
+            }
+        }
+        for (const auto &source : sources)
+        {
+            source->Raise(signal);
+        }
+    }
+
+    void RecordingDisplayBackend::Close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (file_ == nullptr)
+        {
+            return;
+        }
+
+        WriteBuffer();
+        if (fclose(file_) != 0)
+        {
+            stats_.errors++;
+        }
+        file_ = nullptr;
+    }
+
+    TraceRecorderStats RecordingDisplayBackend::Stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    void RecordingDisplayBackend::Append(const TraceRecord &record)
+    {
+        RecordHeader header = {};
+        header.call = static_cast<uint8_t>(record.call);
+        header.result = record.result;
+        header.durationUs = record.durationUs;
+        header.inputSize = static_cast<uint32_t>(record.input.size());
+        header.outputSize = static_cast<uint32_t>(record.output.size());
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (file_ == nullptr)
+        {
+            return;
+        }
+
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&header);
+        buffer_.insert(buffer_.end(), bytes, bytes + sizeof(header));
+        buffer_.insert(buffer_.end(), record.input.begin(), record.input.end());
+        buffer_.insert(buffer_.end(), record.output.begin(), record.output.end());
+        if (record.call != TraceCall::Signal)
+        {
+            stats_.calls++;
+        }
+        stats_.bytes += sizeof(header) + record.input.size() + record.output.size();
+
+        if (buffer_.size() >= kWriteBatchBytes)
+        {
+            WriteBuffer();
+        }
+    }
+
+    void RecordingDisplayBackend::WriteBuffer()
+    {
+        if (!buffer_.empty() && fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size())
+        {
+            stats_.errors++;
+        }
+        buffer_.clear();
+    }
+
+    ReplayDisplayBackend::ReplayDisplayBackend(const DisplayTrace &trace, ReplayBackendOptions options)
+        : trace_(trace), options_(options)
+    {
+        // trace_ is not modified from here on, so the answers can point into it
+        for (size_t i = 0; i < trace_.size(); i++)
+        {
+            const TraceRecord &record = trace_[i];
+            if (record.call == TraceCall::Signal)
+            {
+                uint32_t signal = 0;
+                TraceReader(record.input).U32(signal);
+                signals_.emplace_back(i, static_cast<DisplaySignal>(signal));
+                continue;
+            }
+
+            std::string key(1, static_cast<char>(record.call));
+            key += record.input;
+            answers_[key].records.push_back(&record);
+        }
+        stats_.records = trace_.size() - signals_.size();
+    }
+
+    bool ReplayDisplayBackend::EnumDevice(uint32_t index, DisplayDevice &device)
+    {
+        const TraceRecord *record = Answer(TraceCall::EnumDevice, IndexInput(index));
+        if (record == nullptr || record->result == 0)
+        {
+            return false;
+        }
+
+        TraceReader reader(record->output);
+        return ReadDevice(reader, device);
+    }
+
+    bool ReplayDisplayBackend::GetCurrentMode(const std::string &id, DisplayMode &mode)
+    {
+        const TraceRecord *record = Answer(TraceCall::GetCurrentMode, IdInput(id));
+        return record != nullptr && record->result != 0 && TraceReader(record->output).Mode(mode);
+    }
+
+    bool ReplayDisplayBackend::GetRegistryMode(const std::string &id, DisplayMode &mode)
+    {
+        const TraceRecord *record = Answer(TraceCall::GetRegistryMode, IdInput(id));
+        return record != nullptr && record->result != 0 && TraceReader(record->output).Mode(mode);
+    }
+
+    bool ReplayDisplayBackend::EnumMode(const std::string &id, uint32_t index, DisplayMode &mode)
+    {
+        const TraceRecord *record = Answer(TraceCall::EnumMode, IdIndexInput(id, index));
+        return record != nullptr && record->result != 0 && TraceReader(record->output).Mode(mode);
+    }
+
+    long ReplayDisplayBackend::ApplyMode(const std::string &id, const DisplayMode &mode, bool updateRegistry)
+    {
+        const TraceRecord *record = Answer(TraceCall::ApplyMode, ModeSetInput(id, mode, updateRegistry));
+        if (record == nullptr)
+        {
+            return kDispChangeFailed;
+        }
+        return record->result;
+    }
+
+    long ReplayDisplayBackend::StageMode(const std::string &id, const DisplayMode &mode)
+    {
+        const TraceRecord *record = Answer(TraceCall::StageMode, ModeSetInput(id, mode, false));
+        if (record == nullptr)
+        {
+            return kDispChangeFailed;
+        }
+        return record->result;
+    }
+
+    long ReplayDisplayBackend::StageDeviceState(const std::string &id, const DisplayMode &mode, bool primary)
+    {
+        const TraceRecord *record = Answer(TraceCall::StageDeviceState, ModeSetInput(id, mode, primary));
+        if (record == nullptr)
+        {
+            return kDispChangeFailed;
+        }
+        return record->result;
+    }
+
+    long ReplayDisplayBackend::CommitStagedModes()
+    {
+        const TraceRecord *record = Answer(TraceCall::CommitStagedModes, std::string());
+        if (record == nullptr)
+        {
+            return kDispChangeFailed;
+        }
+        return record->result;
+    }
+
+    bool ReplayDisplayBackend::GetSystemDpi(int &dpiX, int &dpiY)
+    {
+        const TraceRecord *record = Answer(TraceCall::GetSystemDpi, std::string());
+        if (record == nullptr || record->result == 0)
+        {
+            return false;
+        }
+
+        TraceReader reader(record->output);
+        uint32_t x, y;
+        if (!reader.U32(x) || !reader.U32(y))
+        {
+            return false;
+        }
+        dpiX = static_cast<int>(x);
+        dpiY = static_cast<int>(y);
+        return true;
+    }
+
+    bool ReplayDisplayBackend::GetMonitorGeometry(const std::string &id, MonitorGeometry &geometry)
+    {
+        const TraceRecord *record = Answer(TraceCall::GetMonitorGeometry, IdInput(id));
+        return record != nullptr && record->result != 0 && TraceReader(record->output).Geometry(geometry);
+    }
+
+    bool ReplayDisplayBackend::GetEdid(const std::string &id, std::vector<uint8_t> &edid)
+    {
+        const TraceRecord *record = Answer(TraceCall::GetEdid, IdInput(id));
+        return record != nullptr && record->result != 0 && TraceReader(record->output).Bytes(edid);
+    }
+
+    bool ReplayDisplayBackend::GetDriverVersion(const std::string &id, std::string &version)
+    {
+        const TraceRecord *record = Answer(TraceCall::GetDriverVersion, IdInput(id));
+        return record != nullptr && record->result != 0 && TraceReader(record->output).String(version);
+    }
+
+    std::shared_ptr<DisplayEventSource> ReplayDisplayBackend::CreateEventSource()
+    {
+        auto source = std::make_shared<ManualDisplayEventSource>();
+        std::lock_guard<std::mutex> lock(mutex_);
+        eventSources_.push_back(source);
+        return source;
+    }
+
+    ReplayBackendStats ReplayDisplayBackend::Stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    const TraceRecord *ReplayDisplayBackend::Answer(TraceCall call, const std::string &input)
+    {
+        std::string key(1, static_cast<char>(call));
+        key += input;
+
+        const TraceRecord *record = nullptr;
+        for (;;)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto it = answers_.find(key);
+            if (it == answers_.end())
+            {
+                stats_.unanswered++;
+                return nullptr;
+            }
+
+            Answers &answers = it->second;
+            record = answers.records[answers.next];
+
+            // Raise a signal recorded before this answer first; listeners
+            // may make calls of their own, this one included, which take
+            // the answers recorded right after the signal. Their calls do
+            // not raise further signals, which could re-enter a source.
+            size_t position = static_cast<size_t>(record - trace_.data());
+            if (!raising_ && nextSignal_ < signals_.size() && signals_[nextSignal_].first < position)
+            {
+                DisplaySignal signal = signals_[nextSignal_++].second;
+                std::vector<std::shared_ptr<ManualDisplayEventSource>> sources;
+                for (auto source = eventSources_.begin(); source != eventSources_.end();)
+                {
+                    if (auto live = source->lock())
+                    {
+                        sources.push_back(std::move(live));
+                        ++source;
+                    }
+                    else
+                    {
+                        source = eventSources_.erase(source);
+                    }
+                }
+                raising_ = true;
+                lock.unlock();
+
+                for (const auto &source : sources)
+                {
+                    source->Raise(signal);
+                }
+
+                lock.lock();
+                raising_ = false;
+                continue;
+            }
+
+            if (answers.next + 1 < answers.records.size())
+            {
+                answers.next++;
+            }
+            stats_.calls++;
+            break;
+        }
+
+        if (options_.latency && record->durationUs > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(record->durationUs));
+        }
+        return record;
+    }
+}
@@ -0,0 +1,205 @@
+#ifndef MONITORRES_TRACE_BACKEND_H_
+#define MONITORRES_TRACE_BACKEND_H_
+
+#include "display_backend.h"
+#include "display_events.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace monitorres
+{
+    // Version of the trace format RecordingDisplayBackend writes; traces of
+    // other versions are rejected
+    const uint32_t kDisplayTraceVersion = 1;
+
+    // The backend call a trace record answers
+    enum class TraceCall : uint8_t
+    {
+        EnumDevice = 1,
+        GetCurrentMode,
+        EnumMode,
+        ApplyMode,
+        StageMode,
+        StageDeviceState,
+        CommitStagedModes,
+        GetSystemDpi,
+        GetEdid,
+        GetDriverVersion,
+        GetMonitorGeometry,
+        // Not a call: a display signal from the recorded backend's event
+        // source, with the DisplaySignal as input
+        Signal,
+        GetRegistryMode
+    };
+
+    // One backend call: its encoded arguments and what it returned
+    struct TraceRecord
+    {
+        TraceCall call = TraceCall::EnumDevice;
+        // 1 or 0 for calls returning bool, the DisplayChangeCode otherwise
+        int32_t result = 0;
+        // Time the call took in the recorded process
+        uint32_t durationUs = 0;
+        std::string input;
+        // Out parameters; empty if the call failed
+        std::string output;
+    };
+
+    // Every call of a trace, in the order the calls returned
+    using DisplayTrace = std::vector<TraceRecord>;
+
+    // Read a trace file, checking every record. A record cut short by a
+    // crash of the recording process ends the trace. Returns false and sets
+    // error if the file cannot be read or is not a valid trace.
+    bool ReadDisplayTrace(const std::string &path, DisplayTrace &trace, std::string &error);
+
+    struct TraceRecorderStats
+    {
+        std::string path;
+        // Calls recorded
+        uint64_t calls = 0;
+        // Size of the trace, header included
+        uint64_t bytes = 0;
+        // Failed writes; the trace is incomplete if any
+        uint64_t errors = 0;
+    };
+
+    // Passes every call through to another backend and appends it to a
+    // trace file: the call, its arguments, its results and how long it took.
+    // Records are buffered and written in batches. Display signals of the
+    // inner backend are recorded where they arrived and passed on to every
+    // event source the recorder created.
+    class RecordingDisplayBackend : public DisplayBackend
+    {
+    public:
+        // Throws std::runtime_error if path cannot be created
+        RecordingDisplayBackend(std::shared_ptr<DisplayBackend> inner, const std::string &path);
+        ~RecordingDisplayBackend() override;
+
+        bool EnumDevice(uint32_t index, DisplayDevice &device) override;
+        bool GetCurrentMode(const std::string &id, DisplayMode &mode) override;
+        bool GetRegistryMode(const std::string &id, DisplayMode &mode) override;
+        bool EnumMode(const std::string &id, uint32_t index, DisplayMode &mode) override;
+        long ApplyMode(const std::string &id, const DisplayMode &mode, bool updateRegistry) override;
+        long StageMode(const std::string &id, const DisplayMode &mode) override;
+        long StageDeviceState(const std::string &id, const DisplayMode &mode, bool primary) override;
+        long CommitStagedModes() override;
+        bool GetSystemDpi(int &dpiX, int &dpiY) override;
+        bool GetMonitorGeometry(const std::string &id, MonitorGeometry &geometry) override;
+        bool GetEdid(const std::string &id, std::vector<uint8_t> &edid) override;
+        bool GetDriverVersion(const std::string &id, std::string &version) override;
+        std::shared_ptr<DisplayEventSource> CreateEventSource() override;
+
+        const std::shared_ptr<DisplayBackend> &Inner() const { return inner_; }
+
+        // Write the buffered records and close the file; later calls still
+        // reach the inner backend but are not recorded
+        void Close();
+
+        TraceRecorderStats Stats();
+
+    private:
+        void Append(const TraceRecord &record);
+
+        // Caller must hold mutex_
+        void WriteBuffer();
+
+        // Record a signal of the inner source and pass it on
+        void OnSignal(DisplaySignal signal);
+
+        std::shared_ptr<DisplayBackend> inner_;
+        std::mutex mutex_;
+        FILE *file_ = nullptr;
+        std::vector<uint8_t> buffer_;
+        TraceRecorderStats stats_;
+
+        // One source of the inner backend, started by the first
+        // CreateEventSource, so each signal is recorded once however many
+        // sources listen
+        std::mutex eventsMutex_;
+        std::shared_ptr<DisplayEventSource> innerSource_;
+        std::vector<std::weak_ptr<ManualDisplayEventSource>> eventSources_;
+    };
+
+    struct ReplayBackendOptions
+    {
+        // Sleep for the recorded duration of each call, so timings match
+        // the recorded machine
+        bool latency = false;
+    };
+
+    struct ReplayBackendStats
+    {
+        // Calls recorded in the trace
+        uint64_t records = 0;
+        // Calls answered from the trace
+        uint64_t calls = 0;
+        // Calls with arguments the trace never saw; a path that diverged
+        // from the recorded one
+        uint64_t unanswered = 0;
+    };
+
+    // Serves the calls of a trace. A call is matched on its name and
+    // arguments; repeated calls get the recorded answers in order, and the
+    // last one from then on, so a mode-set followed by a query replays the
+    // new mode. Calls the trace does not hold fail, returning false or
+    // kDispChangeFailed. A recorded display signal is raised on the
+    // backend's event sources before the first call recorded after it is
+    // answered, so caches are dropped where they were while recording.
+    // Nothing depends on the platform, so traces from Windows machines
+    // replay anywhere.
+    class ReplayDisplayBackend : public DisplayBackend
+    {
+    public:
+        ReplayDisplayBackend(const DisplayTrace &trace, ReplayBackendOptions options);
+
+        bool EnumDevice(uint32_t index, DisplayDevice &device) override;
+        bool GetCurrentMode(const std::string &id, DisplayMode &mode) override;
+        bool GetRegistryMode(const std::string &id, DisplayMode &mode) override;
+        bool EnumMode(const std::string &id, uint32_t index, DisplayMode &mode) override;
+        long ApplyMode(const std::string &id, const DisplayMode &mode, bool updateRegistry) override;
+        long StageMode(const std::string &id, const DisplayMode &mode) override;
+        long StageDeviceState(const std::string &id, const DisplayMode &mode, bool primary) override;
+        long CommitStagedModes() override;
+        bool GetSystemDpi(int &dpiX, int &dpiY) override;
+        bool GetMonitorGeometry(const std::string &id, MonitorGeometry &geometry) override;
+        bool GetEdid(const std::string &id, std::vector<uint8_t> &edid) override;
+        bool GetDriverVersion(const std::string &id, std::string &version) override;
+        std::shared_ptr<DisplayEventSource> CreateEventSource() override;
+
+        ReplayBackendStats Stats();
+
+    private:
+        // The recorded answers to one call with one set of arguments
+        struct Answers
+        {
+            std::vector<const TraceRecord *> records;
+            size_t next = 0;
+        };
+
+        // Get the next answer to a call, sleeping for its duration if
+        // options_.latency is set; nullptr if the trace has none
+        const TraceRecord *Answer(TraceCall call, const std::string &input);
+
+        DisplayTrace trace_;
+        ReplayBackendOptions options_;
+        std::mutex mutex_;
+        std::unordered_map<std::string, Answers> answers_;
+        // Recorded signals and their position in trace_, in order; signals
+        // before nextSignal_ were raised
+        std::vector<std::pair<size_t, DisplaySignal>> signals_;
+        size_t nextSignal_ = 0;
+        // Set while a signal is being raised
+        bool raising_ = false;
+        std::vector<std::weak_ptr<ManualDisplayEventSource>> eventSources_;
+        ReplayBackendStats stats_;
+    };
+}
+
+#endif
@@ -0,0 +1,450 @@
+#ifdef _WIN32
+
+#include "display_backend.h"
+#include "display_events.h"
+#include "stats.h"
+
+#include <cstring>
+#include <windows.h>
+
+namespace monitorres
+{
+    namespace
+    {
+        DisplayMode ToDisplayMode(const DEVMODE &devMode)
+        {
+            DisplayMode mode;
+            mode.width = devMode.dmPelsWidth;
+            mode.height = devMode.dmPelsHeight;
+            mode.refreshRate = devMode.dmDisplayFrequency;
+            mode.bitsPerPixel = devMode.dmBitsPerPel;
+            mode.orientation = devMode.dmDisplayOrientation;
+            mode.positionX = devMode.dmPosition.x;
+            mode.positionY = devMode.dmPosition.y;
+            return mode;
+        }
+
+        // EnumDisplaySettings and friends address the primary display with NULL
+        const char *DeviceName(const std::string &id)
+        {
+            return id.empty() ? NULL : id.c_str();
+        }
+
+        // Build the DEVMODE that changes a device to mode
+        DEVMODE ToDevMode(const std::string &id, const DisplayMode &mode)
+        {
+            // Start from the current settings to preserve other values
+            DEVMODE devMode;
+            ZeroMemory(&devMode, sizeof(DEVMODE));
+            devMode.dmSize = sizeof(DEVMODE);
+            MONITORRES_COUNT_OS_CALL(EnumDisplaySettings);
+            EnumDisplaySettings(DeviceName(id), ENUM_CURRENT_SETTINGS, &devMode);
+
+            devMode.dmPelsWidth = mode.width;
+            devMode.dmPelsHeight = mode.height;
+            devMode.dmDisplayFrequency = mode.refreshRate;
+            devMode.dmFields = DM_PELSWIDTH | DM_PELSHEIGHT | DM_DISPLAYFREQUENCY;
+            return devMode;
+        }
+
+        // Adapter name of a device id; the primary adapter for the empty id
+        std::string AdapterName(const std::string &id)
+        {
+            if (!id.empty())
+            {
+                return id;
+            }
+
+            DISPLAY_DEVICE adapter;
+            ZeroMemory(&adapter, sizeof(DISPLAY_DEVICE));
+            adapter.cb = sizeof(DISPLAY_DEVICE);
+            for (DWORD i = 0;; i++)
+            {
+                // Counted before the call, so the call that ends the list is counted too
+                MONITORRES_COUNT_OS_CALL(EnumDisplayDevices);
+                if (!EnumDisplayDevices(NULL, i, &adapter, 0))
+                {
+                    break;
+                }
+                if (adapter.StateFlags & DISPLAY_DEVICE_PRIMARY_DEVICE)
+                {
+                    return adapter.DeviceName;
+                }
+            }
+            return "";
+        }
+
+        // Registry key holding the EDID of a monitor, derived from its device
+        // interface path, e.g. \\?\DISPLAY#GSM5B08#5&1a2b3c&0&UID4352#{guid}
+        // becomes SYSTEM\CurrentControlSet\Enum\DISPLAY\GSM5B08\5&1a2b3c&0&UID4352\Device Parameters
+        std::string EdidRegistryKey(const std::string &interfacePath)
+        {
+            std::string path = interfacePath;
+            if (path.compare(0, 4, "\\\\?\\") == 0)
+            {
+                path.erase(0, 4);
+            }
+
+            size_t guid = path.rfind('#');
+            if (guid == std::string::npos)
+            {
+                return "";
+            }
+            path.erase(guid);
+
+            for (auto &c : path)
+            {
+                if (c == '#')
+                {
+                    c = '\\';
+                }
+            }
+            return "SYSTEM\\CurrentControlSet\\Enum\\" + path + "\\Device Parameters";
+        }
+
+        // MONITOR_DPI_TYPE values of GetDpiForMonitor
+        const int kMdtEffectiveDpi = 0;
+        const int kMdtRawDpi = 2;
+
+        // DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2 and its Windows 10 1607 predecessor
+        const HANDLE kPerMonitorAwareV2 = reinterpret_cast<HANDLE>(static_cast<INT_PTR>(-4));
+        const HANDLE kPerMonitorAware = reinterpret_cast<HANDLE>(static_cast<INT_PTR>(-3));
+
+        typedef HRESULT(WINAPI *GetDpiForMonitorFunction)(HMONITOR, int, UINT *, UINT *);
+        typedef HANDLE(WINAPI *SetThreadDpiAwarenessContextFunction)(HANDLE);
+
+        // Per-monitor DPI functions, looked up at run time so the addon still
+        // loads where they are missing: GetDpiForMonitor needs Windows 8.1,
+        // SetThreadDpiAwarenessContext Windows 10 1607
+        struct DpiFunctions
+        {
+            GetDpiForMonitorFunction getDpiForMonitor = NULL;
+            SetThreadDpiAwarenessContextFunction setThreadDpiAwarenessContext = NULL;
+        };
+
+        const DpiFunctions &Dpi()
+        {
+            static const DpiFunctions functions = []
+            {
+                DpiFunctions loaded;
+                // Never freed; the functions are used for the life of the process
+                HMODULE shcore = LoadLibraryA("shcore.dll");
+                if (shcore != NULL)
+                {
+                    loaded.getDpiForMonitor = reinterpret_cast<GetDpiForMonitorFunction>(GetProcAddress(shcore, "GetDpiForMonitor"));
+                }
+                HMODULE user32 = GetModuleHandleA("user32.dll");
+                if (user32 != NULL)
+                {
+                    loaded.setThreadDpiAwarenessContext = reinterpret_cast<SetThreadDpiAwarenessContextFunction>(GetProcAddress(user32, "SetThreadDpiAwarenessContext"));
+                }
+                return loaded;
+            }();
+            return functions;
+        }
+
+        DesktopRect ToDesktopRect(const RECT &rect)
+        {
+            DesktopRect result;
+            result.x = rect.left;
+            result.y = rect.top;
+            result.width = rect.right - rect.left;
+            result.height = rect.bottom - rect.top;
+            return result;
+        }
+
+        // The HMONITOR showing a device, found by EnumDisplayMonitors
+        struct MonitorSearch
+        {
+            const std::string *id;
+            HMONITOR monitor = NULL;
+            MONITORINFOEX info;
+        };
+
+        BOOL CALLBACK MatchMonitor(HMONITOR monitor, HDC, LPRECT, LPARAM data)
+        {
+            MonitorSearch &search = *reinterpret_cast<MonitorSearch *>(data);
+
+            MONITORINFOEX info;
+            ZeroMemory(&info, sizeof(MONITORINFOEX));
+            info.cbSize = sizeof(MONITORINFOEX);
+            MONITORRES_COUNT_OS_CALL(GetMonitorInfo);
+            if (!GetMonitorInfo(monitor, &info))
+            {
+                return TRUE;
+            }
+
+            bool matches = search.id->empty() ? (info.dwFlags & MONITORINFOF_PRIMARY) != 0 : *search.id == info.szDevice;
+            if (!matches)
+            {
+                return TRUE;
+            }
+
+            search.monitor = monitor;
+            search.info = info;
+            return FALSE;
+        }
+
+        class Win32DisplayBackend : public DisplayBackend
+        {
+        public:
+            bool EnumDevice(uint32_t index, DisplayDevice &device) override
+            {
+                DISPLAY_DEVICE displayDevice;
+                ZeroMemory(&displayDevice, sizeof(DISPLAY_DEVICE));
+                displayDevice.cb = sizeof(DISPLAY_DEVICE);
+
+                MONITORRES_COUNT_OS_CALL(EnumDisplayDevices);
+                if (!EnumDisplayDevices(NULL, index, &displayDevice, 0))
+                {
+                    return false;
+                }
+
+                device.id = displayDevice.DeviceName;
+                device.name = displayDevice.DeviceString;
+                device.deviceId = displayDevice.DeviceID;
+                device.deviceKey = displayDevice.DeviceKey;
+                device.stateFlags = displayDevice.StateFlags;
+                return true;
+            }
+
+            bool GetCurrentMode(const std::string &id, DisplayMode &mode) override
+            {
+                return EnumMode(id, ENUM_CURRENT_SETTINGS, mode);
+            }
+
+            bool GetRegistryMode(const std::string &id, DisplayMode &mode) override
+            {
+                return EnumMode(id, ENUM_REGISTRY_SETTINGS, mode);
+            }
+
+            bool EnumMode(const std::string &id, uint32_t index, DisplayMode &mode) override
+            {
+                DEVMODE devMode;
+                ZeroMemory(&devMode, sizeof(DEVMODE));
+                devMode.dmSize = sizeof(DEVMODE);
+
+                MONITORRES_COUNT_OS_CALL(EnumDisplaySettings);
+                if (!EnumDisplaySettings(DeviceName(id), index, &devMode))
+                {
+                    return false;
+                }
+
+                mode = ToDisplayMode(devMode);
+                return true;
+            }
+
+            long ApplyMode(const std::string &id, const DisplayMode &mode, bool updateRegistry) override
+            {
+                DEVMODE devMode = ToDevMode(id, mode);
+
+                DWORD flags = updateRegistry ? CDS_UPDATEREGISTRY : 0;
+                MONITORRES_COUNT_OS_CALL(ChangeDisplaySettingsEx);
+                if (id.empty())
+                {
+                    return ChangeDisplaySettings(&devMode, flags);
+                }
+                return ChangeDisplaySettingsEx(id.c_str(), &devMode, NULL, flags, NULL);
+            }
+
+            long StageMode(const std::string &id, const DisplayMode &mode) override
+            {
+                DEVMODE devMode = ToDevMode(id, mode);
+
+                // CDS_NORESET only records the change in the registry
+                MONITORRES_COUNT_OS_CALL(ChangeDisplaySettingsEx);
+                return ChangeDisplaySettingsEx(DeviceName(id), &devMode, NULL, CDS_UPDATEREGISTRY | CDS_NORESET, NULL);
+            }
+
+            long StageDeviceState(const std::string &id, const DisplayMode &mode, bool primary) override
+            {
+                DEVMODE devMode = ToDevMode(id, mode);
+                devMode.dmBitsPerPel = mode.bitsPerPixel;
+                devMode.dmDisplayOrientation = mode.orientation;
+                devMode.dmPosition.x = mode.positionX;
+                devMode.dmPosition.y = mode.positionY;
+                devMode.dmFields |= DM_BITSPERPEL | DM_DISPLAYORIENTATION | DM_POSITION;
+
+                // The primary display must sit at the origin; positions captured
+                // from a live desktop already satisfy that
+                DWORD flags = CDS_UPDATEREGISTRY | CDS_NORESET | (primary ? CDS_SET_PRIMARY : 0);
+                MONITORRES_COUNT_OS_CALL(ChangeDisplaySettingsEx);
+                return ChangeDisplaySettingsEx(DeviceName(id), &devMode, NULL, flags, NULL);
+            }
+
+            long CommitStagedModes() override
+            {
+                MONITORRES_COUNT_OS_CALL(ChangeDisplaySettingsEx);
+                return ChangeDisplaySettingsEx(NULL, NULL, NULL, 0, NULL);
+            }
+
+            bool GetSystemDpi(int &dpiX, int &dpiY) override
+            {
+                MONITORRES_COUNT_OS_CALL(GetDC);
+                HDC hdc = GetDC(NULL);
+                if (hdc == NULL)
+                {
+                    return false;
+                }
+
+                dpiX = GetDeviceCaps(hdc, LOGPIXELSX);
+                dpiY = GetDeviceCaps(hdc, LOGPIXELSY);
+
+                ReleaseDC(NULL, hdc);
+                return true;
+            }
+
+            bool GetMonitorGeometry(const std::string &id, MonitorGeometry &geometry) override
+            {
+                const DpiFunctions &dpi = Dpi();
+
+                // Node declares no DPI awareness, so Windows would scale the
+                // rects and report 96 DPI; ask as a per-monitor aware thread
+                HANDLE previous = NULL;
+                if (dpi.setThreadDpiAwarenessContext != NULL)
+                {
+                    previous = dpi.setThreadDpiAwarenessContext(kPerMonitorAwareV2);
+                    if (previous == NULL)
+                    {
+                        previous = dpi.setThreadDpiAwarenessContext(kPerMonitorAware);
+                    }
+                }
+
+                MonitorSearch search;
+                search.id = &id;
+                EnumDisplayMonitors(NULL, NULL, MatchMonitor, reinterpret_cast<LPARAM>(&search));
+
+                bool found = search.monitor != NULL;
+                if (found)
+                {
+                    geometry = MonitorGeometry();
+                    geometry.bounds = ToDesktopRect(search.info.rcMonitor);
+                    geometry.workArea = ToDesktopRect(search.info.rcWork);
+
+                    UINT x = 0;
+                    UINT y = 0;
+                    if (dpi.getDpiForMonitor != NULL && SUCCEEDED(dpi.getDpiForMonitor(search.monitor, kMdtEffectiveDpi, &x, &y)))
+                    {
+                        geometry.effectiveDpiX = x;
+                        geometry.effectiveDpiY = y;
+                    }
+                    else
+                    {
+                        // Before Windows 8.1 every monitor uses the system DPI
+                        int systemX, systemY;
+                        if (GetSystemDpi(systemX, systemY))
+                        {
+                            geometry.effectiveDpiX = static_cast<uint32_t>(systemX);
+                            geometry.effectiveDpiY = static_cast<uint32_t>(systemY);
+                        }
+                    }
+
+                    if (dpi.getDpiForMonitor != NULL && SUCCEEDED(dpi.getDpiForMonitor(search.monitor, kMdtRawDpi, &x, &y)))
+                    {
+                        geometry.rawDpiX = x;
+                        geometry.rawDpiY = y;
+                    }
+                }
+
+                if (previous != NULL)
+                {
+                    dpi.setThreadDpiAwarenessContext(previous);
+                }
+                return found;
+            }
+
+            bool GetEdid(const std::string &id, std::vector<uint8_t> &edid) override
+            {
+                std::string adapter = AdapterName(id);
+                if (adapter.empty())
+                {
+                    return false;
+                }
+
+                // The first monitor on the adapter, with its device interface path as DeviceID
+                DISPLAY_DEVICE monitor;
+                ZeroMemory(&monitor, sizeof(DISPLAY_DEVICE));
+                monitor.cb = sizeof(DISPLAY_DEVICE);
+                MONITORRES_COUNT_OS_CALL(EnumDisplayDevices);
+                if (!EnumDisplayDevices(adapter.c_str(), 0, &monitor, EDD_GET_DEVICE_INTERFACE_NAME))
+                {
+                    return false;
+                }
+
+                std::string key = EdidRegistryKey(monitor.DeviceID);
+                if (key.empty())
+                {
+                    return false;
+                }
+
+                DWORD size = 0;
+                if (RegGetValue(HKEY_LOCAL_MACHINE, key.c_str(), "EDID", RRF_RT_REG_BINARY, NULL, NULL, &size) != ERROR_SUCCESS || size == 0)
+                {
+                    return false;
+                }
+
+                edid.resize(size);
+                if (RegGetValue(HKEY_LOCAL_MACHINE, key.c_str(), "EDID", RRF_RT_REG_BINARY, NULL, edid.data(), &size) != ERROR_SUCCESS)
+                {
+                    return false;
+                }
+                edid.resize(size);
+                return true;
+            }
+
+            bool GetDriverVersion(const std::string &id, std::string &version) override
+            {
+                // DeviceKey names the adapter's driver key, e.g.
+                // \Registry\Machine\System\CurrentControlSet\Control\Video\{guid}\0000
+                std::string adapter = AdapterName(id);
+                DISPLAY_DEVICE displayDevice;
+                ZeroMemory(&displayDevice, sizeof(DISPLAY_DEVICE));
+                displayDevice.cb = sizeof(DISPLAY_DEVICE);
+
+                std::string deviceKey;
+                for (DWORD i = 0; !adapter.empty(); i++)
+                {
+                    MONITORRES_COUNT_OS_CALL(EnumDisplayDevices);
+                    if (!EnumDisplayDevices(NULL, i, &displayDevice, 0))
+                    {
+                        break;
+                    }
+                    if (adapter == displayDevice.DeviceName)
+                    {
+                        deviceKey = displayDevice.DeviceKey;
+                        break;
+                    }
+                }
+
+                const std::string machinePrefix = "\\Registry\\Machine\\";
+                if (deviceKey.size() <= machinePrefix.size() || _strnicmp(deviceKey.c_str(), machinePrefix.c_str(), machinePrefix.size()) != 0)
+                {
+                    return false;
+                }
+                std::string key = deviceKey.substr(machinePrefix.size());
+
+                char value[256];
+                DWORD size = sizeof(value);
+                if (RegGetValue(HKEY_LOCAL_MACHINE, key.c_str(), "DriverVersion", RRF_RT_REG_SZ, NULL, value, &size) != ERROR_SUCCESS)
+                {
+                    return false;
+                }
+
+                version = value;
+                return true;
+            }
+
+            std::shared_ptr<DisplayEventSource> CreateEventSource() override
+            {
+                return CreateWin32DisplayEventSource();
+            }
+        };
+    }
+
+    std::shared_ptr<DisplayBackend> CreateWin32DisplayBackend()
+    {
+        return std::make_shared<Win32DisplayBackend>();
+    }
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifdef _WIN32
+
+#include "display_events.h"
+
+#include <windows.h>
+#include <dbt.h>
+
+#include <future>
+
+namespace monitorres
+{
+    namespace
+    {
+        // GUID_DEVINTERFACE_MONITOR from ntddvdeo.h
+        const GUID kMonitorInterfaceGuid = {0xe6f07b5f, 0xee97, 0x4a90, {0xb0, 0x76, 0x33, 0xf5, 0x7b, 0xf4, 0xea, 0xa7}};
+
+        const char *kWindowClassName = "monitorresDisplayWatcher";
+
+        // Listens on a dedicated thread with a hidden top-level window.
+        // WM_DISPLAYCHANGE is only broadcast to top-level windows, so a
+        // message-only (HWND_MESSAGE) window would never receive it.
+        class Win32DisplayEventSource : public DisplayEventSource
+        {
+        public:
+            ~Win32DisplayEventSource() override
+            {
+                Stop();
+            }
+
+            bool Start(DisplaySignalCallback callback) override
+            {
+                callback_ = std::move(callback);
+
+                std::promise<bool> ready;
+                std::future<bool> started = ready.get_future();
+                thread_ = std::thread(&Win32DisplayEventSource::Run, this, std::move(ready));
+
+                if (!started.get())
+                {
+                    thread_.join();
+                    return false;
+                }
+                return true;
+            }
+
+            void Stop() override
+            {
+                if (!thread_.joinable())
+                {
+                    return;
+                }
+
+                PostThreadMessage(threadId_, WM_QUIT, 0, 0);
+                thread_.join();
+            }
+
+        private:
+            static LRESULT CALLBACK WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+            {
+                if (message == WM_NCCREATE)
+                {
+                    CREATESTRUCT *create = reinterpret_cast<CREATESTRUCT *>(lParam);
+                    SetWindowLongPtr(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(create->lpCreateParams));
+                }
+
+                Win32DisplayEventSource *source = reinterpret_cast<Win32DisplayEventSource *>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
+                if (source != nullptr)
+                {
+                    switch (message)
+                    {
+                    case WM_DISPLAYCHANGE:
+                        source->callback_(DisplaySignal::ModeChanged);
+                        break;
+                    case WM_DEVICECHANGE:
+                        if (wParam == DBT_DEVICEARRIVAL || wParam == DBT_DEVICEREMOVECOMPLETE || wParam == DBT_DEVNODES_CHANGED)
+                        {
+                            source->callback_(DisplaySignal::DevicesChanged);
+                        }
+                        break;
+                    }
+                }
+
+                return DefWindowProc(hwnd, message, wParam, lParam);
+            }
+
+            void Run(std::promise<bool> ready)
+            {
+                threadId_ = GetCurrentThreadId();
+                HINSTANCE instance = GetModuleHandle(NULL);
+
+                WNDCLASSEX windowClass;
+                ZeroMemory(&windowClass, sizeof(WNDCLASSEX));
+                windowClass.cbSize = sizeof(WNDCLASSEX);
+                windowClass.lpfnWndProc = WindowProc;
+                windowClass.hInstance = instance;
+                windowClass.lpszClassName = kWindowClassName;
+
+                // A second watcher finds the class already registered
+                if (!RegisterClassEx(&windowClass) && GetLastError() != ERROR_CLASS_ALREADY_EXISTS)
+                {
+                    ready.set_value(false);
+                    return;
+                }
+
+                HWND hwnd = CreateWindowEx(0, kWindowClassName, "", WS_OVERLAPPED, 0, 0, 0, 0, NULL, NULL, instance, this);
+                if (hwnd == NULL)
+                {
+                    ready.set_value(false);
+                    return;
+                }
+
+                DEV_BROADCAST_DEVICEINTERFACE filter;
+                ZeroMemory(&filter, sizeof(DEV_BROADCAST_DEVICEINTERFACE));
+                filter.dbcc_size = sizeof(DEV_BROADCAST_DEVICEINTERFACE);
+                filter.dbcc_devicetype = DBT_DEVTYP_DEVICEINTERFACE;
+                filter.dbcc_classguid = kMonitorInterfaceGuid;
+                HDEVNOTIFY notification = RegisterDeviceNotification(hwnd, &filter, DEVICE_NOTIFY_WINDOW_HANDLE);
+
+                // Make sure the queue exists before Start() returns, so Stop() can always post WM_QUIT
+                MSG message;
+                PeekMessage(&message, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+                ready.set_value(true);
+
+                while (GetMessage(&message, NULL, 0, 0) > 0)
+                {
+                    TranslateMessage(&message);
+                    DispatchMessage(&message);
+                }
+
+                if (notification != NULL)
+                {
+                    UnregisterDeviceNotification(notification);
+                }
+                DestroyWindow(hwnd);
+            }
+
+            DisplaySignalCallback callback_;
+            std::thread thread_;
+            DWORD threadId_ = 0;
+        };
+    }
+
+    std::shared_ptr<DisplayEventSource> CreateWin32DisplayEventSource()
+    {
+        return std::make_shared<Win32DisplayEventSource>();
+    }
+}
+
+#endif
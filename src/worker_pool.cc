@@ -0,0 +1,104 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+namespace monitorres
+{
+    WorkerPool::WorkerPool(uint32_t threads)
+    {
+        // The caller of Run works too, so one thread fewer is started
+        for (uint32_t i = 1; i < threads; i++)
+        {
+            threads_.emplace_back(&WorkerPool::WorkLoop, this);
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+
+        for (auto &thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    void WorkerPool::Run(size_t count, const std::function<void(size_t)> &task)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> run(runMutex_);
+        {
+            // A worker that woke too late for the previous loop may still be draining it
+            std::unique_lock<std::mutex> lock(mutex_);
+            idle_.wait(lock, [this]
+                       { return draining_ == 0; });
+
+            task_ = &task;
+            count_ = count;
+            next_.store(0);
+            loop_++;
+        }
+        if (count > 1)
+        {
+            wake_.notify_all();
+        }
+
+        Drain();
+
+        // Every iteration is claimed; wait for the ones other threads are running
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this]
+                   { return draining_ == 0; });
+        task_ = nullptr;
+        count_ = 0;
+    }
+
+    void WorkerPool::Drain()
+    {
+        for (size_t i = next_.fetch_add(1); i < count_; i = next_.fetch_add(1))
+        {
+            (*task_)(i);
+        }
+    }
+
+    void WorkerPool::WorkLoop()
+    {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            wake_.wait(lock, [this, seen]
+                       { return stopping_ || loop_ != seen; });
+            if (stopping_)
+            {
+                return;
+            }
+
+            seen = loop_;
+            draining_++;
+            lock.unlock();
+
+            Drain();
+
+            lock.lock();
+            if (--draining_ == 0)
+            {
+                idle_.notify_all();
+            }
+        }
+    }
+
+    WorkerPool &SharedWorkerPool()
+    {
+        static WorkerPool pool(std::min(std::max(std::thread::hardware_concurrency(), kMinPoolThreads), kMaxPoolThreads));
+        return pool;
+    }
+}
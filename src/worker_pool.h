@@ -0,0 +1,69 @@
+#ifndef MONITORRES_WORKER_POOL_H_
+#define MONITORRES_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace monitorres
+{
+    // Bounds of the process-wide pool's size. Its work mostly waits on the
+    // driver, so even a machine with few cores gets kMinPoolThreads.
+    const uint32_t kMinPoolThreads = 4;
+    const uint32_t kMaxPoolThreads = 8;
+
+    // Fixed set of threads that run the iterations of a loop in parallel.
+    // Iterations are claimed through an atomic counter, so tasks that only
+    // write their own slot of a preallocated output need no locks.
+    class WorkerPool
+    {
+    public:
+        explicit WorkerPool(uint32_t threads);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+        // Threads that run iterations, counting the caller of Run
+        uint32_t Concurrency() const { return static_cast<uint32_t>(threads_.size()) + 1; }
+
+        // Call task(i) for every i below count on the pool and the calling
+        // thread, returning once all calls finished. task must not throw.
+        // One loop runs at a time; concurrent callers wait their turn.
+        void Run(size_t count, const std::function<void(size_t)> &task);
+
+    private:
+        void WorkLoop();
+
+        // Run iterations until none are left to claim
+        void Drain();
+
+        // Held for the whole of a Run
+        std::mutex runMutex_;
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable idle_;
+        // Set up by Run under mutex_ while no worker is draining
+        const std::function<void(size_t)> *task_ = nullptr;
+        size_t count_ = 0;
+        std::atomic<size_t> next_{0};
+        // Bumped by every Run so each worker joins a loop once
+        uint64_t loop_ = 0;
+        // Workers inside Drain
+        uint32_t draining_ = 0;
+        bool stopping_ = false;
+        std::vector<std::thread> threads_;
+    };
+
+    // The process-wide pool, one thread per core within kMinPoolThreads and
+    // kMaxPoolThreads, started on first use
+    WorkerPool &SharedWorkerPool();
+}
+
+#endif
@@ -0,0 +1,61 @@
+// The watcher and the reconciler move to a backend installed while they run
+
+const { test, assert, monitorres } = require('../harness');
+
+const kDisplay1 = '\\\\.\\DISPLAY1';
+
+function waitFor(predicate, timeoutMs = 2000) {
+  const deadline = Date.now() + timeoutMs;
+  return new Promise((resolve, reject) => {
+    const poll = () => {
+      if (predicate()) {
+        resolve();
+      } else if (Date.now() > deadline) {
+        reject(new Error('Timed out waiting'));
+      } else {
+        setTimeout(poll, 5);
+      }
+    };
+    poll();
+  });
+}
+
+test('the watcher reports and follows a new backend', async () => {
+  const events = [];
+  const listener = (event) => events.push(event);
+  monitorres.setDisplayChangeCoalescing(10);
+  monitorres.on('change', listener);
+  try {
+    monitorres.useSimulatedBackend({
+      monitors: [{ width: 1920, height: 1080, refreshRate: 60 }, { width: 1920, height: 1080, refreshRate: 60, position: { x: 1920, y: 0 } }]
+    });
+    await waitFor(() => events.length === 1);
+    assert.deepStrictEqual(events[0].added, ['\\\\.\\DISPLAY2']);
+
+    monitorres.simulateDisplayChange({ disconnect: '\\\\.\\DISPLAY2' });
+    await waitFor(() => events.length === 2);
+    assert.deepStrictEqual(events[1].removed, ['\\\\.\\DISPLAY2']);
+  } finally {
+    monitorres.off('change', listener);
+    monitorres.setDisplayChangeCoalescing(250);
+  }
+});
+
+test('the reconciler corrects drift on a new backend', async () => {
+  const events = [];
+  const listener = (event) => events.push(event);
+  monitorres.on('reconcile', listener);
+  monitorres.setReconcilerOptions({ intervalMs: 10 });
+  try {
+    monitorres.setDesiredState(kDisplay1, { width: 1920, height: 1080 });
+    monitorres.useSimulatedBackend();
+    assert.strictEqual(monitorres.setMonitorResolution(kDisplay1, 1280, 720), true);
+    await waitFor(() => events.length === 1);
+    assert.strictEqual(events[0].type, 'corrected');
+    assert.strictEqual(monitorres.getMonitorResolution(kDisplay1).width, 1920);
+  } finally {
+    monitorres.clearDesiredState();
+    monitorres.off('reconcile', listener);
+    monitorres.setReconcilerOptions({});
+  }
+});
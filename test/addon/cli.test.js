@@ -0,0 +1,115 @@
+// Arguments of monitorres_cli, run against its simulated backend
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { spawnSync } = require('child_process');
+const { test, assert } = require('../harness');
+const { topologyBlob } = require('../fixtures/traces/record');
+
+const kCli = path.join(__dirname, '..', '..', 'build', 'Release', process.platform === 'win32' ? 'monitorres_cli.exe' : 'monitorres_cli');
+const kExitUsage = 2;
+
+function cli(...args) {
+  return spawnSync(kCli, ['--simulated', ...args], { encoding: 'utf8' });
+}
+
+// Two monitors of ten modes each
+function cli2(args, input) {
+  return spawnSync(kCli, ['--simulated=2x10', ...args], { encoding: 'utf8', input });
+}
+
+// Built unless --monitorres_cli=0
+function ifBuilt(fn) {
+  return () => (fs.existsSync(kCli) ? fn() : console.log('    monitorres_cli not built, skipped'));
+}
+
+test('set applies a mode with and without a refresh rate', ifBuilt(() => {
+  for (const spec of ['1280x720', '1280x720@60']) {
+    const run = cli('set', spec);
+    assert.strictEqual(run.status, 0, run.stderr);
+    const result = JSON.parse(run.stdout);
+    assert.strictEqual(result.width, 1280);
+    assert.strictEqual(result.height, 720);
+  }
+}));
+
+test('set rejects a malformed mode as a usage error', ifBuilt(() => {
+  const specs = ['-5x720', '99999999999x720', '1280x99999999999', '1280x720@-60', '1280x720@4294967356',
+    '+1280x720', ' 1280x720', '1280x720abc', '1280x720@60abc', '1280x720@', 'x720', '1280x', '1280', '1280x720x60'];
+  for (const spec of specs) {
+    const run = cli('set', spec);
+    assert.strictEqual(run.status, kExitUsage, `${spec}: ${run.stdout}${run.stderr}`);
+    assert.match(run.stderr, /^monitorres: /, spec);
+  }
+}));
+
+test('numeric options reject signs and overflow', ifBuilt(() => {
+  for (const option of ['--count=-1', '--timeout=99999999999', '--interval=+5', '--coalesce=']) {
+    assert.strictEqual(cli(option, 'list').status, kExitUsage, option);
+  }
+}));
+
+test('list prints every active monitor as JSON or lines', ifBuilt(() => {
+  const json = cli2(['list']);
+  assert.strictEqual(json.status, 0, json.stderr);
+  const monitors = JSON.parse(json.stdout);
+  assert.deepStrictEqual(monitors.map((monitor) => [monitor.id, monitor.primary, monitor.x]),
+    [['\\\\.\\DISPLAY1', true, 0], ['\\\\.\\DISPLAY2', false, monitors[0].width]]);
+
+  const lines = cli2(['--lines', 'list']);
+  assert.strictEqual(lines.status, 0, lines.stderr);
+  assert.deepStrictEqual(lines.stdout.trim().split('\n').map((line) => line.split('\t').slice(0, 4)),
+    monitors.map((monitor) => [monitor.id, `${monitor.width}x${monitor.height}@${monitor.refreshRate}`,
+      `${monitor.x},${monitor.y}`, monitor.primary ? 'primary' : '-']));
+}));
+
+test('modes lists the modes of the primary or a named monitor', ifBuilt(() => {
+  const primary = cli2(['modes']);
+  assert.strictEqual(primary.status, 0, primary.stderr);
+  const modes = JSON.parse(primary.stdout);
+  assert.strictEqual(modes.length, 10);
+  assert.deepStrictEqual(JSON.parse(cli2(['modes', '\\\\.\\DISPLAY2']).stdout), modes);
+
+  const lines = cli2(['--lines', 'modes']).stdout.trim().split('\n');
+  assert.deepStrictEqual(lines, modes.map((mode) => `${mode.width}x${mode.height}@${mode.refreshRate}\t${mode.bitsPerPixel}`));
+
+  const unknown = cli2(['modes', 'nope']);
+  assert.strictEqual(unknown.status, 1);
+  assert.match(unknown.stderr, /^monitorres: /);
+}));
+
+test('capture and restore round-trip through a file and a pipe', ifBuilt(() => {
+  const file = path.join(os.tmpdir(), `monitorres-cli-${process.pid}.topology`);
+  try {
+    assert.strictEqual(cli2(['capture', file]).status, 0);
+    const fromFile = cli2(['restore', file]);
+    assert.strictEqual(fromFile.status, 0, fromFile.stderr);
+    assert.deepStrictEqual(JSON.parse(fromFile.stdout), { changed: [], missing: [] });
+
+    const captured = spawnSync(kCli, ['--simulated=2x10', 'capture']);
+    assert.deepStrictEqual(captured.stdout, fs.readFileSync(file));
+    const fromPipe = cli2(['restore'], captured.stdout);
+    assert.deepStrictEqual(JSON.parse(fromPipe.stdout), { changed: [], missing: [] });
+  } finally {
+    if (fs.existsSync(file)) {
+      fs.unlinkSync(file);
+    }
+  }
+}));
+
+test('restore applies the monitors that differ and reports the missing ones', ifBuilt(() => {
+  const [first, second] = JSON.parse(cli2(['list']).stdout);
+  const blob = topologyBlob([
+    { ...first, orientation: 0 },
+    { ...second, refreshRate: 30, orientation: 0 },
+    { id: '\\\\.\\DISPLAY3', width: 640, height: 360, refreshRate: 60, orientation: 0, x: 1280, y: 0 },
+  ]);
+  const run = cli2(['restore'], blob);
+  assert.strictEqual(run.status, 0, run.stderr);
+  assert.deepStrictEqual(JSON.parse(run.stdout), { changed: [second.id], missing: ['\\\\.\\DISPLAY3'] });
+
+  const damaged = cli2(['restore'], Buffer.from('garbage'));
+  assert.strictEqual(damaged.status, 1);
+  assert.match(damaged.stderr, /^monitorres: invalid topology/);
+}));
@@ -0,0 +1,19 @@
+// Fallback policies of monitorFromPoint and monitorFromRect
+
+const { test, assert, monitorres } = require('../harness');
+
+test('each policy applies to a point outside every monitor', () => {
+  assert.strictEqual(monitorres.monitorFromPoint(-100, -100), -1);
+  assert.strictEqual(monitorres.monitorFromPoint(-100, -100, 'none'), -1);
+  assert.strictEqual(monitorres.monitorFromPoint(-100, -100, 'primary'), 0);
+  assert.strictEqual(monitorres.monitorFromPoint(-100, -100, 'nearest'), 0);
+  assert.strictEqual(monitorres.monitorFromRect({ x: -300, y: -300, width: 100, height: 100 }, 'nearest'), 0);
+});
+
+test('a policy must match in full', () => {
+  for (const policy of ['nearestXYZ', 'primaryX', 'near', '', 'NONE']) {
+    assert.throws(() => monitorres.monitorFromPoint(0, 0, policy), TypeError, policy);
+    assert.throws(() => monitorres.monitorFromRect({ x: 0, y: 0, width: 1, height: 1 }, policy), TypeError, policy);
+  }
+  assert.throws(() => monitorres.monitorFromPoint(0, 0, 1), TypeError);
+});
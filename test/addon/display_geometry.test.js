@@ -0,0 +1,79 @@
+// getDisplayGeometry against simulated monitors with insets, DPIs and EDIDs
+
+const fs = require('fs');
+const path = require('path');
+const { test, assert, monitorres } = require('../harness');
+const { topologyBlob } = require('../fixtures/traces/record');
+
+const kDisplay1 = '\\\\.\\DISPLAY1';
+const kDisplay2 = '\\\\.\\DISPLAY2';
+// 598 x 336 mm, see test/fixtures/edid/generate.js
+const kEdid = new Uint8Array(fs.readFileSync(path.join(__dirname, '..', 'fixtures', 'edid', 'base.bin')));
+
+test('bounds, work areas and DPIs of every monitor', () => {
+  monitorres.useSimulatedBackend({
+    dpi: { x: 96, y: 96 },
+    monitors: [
+      { id: kDisplay1, width: 2560, height: 1440, refreshRate: 144, dpi: { x: 144, y: 144 },
+        workAreaInsets: { bottom: 48 } },
+      { id: kDisplay2, width: 1920, height: 1080, refreshRate: 60, bitsPerPixel: 24, position: { x: -1920, y: 360 },
+        rawDpi: { x: 92, y: 93 }, workAreaInsets: { left: 10, top: 20, right: 30, bottom: 40 } },
+    ],
+  });
+
+  assert.deepStrictEqual(monitorres.getDisplayGeometry(), [
+    { id: kDisplay1, primary: true, x: 0, y: 0, width: 2560, height: 1440,
+      workX: 0, workY: 0, workWidth: 2560, workHeight: 1392,
+      dpiX: 144, dpiY: 144, rawDpiX: 0, rawDpiY: 0, scaleFactor: 1.5,
+      orientation: 0, refreshRate: 144, bitsPerPixel: 32 },
+    { id: kDisplay2, primary: false, x: -1920, y: 360, width: 1920, height: 1080,
+      workX: -1910, workY: 380, workWidth: 1880, workHeight: 1020,
+      dpiX: 96, dpiY: 96, rawDpiX: 92, rawDpiY: 93, scaleFactor: 1,
+      orientation: 0, refreshRate: 60, bitsPerPixel: 24 },
+  ]);
+});
+
+test('insets wider than the monitor leave an empty work area', () => {
+  monitorres.useSimulatedBackend({
+    monitors: [{ width: 1920, height: 1080, refreshRate: 60, workAreaInsets: { left: 1500, right: 1500, top: 2000 } }],
+  });
+  const [geometry] = monitorres.getDisplayGeometry();
+  assert.deepStrictEqual([geometry.workX, geometry.workY, geometry.workWidth, geometry.workHeight], [1500, 1080, 0, 0]);
+});
+
+test('the raw DPI follows the EDID image size, the mode and the rotation', () => {
+  monitorres.useSimulatedBackend({
+    monitors: [{ id: kDisplay1, width: 1920, height: 1200, refreshRate: 60, edid: kEdid, modes: [
+      { width: 1920, height: 1200, refreshRate: 60 }, { width: 1280, height: 800, refreshRate: 60 }] }],
+  });
+  const rawDpi = () => monitorres.getDisplayGeometry().map((monitor) => [monitor.rawDpiX, monitor.rawDpiY])[0];
+
+  // 1920 px over 598 mm and 1200 px over 336 mm
+  assert.deepStrictEqual(rawDpi(), [82, 91]);
+
+  assert.strictEqual(monitorres.setMonitorResolution(kDisplay1, 1280, 800, 60), true);
+  assert.deepStrictEqual(rawDpi(), [54, 60]);
+
+  // Rotated, the 336 mm side runs across
+  const restored = monitorres.restoreTopology(topologyBlob([
+    { id: kDisplay1, width: 1200, height: 1920, refreshRate: 60, orientation: 1, primary: true, x: 0, y: 0 }]));
+  assert.deepStrictEqual(restored.changed, [kDisplay1]);
+  const [geometry] = monitorres.getDisplayGeometry();
+  assert.deepStrictEqual([geometry.width, geometry.height, geometry.orientation], [1200, 1920, 1]);
+  assert.deepStrictEqual(rawDpi(), [91, 82]);
+});
+
+test('a mode change is seen by the next call', () => {
+  monitorres.useSimulatedBackend({
+    monitors: [
+      { id: kDisplay1, width: 1920, height: 1080, refreshRate: 60, modes: [
+        { width: 1920, height: 1080, refreshRate: 60 }, { width: 1280, height: 720, refreshRate: 75 }] },
+      { id: kDisplay2, width: 1920, height: 1080, refreshRate: 60, position: { x: 1920, y: 0 } },
+    ],
+  });
+  assert.deepStrictEqual(monitorres.getDisplayGeometry(), monitorres.getDisplayGeometry());
+
+  assert.strictEqual(monitorres.setMonitorResolution(kDisplay1, 1280, 720, 75), true);
+  const [first] = monitorres.getDisplayGeometry();
+  assert.deepStrictEqual([first.width, first.height, first.refreshRate, first.workWidth], [1280, 720, 75, 1280]);
+});
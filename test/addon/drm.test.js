@@ -0,0 +1,73 @@
+// The DRM backend against the sysfs tree in test/fixtures/drm:
+//
+//   card0-DP-1      connected, enabled, 2560x1440 preferred, DisplayID EDID
+//   card0-DP-2      disconnected, no modes, empty EDID
+//   card0-HDMI-A-1  connected, enabled, an interlaced mode listed, CEA-861 EDID
+//   card0-eDP-1     connected but disabled, as with a closed lid
+//
+// next to the card0 node and version file that are not connectors.
+
+const path = require('path');
+const { test, assert, monitorres } = require('../harness');
+
+const kSysfsRoot = path.join(__dirname, '..', 'fixtures', 'drm');
+
+function resolutions(id) {
+  return monitorres.getAvailableResolutions(id).map((mode) => `${mode.width}x${mode.height}@${mode.refreshRate}`);
+}
+
+// Linux only; elsewhere useDrmBackend throws
+function onLinux(fn) {
+  return () => {
+    if (process.platform !== 'linux') {
+      console.log('    not Linux, skipped');
+      return undefined;
+    }
+    monitorres.useDrmBackend({ sysfsRoot: kSysfsRoot });
+    return fn();
+  };
+}
+
+test('getAllMonitors lists the enabled connected connectors', onLinux(() => {
+  const monitors = monitorres.getAllMonitors();
+  assert.deepStrictEqual(monitors.map((m) => m.id), ['card0-DP-1', 'card0-HDMI-A-1']);
+
+  const [dp, hdmi] = monitors;
+  assert.strictEqual(dp.name, 'DP-1');
+  assert.strictEqual(dp.primaryDevice, true);
+  assert.strictEqual(hdmi.primaryDevice, false);
+  assert.strictEqual(dp.deviceId, 'MONITOR\\GSM5B08');
+  assert.strictEqual(dp.deviceKey, path.join(kSysfsRoot, 'card0-DP-1'));
+  assert.deepStrictEqual(dp.currentSettings, {
+    width: 2560, height: 1440, refreshRate: 0, bitsPerPixel: 32, orientation: 0, position: { x: 0, y: 0 },
+  });
+
+  assert.strictEqual(dp.edid.name, 'TESTMON');
+  assert.deepStrictEqual(dp.edid.timings.map((t) => `${t.width}x${t.height}@${t.refreshRate}`), ['1920x1080@60', '1280x720@60', '2560x1440@144']);
+  assert.deepStrictEqual(hdmi.edid.timings.map((t) => `${t.width}x${t.height}@${t.refreshRate}`), ['1920x1080@60', '1280x720@60']);
+}));
+
+test('getAvailableResolutions lists each mode once without refresh rates', onLinux(() => {
+  assert.deepStrictEqual(resolutions('card0-DP-1'), ['2560x1440@0', '1920x1080@0', '1280x720@0']);
+  // 1920x1080i is the same size as 1920x1080
+  assert.deepStrictEqual(resolutions('card0-HDMI-A-1'), ['1920x1080@0', '1280x720@0', '720x576@0']);
+  assert.deepStrictEqual(resolutions('card0-eDP-1'), ['1920x1200@0']);
+  assert.deepStrictEqual(resolutions('card0-DP-2'), []);
+  // The first active connector stands in for the primary display
+  assert.deepStrictEqual(resolutions(''), resolutions('card0-DP-1'));
+}));
+
+test('getMonitorResolution reports the preferred mode of active connectors', onLinux(() => {
+  assert.deepStrictEqual(monitorres.getMonitorResolution('card0-DP-1'), { width: 2560, height: 1440, refreshRate: 0, bitsPerPixel: 32 });
+  assert.deepStrictEqual(monitorres.getMonitorResolution('card0-HDMI-A-1'), { width: 1920, height: 1080, refreshRate: 0, bitsPerPixel: 32 });
+  assert.deepStrictEqual(monitorres.getMonitorResolution(''), monitorres.getMonitorResolution('card0-DP-1'));
+  for (const id of ['card0-eDP-1', 'card0-DP-2', 'card0-VGA-1']) {
+    assert.throws(() => monitorres.getMonitorResolution(id), /Failed to get display settings/, id);
+  }
+}));
+
+test('mode changes fail, since sysfs is read-only', onLinux(() => {
+  const result = monitorres.setMonitorResolution('card0-DP-1', 1920, 1080);
+  assert.strictEqual(result.code, -1);
+  assert.strictEqual(monitorres.getMonitorResolution('card0-DP-1').width, 2560);
+}));
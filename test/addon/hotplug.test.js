@@ -0,0 +1,42 @@
+// Cached mode lists, layout and geometry after simulated hotplug, without change listeners
+
+const { test, assert, monitorres } = require('../harness');
+
+const kDisplay1 = '\\\\.\\DISPLAY1';
+
+function resolutions(id) {
+  return [...new Set(monitorres.getAvailableResolutions(id).map((mode) => `${mode.width}x${mode.height}`))];
+}
+
+test('reconnecting a monitor refreshes its mode list', () => {
+  monitorres.useSimulatedBackend({
+    monitors: [{ id: kDisplay1, width: 1920, height: 1080, refreshRate: 60, modes: [
+      { width: 1920, height: 1080, refreshRate: 60 }, { width: 1280, height: 720, refreshRate: 60 }] }]
+  });
+  assert.deepStrictEqual(resolutions(kDisplay1), ['1920x1080', '1280x720']);
+
+  monitorres.simulateDisplayChange({
+    connect: { id: kDisplay1, width: 2560, height: 1440, refreshRate: 60, modes: [
+      { width: 2560, height: 1440, refreshRate: 60 }, { width: 1920, height: 1080, refreshRate: 60 },
+      { width: 3840, height: 2160, refreshRate: 60 }] }
+  });
+  assert.deepStrictEqual(resolutions(kDisplay1).sort(), ['1920x1080', '2560x1440', '3840x2160']);
+  assert.strictEqual(monitorres.setMonitorResolution(kDisplay1, 3840, 2160), true);
+});
+
+test('monitorFromPoint sees a hotplugged monitor', () => {
+  assert.strictEqual(monitorres.monitorFromPoint(2000, 10), -1);
+  monitorres.simulateDisplayChange({
+    connect: { id: '\\\\.\\DISPLAY2', width: 1920, height: 1080, refreshRate: 60, position: { x: 1920, y: 0 } }
+  });
+  const index = monitorres.monitorFromPoint(2000, 10);
+  assert.strictEqual(monitorres.getDesktopLayout().monitors[index].id, '\\\\.\\DISPLAY2');
+});
+
+test('getDisplayGeometry sees a hotplugged monitor', () => {
+  assert.strictEqual(monitorres.getDisplayGeometry().length, 1);
+  monitorres.simulateDisplayChange({
+    connect: { id: '\\\\.\\DISPLAY2', width: 1920, height: 1080, refreshRate: 60, position: { x: 1920, y: 0 } }
+  });
+  assert.deepStrictEqual(monitorres.getDisplayGeometry().map((monitor) => monitor.x), [0, 1920]);
+});
@@ -0,0 +1,54 @@
+// getFullInventory against serial getAllMonitors and getAvailableResolutions calls
+
+const { test, assert, monitorres } = require('../harness');
+
+// What the inventory replaces: the monitors, then each mode list in turn
+function serialInventory() {
+  const monitors = monitorres.getAllMonitors();
+  const modes = Object.fromEntries(monitors.map(({ id }) => [id, monitorres.getAvailableResolutions(id)]));
+  return { monitors, modes };
+}
+
+test('the inventory matches serial calls on many monitors', async () => {
+  monitorres.useSimulatedBackend({ monitorCount: 16, modeCount: 1000 });
+
+  const cold = await monitorres.getFullInventory();
+  assert.deepStrictEqual(Object.keys(cold), ['monitors', 'modes']);
+  assert.strictEqual(cold.monitors.length, 16);
+  assert.deepStrictEqual(Object.keys(cold.modes), cold.monitors.map(({ id }) => id));
+
+  const serial = serialInventory();
+  assert.deepStrictEqual(cold, serial);
+
+  // Cached mode lists, and mode lists dropped again
+  assert.deepStrictEqual(await monitorres.getFullInventory(), serial);
+  monitorres.invalidateModeCache();
+  assert.deepStrictEqual(await monitorres.getFullInventory(), serial);
+});
+
+test('concurrent inventories agree', async () => {
+  monitorres.useSimulatedBackend({ monitorCount: 8, modeCount: 200 });
+  const inventories = await Promise.all(Array.from({ length: 4 }, () => monitorres.getFullInventory()));
+  const serial = serialInventory();
+  for (const inventory of inventories) {
+    assert.deepStrictEqual(inventory, serial);
+  }
+});
+
+test('mode lists are read in parallel', async () => {
+  const options = { monitorCount: 8, modeCount: 10, modeListLatencyMs: 25 };
+
+  monitorres.useSimulatedBackend(options);
+  let start = process.hrtime.bigint();
+  const serial = serialInventory();
+  const serialMs = Number(process.hrtime.bigint() - start) / 1e6;
+
+  monitorres.useSimulatedBackend(options);
+  start = process.hrtime.bigint();
+  const inventory = await monitorres.getFullInventory();
+  const inventoryMs = Number(process.hrtime.bigint() - start) / 1e6;
+
+  assert.deepStrictEqual(inventory, serial);
+  assert.ok(serialMs >= 8 * 25, `serial calls took ${serialMs}ms`);
+  assert.ok(inventoryMs < serialMs * 0.75, `inventory took ${inventoryMs}ms, serial calls ${serialMs}ms`);
+});
@@ -0,0 +1,75 @@
+// iterateModes order, batch sizes and early exit
+
+const { test, assert, monitorres } = require('../harness');
+
+const kStats = monitorres.getStats() !== null;
+
+async function collect(iterable) {
+  const modes = [];
+  for await (const mode of iterable) {
+    modes.push(mode);
+  }
+  return modes;
+}
+
+// EnumDisplaySettings calls the simulated backend answered so far
+function modeReads() {
+  return monitorres.getStats().osCalls.EnumDisplaySettings;
+}
+
+test('modes come in getAvailableResolutions order for any batch size', async () => {
+  monitorres.useSimulatedBackend({ monitorCount: 1, modeCount: 1000 });
+  const [{ id }] = monitorres.getAllMonitors();
+
+  // The first pass enumerates through the cursor, later ones read the list
+  // getAvailableResolutions cached
+  monitorres.invalidateModeCache();
+  const enumerated = await collect(monitorres.iterateModes(id, { batchSize: 7 }));
+  const expected = monitorres.getAvailableResolutions(id);
+  assert.strictEqual(expected.length, 1000);
+  assert.deepStrictEqual(enumerated, expected);
+
+  for (const batchSize of [1, 256, 999, 1000, 65536, undefined]) {
+    assert.deepStrictEqual(await collect(monitorres.iterateModes(id, { batchSize })), expected, String(batchSize));
+  }
+  assert.deepStrictEqual(await collect(monitorres.iterateModes(id)), expected);
+
+  assert.deepStrictEqual(await collect(monitorres.iterateModes('\\\\.\\DISPLAY9')), []);
+});
+
+test('batchSize must be an integer from 1 to 65536', async () => {
+  const [{ id }] = monitorres.getAllMonitors();
+  for (const batchSize of [0, -1, 1.5, 65537, NaN, '64', null]) {
+    await assert.rejects(monitorres.iterateModes(id, { batchSize }).next(), TypeError, String(batchSize));
+  }
+  await assert.rejects(monitorres.iterateModes(1).next(), TypeError);
+});
+
+test('leaving the loop stops the enumeration', async () => {
+  if (!kStats) {
+    return;
+  }
+  monitorres.useSimulatedBackend({ monitorCount: 1, modeCount: 1000 });
+  const [{ id }] = monitorres.getAllMonitors();
+  monitorres.invalidateModeCache();
+  monitorres.resetStats();
+
+  let seen = 0;
+  for await (const mode of monitorres.iterateModes(id, { batchSize: 10 })) {
+    assert.ok(mode.width > 0);
+    if (++seen === 15) {
+      break;
+    }
+  }
+
+  // Two batches were read, and the closed cursor reads no more
+  const reads = modeReads();
+  assert.ok(reads >= 15 && reads <= 21, `${reads} reads`);
+  await new Promise((resolve) => setTimeout(resolve, 50));
+  assert.strictEqual(modeReads(), reads);
+
+  // Reading everything takes the whole list
+  monitorres.resetStats();
+  assert.strictEqual((await collect(monitorres.iterateModes(id, { batchSize: 10 }))).length, 1000);
+  assert.ok(modeReads() >= 1000);
+});
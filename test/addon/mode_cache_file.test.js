@@ -0,0 +1,45 @@
+// Mode lists stored with setModeCacheFile and read back
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { test, assert, monitorres } = require('../harness');
+
+const kDisplay1 = '\\\\.\\DISPLAY1';
+
+function removeFile(file) {
+  if (fs.existsSync(file)) {
+    fs.unlinkSync(file);
+  }
+}
+
+test('a stored mode list is read back from the file', () => {
+  const file = path.join(os.tmpdir(), `monitorres-modes-${process.pid}.bin`);
+  try {
+    assert.strictEqual(monitorres.setModeCacheFile(file), false);
+    const modes = monitorres.getAvailableResolutions(kDisplay1);
+    monitorres.setModeCacheFile(null);
+
+    assert.strictEqual(monitorres.setModeCacheFile(file), true);
+    monitorres.invalidateModeCache();
+    assert.deepStrictEqual(monitorres.getAvailableResolutions(kDisplay1), modes);
+    const stats = monitorres.getModeCacheStats().file;
+    assert.strictEqual(stats.entries, 1);
+    assert.strictEqual(stats.hits, 1);
+  } finally {
+    monitorres.setModeCacheFile(null);
+    removeFile(file);
+  }
+});
+
+test('a corrupt file is ignored', () => {
+  const file = path.join(os.tmpdir(), `monitorres-modes-corrupt-${process.pid}.bin`);
+  fs.writeFileSync(file, Buffer.alloc(256, 0xab));
+  try {
+    assert.strictEqual(monitorres.setModeCacheFile(file), false);
+    assert.ok(monitorres.getAvailableResolutions(kDisplay1).length > 0);
+  } finally {
+    monitorres.setModeCacheFile(null);
+    removeFile(file);
+  }
+});
@@ -0,0 +1,143 @@
+// setMonitorResolution validation and error reporting through the addon
+
+const { test, assert, monitorres } = require('../harness');
+
+const kDispChangeBadMode = -2;
+
+test('applies a listed mode', () => {
+  assert.strictEqual(monitorres.setMonitorResolution('\\\\.\\DISPLAY1', 1280, 720, 60), true);
+  assert.deepStrictEqual(
+    [monitorres.getMonitorResolution('\\\\.\\DISPLAY1').width, monitorres.getMonitorResolution('\\\\.\\DISPLAY1').height],
+    [1280, 720]
+  );
+});
+
+test('reports the closest refresh rate it used', () => {
+  const result = monitorres.setMonitorResolution('\\\\.\\DISPLAY1', 1920, 1080, 70);
+  assert.strictEqual(result.success, true);
+  assert.strictEqual(result.actualRefreshRate, 75);
+});
+
+test('rejects an unlisted resolution with BADMODE', () => {
+  const result = monitorres.setMonitorResolution('\\\\.\\DISPLAY1', 1000, 700);
+  assert.strictEqual(result.code, kDispChangeBadMode);
+  assert.match(result.message, /not supported/);
+});
+
+test('async requests settle with the same results', async () => {
+  assert.strictEqual(await monitorres.setMonitorResolutionAsync('\\\\.\\DISPLAY1', 1600, 900, 60), true);
+  const result = await monitorres.setMonitorResolutionAsync('\\\\.\\DISPLAY1', 1000, 700);
+  assert.strictEqual(result.code, kDispChangeBadMode);
+});
+
+test('a coalesced async request keeps its result when a later one is rejected', async () => {
+  monitorres.setModeChangeCoalescing(100);
+  try {
+    const pending = monitorres.setMonitorResolutionAsync('\\\\.\\DISPLAY1', 1280, 720);
+    const rejected = monitorres.setMonitorResolution('\\\\.\\DISPLAY1', 1000, 700);
+    assert.strictEqual(rejected.code, kDispChangeBadMode);
+    assert.strictEqual(await pending, true);
+    assert.strictEqual(monitorres.getMonitorResolution('\\\\.\\DISPLAY1').width, 1280);
+  } finally {
+    monitorres.setModeChangeCoalescing(0);
+  }
+});
+
+test('pending async requests leave the libuv thread pool free', async () => {
+  const fs = require('fs');
+  monitorres.setModeChangeCoalescing(1000);
+  try {
+    // More than the pool's four threads, all waiting out the coalescing window
+    const changes = Array.from({ length: 8 }, () => monitorres.setMonitorResolutionAsync('\\\\.\\DISPLAY1', 1280, 720));
+    const start = Date.now();
+    await fs.promises.stat(__filename);
+    assert.ok(Date.now() - start < 500, `fs.promises.stat took ${Date.now() - start}ms`);
+    assert.deepStrictEqual(await Promise.all(changes), Array(8).fill(true));
+  } finally {
+    monitorres.setModeChangeCoalescing(0);
+  }
+});
+
+function delay(milliseconds) {
+  return new Promise((resolve) => setTimeout(resolve, milliseconds));
+}
+
+async function rejection(promise) {
+  try {
+    await promise;
+  } catch (err) {
+    return err;
+  }
+  assert.fail('expected the promise to reject');
+}
+
+function width() {
+  return monitorres.getMonitorResolution('\\\\.\\DISPLAY1').width;
+}
+
+test('a timeout drops a change that has not started', async () => {
+  monitorres.setModeChangeCoalescing(300);
+  try {
+    const withdrawn = monitorres.getModeChangeStats().withdrawn;
+    const err = await rejection(monitorres.setMonitorResolutionAsync('\\\\.\\DISPLAY1', 1280, 720, 60, { timeout: 50 }));
+    assert.strictEqual(err.code, 'ETIMEDOUT');
+    assert.strictEqual(monitorres.getModeChangeStats().withdrawn, withdrawn + 1);
+    await delay(400);
+    assert.strictEqual(width(), 1920);
+  } finally {
+    monitorres.setModeChangeCoalescing(0);
+  }
+});
+
+test('a timeout rejects during the mode-set, which completes in the background', async () => {
+  monitorres.useSimulatedBackend({ applyLatencyMs: 500 });
+  const start = Date.now();
+  const err = await rejection(monitorres.setMonitorResolutionAsync('\\\\.\\DISPLAY1', 1280, 720, 60, { timeout: 100 }));
+  assert.strictEqual(err.code, 'ETIMEDOUT');
+  assert.ok(Date.now() - start < 400, `rejected after ${Date.now() - start}ms`);
+  await delay(600);
+  assert.strictEqual(width(), 1280);
+});
+
+test('an aborted signal drops the change', async () => {
+  const controller = new AbortController();
+  controller.abort();
+  const err = await rejection(monitorres.setMonitorResolutionAsync('\\\\.\\DISPLAY1', 1280, 720, 60, { signal: controller.signal }));
+  assert.strictEqual(err.name, 'AbortError');
+  assert.strictEqual(err.code, 'ABORT_ERR');
+  await delay(50);
+  assert.strictEqual(width(), 1920);
+});
+
+test('aborting rejects during the mode-set, which completes in the background', async () => {
+  monitorres.useSimulatedBackend({ applyLatencyMs: 500 });
+  const controller = new AbortController();
+  const start = Date.now();
+  const pending = rejection(monitorres.setMonitorResolutionAsync('\\\\.\\DISPLAY1', 1280, 720, 60, { signal: controller.signal }));
+  await delay(100);
+  controller.abort();
+  const err = await pending;
+  assert.strictEqual(err.code, 'ABORT_ERR');
+  assert.ok(Date.now() - start < 400, `rejected after ${Date.now() - start}ms`);
+  await delay(600);
+  assert.strictEqual(width(), 1280);
+});
+
+// A timer left behind would keep this file's process alive for a minute
+test('a change that finishes in time clears its timeout', async () => {
+  const start = Date.now();
+  assert.strictEqual(await monitorres.setMonitorResolutionAsync('\\\\.\\DISPLAY1', 1280, 720, 60, { timeout: 60000, signal: new AbortController().signal }), true);
+  assert.ok(Date.now() - start < 1000);
+});
+
+test('setMonitorResolution stores a mode setAllScreenResolutions only applied', () => {
+  const stats = () => monitorres.getModeChangeStats();
+  assert.strictEqual(monitorres.setAllScreenResolutions(1280, 720), true);
+  const before = stats();
+  assert.strictEqual(monitorres.setMonitorResolution('\\\\.\\DISPLAY1', 1280, 720), true);
+  assert.strictEqual(stats().applied, before.applied + 1);
+  assert.strictEqual(stats().unchanged, before.unchanged);
+  assert.strictEqual(monitorres.setMonitorResolution('\\\\.\\DISPLAY1', 1280, 720), true);
+  assert.strictEqual(stats().applied, before.applied + 1);
+  assert.strictEqual(stats().unchanged, before.unchanged + 1);
+});
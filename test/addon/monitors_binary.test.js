@@ -0,0 +1,118 @@
+// getAllMonitorsBinary written natively and read back with decodeMonitorsBinary
+
+const fs = require('fs');
+const path = require('path');
+const { test, assert, monitorres } = require('../harness');
+
+const kEdid = fs.readFileSync(path.join(__dirname, '..', 'fixtures', 'edid', 'displayid.bin'));
+
+function useThreeMonitors() {
+  monitorres.useSimulatedBackend({
+    monitors: [
+      { width: 2560, height: 1440, refreshRate: 144, edid: new Uint8Array(kEdid) },
+      { width: 1920, height: 1080, refreshRate: 60, position: { x: 2560, y: 0 }, name: 'Zweiter Bildschirm ü' },
+      { width: 1920, height: 1080, refreshRate: 60, position: { x: -1920, y: 0 } },
+    ],
+  });
+}
+
+// getAllMonitors without the EDID timings, which the binary layout leaves out
+function expectedMonitors() {
+  return monitorres.getAllMonitors().map((monitor) => {
+    if (monitor.edid) {
+      const { timings, ...edid } = monitor.edid;
+      return { ...monitor, edid };
+    }
+    return monitor;
+  });
+}
+
+// Header fields, see the README
+function header(buffer) {
+  const view = new DataView(buffer);
+  return {
+    count: view.getUint32(8, true),
+    recordSize: view.getUint32(12, true),
+    recordsOffset: view.getUint32(16, true),
+    stringsOffset: view.getUint32(20, true),
+    totalSize: view.getUint32(24, true),
+  };
+}
+
+test('decoding reproduces getAllMonitors', () => {
+  useThreeMonitors();
+  const inventory = monitorres.decodeMonitorsBinary(monitorres.getAllMonitorsBinary());
+  assert.strictEqual(inventory.length, 3);
+  assert.deepStrictEqual(inventory.toArray(), expectedMonitors());
+  assert.deepStrictEqual([...inventory].map((monitor) => monitor.toJSON()), expectedMonitors());
+  assert.strictEqual(inventory.at(3), undefined);
+  assert.strictEqual(inventory.at(0).edid.name, 'TESTMON');
+  assert.strictEqual(inventory.at(1).edid, null);
+  assert.strictEqual(inventory.at(2).currentSettings.position.x, -1920);
+});
+
+test('a typed array over part of a larger buffer decodes', () => {
+  useThreeMonitors();
+  const buffer = new Uint8Array(monitorres.getAllMonitorsBinary());
+  const larger = new Uint8Array(buffer.length + 16);
+  larger.set(buffer, 8);
+  const inventory = monitorres.decodeMonitorsBinary(larger.subarray(8, 8 + buffer.length));
+  assert.deepStrictEqual(inventory.toArray(), expectedMonitors());
+});
+
+test('records longer than the reader knows are stepped over', () => {
+  useThreeMonitors();
+  const buffer = monitorres.getAllMonitorsBinary();
+  const { count, recordSize, recordsOffset, stringsOffset, totalSize } = header(buffer);
+  const source = new Uint8Array(buffer);
+  const padded = new Uint8Array(totalSize + 4 * count);
+  padded.set(source.subarray(0, recordsOffset));
+  for (let i = 0; i < count; i++) {
+    padded.set(source.subarray(recordsOffset + i * recordSize, recordsOffset + (i + 1) * recordSize), recordsOffset + i * (recordSize + 4));
+  }
+  padded.set(source.subarray(stringsOffset), stringsOffset + 4 * count);
+  const view = new DataView(padded.buffer);
+  view.setUint32(12, recordSize + 4, true);
+  view.setUint32(20, stringsOffset + 4 * count, true);
+  view.setUint32(24, totalSize + 4 * count, true);
+  assert.deepStrictEqual(monitorres.decodeMonitorsBinary(padded).toArray(), expectedMonitors());
+});
+
+test('damaged buffers are rejected', () => {
+  useThreeMonitors();
+  const buffer = new Uint8Array(monitorres.getAllMonitorsBinary());
+
+  assert.throws(() => monitorres.decodeMonitorsBinary(buffer.subarray(0, 16)));
+  assert.throws(() => monitorres.decodeMonitorsBinary(buffer.subarray(0, buffer.length - 1)));
+
+  const magic = buffer.slice();
+  magic[0] = 0;
+  assert.throws(() => monitorres.decodeMonitorsBinary(magic));
+
+  const version = buffer.slice();
+  new DataView(version.buffer).setUint16(4, 2, true);
+  assert.throws(() => monitorres.decodeMonitorsBinary(version));
+});
+
+test('the buffer survives a transfer to another thread', async () => {
+  const { Worker } = require('worker_threads');
+  useThreeMonitors();
+  const buffer = monitorres.getAllMonitorsBinary();
+  const expected = expectedMonitors();
+  const worker = new Worker(`
+    const { parentPort } = require('worker_threads');
+    const monitorres = require(${JSON.stringify(path.join(__dirname, '..', '..'))});
+    parentPort.once('message', (buffer) => parentPort.postMessage(monitorres.decodeMonitorsBinary(buffer).toArray()));
+  `, { eval: true });
+  try {
+    const decoded = new Promise((resolve, reject) => {
+      worker.once('message', resolve);
+      worker.once('error', reject);
+    });
+    worker.postMessage(buffer, [buffer]);
+    assert.strictEqual(buffer.byteLength, 0);
+    assert.deepStrictEqual(await decoded, expected);
+  } finally {
+    await worker.terminate();
+  }
+});
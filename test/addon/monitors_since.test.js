@@ -0,0 +1,87 @@
+// getMonitorsSince across hotplug, mode changes and generations it does not know
+
+const { test, assert, monitorres } = require('../harness');
+
+const kDisplay1 = '\\\\.\\DISPLAY1';
+const kDisplay2 = '\\\\.\\DISPLAY2';
+
+// The generation of the monitors as they are now
+function current() {
+  return monitorres.getMonitorsSince(0).generation;
+}
+
+function monitor(id) {
+  return monitorres.getAllMonitors().find((entry) => entry.id === id);
+}
+
+test('an unchanged generation returns null', () => {
+  const all = monitorres.getMonitorsSince(0);
+  assert.strictEqual(all.full, true);
+  assert.deepStrictEqual(all.added, monitorres.getAllMonitors());
+  assert.deepStrictEqual(all.removed, []);
+  assert.deepStrictEqual(all.changed, []);
+
+  assert.strictEqual(monitorres.getMonitorsSince(all.generation), null);
+  assert.strictEqual(monitorres.getMonitorsSince(all.generation), null);
+  assert.strictEqual(monitorres.getMonitorsSince(0).generation, all.generation);
+});
+
+test('a hotplugged monitor is added, then removed', () => {
+  const before = current();
+  monitorres.simulateDisplayChange({ connect: { id: kDisplay2, width: 1280, height: 1024, refreshRate: 60, position: { x: 1920, y: 0 } } });
+
+  const connected = monitorres.getMonitorsSince(before);
+  assert.ok(connected.generation > before);
+  assert.strictEqual(connected.full, false);
+  assert.deepStrictEqual(connected.added, [monitor(kDisplay2)]);
+  assert.deepStrictEqual(connected.removed, []);
+  assert.deepStrictEqual(connected.changed, []);
+  assert.strictEqual(monitorres.getMonitorsSince(connected.generation), null);
+
+  monitorres.simulateDisplayChange({ disconnect: kDisplay2 });
+  const disconnected = monitorres.getMonitorsSince(connected.generation);
+  assert.ok(disconnected.generation > connected.generation);
+  assert.strictEqual(disconnected.full, false);
+  assert.deepStrictEqual(disconnected.added, []);
+  assert.deepStrictEqual(disconnected.removed, [kDisplay2]);
+  assert.deepStrictEqual(disconnected.changed, []);
+
+  // Both steps at once from the generation before them
+  const both = monitorres.getMonitorsSince(before);
+  assert.strictEqual(both.full, false);
+  assert.deepStrictEqual([both.added, both.removed, both.changed], [[], [], []]);
+});
+
+test('a mode change reports the monitor as changed', () => {
+  const before = current();
+  assert.strictEqual(monitorres.setMonitorResolution(kDisplay1, 1280, 720), true);
+
+  const changes = monitorres.getMonitorsSince(before);
+  assert.strictEqual(changes.full, false);
+  assert.deepStrictEqual(changes.added, []);
+  assert.deepStrictEqual(changes.removed, []);
+  assert.deepStrictEqual(changes.changed, [monitor(kDisplay1)]);
+  assert.strictEqual(changes.changed[0].currentSettings.width, 1280);
+  assert.strictEqual(changes.changed[0].currentSettings.height, 720);
+});
+
+test('a stale or future generation returns every monitor', () => {
+  const stale = current();
+  // More changes than the history keeps
+  for (let i = 0; i < 20; i++) {
+    assert.strictEqual(monitorres.setMonitorResolution(kDisplay1, i % 2 ? 1920 : 1280, i % 2 ? 1080 : 720), true);
+    current();
+  }
+
+  const latest = current();
+  for (const generation of [stale, latest + 1000]) {
+    const changes = monitorres.getMonitorsSince(generation);
+    assert.strictEqual(changes.generation, latest);
+    assert.strictEqual(changes.full, true);
+    assert.deepStrictEqual(changes.added, monitorres.getAllMonitors());
+    assert.deepStrictEqual(changes.removed, []);
+    assert.deepStrictEqual(changes.changed, []);
+  }
+
+  assert.throws(() => monitorres.getMonitorsSince('1'), TypeError);
+});
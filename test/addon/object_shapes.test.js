@@ -0,0 +1,83 @@
+// Field projections of getAllMonitors and the keys of the shaped result objects
+
+const { test, assert, monitorres } = require('../harness');
+
+// The monitors of the default simulated backend reduced to the listed paths
+function project(monitors, paths) {
+  return monitors.map((monitor) => {
+    const result = {};
+    for (const path of paths) {
+      const [field, nested] = path.split('.');
+      if (nested === undefined) {
+        result[field] = monitor[field];
+      } else {
+        result[field] = result[field] || {};
+        result[field][nested] = monitor[field][nested];
+      }
+    }
+    return result;
+  });
+}
+
+test('fields builds only the projected keys', () => {
+  monitorres.useSimulatedBackend({ monitorCount: 3, modeCount: 10 });
+  const monitors = monitorres.getAllMonitors();
+
+  const paths = ['id', 'currentSettings.width', 'currentSettings.height'];
+  const projected = monitorres.getAllMonitors({ fields: paths });
+  assert.strictEqual(projected.length, monitors.length);
+  for (const monitor of projected) {
+    assert.deepStrictEqual(Object.keys(monitor), ['id', 'currentSettings']);
+    assert.deepStrictEqual(Object.keys(monitor.currentSettings), ['width', 'height']);
+  }
+  assert.deepStrictEqual(projected, project(monitors, paths));
+
+  // Keys come in declaration order whatever the order of the list
+  const reordered = monitorres.getAllMonitors({ fields: ['currentSettings.height', 'primaryDevice', 'name'] });
+  assert.deepStrictEqual(Object.keys(reordered[0]), ['name', 'primaryDevice', 'currentSettings']);
+  assert.deepStrictEqual(reordered, project(monitors, ['name', 'primaryDevice', 'currentSettings.height']));
+
+  // The same list again reuses its constructor and builds the same objects
+  assert.deepStrictEqual(monitorres.getAllMonitors({ fields: paths }), projected);
+});
+
+test('a path to a nested object selects all of it', () => {
+  const [monitor] = monitorres.getAllMonitors();
+
+  const [position] = monitorres.getAllMonitors({ fields: ['currentSettings.position'] });
+  assert.deepStrictEqual(Object.keys(position), ['currentSettings']);
+  assert.deepStrictEqual(position.currentSettings, { position: monitor.currentSettings.position });
+
+  const [x] = monitorres.getAllMonitors({ fields: ['currentSettings.position.x'] });
+  assert.deepStrictEqual(x, { currentSettings: { position: { x: monitor.currentSettings.position.x } } });
+
+  const [settings] = monitorres.getAllMonitors({ fields: ['currentSettings'] });
+  assert.deepStrictEqual(settings, { currentSettings: monitor.currentSettings });
+
+  const [edid] = monitorres.getAllMonitors({ fields: ['edid'] });
+  assert.deepStrictEqual(edid, { edid: monitor.edid });
+});
+
+test('fields must name known paths', () => {
+  for (const fields of [['nope'], ['currentSettings.nope'], ['id.width'], ['currentSettings.position.z'], ['edid.nope'], 'id', [1]]) {
+    assert.throws(() => monitorres.getAllMonitors({ fields }), TypeError, JSON.stringify(fields));
+  }
+});
+
+test('shaped results keep their keys', () => {
+  const [monitor] = monitorres.getAllMonitors();
+
+  assert.deepStrictEqual(Object.keys(monitorres.getAvailableResolutionsPacked(monitor.id)), ['count', 'width', 'height', 'refreshRate', 'bitsPerPixel']);
+  assert.deepStrictEqual(Object.keys(monitorres.getSystemDPI()), ['x', 'y']);
+
+  const layout = monitorres.getDesktopLayout();
+  assert.deepStrictEqual(Object.keys(layout), ['generation', 'bounds', 'primary', 'monitors']);
+  assert.deepStrictEqual(Object.keys(layout.bounds), ['x', 'y', 'width', 'height']);
+  assert.deepStrictEqual(Object.keys(layout.monitors[0]), ['x', 'y', 'width', 'height', 'id', 'primary']);
+  assert.strictEqual(layout.monitors[0].id, monitor.id);
+
+  assert.deepStrictEqual(Object.keys(monitorres.getModeChangeStats()), ['requests', 'applied', 'unchanged', 'coalesced', 'withdrawn', 'elided']);
+  assert.deepStrictEqual(Object.keys(monitorres.getModeCacheStats()), ['hits', 'misses', 'coalesced', 'invalidations', 'entries', 'file']);
+  assert.strictEqual(monitorres.getModeCacheStats().file, null);
+  assert.deepStrictEqual(Object.keys(monitorres.getSimulatedBackendStats()), ['modeSets', 'stagedModes', 'commits']);
+});
@@ -0,0 +1,89 @@
+// getAvailableResolutionsPacked against getAvailableResolutions
+
+const { test, assert, monitorres } = require('../harness');
+
+const kColumns = ['width', 'height', 'refreshRate', 'bitsPerPixel'];
+
+// The packed columns as one object per mode
+function unpack(packed) {
+  return Array.from({ length: packed.count }, (_, i) =>
+    Object.fromEntries(kColumns.map((column) => [column, packed[column][i]]))
+  );
+}
+
+function compareModes(a, b) {
+  for (const column of kColumns) {
+    if (a[column] !== b[column]) {
+      return a[column] - b[column];
+    }
+  }
+  return 0;
+}
+
+test('the columns hold the sorted mode list', () => {
+  monitorres.useSimulatedBackend({ monitorCount: 2, modeCount: 1000 });
+  for (const { id } of monitorres.getAllMonitors()) {
+    const packed = monitorres.getAvailableResolutionsPacked(id);
+    const modes = monitorres.getAvailableResolutions(id);
+
+    assert.strictEqual(packed.count, modes.length);
+    for (const column of kColumns) {
+      assert.ok(packed[column] instanceof Uint32Array, column);
+      assert.strictEqual(packed[column].length, packed.count, column);
+      assert.strictEqual(packed[column].buffer, packed.width.buffer, column);
+    }
+    assert.deepStrictEqual(unpack(packed), modes.slice().sort(compareModes));
+  }
+});
+
+test('modes that differ only in bit depth are listed separately', () => {
+  monitorres.useSimulatedBackend({
+    monitors: [{
+      width: 1920,
+      height: 1080,
+      refreshRate: 60,
+      modes: [
+        { width: 1920, height: 1080, refreshRate: 60 },
+        { width: 1920, height: 1080, refreshRate: 60, bitsPerPixel: 16 },
+        { width: 1280, height: 720, refreshRate: 75, bitsPerPixel: 24 },
+      ],
+    }],
+  });
+  const [{ id }] = monitorres.getAllMonitors();
+
+  assert.deepStrictEqual(unpack(monitorres.getAvailableResolutionsPacked(id)), [
+    { width: 1280, height: 720, refreshRate: 75, bitsPerPixel: 24 },
+    { width: 1920, height: 1080, refreshRate: 60, bitsPerPixel: 16 },
+    { width: 1920, height: 1080, refreshRate: 60, bitsPerPixel: 32 },
+  ]);
+  assert.deepStrictEqual(monitorres.getAvailableResolutions(id), [
+    { width: 1920, height: 1080, refreshRate: 60, bitsPerPixel: 32 },
+    { width: 1280, height: 720, refreshRate: 75, bitsPerPixel: 24 },
+  ]);
+});
+
+test('an unknown or unplugged monitor has empty columns', () => {
+  for (const unknown of ['\\\\.\\DISPLAY9', '']) {
+    const packed = monitorres.getAvailableResolutionsPacked(unknown);
+    assert.strictEqual(packed.count, monitorres.getAvailableResolutions(unknown).length, unknown);
+  }
+
+  const empty = monitorres.getAvailableResolutionsPacked('\\\\.\\DISPLAY9');
+  assert.strictEqual(empty.count, 0);
+  for (const column of kColumns) {
+    assert.ok(empty[column] instanceof Uint32Array, column);
+    assert.strictEqual(empty[column].length, 0, column);
+  }
+
+  const id = '\\\\.\\DISPLAY2';
+  monitorres.simulateDisplayChange({ connect: { id, width: 1280, height: 1024, refreshRate: 60, position: { x: 1920, y: 0 } } });
+  assert.strictEqual(monitorres.getAvailableResolutionsPacked(id).count, 1);
+  monitorres.simulateDisplayChange({ disconnect: id });
+  assert.strictEqual(monitorres.getAvailableResolutionsPacked(id).count, 0);
+  assert.deepStrictEqual(monitorres.getAvailableResolutions(id), []);
+});
+
+test('the monitor ID must be a string', () => {
+  assert.throws(() => monitorres.getAvailableResolutionsPacked(), TypeError);
+  assert.throws(() => monitorres.getAvailableResolutionsPacked(1), TypeError);
+});
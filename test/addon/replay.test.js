@@ -0,0 +1,50 @@
+// Replays the traces in test/fixtures/traces and compares what the exports
+// return with what they returned while the trace was recorded
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { test, assert, monitorres } = require('../harness');
+const { scenarios } = require('../fixtures/traces/record');
+
+const kTraces = path.join(__dirname, '..', 'fixtures', 'traces');
+
+for (const [name, scenario] of Object.entries(scenarios)) {
+  test(`replaying ${name} reproduces its results`, () => {
+    const expected = JSON.parse(fs.readFileSync(path.join(kTraces, `${name}.json`), 'utf8'));
+    monitorres.useReplayBackend(path.join(kTraces, `${name}.trace`));
+    const results = JSON.parse(JSON.stringify(scenario.run(monitorres, false)));
+    assert.deepStrictEqual(results, expected);
+    assert.strictEqual(monitorres.getReplayBackendStats().unanswered, 0);
+  });
+}
+
+// Write a copy of a trace with edits to a temporary file
+function withEditedTrace(name, edit, fn) {
+  const file = path.join(os.tmpdir(), `monitorres-${process.pid}-${name}`);
+  fs.writeFileSync(file, edit(fs.readFileSync(path.join(kTraces, name))));
+  try {
+    fn(file);
+  } finally {
+    fs.unlinkSync(file);
+  }
+}
+
+test('a trace of another version is rejected', () => {
+  const version = (trace) => {
+    trace.writeUInt32LE(2, 8);
+    return trace;
+  };
+  withEditedTrace('multi_monitor.trace', version, (file) => {
+    assert.throws(() => monitorres.useReplayBackend(file), /Unsupported trace version 2/);
+  });
+});
+
+test('a trace cut off partway through a record keeps the records before it', () => {
+  monitorres.useReplayBackend(path.join(kTraces, 'hotplug.trace'));
+  const { records } = monitorres.getReplayBackendStats();
+  withEditedTrace('hotplug.trace', (trace) => trace.subarray(0, trace.length - 1), (file) => {
+    monitorres.useReplayBackend(file);
+    assert.strictEqual(monitorres.getReplayBackendStats().records, records - 1);
+  });
+});
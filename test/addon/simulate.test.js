@@ -0,0 +1,38 @@
+// Raw display messages sent by simulateDisplayChange, as counted by on('change')
+
+const { test, assert, monitorres } = require('../harness');
+
+const kDisplay2 = '\\\\.\\DISPLAY2';
+
+function nextChange() {
+  return new Promise((resolve) => {
+    const listener = (event) => {
+      monitorres.off('change', listener);
+      resolve(event);
+    };
+    monitorres.on('change', listener);
+  });
+}
+
+async function signalsOf(change) {
+  monitorres.setDisplayChangeCoalescing(10);
+  try {
+    const event = nextChange();
+    monitorres.simulateDisplayChange(change);
+    return (await event).signals;
+  } finally {
+    monitorres.setDisplayChangeCoalescing(250);
+  }
+}
+
+const kMonitor2 = { id: kDisplay2, width: 1920, height: 1080, refreshRate: 60, position: { x: 1920, y: 0 } };
+
+test('a hotplug sends one raw message besides its device change', async () => {
+  assert.strictEqual(await signalsOf({ connect: kMonitor2 }), 2);
+  assert.strictEqual(await signalsOf({ disconnect: kDisplay2 }), 2);
+});
+
+test('signals overrides the raw message count', async () => {
+  assert.strictEqual(await signalsOf({ connect: kMonitor2, signals: 0 }), 1);
+  assert.strictEqual(await signalsOf({ disconnect: kDisplay2, signals: 3 }), 4);
+});
@@ -0,0 +1,115 @@
+// getStats/resetStats counters and the trace startTrace/stopTrace records
+
+const { test, assert, monitorres } = require('../harness');
+
+const kDisplay1 = '\\\\.\\DISPLAY1';
+// Builds made with --monitorres_stats=0 have no instrumentation
+const kStats = monitorres.getStats() !== null;
+
+function checkHistogram(histogram, name) {
+  assert.ok(histogram.count > 0, name);
+  assert.strictEqual(histogram.buckets.reduce((sum, [, count]) => sum + count, 0), histogram.count, name);
+  assert.ok(histogram.p50Ns <= histogram.p90Ns && histogram.p90Ns <= histogram.p99Ns && histogram.p99Ns <= histogram.maxNs, name);
+  assert.ok(histogram.totalNs >= histogram.maxNs, name);
+}
+
+test('without stats support the calls are inert', () => {
+  if (kStats) {
+    return;
+  }
+  monitorres.resetStats();
+  assert.strictEqual(monitorres.getStats(), null);
+  assert.strictEqual(monitorres.startTrace(), false);
+  assert.strictEqual(monitorres.stopTrace(), null);
+});
+
+test('calls add to the export histograms and OS call counters', () => {
+  if (!kStats) {
+    return;
+  }
+  monitorres.resetStats();
+  monitorres.invalidateModeCache();
+  monitorres.getAllMonitors();
+  monitorres.getAvailableResolutions(kDisplay1);
+
+  const first = monitorres.getStats();
+  assert.strictEqual(first.exports.getAllMonitors.count, 1);
+  assert.strictEqual(first.exports.getAvailableResolutions.count, 1);
+  for (const name of Object.keys(first.exports)) {
+    checkHistogram(first.exports[name], name);
+  }
+  checkHistogram(first.phases.enumerateModes, 'enumerateModes');
+  assert.ok(first.osCalls.EnumDisplayDevices > 0);
+  assert.ok(first.osCalls.EnumDisplaySettings > 0);
+  assert.strictEqual(first.osCalls.ChangeDisplaySettingsEx, 0);
+  assert.ok(first.jsObjects > 0);
+
+  assert.strictEqual(monitorres.setMonitorResolution(kDisplay1, 1280, 720), true);
+  monitorres.getAllMonitors();
+  const second = monitorres.getStats();
+  assert.strictEqual(second.exports.getAllMonitors.count, 2);
+  assert.strictEqual(second.exports.setMonitorResolution.count, 1);
+  assert.ok(second.osCalls.EnumDisplayDevices > first.osCalls.EnumDisplayDevices);
+  assert.strictEqual(second.osCalls.ChangeDisplaySettingsEx, 1);
+  assert.ok(second.jsObjects > first.jsObjects);
+});
+
+test('resetStats zeroes every counter', () => {
+  if (!kStats) {
+    return;
+  }
+  monitorres.getAllMonitors();
+  monitorres.resetStats();
+
+  const stats = monitorres.getStats();
+  assert.deepStrictEqual(stats.exports, {});
+  assert.deepStrictEqual(stats.phases, {});
+  for (const [name, count] of Object.entries(stats.osCalls)) {
+    assert.strictEqual(count, 0, name);
+  }
+  assert.strictEqual(stats.jsObjects, 0);
+  assert.strictEqual(stats.tracing, false);
+});
+
+test('a trace is Chrome trace JSON of the calls it saw', () => {
+  if (!kStats) {
+    return;
+  }
+  assert.strictEqual(monitorres.startTrace(), true);
+  assert.strictEqual(monitorres.getStats().tracing, true);
+  monitorres.invalidateModeCache();
+  monitorres.getAvailableResolutions(kDisplay1);
+  const trace = JSON.parse(monitorres.stopTrace());
+  assert.strictEqual(monitorres.getStats().tracing, false);
+  assert.strictEqual(monitorres.stopTrace(), null);
+
+  assert.ok(Array.isArray(trace.traceEvents));
+  assert.strictEqual(trace.otherData.droppedEvents, 0);
+  for (const event of trace.traceEvents) {
+    assert.strictEqual(event.ph, 'X');
+    assert.strictEqual(typeof event.name, 'string');
+    assert.ok(event.ts >= 0 && event.dur >= 0, event.name);
+  }
+
+  // The phase nests inside the export that ran it
+  const call = trace.traceEvents.find((event) => event.name === 'getAvailableResolutions');
+  const phase = trace.traceEvents.find((event) => event.name === 'enumerateModes');
+  assert.ok(call && phase);
+  assert.ok(phase.ts >= call.ts && phase.ts + phase.dur <= call.ts + call.dur + 0.001);
+});
+
+test('maxEvents caps the trace and counts the rest', () => {
+  if (!kStats) {
+    return;
+  }
+  monitorres.startTrace({ maxEvents: 3 });
+  for (let i = 0; i < 10; i++) {
+    monitorres.getAllMonitors();
+  }
+  const trace = JSON.parse(monitorres.stopTrace());
+  assert.strictEqual(trace.traceEvents.length, 3);
+  assert.ok(trace.otherData.droppedEvents >= 7);
+
+  assert.throws(() => monitorres.startTrace({ maxEvents: -1 }), TypeError);
+  assert.strictEqual(monitorres.stopTrace(), null);
+});
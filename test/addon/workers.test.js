@@ -0,0 +1,81 @@
+// The read exports, cache invalidation and backend swaps from many
+// worker_threads at once, against one shared simulated backend
+
+const path = require('path');
+const { Worker } = require('worker_threads');
+const { test, assert, monitorres } = require('../harness');
+
+const kTopology = { monitorCount: 4, modeCount: 50 };
+const kWorkers = 6;
+const kRounds = 200;
+
+// Each worker checks every result against the lists the main thread read,
+// invalidates the mode cache now and then, and the first two also swap in
+// fresh simulated backends with the same topology
+const kWorkerSource = `
+  const assert = require('assert');
+  const { parentPort, workerData } = require('worker_threads');
+  const monitorres = require(workerData.addon);
+  const { index, rounds, topology, ids, modes } = workerData;
+
+  for (let round = 0; round < rounds; round++) {
+    assert.deepStrictEqual(monitorres.getAllMonitors().map((monitor) => monitor.id), ids);
+    const id = ids[(index + round) % ids.length];
+    assert.deepStrictEqual(monitorres.getAvailableResolutions(id), modes[id]);
+    if (round % 10 === index) {
+      monitorres.invalidateModeCache(round % 20 === index ? undefined : id);
+    }
+    if (index < 2 && round % 25 === 0) {
+      monitorres.useSimulatedBackend(topology);
+    }
+  }
+  parentPort.postMessage(rounds);
+`;
+
+function runWorker(workerData) {
+  return new Promise((resolve, reject) => {
+    const worker = new Worker(kWorkerSource, { eval: true, workerData });
+    let rounds = 0;
+    worker.on('message', (message) => {
+      rounds = message;
+    });
+    worker.on('error', reject);
+    worker.on('exit', (code) => resolve({ code, rounds }));
+  });
+}
+
+test('workers read, invalidate and swap backends at once', async () => {
+  monitorres.useSimulatedBackend(kTopology);
+  const ids = monitorres.getAllMonitors().map((monitor) => monitor.id);
+  const modes = Object.fromEntries(ids.map((id) => [id, monitorres.getAvailableResolutions(id)]));
+  assert.strictEqual(ids.length, kTopology.monitorCount);
+
+  const results = await Promise.all(Array.from({ length: kWorkers }, (_, index) => runWorker({
+    addon: path.join(__dirname, '..', '..'),
+    index,
+    rounds: kRounds,
+    topology: kTopology,
+    ids,
+    modes,
+  })));
+  assert.deepStrictEqual(results, Array(kWorkers).fill({ code: 0, rounds: kRounds }));
+
+  // The main thread's view survived the workers and their teardown
+  assert.deepStrictEqual(monitorres.getAllMonitors().map((monitor) => monitor.id), ids);
+  assert.deepStrictEqual(monitorres.getAvailableResolutions(ids[0]), modes[ids[0]]);
+});
+
+test('a worker exits cleanly with a change listener and a pending async change', async () => {
+  const { code } = await new Promise((resolve, reject) => {
+    const worker = new Worker(`
+      const monitorres = require(${JSON.stringify(path.join(__dirname, '..', '..'))});
+      monitorres.on('change', () => {});
+      monitorres.setModeChangeCoalescing(200);
+      monitorres.setMonitorResolutionAsync('\\\\\\\\.\\\\DISPLAY1', 1280, 720).then(() => process.exit(0));
+    `, { eval: true });
+    worker.on('error', reject);
+    worker.on('exit', (exitCode) => resolve({ code: exitCode }));
+  });
+  monitorres.setModeChangeCoalescing(0);
+  assert.strictEqual(code, 0);
+});
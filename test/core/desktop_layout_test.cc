@@ -0,0 +1,58 @@
+// Desktop layout lookups across topology changes
+
+#include "test.h"
+
+using namespace monitorres;
+using namespace monitorres::test;
+
+MONITORRES_TEST(LayoutFollowsHotplugWithoutWatcher)
+{
+    auto backend = UseSimulatedBackend({MakeMonitor("\\\\.\\DISPLAY1", true, {MakeMode(1920, 1080, 60)})});
+    EXPECT_EQ(DesktopLayouts().Get(*backend)->Monitors().size(), 1u);
+    EXPECT_EQ(DesktopLayouts().Get(*backend)->MonitorFromPoint(2000, 10, MonitorFallback::None), -1);
+
+    SimulatedMonitor second = MakeMonitor("\\\\.\\DISPLAY2", false, {MakeMode(1280, 1024, 60)});
+    second.current.positionX = 1920;
+    backend->Connect(second);
+
+    std::shared_ptr<const DesktopLayout> layout = DesktopLayouts().Get(*backend);
+    EXPECT_EQ(layout->Monitors().size(), 2u);
+    EXPECT_EQ(layout->MonitorFromPoint(2000, 10, MonitorFallback::None), 1);
+
+    ASSERT_TRUE(backend->Disconnect("\\\\.\\DISPLAY2"));
+    EXPECT_EQ(DesktopLayouts().Get(*backend)->MonitorFromPoint(2000, 10, MonitorFallback::None), -1);
+}
+
+MONITORRES_TEST(LayoutFollowsBackendSwap)
+{
+    UseSimulatedBackend({MakeMonitor("\\\\.\\DISPLAY1", true, {MakeMode(1920, 1080, 60)})});
+    EXPECT_EQ(DesktopLayouts().Get(*GetDisplayBackend())->Bounds().width, 1920);
+
+    auto backend = UseSimulatedBackend({MakeMonitor("\\\\.\\DISPLAY1", true, {MakeMode(2560, 1440, 60)})});
+    EXPECT_EQ(DesktopLayouts().Get(*backend)->Bounds().width, 2560);
+}
+
+MONITORRES_TEST(GeometryFollowsHotplugWithoutWatcher)
+{
+    auto backend = UseSimulatedBackend({MakeMonitor("\\\\.\\DISPLAY1", true, {MakeMode(1920, 1080, 60)})});
+    EXPECT_EQ(DisplayGeometries().Get(*backend)->monitors.size(), 1u);
+
+    SimulatedMonitor second = MakeMonitor("\\\\.\\DISPLAY2", false, {MakeMode(1280, 1024, 60)});
+    second.current.positionX = 1920;
+    backend->Connect(second);
+
+    std::shared_ptr<const DisplayGeometry> geometry = DisplayGeometries().Get(*backend);
+    ASSERT_TRUE(geometry->monitors.size() == 2u);
+    EXPECT_EQ(geometry->monitors[1].geometry.bounds.x, 1920);
+}
+
+MONITORRES_TEST(GeometryIsReadAgainAfterSignal)
+{
+    auto backend = UseSimulatedBackend({MakeMonitor("\\\\.\\DISPLAY1", true, {MakeMode(1920, 1080, 60)})});
+    std::shared_ptr<const DisplayGeometry> geometry = DisplayGeometries().Get(*backend);
+    EXPECT_TRUE(DisplayGeometries().Get(*backend) == geometry);
+
+    // A scale change raises a signal without changing the topology
+    backend->RaiseSignals(DisplaySignal::ModeChanged, 1);
+    EXPECT_TRUE(DisplayGeometries().Get(*backend) != geometry);
+}
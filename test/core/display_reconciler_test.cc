@@ -0,0 +1,137 @@
+// Drift correction of DisplayReconciler and its move to a new backend
+
+#include "test.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace monitorres;
+using namespace monitorres::test;
+
+namespace
+{
+    const char *const kDisplay1 = "\\\\.\\DISPLAY1";
+
+    // Collects the events of a reconciler from its thread
+    class EventLog
+    {
+    public:
+        DisplayReconciler::EventCallback Callback()
+        {
+            return [this](const ReconcileEvent &event)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                events_.push_back(event);
+                added_.notify_all();
+            };
+        }
+
+        // Wait until count events arrived; false after two seconds
+        bool WaitFor(size_t count)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return added_.wait_for(lock, std::chrono::seconds(2), [this, count]
+                                   { return events_.size() >= count; });
+        }
+
+        ReconcileEvent At(size_t index)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return events_.at(index);
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable added_;
+        std::vector<ReconcileEvent> events_;
+    };
+
+    std::shared_ptr<SimulatedDisplayBackend> MakeBackend()
+    {
+        SimulatedBackendOptions options;
+        options.monitors = {MakeMonitor(kDisplay1, true, {MakeMode(1920, 1080, 60), MakeMode(1280, 720, 60)})};
+        return std::make_shared<SimulatedDisplayBackend>(std::move(options));
+    }
+
+    DesiredDisplayState Desired(uint32_t width, uint32_t height)
+    {
+        DesiredDisplayState state;
+        state.width = width;
+        state.height = height;
+        return state;
+    }
+
+    ReconcilerOptions FastOptions()
+    {
+        ReconcilerOptions options;
+        options.interval = std::chrono::milliseconds(10);
+        return options;
+    }
+
+    uint32_t CurrentWidth(DisplayBackend &backend)
+    {
+        DisplayMode mode;
+        return backend.GetCurrentMode(kDisplay1, mode) ? mode.width : 0;
+    }
+}
+
+MONITORRES_TEST(ReconcilerRejectsUnsupportedState)
+{
+    auto backend = MakeBackend();
+    SetDisplayBackend(backend);
+    EventLog log;
+    DisplayReconciler reconciler(backend, log.Callback());
+
+    std::string error;
+    EXPECT_TRUE(!reconciler.SetDesired(kDisplay1, Desired(1024, 768), error));
+    EXPECT_EQ(error, std::string("Monitor \\\\.\\DISPLAY1 does not support 1024x768"));
+    EXPECT_EQ(reconciler.Size(), 0u);
+}
+
+MONITORRES_TEST(ReconcilerPutsDriftedDeviceBack)
+{
+    auto backend = MakeBackend();
+    SetDisplayBackend(backend);
+    EventLog log;
+    DisplayReconciler reconciler(backend, log.Callback());
+    reconciler.SetOptions(FastOptions());
+    reconciler.Start(backend->CreateEventSource());
+
+    std::string error;
+    ASSERT_TRUE(reconciler.SetDesired(kDisplay1, Desired(1920, 1080), error));
+    ASSERT_TRUE(backend->ApplyMode(kDisplay1, MakeMode(1280, 720, 60), false) == kDispChangeSuccessful);
+
+    ASSERT_TRUE(log.WaitFor(1));
+    ReconcileEvent event = log.At(0);
+    EXPECT_TRUE(event.kind == ReconcileEvent::Kind::Corrected);
+    EXPECT_EQ(event.from.width, 1280u);
+    EXPECT_EQ(event.to.width, 1920u);
+    EXPECT_EQ(CurrentWidth(*backend), 1920u);
+    reconciler.Stop();
+    EXPECT_EQ(reconciler.Stats().corrected, 1u);
+}
+
+MONITORRES_TEST(ReconcilerMovesToRebindBackend)
+{
+    auto first = MakeBackend();
+    auto second = MakeBackend();
+    SetDisplayBackend(first);
+    EventLog log;
+    DisplayReconciler reconciler(first, log.Callback());
+    reconciler.SetOptions(FastOptions());
+    reconciler.Start(first->CreateEventSource());
+
+    std::string error;
+    ASSERT_TRUE(reconciler.SetDesired(kDisplay1, Desired(1920, 1080), error));
+    SetDisplayBackend(second);
+    reconciler.Rebind(second, second->CreateEventSource());
+
+    ASSERT_TRUE(second->ApplyMode(kDisplay1, MakeMode(1280, 720, 60), false) == kDispChangeSuccessful);
+    ASSERT_TRUE(log.WaitFor(1));
+    EXPECT_EQ(CurrentWidth(*second), 1920u);
+    EXPECT_EQ(first->Stats().commits, 0u);
+    reconciler.Stop();
+}
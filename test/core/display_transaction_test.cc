@@ -0,0 +1,84 @@
+// Staging and committing several mode changes with DisplayTransaction
+
+#include "test.h"
+
+#include <string>
+
+using namespace monitorres;
+using namespace monitorres::test;
+
+namespace
+{
+    const char *const kDisplay1 = "\\\\.\\DISPLAY1";
+    const char *const kDisplay2 = "\\\\.\\DISPLAY2";
+
+    std::shared_ptr<SimulatedDisplayBackend> UseTwoDisplays()
+    {
+        return UseSimulatedBackend({MakeMonitor(kDisplay1, true, {MakeMode(1920, 1080, 60), MakeMode(1280, 720, 60)}),
+                                    MakeMonitor(kDisplay2, false, {MakeMode(1920, 1080, 60), MakeMode(1280, 720, 60)})});
+    }
+
+    ModeChangeRequest Request(const std::string &id, int width, int height)
+    {
+        ModeChangeRequest request;
+        request.id = id;
+        request.width = width;
+        request.height = height;
+        return request;
+    }
+}
+
+MONITORRES_TEST(TransactionCommitsEveryDeviceInOneModeSet)
+{
+    auto backend = UseTwoDisplays();
+    DisplayTransaction transaction;
+    EXPECT_TRUE(transaction.Add(*backend, Request(kDisplay1, 1280, 720)).status == ModeChangeResult::Status::Applied);
+    EXPECT_TRUE(transaction.Add(*backend, Request(kDisplay2, 1280, 720)).status == ModeChangeResult::Status::Applied);
+    EXPECT_EQ(transaction.Size(), 2u);
+
+    TransactionResult result = transaction.Commit(*backend);
+    EXPECT_EQ(result.code, static_cast<long>(kDispChangeSuccessful));
+    EXPECT_EQ(backend->Stats().commits, 1u);
+    EXPECT_EQ(transaction.Size(), 0u);
+
+    DisplayMode mode;
+    ASSERT_TRUE(backend->GetCurrentMode(kDisplay2, mode));
+    EXPECT_EQ(mode.width, 1280u);
+}
+
+MONITORRES_TEST(TransactionReplacesChangeForSameDevice)
+{
+    auto backend = UseTwoDisplays();
+    DisplayTransaction transaction;
+    transaction.Add(*backend, Request(kDisplay2, 1280, 720));
+    transaction.Add(*backend, Request(kDisplay2, 1920, 1080));
+    EXPECT_EQ(transaction.Size(), 1u);
+}
+
+MONITORRES_TEST(TransactionTreatsEmptyIdAsPrimary)
+{
+    auto backend = UseTwoDisplays();
+    DisplayTransaction transaction;
+    transaction.Add(*backend, Request("", 1280, 720));
+    transaction.Add(*backend, Request(kDisplay1, 1920, 1080));
+    EXPECT_EQ(transaction.Size(), 1u);
+
+    transaction.Add(*backend, Request("", 1280, 720));
+    EXPECT_EQ(transaction.Size(), 1u);
+    transaction.Commit(*backend);
+    EXPECT_EQ(backend->Stats().stagedModes, 1u);
+
+    DisplayMode mode;
+    ASSERT_TRUE(backend->GetCurrentMode(kDisplay1, mode));
+    EXPECT_EQ(mode.width, 1280u);
+}
+
+MONITORRES_TEST(TransactionRejectsUnlistedModeWithoutStaging)
+{
+    auto backend = UseTwoDisplays();
+    DisplayTransaction transaction;
+    ModeChangeResult result = transaction.Add(*backend, Request(kDisplay2, 800, 600));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Rejected);
+    EXPECT_EQ(result.code, static_cast<long>(kDispChangeBadMode));
+    EXPECT_EQ(transaction.Size(), 0u);
+}
@@ -0,0 +1,104 @@
+// Coalescing of DisplayChangeWatcher and its move to a new backend
+
+#include "test.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace monitorres;
+using namespace monitorres::test;
+
+namespace
+{
+    // Collects the events of a watcher from its thread
+    class ChangeLog
+    {
+    public:
+        DisplayChangeWatcher::ChangeCallback Callback()
+        {
+            return [this](const DisplayChangeEvent &event)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                events_.push_back(event);
+                added_.notify_all();
+            };
+        }
+
+        // Wait until count events arrived; false after two seconds
+        bool WaitFor(size_t count)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return added_.wait_for(lock, std::chrono::seconds(2), [this, count]
+                                   { return events_.size() >= count; });
+        }
+
+        DisplayChangeEvent At(size_t index)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return events_.at(index);
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable added_;
+        std::vector<DisplayChangeEvent> events_;
+    };
+
+    std::shared_ptr<SimulatedDisplayBackend> MakeBackend(size_t monitors)
+    {
+        SimulatedBackendOptions options;
+        for (size_t i = 0; i < monitors; i++)
+        {
+            options.monitors.push_back(MakeMonitor("\\\\.\\DISPLAY" + std::to_string(i + 1), i == 0, {MakeMode(1920, 1080, 60)}));
+            options.monitors.back().current.positionX = static_cast<int32_t>(i * 1920);
+        }
+        return std::make_shared<SimulatedDisplayBackend>(std::move(options));
+    }
+}
+
+MONITORRES_TEST(WatcherCoalescesBurstIntoOneEvent)
+{
+    auto backend = MakeBackend(1);
+    ChangeLog log;
+    DisplayChangeWatcher watcher(backend, log.Callback());
+    watcher.SetCoalesceWindow(std::chrono::milliseconds(20));
+    ASSERT_TRUE(watcher.Start(backend->CreateEventSource()));
+
+    SimulatedMonitor second = MakeMonitor("\\\\.\\DISPLAY2", false, {MakeMode(1280, 1024, 60)});
+    second.current.positionX = 1920;
+    backend->Connect(second);
+    backend->RaiseSignals(DisplaySignal::ModeChanged, 3);
+
+    ASSERT_TRUE(log.WaitFor(1));
+    DisplayChangeEvent event = log.At(0);
+    EXPECT_EQ(event.signals, 4u);
+    ASSERT_TRUE(event.added.size() == 1u);
+    EXPECT_EQ(event.added[0], std::string("\\\\.\\DISPLAY2"));
+    watcher.Stop();
+}
+
+MONITORRES_TEST(WatcherReportsRebindAsChange)
+{
+    auto first = MakeBackend(1);
+    auto second = MakeBackend(2);
+    ChangeLog log;
+    DisplayChangeWatcher watcher(first, log.Callback());
+    watcher.SetCoalesceWindow(std::chrono::milliseconds(20));
+    ASSERT_TRUE(watcher.Start(first->CreateEventSource()));
+
+    watcher.Rebind(second, second->CreateEventSource());
+    ASSERT_TRUE(log.WaitFor(1));
+    DisplayChangeEvent event = log.At(0);
+    EXPECT_EQ(event.signals, 1u);
+    ASSERT_TRUE(event.added.size() == 1u);
+    EXPECT_EQ(event.added[0], std::string("\\\\.\\DISPLAY2"));
+
+    // Signals now come from the new backend
+    ASSERT_TRUE(second->Disconnect("\\\\.\\DISPLAY2"));
+    ASSERT_TRUE(log.WaitFor(2));
+    EXPECT_EQ(log.At(1).removed.size(), 1u);
+    watcher.Stop();
+}
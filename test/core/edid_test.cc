@@ -0,0 +1,114 @@
+// ParseEdid against the fixtures in test/fixtures/edid, which generate.js
+// there writes
+
+#include "test.h"
+
+#include <string>
+#include <vector>
+
+using namespace monitorres;
+using namespace monitorres::test;
+
+namespace
+{
+    bool ParseFixture(const std::string &name, EdidInfo &info)
+    {
+        std::vector<uint8_t> edid = ReadFixture("edid/" + name);
+        return !edid.empty() && ParseEdid(edid.data(), edid.size(), info);
+    }
+
+    void ExpectTiming(const EdidTiming &timing, uint32_t width, uint32_t height, uint32_t refreshRate, uint32_t pixelClockKHz)
+    {
+        EXPECT_EQ(timing.width, width);
+        EXPECT_EQ(timing.height, height);
+        EXPECT_EQ(timing.refreshRate, refreshRate);
+        EXPECT_EQ(timing.pixelClockKHz, pixelClockKHz);
+        EXPECT_TRUE(!timing.interlaced);
+    }
+
+    // The base block every valid fixture starts with
+    void ExpectBaseBlock(const EdidInfo &info)
+    {
+        EXPECT_EQ(info.manufacturer, std::string("GSM"));
+        EXPECT_EQ(info.productCode, 0x5B08u);
+        EXPECT_EQ(info.serialNumber, 12345678u);
+        EXPECT_EQ(info.serial, std::string("SN0001"));
+        EXPECT_EQ(info.name, std::string("TESTMON"));
+        EXPECT_EQ(info.manufactureWeek, 12u);
+        EXPECT_EQ(info.manufactureYear, 2022u);
+        EXPECT_EQ(info.versionMajor, 1u);
+        EXPECT_EQ(info.versionMinor, 4u);
+        // From the preferred timing rather than the centimeters of the base block
+        EXPECT_EQ(info.widthMm, 598u);
+        EXPECT_EQ(info.heightMm, 336u);
+        EXPECT_TRUE(info.hasPreferredTiming);
+        ASSERT_TRUE(!info.timings.empty());
+        ExpectTiming(info.timings[0], 1920, 1080, 60, 148500);
+    }
+}
+
+MONITORRES_TEST(EdidParsesBaseBlock)
+{
+    EdidInfo info;
+    ASSERT_TRUE(ParseFixture("base.bin", info));
+    ExpectBaseBlock(info);
+    EXPECT_EQ(info.timings.size(), 1u);
+}
+
+MONITORRES_TEST(EdidParsesCeaExtension)
+{
+    EdidInfo info;
+    ASSERT_TRUE(ParseFixture("cea861.bin", info));
+    ExpectBaseBlock(info);
+    ASSERT_TRUE(info.timings.size() == 2);
+    ExpectTiming(info.timings[1], 1280, 720, 60, 74250);
+}
+
+MONITORRES_TEST(EdidParsesDisplayIdExtension)
+{
+    EdidInfo info;
+    ASSERT_TRUE(ParseFixture("displayid.bin", info));
+    ExpectBaseBlock(info);
+    ASSERT_TRUE(info.timings.size() == 3);
+    ExpectTiming(info.timings[1], 1280, 720, 60, 74250);
+    ExpectTiming(info.timings[2], 2560, 1440, 144, 580080);
+}
+
+MONITORRES_TEST(EdidRejectsTruncatedBaseBlock)
+{
+    EdidInfo info;
+    EXPECT_TRUE(!ParseFixture("truncated_base.bin", info));
+}
+
+MONITORRES_TEST(EdidSkipsMissingExtensionBlocks)
+{
+    // Byte 126 announces two extensions but the first is cut off
+    EdidInfo info;
+    ASSERT_TRUE(ParseFixture("truncated_extensions.bin", info));
+    ExpectBaseBlock(info);
+    EXPECT_EQ(info.timings.size(), 1u);
+}
+
+MONITORRES_TEST(EdidRejectsBadBaseChecksum)
+{
+    EdidInfo info;
+    EXPECT_TRUE(!ParseFixture("bad_checksum.bin", info));
+}
+
+MONITORRES_TEST(EdidSkipsExtensionWithBadChecksum)
+{
+    EdidInfo info;
+    ASSERT_TRUE(ParseFixture("bad_extension_checksum.bin", info));
+    ExpectBaseBlock(info);
+    EXPECT_EQ(info.timings.size(), 1u);
+}
+
+MONITORRES_TEST(EdidCacheReturnsSameParseForSameBytes)
+{
+    std::vector<uint8_t> edid = ReadFixture("edid/displayid.bin");
+    EdidCache cache;
+    auto first = cache.Get(edid);
+    ASSERT_TRUE(first != nullptr);
+    EXPECT_TRUE(cache.Get(edid) == first);
+    EXPECT_TRUE(cache.Get(ReadFixture("edid/bad_checksum.bin")) == nullptr);
+}
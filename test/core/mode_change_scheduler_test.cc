@@ -0,0 +1,172 @@
+// Batching, per-request results and per-device concurrency of ModeChangeScheduler
+
+#include "test.h"
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+using namespace monitorres;
+using namespace monitorres::test;
+
+namespace
+{
+    const char *const kDisplay1 = "\\\\.\\DISPLAY1";
+    const char *const kDisplay2 = "\\\\.\\DISPLAY2";
+
+    // Two displays listing 1920x1080 and 1280x720 at 60 Hz
+    std::shared_ptr<SimulatedDisplayBackend> UseTwoDisplays(uint32_t applyLatencyMs)
+    {
+        SimulatedBackendOptions options;
+        options.monitors = {MakeMonitor(kDisplay1, true, {MakeMode(1920, 1080, 60), MakeMode(1280, 720, 60)}),
+                            MakeMonitor(kDisplay2, false, {MakeMode(1920, 1080, 60), MakeMode(1280, 720, 60)})};
+        options.monitors[1].current.positionX = 1920;
+        options.applyLatencyMs = applyLatencyMs;
+        return UseSimulatedBackend(std::move(options));
+    }
+
+    ModeChangeRequest Request(const std::string &id, int width, int height)
+    {
+        ModeChangeRequest request;
+        request.id = id;
+        request.width = width;
+        request.height = height;
+        return request;
+    }
+
+    bool Never()
+    {
+        return false;
+    }
+
+    // A shouldStop that gives up after milliseconds
+    std::function<bool()> After(int milliseconds)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+        return [deadline]
+        { return std::chrono::steady_clock::now() >= deadline; };
+    }
+}
+
+MONITORRES_TEST(BatchRejectsUnsupportedRequestOnItsOwn)
+{
+    auto backend = UseTwoDisplays(0);
+    ModeChangeScheduler scheduler;
+    scheduler.SetCoalesceWindow(std::chrono::milliseconds(1000));
+
+    ModeChangeTicket valid = scheduler.Submit(backend, Request(kDisplay1, 1280, 720), false);
+    ModeChangeTicket invalid = scheduler.Submit(backend, Request(kDisplay1, 1000, 700), true);
+
+    ModeChangeResult result;
+    ASSERT_TRUE(scheduler.Wait(valid, Never, result));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Applied);
+    ASSERT_TRUE(scheduler.Wait(invalid, Never, result));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Rejected);
+    EXPECT_EQ(result.code, static_cast<long>(kDispChangeBadMode));
+
+    DisplayMode current;
+    ASSERT_TRUE(backend->GetCurrentMode(kDisplay1, current));
+    EXPECT_EQ(current.width, 1280u);
+    EXPECT_EQ(scheduler.Stats().coalesced, 0u);
+}
+
+MONITORRES_TEST(BatchAppliesLastSupportedRequestOnce)
+{
+    auto backend = UseTwoDisplays(0);
+    ModeChangeScheduler scheduler;
+    scheduler.SetCoalesceWindow(std::chrono::milliseconds(1000));
+
+    ModeChangeTicket first = scheduler.Submit(backend, Request(kDisplay1, 1280, 720), false);
+    ModeChangeTicket last = scheduler.Submit(backend, Request(kDisplay1, 1920, 1080), true);
+
+    ModeChangeResult result;
+    ASSERT_TRUE(scheduler.Wait(first, Never, result));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Applied);
+    EXPECT_TRUE(result.unchanged);
+    ASSERT_TRUE(scheduler.Wait(last, Never, result));
+    EXPECT_TRUE(result.unchanged);
+
+    ModeChangeStats stats = scheduler.Stats();
+    EXPECT_EQ(stats.requests, 2u);
+    EXPECT_EQ(stats.coalesced, 1u);
+    EXPECT_EQ(stats.unchanged, 1u);
+    EXPECT_EQ(backend->Stats().modeSets, 0u);
+}
+
+MONITORRES_TEST(SlowChangeDoesNotHoldUpOtherDevice)
+{
+    auto backend = UseTwoDisplays(200);
+    ModeChangeScheduler scheduler;
+
+    ModeChangeTicket slow = scheduler.Submit(backend, Request(kDisplay1, 1280, 720), true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ModeChangeTicket other = scheduler.Submit(backend, Request(kDisplay2, 1280, 720), false);
+
+    ModeChangeResult result;
+    EXPECT_TRUE(scheduler.Wait(other, After(50), result));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Applied);
+    ASSERT_TRUE(scheduler.Wait(slow, Never, result));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Applied);
+    EXPECT_EQ(scheduler.Stats().withdrawn, 0u);
+}
+
+MONITORRES_TEST(QueuedChangeToBusyDeviceCanBeWithdrawn)
+{
+    auto backend = UseTwoDisplays(200);
+    ModeChangeScheduler scheduler;
+
+    ModeChangeTicket slow = scheduler.Submit(backend, Request(kDisplay1, 1280, 720), true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ModeChangeTicket queued = scheduler.Submit(backend, Request(kDisplay1, 1920, 1080), false);
+
+    ModeChangeResult result;
+    EXPECT_TRUE(!scheduler.Wait(queued, After(50), result));
+    ASSERT_TRUE(scheduler.Wait(slow, Never, result));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Applied);
+
+    EXPECT_EQ(scheduler.Stats().withdrawn, 1u);
+    EXPECT_EQ(backend->Stats().modeSets, 1u);
+}
+
+MONITORRES_TEST(EmptyIdJoinsPrimaryBatchAndKeepsRegistryUpdate)
+{
+    auto backend = UseTwoDisplays(0);
+    ModeChangeScheduler scheduler;
+    scheduler.SetCoalesceWindow(std::chrono::milliseconds(1000));
+
+    // setMonitorResolution stores the mode, setAllScreenResolutions does not
+    ModeChangeRequest stored = Request(kDisplay1, 1280, 720);
+    stored.updateRegistry = true;
+    ModeChangeTicket first = scheduler.Submit(backend, stored, false);
+    ModeChangeTicket primary = scheduler.Submit(backend, Request("", 1280, 720), true);
+
+    ModeChangeResult result;
+    ASSERT_TRUE(scheduler.Wait(first, Never, result));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Applied);
+    ASSERT_TRUE(scheduler.Wait(primary, Never, result));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Applied);
+
+    EXPECT_EQ(scheduler.Stats().coalesced, 1u);
+    EXPECT_EQ(backend->Stats().modeSets, 1u);
+    DisplayMode registry;
+    ASSERT_TRUE(backend->GetRegistryMode(kDisplay1, registry));
+    EXPECT_EQ(registry.width, 1280u);
+}
+
+MONITORRES_TEST(EmptyIdWaitsForRunningChangeToPrimary)
+{
+    auto backend = UseTwoDisplays(200);
+    ModeChangeScheduler scheduler;
+
+    ModeChangeTicket slow = scheduler.Submit(backend, Request(kDisplay1, 1280, 720), true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ModeChangeTicket queued = scheduler.Submit(backend, Request("", 1920, 1080), false);
+
+    // Queued behind the running change like a request with the primary's id
+    ModeChangeResult result;
+    EXPECT_TRUE(!scheduler.Wait(queued, After(50), result));
+    ASSERT_TRUE(scheduler.Wait(slow, Never, result));
+    EXPECT_EQ(scheduler.Stats().withdrawn, 1u);
+    EXPECT_EQ(backend->Stats().modeSets, 1u);
+}
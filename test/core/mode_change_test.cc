@@ -0,0 +1,140 @@
+// Mode validation, closest refresh rate selection and error mapping of
+// PlanModeChange and ChangeDisplayMode
+
+#include "test.h"
+
+#include <string>
+
+using namespace monitorres;
+using namespace monitorres::test;
+
+namespace
+{
+    // A primary display listing 1920x1080 at 60 and 144 Hz and 1280x720 at 60 Hz
+    std::shared_ptr<SimulatedDisplayBackend> UseSingleDisplay()
+    {
+        return UseSimulatedBackend({MakeMonitor("\\\\.\\DISPLAY1", true,
+                                                {MakeMode(1920, 1080, 60), MakeMode(1920, 1080, 144), MakeMode(1280, 720, 60)})});
+    }
+
+    ModeChangeRequest Request(int width, int height)
+    {
+        ModeChangeRequest request;
+        request.width = width;
+        request.height = height;
+        return request;
+    }
+
+    ModeChangeRequest Request(int width, int height, int refreshRate)
+    {
+        ModeChangeRequest request = Request(width, height);
+        request.refreshRate = refreshRate;
+        request.hasRefreshRate = true;
+        return request;
+    }
+}
+
+MONITORRES_TEST(PlanAcceptsListedModeKeepingCurrentRate)
+{
+    auto backend = UseSingleDisplay();
+    ModeChangePlan plan = PlanModeChange(*backend, Request(1280, 720));
+    EXPECT_TRUE(!plan.resolved);
+    EXPECT_TRUE(!plan.usesClosestRefreshRate);
+    EXPECT_TRUE(!plan.unchanged);
+    EXPECT_EQ(plan.target.width, 1280u);
+    EXPECT_EQ(plan.target.height, 720u);
+    EXPECT_EQ(plan.target.refreshRate, 60u);
+}
+
+MONITORRES_TEST(PlanMarksCurrentModeUnchanged)
+{
+    auto backend = UseSingleDisplay();
+    ModeChangePlan plan = PlanModeChange(*backend, Request(1920, 1080, 60));
+    EXPECT_TRUE(!plan.resolved);
+    EXPECT_TRUE(plan.unchanged);
+
+    ModeChangeResult result = ApplyModeChange(*backend, plan);
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Applied);
+    EXPECT_TRUE(result.unchanged);
+    EXPECT_EQ(backend->Stats().modeSets, 0u);
+}
+
+MONITORRES_TEST(RegistryUpdateOfUnstoredModeIsApplied)
+{
+    auto backend = UseSingleDisplay();
+
+    // Applied live only, the way setAllScreenResolutions does
+    ModeChangeResult result = ChangeDisplayMode(*backend, Request(1280, 720));
+    EXPECT_TRUE(!result.unchanged);
+    EXPECT_EQ(backend->Stats().modeSets, 1u);
+    EXPECT_TRUE(ChangeDisplayMode(*backend, Request(1280, 720)).unchanged);
+
+    // The same mode with updateRegistry still has to be stored
+    ModeChangeRequest store = Request(1280, 720);
+    store.updateRegistry = true;
+    result = ChangeDisplayMode(*backend, store);
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Applied);
+    EXPECT_TRUE(!result.unchanged);
+    EXPECT_EQ(backend->Stats().modeSets, 2u);
+
+    DisplayMode stored;
+    ASSERT_TRUE(backend->GetRegistryMode("", stored));
+    EXPECT_EQ(stored.width, 1280u);
+
+    // Once stored, it is a no-op
+    EXPECT_TRUE(ChangeDisplayMode(*backend, store).unchanged);
+    EXPECT_EQ(backend->Stats().modeSets, 2u);
+}
+
+MONITORRES_TEST(PlanRejectsUnlistedResolution)
+{
+    auto backend = UseSingleDisplay();
+    ModeChangePlan plan = PlanModeChange(*backend, Request(1600, 900));
+    EXPECT_TRUE(plan.resolved);
+    EXPECT_TRUE(plan.result.status == ModeChangeResult::Status::Rejected);
+    EXPECT_EQ(plan.result.code, static_cast<long>(kDispChangeBadMode));
+    EXPECT_EQ(plan.result.message, std::string("The requested resolution is not supported. Width: 1600, Height: 900"));
+}
+
+MONITORRES_TEST(ChangeAppliesClosestRefreshRate)
+{
+    auto backend = UseSingleDisplay();
+    ModeChangeResult result = ChangeDisplayMode(*backend, Request(1920, 1080, 120));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::AppliedClosestRefreshRate);
+    EXPECT_EQ(result.code, static_cast<long>(kDispChangeSuccessful));
+    EXPECT_EQ(result.actualRefreshRate, 144);
+    EXPECT_EQ(result.message, std::string("Used closest available refresh rate: 144Hz instead of requested 120Hz. Available rates: 60, 144"));
+
+    DisplayMode current;
+    ASSERT_TRUE(backend->GetCurrentMode("", current));
+    EXPECT_EQ(current.refreshRate, 144u);
+}
+
+MONITORRES_TEST(ClosestRefreshRatePrefersLowerOnTies)
+{
+    ModeTable table({MakeMode(1920, 1080, 60), MakeMode(1920, 1080, 120), MakeMode(1280, 720, 60)});
+    EXPECT_EQ(table.ClosestRefreshRate(1920, 1080, 90), 60u);
+    EXPECT_EQ(table.ClosestRefreshRate(1920, 1080, 91), 120u);
+    EXPECT_EQ(table.ClosestRefreshRate(1920, 1080, 240), 120u);
+    EXPECT_EQ(table.ClosestRefreshRate(1600, 900, 60), 0u);
+}
+
+MONITORRES_TEST(ChangeReportsUnreadableDeviceAsFailed)
+{
+    auto backend = UseSingleDisplay();
+    ModeChangeRequest request = Request(1920, 1080);
+    request.id = "\\\\.\\DISPLAY9";
+    ModeChangeResult result = ChangeDisplayMode(*backend, request);
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Failed);
+    EXPECT_EQ(result.code, static_cast<long>(kDispChangeFailed));
+    EXPECT_EQ(result.message, std::string("Failed to get current display settings"));
+}
+
+MONITORRES_TEST(DisplayChangeCodesMapToMessages)
+{
+    EXPECT_EQ(std::string(DescribeDisplayChangeCode(kDispChangeSuccessful)), std::string("The display settings change was successful"));
+    EXPECT_EQ(std::string(DescribeDisplayChangeCode(kDispChangeBadMode)), std::string("The graphics mode is not supported"));
+    EXPECT_EQ(std::string(DescribeDisplayChangeCode(kDispChangeFailed)), std::string("The display driver failed the specified graphics mode"));
+    EXPECT_EQ(std::string(DescribeDisplayChangeCode(kDispChangeRestart)), std::string("The computer must be restarted for the graphics mode to work"));
+    EXPECT_EQ(std::string(DescribeDisplayChangeCode(-42)), std::string("Unknown error"));
+}
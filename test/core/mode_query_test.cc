@@ -0,0 +1,305 @@
+// findBestMode's query: range filters, aspect ratios, every ranking key and
+// the pruning of whole resolutions, checked against a brute-force scan
+
+#include "test.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace monitorres;
+using namespace monitorres::test;
+
+namespace
+{
+    DisplayMode MakeDeepMode(uint32_t width, uint32_t height, uint32_t refreshRate, uint32_t bitsPerPixel)
+    {
+        DisplayMode mode = MakeMode(width, height, refreshRate);
+        mode.bitsPerPixel = bitsPerPixel;
+        return mode;
+    }
+
+    // "WxH@R/B" for each mode, so mismatches print readably
+    std::string Describe(const std::vector<DisplayMode> &modes)
+    {
+        std::string text;
+        for (const auto &mode : modes)
+        {
+            text += (text.empty() ? "" : " ") + std::to_string(mode.width) + "x" + std::to_string(mode.height) + "@" +
+                    std::to_string(mode.refreshRate) + "/" + std::to_string(mode.bitsPerPixel);
+        }
+        return text;
+    }
+
+    std::vector<DisplayMode> Find(const ModeTable &table, const ModeQuery &query, size_t count, const DisplayMode *current = nullptr)
+    {
+        return FindBestModes(table, query, current, count);
+    }
+
+    ModeQuery Ranked(ModeRankField field, bool ascending)
+    {
+        ModeQuery query;
+        query.ranking.push_back({field, ascending});
+        return query;
+    }
+
+    // Modes of every width, height, refresh rate and depth mix, at 2K to 10K
+    // modes much like the benchmark's tables
+    std::vector<DisplayMode> GeneratedModes(uint32_t seed, size_t count)
+    {
+        const uint32_t kWidths[] = {640, 800, 1024, 1152, 1280, 1360, 1366, 1440, 1600, 1680, 1920, 2048, 2560, 3440, 3840, 5120};
+        const uint32_t kHeights[] = {480, 600, 720, 768, 864, 900, 1024, 1050, 1080, 1200, 1440, 1600, 2160, 2880};
+        const uint32_t kDepths[] = {8, 16, 24, 32};
+
+        std::vector<DisplayMode> modes;
+        uint32_t state = seed;
+        auto next = [&state](uint32_t bound)
+        {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) % bound;
+        };
+        for (size_t i = 0; i < count; i++)
+        {
+            modes.push_back(MakeDeepMode(kWidths[next(16)], kHeights[next(14)], 24 + next(217), kDepths[next(4)]));
+        }
+        return modes;
+    }
+
+    // Every key of the table that passes the constraints, fully sorted by
+    // the ranking, then cut to count
+    std::vector<DisplayMode> BruteForce(const ModeTable &table, const ModeQuery &query, const DisplayMode *current, size_t count)
+    {
+        std::vector<ModeRankKey> ranking = query.ranking;
+        if (ranking.empty())
+        {
+            ranking = {{ModeRankField::Area, false}, {ModeRankField::RefreshRate, false}, {ModeRankField::BitsPerPixel, false}};
+        }
+
+        auto score = [&](const ModeRankKey &key, const DisplayMode &mode) -> int64_t
+        {
+            int64_t value = 0;
+            switch (key.field)
+            {
+            case ModeRankField::Native:
+                return mode.width == table.NativeWidth() && mode.height == table.NativeHeight();
+            case ModeRankField::Current:
+                return current != nullptr && mode.width == current->width && mode.height == current->height && mode.refreshRate == current->refreshRate;
+            case ModeRankField::Width:
+                value = mode.width;
+                break;
+            case ModeRankField::Height:
+                value = mode.height;
+                break;
+            case ModeRankField::Area:
+                value = static_cast<int64_t>(mode.width) * mode.height;
+                break;
+            case ModeRankField::RefreshRate:
+                value = mode.refreshRate;
+                break;
+            case ModeRankField::BitsPerPixel:
+                value = mode.bitsPerPixel;
+                break;
+            }
+            return key.ascending ? -value : value;
+        };
+
+        const ModeConstraints &constraints = query.constraints;
+        std::vector<DisplayMode> matches;
+        for (uint64_t key : table.Keys())
+        {
+            DisplayMode mode = MakeDeepMode(ModeKeyWidth(key), ModeKeyHeight(key), ModeKeyRefreshRate(key), ModeKeyBitsPerPixel(key));
+            if (constraints.width.Contains(mode.width) &&
+                constraints.height.Contains(mode.height) &&
+                constraints.refreshRate.Contains(mode.refreshRate) &&
+                constraints.bitsPerPixel.Contains(mode.bitsPerPixel) &&
+                (constraints.minAspectRatio <= 0 || mode.width >= constraints.minAspectRatio * mode.height) &&
+                (constraints.maxAspectRatio <= 0 || mode.width <= constraints.maxAspectRatio * mode.height))
+            {
+                matches.push_back(mode);
+            }
+        }
+
+        std::sort(matches.begin(), matches.end(), [&](const DisplayMode &a, const DisplayMode &b)
+                  {
+            for (const auto &key : ranking)
+            {
+                int64_t scoreA = score(key, a);
+                int64_t scoreB = score(key, b);
+                if (scoreA != scoreB)
+                {
+                    return scoreA > scoreB;
+                }
+            }
+            return PackModeKey(a.width, a.height, a.refreshRate, a.bitsPerPixel) > PackModeKey(b.width, b.height, b.refreshRate, b.bitsPerPixel); });
+
+        matches.resize(std::min(matches.size(), count));
+        return matches;
+    }
+}
+
+MONITORRES_TEST(RangeFiltersBoundEveryField)
+{
+    ModeTable table({MakeDeepMode(1280, 720, 60, 32),
+                     MakeDeepMode(1280, 1024, 75, 16),
+                     MakeDeepMode(1920, 1080, 60, 32),
+                     MakeDeepMode(1920, 1080, 144, 32),
+                     MakeDeepMode(2560, 1440, 60, 24),
+                     MakeDeepMode(3840, 2160, 30, 32)});
+
+    ModeQuery query;
+    query.constraints.width = {1280, 2560};
+    EXPECT_EQ(Describe(Find(table, query, 10)), std::string("2560x1440@60/24 1920x1080@144/32 1920x1080@60/32 1280x1024@75/16 1280x720@60/32"));
+
+    query = ModeQuery();
+    query.constraints.height = {1024, 1080};
+    EXPECT_EQ(Describe(Find(table, query, 10)), std::string("1920x1080@144/32 1920x1080@60/32 1280x1024@75/16"));
+
+    query = ModeQuery();
+    query.constraints.refreshRate = {60, 75};
+    query.constraints.bitsPerPixel = {24, 32};
+    EXPECT_EQ(Describe(Find(table, query, 10)), std::string("2560x1440@60/24 1920x1080@60/32 1280x720@60/32"));
+
+    // Exact values are ranges of one
+    query = ModeQuery();
+    query.constraints.width = {1920, 1920};
+    query.constraints.refreshRate = {144, 144};
+    EXPECT_EQ(Describe(Find(table, query, 10)), std::string("1920x1080@144/32"));
+
+    query = ModeQuery();
+    query.constraints.width = {1921, 2559};
+    EXPECT_TRUE(Find(table, query, 10).empty());
+}
+
+MONITORRES_TEST(AspectRatioToleranceKeepsNearMatches)
+{
+    ModeTable table({MakeMode(1366, 768, 60),
+                     MakeMode(1920, 1080, 60),
+                     MakeMode(1920, 1200, 60),
+                     MakeMode(1280, 1024, 60),
+                     MakeMode(2560, 1080, 60)});
+
+    // 1366x768 is 1.7786, within 1% of 16:9
+    ModeQuery query;
+    query.constraints.minAspectRatio = 16.0 / 9 * (1 - kAspectRatioTolerance);
+    query.constraints.maxAspectRatio = 16.0 / 9 * (1 + kAspectRatioTolerance);
+    EXPECT_EQ(Describe(Find(table, query, 10)), std::string("1920x1080@60/32 1366x768@60/32"));
+
+    // Open on one side
+    query = ModeQuery();
+    query.constraints.minAspectRatio = 2;
+    EXPECT_EQ(Describe(Find(table, query, 10)), std::string("2560x1080@60/32"));
+
+    query = ModeQuery();
+    query.constraints.maxAspectRatio = 1.6;
+    EXPECT_EQ(Describe(Find(table, query, 10)), std::string("1920x1200@60/32 1280x1024@60/32"));
+}
+
+MONITORRES_TEST(EachRankingKeyInBothOrders)
+{
+    ModeTable table({MakeDeepMode(1280, 1024, 60, 32),
+                     MakeDeepMode(1600, 900, 120, 16),
+                     MakeDeepMode(1920, 1080, 60, 24),
+                     MakeDeepMode(1024, 1280, 75, 8)},
+                    1600, 900);
+
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::Width, false), 1)), std::string("1920x1080@60/24"));
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::Width, true), 1)), std::string("1024x1280@75/8"));
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::Height, false), 1)), std::string("1024x1280@75/8"));
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::Height, true), 1)), std::string("1600x900@120/16"));
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::Area, false), 1)), std::string("1920x1080@60/24"));
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::Area, true), 2)), std::string("1280x1024@60/32 1024x1280@75/8"));
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::RefreshRate, false), 1)), std::string("1600x900@120/16"));
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::RefreshRate, true), 1)), std::string("1920x1080@60/24"));
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::BitsPerPixel, false), 1)), std::string("1280x1024@60/32"));
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::BitsPerPixel, true), 1)), std::string("1024x1280@75/8"));
+
+    // Native and current ignore the order
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::Native, false), 1)), std::string("1600x900@120/16"));
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::Native, true), 1)), std::string("1600x900@120/16"));
+    DisplayMode current = MakeMode(1280, 1024, 60);
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::Current, false), 1, &current)), std::string("1280x1024@60/32"));
+    EXPECT_EQ(Describe(Find(table, Ranked(ModeRankField::Current, true), 1, &current)), std::string("1280x1024@60/32"));
+
+    // Later keys break ties of earlier ones
+    ModeTable rates({MakeMode(1920, 1080, 60), MakeMode(1920, 1080, 144), MakeMode(2560, 1440, 60)});
+    ModeQuery query = Ranked(ModeRankField::RefreshRate, true);
+    query.ranking.push_back({ModeRankField::Area, true});
+    EXPECT_EQ(Describe(Find(rates, query, 3)), std::string("1920x1080@60/32 2560x1440@60/32 1920x1080@144/32"));
+}
+
+MONITORRES_TEST(AlternativesCountCapsTheResult)
+{
+    ModeTable table(GeneratedModes(7, 500));
+    ModeQuery query;
+
+    EXPECT_TRUE(Find(table, query, 0).empty());
+    EXPECT_EQ(Find(table, query, 1).size(), 1u);
+    EXPECT_EQ(Find(table, query, kDefaultModeAlternatives + 1).size(), static_cast<size_t>(kDefaultModeAlternatives + 1));
+    EXPECT_EQ(Find(table, query, kMaxBestModes).size(), kMaxBestModes);
+    EXPECT_EQ(Find(table, query, kMaxBestModes * 4).size(), kMaxBestModes);
+
+    // Fewer matches than asked for
+    query.constraints.width = {1920, 1920};
+    query.constraints.height = {1080, 1080};
+    query.constraints.refreshRate = {60, 69};
+    EXPECT_EQ(Describe(Find(table, query, kMaxBestModes)), Describe(BruteForce(table, query, nullptr, kMaxBestModes)));
+    EXPECT_TRUE(Find(table, query, kMaxBestModes).size() < kMaxBestModes);
+}
+
+MONITORRES_TEST(PrunedSearchMatchesBruteForce)
+{
+    const ModeRankField kFields[] = {ModeRankField::Native, ModeRankField::Current, ModeRankField::Width, ModeRankField::Height,
+                                     ModeRankField::Area, ModeRankField::RefreshRate, ModeRankField::BitsPerPixel};
+
+    uint32_t state = 12345;
+    auto next = [&state](uint32_t bound)
+    {
+        state = state * 22695477u + 1u;
+        return (state >> 8) % bound;
+    };
+
+    for (size_t size : {2000u, 10000u})
+    {
+        std::vector<DisplayMode> enumerated = GeneratedModes(static_cast<uint32_t>(size), size);
+        ModeTable table(enumerated, 1920, 1080);
+        DisplayMode current = table.Modes()[size / 3 % table.Modes().size()];
+
+        for (int round = 0; round < 500; round++)
+        {
+            ModeQuery query;
+            ModeConstraints &constraints = query.constraints;
+            if (next(2))
+            {
+                constraints.width.min = 640 + next(2000);
+                constraints.width.max = constraints.width.min + next(3000);
+            }
+            if (next(2))
+            {
+                constraints.height = {480 + next(1000), UINT32_MAX};
+            }
+            if (next(2))
+            {
+                constraints.refreshRate.min = 24 + next(120);
+                constraints.refreshRate.max = next(2) ? UINT32_MAX : constraints.refreshRate.min + next(100);
+            }
+            if (next(3) == 0)
+            {
+                constraints.bitsPerPixel = {16, 24};
+            }
+            if (next(3) == 0)
+            {
+                double ratio = next(2) ? 16.0 / 9 : 4.0 / 3;
+                constraints.minAspectRatio = ratio * (1 - kAspectRatioTolerance);
+                constraints.maxAspectRatio = next(2) ? ratio * (1 + kAspectRatioTolerance) : 0;
+            }
+
+            for (uint32_t keys = next(4); keys > 0; keys--)
+            {
+                query.ranking.push_back({kFields[next(7)], next(2) == 1});
+            }
+
+            size_t count = 1 + next(kMaxModeAlternatives + 1);
+            EXPECT_EQ(Describe(FindBestModes(table, query, &current, count)), Describe(BruteForce(table, query, &current, count)));
+        }
+    }
+}
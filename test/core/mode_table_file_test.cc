@@ -0,0 +1,135 @@
+// The persistent mode table file against concurrent opens and saves
+
+#include "test.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace monitorres;
+using namespace monitorres::test;
+
+namespace
+{
+    const int kDevices = 8;
+
+    std::string TemporaryPath(const std::string &name)
+    {
+        const char *directory = std::getenv("TMPDIR");
+        if (directory == nullptr)
+        {
+            directory = std::getenv("TEMP");
+        }
+        return std::string(directory != nullptr ? directory : ".") + "/" + name;
+    }
+
+    ModeTableKey Key(int device)
+    {
+        ModeTableKey key;
+        key.id = "\\\\.\\DISPLAY" + std::to_string(device + 1);
+        key.edidHash = 0x1234 + device;
+        key.driverVersion = "1.0";
+        return key;
+    }
+
+    // A table of device + 2 modes, so each device's table can be told apart
+    std::shared_ptr<const ModeTable> Table(int device)
+    {
+        std::vector<DisplayMode> modes;
+        for (int i = 0; i < device + 2; i++)
+        {
+            modes.push_back(MakeMode(640 + 64 * i, 480, 60));
+        }
+        return std::make_shared<const ModeTable>(modes);
+    }
+}
+
+MONITORRES_TEST(ModeTableFileRoundTrip)
+{
+    std::string path = TemporaryPath("monitorres_mode_table_file_round_trip.bin");
+    remove(path.c_str());
+    {
+        ModeTableFile file;
+        EXPECT_TRUE(!file.Open(path));
+        for (int device = 0; device < kDevices; device++)
+        {
+            file.Save(Key(device), Table(device));
+        }
+        file.Flush();
+        EXPECT_EQ(file.Stats().writes, 1u);
+    }
+
+    ModeTableFile file;
+    ASSERT_TRUE(file.Open(path));
+    for (int device = 0; device < kDevices; device++)
+    {
+        std::shared_ptr<const ModeTable> table = file.Find(Key(device));
+        ASSERT_TRUE(table != nullptr);
+        EXPECT_EQ(table->Modes().size(), static_cast<size_t>(device + 2));
+    }
+
+    ModeTableKey changed = Key(0);
+    changed.driverVersion = "2.0";
+    EXPECT_TRUE(file.Find(changed) == nullptr);
+    remove(path.c_str());
+}
+
+// Open reads a mapping while a writer started by Save replaces the file;
+// the writer must not unmap the mapping Open just indexed
+MONITORRES_TEST(ModeTableFileOpenDuringSave)
+{
+    std::string path = TemporaryPath("monitorres_mode_table_file_concurrent.bin");
+    remove(path.c_str());
+
+    ModeTableFile file;
+    file.Open(path);
+    for (int device = 0; device < kDevices; device++)
+    {
+        file.Save(Key(device), Table(device));
+    }
+    file.Flush();
+
+    std::atomic<bool> stop{false};
+    std::thread saver([&]()
+    {
+        for (int i = 0; !stop; i++)
+        {
+            file.Save(Key(i % kDevices), Table(i % kDevices));
+        }
+    });
+
+    int wrongTables = 0;
+    for (int i = 0; i < 500; i++)
+    {
+        file.Open(path);
+        // Long enough for a writer started meanwhile to replace the file
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        for (int device = 0; device < kDevices; device++)
+        {
+            // Copied out of the mapping Open read, unless a save replaced it
+            std::shared_ptr<const ModeTable> table = file.Find(Key(device));
+            if (table != nullptr && table->Modes().size() != static_cast<size_t>(device + 2))
+            {
+                wrongTables++;
+            }
+        }
+    }
+    stop = true;
+    saver.join();
+    file.Flush();
+    EXPECT_EQ(wrongTables, 0);
+
+    ASSERT_TRUE(file.Open(path));
+    for (int device = 0; device < kDevices; device++)
+    {
+        std::shared_ptr<const ModeTable> table = file.Find(Key(device));
+        ASSERT_TRUE(table != nullptr);
+        EXPECT_EQ(table->Modes().size(), static_cast<size_t>(device + 2));
+    }
+    file.Open("");
+    remove(path.c_str());
+}
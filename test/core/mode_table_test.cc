@@ -0,0 +1,125 @@
+// Cached mode tables against hotplug, with and without display signals
+
+#include "test.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace monitorres;
+using namespace monitorres::test;
+
+namespace
+{
+    const char *const kDisplay1 = "\\\\.\\DISPLAY1";
+
+    // A simulated backend that raises no signals, like the DRM backend
+    class SilentBackend : public SimulatedDisplayBackend
+    {
+    public:
+        explicit SilentBackend(SimulatedBackendOptions options) : SimulatedDisplayBackend(std::move(options)) {}
+
+        std::shared_ptr<DisplayEventSource> CreateEventSource() override { return nullptr; }
+    };
+
+    SimulatedMonitor SmallMonitor()
+    {
+        return MakeMonitor(kDisplay1, true, {MakeMode(1920, 1080, 60), MakeMode(1280, 720, 60)});
+    }
+
+    SimulatedMonitor LargeMonitor()
+    {
+        return MakeMonitor(kDisplay1, true, {MakeMode(2560, 1440, 60), MakeMode(1920, 1080, 60), MakeMode(3840, 2160, 60)});
+    }
+
+    ModeChangeRequest Request(int width, int height)
+    {
+        ModeChangeRequest request;
+        request.id = kDisplay1;
+        request.width = width;
+        request.height = height;
+        return request;
+    }
+}
+
+MONITORRES_TEST(HotplugDropsCachedTableWithoutWatcher)
+{
+    auto backend = UseSimulatedBackend({SmallMonitor()});
+    EXPECT_EQ(ModeTables().Get(*backend, kDisplay1)->Modes().size(), 2u);
+
+    backend->Connect(LargeMonitor());
+    EXPECT_TRUE(ModeTables().Peek(kDisplay1) == nullptr);
+    std::shared_ptr<const ModeTable> table = ModeTables().Get(*backend, kDisplay1);
+    EXPECT_EQ(table->Modes().size(), 3u);
+    EXPECT_TRUE(table->HasResolution(3840, 2160));
+}
+
+MONITORRES_TEST(ModeSetKeepsCachedTable)
+{
+    auto backend = UseSimulatedBackend({SmallMonitor()});
+    std::shared_ptr<const ModeTable> table = ModeTables().Get(*backend, kDisplay1);
+
+    ModeChangeResult result = ChangeDisplayMode(*backend, Request(1280, 720));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Applied);
+    EXPECT_TRUE(ModeTables().Peek(kDisplay1) == table);
+}
+
+MONITORRES_TEST(RotationDropsOnlyThatTable)
+{
+    SimulatedMonitor second = MakeMonitor("\\\\.\\DISPLAY2", false, {MakeMode(1280, 1024, 60)});
+    auto backend = UseSimulatedBackend({SmallMonitor(), second});
+    ModeTables().Get(*backend, kDisplay1);
+    std::shared_ptr<const ModeTable> other = ModeTables().Get(*backend, "\\\\.\\DISPLAY2");
+
+    DisplayMode rotated = MakeMode(1080, 1920, 60);
+    rotated.orientation = 1;
+    ASSERT_TRUE(backend->StageDeviceState(kDisplay1, rotated, true) == kDispChangeSuccessful);
+    ASSERT_TRUE(backend->CommitStagedModes() == kDispChangeSuccessful);
+    EXPECT_TRUE(ModeTables().Peek(kDisplay1) == nullptr);
+    EXPECT_TRUE(ModeTables().Peek("\\\\.\\DISPLAY2") == other);
+}
+
+MONITORRES_TEST(RejectionReenumeratesStaleTable)
+{
+    SimulatedBackendOptions options;
+    options.monitors = {SmallMonitor()};
+    auto backend = std::make_shared<SilentBackend>(std::move(options));
+    SetDisplayBackend(backend);
+    ModeTables().Get(*backend, kDisplay1);
+
+    backend->Connect(LargeMonitor());
+    ModeChangeResult result = ChangeDisplayMode(*backend, Request(3840, 2160));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Applied);
+    EXPECT_EQ(ModeTables().Peek(kDisplay1)->Modes().size(), 3u);
+
+    // A mode no fresh enumeration lists is still rejected
+    result = ChangeDisplayMode(*backend, Request(1024, 768));
+    EXPECT_TRUE(result.status == ModeChangeResult::Status::Rejected);
+    EXPECT_EQ(result.code, static_cast<long>(kDispChangeBadMode));
+}
+
+MONITORRES_TEST(EmptyIdInvalidatesPrimaryUnderBothIds)
+{
+    SimulatedMonitor second = MakeMonitor("\\\\.\\DISPLAY2", false, {MakeMode(1280, 1024, 60)});
+    auto backend = UseSimulatedBackend({SmallMonitor(), second});
+
+    const char *directory = std::getenv("TMPDIR");
+    std::string path = std::string(directory != nullptr ? directory : ".") + "/monitorres_mode_table_invalidate.bin";
+    remove(path.c_str());
+    PersistentModeTables().Open(path);
+
+    ModeTables().Get(*backend, kDisplay1);
+    ModeTables().Get(*backend, "");
+    std::shared_ptr<const ModeTable> other = ModeTables().Get(*backend, "\\\\.\\DISPLAY2");
+    EXPECT_EQ(PersistentModeTables().Stats().entries, 2u);
+
+    ModeTables().Invalidate(*backend, "");
+    EXPECT_TRUE(ModeTables().Peek(kDisplay1) == nullptr);
+    EXPECT_TRUE(ModeTables().Peek("") == nullptr);
+    EXPECT_TRUE(ModeTables().Peek("\\\\.\\DISPLAY2") == other);
+    // The file entry of the primary goes too, so it is enumerated again
+    EXPECT_EQ(PersistentModeTables().Stats().entries, 1u);
+
+    PersistentModeTables().Open("");
+    remove(path.c_str());
+}
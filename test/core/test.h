@@ -0,0 +1,92 @@
+#ifndef MONITORRES_TEST_TEST_H_
+#define MONITORRES_TEST_TEST_H_
+
+// A small harness for monitorres_core_tests. Tests register themselves with
+// MONITORRES_TEST and run in registration order; a failed expectation is
+// reported and the test carries on, a failed assertion returns from it.
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "monitorres_core.h"
+
+namespace monitorres
+{
+    namespace test
+    {
+        using TestFunction = void (*)();
+
+        struct TestRegistration
+        {
+            TestRegistration(const char *name, TestFunction function);
+        };
+
+        // Record a failure of the running test
+        void Fail(const char *file, int line, const std::string &message);
+
+        template <typename A, typename B>
+        std::string DescribeMismatch(const char *expression, const A &actual, const B &expected)
+        {
+            std::ostringstream out;
+            out << expression << ": got " << actual << ", expected " << expected;
+            return out.str();
+        }
+
+        // Path of a file under test/fixtures; MONITORRES_TEST_FIXTURES overrides the directory
+        std::string FixturePath(const std::string &relative);
+
+        // Read a fixture, failing the running test if it cannot be read
+        std::vector<uint8_t> ReadFixture(const std::string &relative);
+
+        // Monitor for simulated topologies: a device with the listed modes,
+        // running the first one
+        SimulatedMonitor MakeMonitor(const std::string &id, bool primary, std::vector<DisplayMode> modes);
+
+        DisplayMode MakeMode(uint32_t width, uint32_t height, uint32_t refreshRate);
+
+        // Install a simulated backend as the active one, which also drops the
+        // process-wide caches of the previous test
+        std::shared_ptr<SimulatedDisplayBackend> UseSimulatedBackend(std::vector<SimulatedMonitor> monitors);
+        std::shared_ptr<SimulatedDisplayBackend> UseSimulatedBackend(SimulatedBackendOptions options);
+    }
+}
+
+#define MONITORRES_TEST(name)                                                                   \
+    static void name();                                                                         \
+    static ::monitorres::test::TestRegistration name##Registration(#name, name); \
+    static void name()
+
+#define EXPECT_TRUE(condition)                                                  \
+    do                                                                          \
+    {                                                                           \
+        if (!(condition))                                                       \
+        {                                                                       \
+            ::monitorres::test::Fail(__FILE__, __LINE__, "expected " #condition); \
+        }                                                                       \
+    } while (0)
+
+#define EXPECT_EQ(actual, expected)                                                                                       \
+    do                                                                                                                    \
+    {                                                                                                                     \
+        const auto &monitorresActual = (actual);                                                                          \
+        const auto &monitorresExpected = (expected);                                                                      \
+        if (!(monitorresActual == monitorresExpected))                                                                    \
+        {                                                                                                                 \
+            ::monitorres::test::Fail(__FILE__, __LINE__, ::monitorres::test::DescribeMismatch(#actual, monitorresActual, monitorresExpected)); \
+        }                                                                                                                 \
+    } while (0)
+
+#define ASSERT_TRUE(condition)                                                  \
+    do                                                                          \
+    {                                                                           \
+        if (!(condition))                                                       \
+        {                                                                       \
+            ::monitorres::test::Fail(__FILE__, __LINE__, "expected " #condition); \
+            return;                                                             \
+        }                                                                       \
+    } while (0)
+
+#endif
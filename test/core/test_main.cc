@@ -0,0 +1,137 @@
+// Runner of monitorres_core_tests. Every test runs against its own simulated
+// backend; pass substrings of test names to run only the matching ones.
+//
+//   monitorres_core_tests [filter...]
+
+#include "test.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace monitorres
+{
+    namespace test
+    {
+        namespace
+        {
+            struct RegisteredTest
+            {
+                const char *name;
+                TestFunction function;
+            };
+
+            // Function-local so registrations from any translation unit see it initialized
+            std::vector<RegisteredTest> &Registry()
+            {
+                static std::vector<RegisteredTest> tests;
+                return tests;
+            }
+
+            uint32_t failures = 0;
+        }
+
+        TestRegistration::TestRegistration(const char *name, TestFunction function)
+        {
+            Registry().push_back({name, function});
+        }
+
+        void Fail(const char *file, int line, const std::string &message)
+        {
+            failures++;
+            std::fprintf(stderr, "  %s:%d: %s\n", file, line, message.c_str());
+        }
+
+        std::string FixturePath(const std::string &relative)
+        {
+            const char *root = std::getenv("MONITORRES_TEST_FIXTURES");
+            return std::string(root != nullptr && root[0] != '\0' ? root : "test/fixtures") + "/" + relative;
+        }
+
+        std::vector<uint8_t> ReadFixture(const std::string &relative)
+        {
+            std::ifstream in(FixturePath(relative), std::ios::binary);
+            if (!in)
+            {
+                Fail(__FILE__, __LINE__, "cannot read fixture " + FixturePath(relative));
+                return {};
+            }
+            return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+        DisplayMode MakeMode(uint32_t width, uint32_t height, uint32_t refreshRate)
+        {
+            DisplayMode mode;
+            mode.width = width;
+            mode.height = height;
+            mode.refreshRate = refreshRate;
+            mode.bitsPerPixel = 32;
+            return mode;
+        }
+
+        SimulatedMonitor MakeMonitor(const std::string &id, bool primary, std::vector<DisplayMode> modes)
+        {
+            SimulatedMonitor monitor;
+            monitor.device.id = id;
+            monitor.device.name = "Simulated Display";
+            monitor.device.deviceId = "SIMULATED" + id.substr(id.rfind('\\'));
+            monitor.device.stateFlags = kDeviceAttachedToDesktop | (primary ? kDevicePrimary : 0);
+            monitor.current = modes.empty() ? DisplayMode() : modes.front();
+            monitor.modes = std::move(modes);
+            return monitor;
+        }
+
+        std::shared_ptr<SimulatedDisplayBackend> UseSimulatedBackend(std::vector<SimulatedMonitor> monitors)
+        {
+            SimulatedBackendOptions options;
+            options.monitors = std::move(monitors);
+            return UseSimulatedBackend(std::move(options));
+        }
+
+        std::shared_ptr<SimulatedDisplayBackend> UseSimulatedBackend(SimulatedBackendOptions options)
+        {
+            auto backend = std::make_shared<SimulatedDisplayBackend>(std::move(options));
+            SetDisplayBackend(backend);
+            return backend;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    using namespace monitorres::test;
+
+    uint32_t run = 0;
+    uint32_t failed = 0;
+    for (const RegisteredTest &test : Registry())
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc && !selected; i++)
+        {
+            selected = std::string(test.name).find(argv[i]) != std::string::npos;
+        }
+        if (!selected)
+        {
+            continue;
+        }
+
+        uint32_t failuresBefore = failures;
+        std::printf("%s\n", test.name);
+        std::fflush(stdout);
+        test.function();
+        run++;
+        if (failures != failuresBefore)
+        {
+            failed++;
+            std::printf("  FAILED\n");
+        }
+    }
+    monitorres::SetDisplayBackend(nullptr);
+
+    std::printf("%u of %u tests passed\n", run - failed, run);
+    return failed == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+// Capturing, serializing and restoring topologies: capture, mutate, restore
+// and compare, plus blobs from other versions and damaged blobs
+
+#include "test.h"
+
+#include <string>
+#include <vector>
+
+using namespace monitorres;
+using namespace monitorres::test;
+
+namespace
+{
+    const char *const kDisplay1 = "\\\\.\\DISPLAY1";
+    const char *const kDisplay2 = "\\\\.\\DISPLAY2";
+
+    // A primary 1920x1080 display with a second one to its right
+    std::shared_ptr<SimulatedDisplayBackend> UseTwoDisplays()
+    {
+        SimulatedMonitor second = MakeMonitor(kDisplay2, false, {MakeMode(1920, 1080, 60), MakeMode(1280, 720, 60)});
+        second.current.positionX = 1920;
+        return UseSimulatedBackend({MakeMonitor(kDisplay1, true, {MakeMode(1920, 1080, 60), MakeMode(1280, 720, 60)}), second});
+    }
+
+    bool SameTopology(const Topology &a, const Topology &b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            const DisplayMode &x = a[i].mode;
+            const DisplayMode &y = b[i].mode;
+            if (a[i].id != b[i].id || a[i].primary != b[i].primary ||
+                x.width != y.width || x.height != y.height || x.refreshRate != y.refreshRate ||
+                x.bitsPerPixel != y.bitsPerPixel || x.orientation != y.orientation ||
+                x.positionX != y.positionX || x.positionY != y.positionY)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    TopologyDevice *Find(Topology &topology, const std::string &id)
+    {
+        for (auto &device : topology)
+        {
+            if (device.id == id)
+            {
+                return &device;
+            }
+        }
+        return nullptr;
+    }
+
+    // Rewrite the trailing FNV-1a checksum, so a blob edited on purpose
+    // reaches the checks behind it
+    void Reseal(std::vector<uint8_t> &blob)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i + 4 < blob.size(); i++)
+        {
+            hash = (hash ^ blob[i]) * 16777619u;
+        }
+        for (size_t i = 0; i < 4; i++)
+        {
+            blob[blob.size() - 4 + i] = static_cast<uint8_t>(hash >> (8 * i));
+        }
+    }
+
+    std::string DeserializeError(const std::vector<uint8_t> &blob)
+    {
+        Topology topology;
+        std::string error;
+        return DeserializeTopology(blob.data(), blob.size(), topology, error) ? std::string() : error;
+    }
+}
+
+MONITORRES_TEST(TopologyRoundTripsThroughBlob)
+{
+    auto backend = UseTwoDisplays();
+    Topology captured = CaptureTopology(*backend);
+    ASSERT_TRUE(captured.size() == 2);
+    EXPECT_TRUE(captured[0].primary);
+    EXPECT_EQ(captured[1].mode.positionX, 1920);
+
+    std::vector<uint8_t> blob = SerializeTopology(captured);
+    EXPECT_EQ(blob[4], kTopologyFormatVersion);
+    Topology parsed;
+    std::string error;
+    ASSERT_TRUE(DeserializeTopology(blob.data(), blob.size(), parsed, error));
+    EXPECT_TRUE(SameTopology(parsed, captured));
+}
+
+MONITORRES_TEST(TopologyRestoresMutatedState)
+{
+    auto backend = UseTwoDisplays();
+    Topology original = CaptureTopology(*backend);
+    std::vector<uint8_t> blob = SerializeTopology(original);
+
+    // Rotate and shrink the second display, move it left and make it primary
+    Topology mutated = original;
+    TopologyDevice *second = Find(mutated, kDisplay2);
+    second->mode.width = 720;
+    second->mode.height = 1280;
+    second->mode.orientation = 1;
+    second->mode.positionX = -720;
+    second->primary = true;
+    Find(mutated, kDisplay1)->primary = false;
+    TopologyRestoreResult mutation = RestoreTopology(*backend, mutated);
+    ASSERT_TRUE(mutation.code == kDispChangeSuccessful);
+    EXPECT_TRUE(SameTopology(CaptureTopology(*backend), mutated));
+
+    Topology saved;
+    std::string error;
+    ASSERT_TRUE(DeserializeTopology(blob.data(), blob.size(), saved, error));
+    uint64_t commitsBefore = backend->Stats().commits;
+    TopologyRestoreResult restored = RestoreTopology(*backend, saved);
+    EXPECT_EQ(restored.code, static_cast<long>(kDispChangeSuccessful));
+    EXPECT_EQ(restored.changed.size(), 2u);
+    EXPECT_TRUE(restored.missing.empty());
+    EXPECT_EQ(backend->Stats().commits, commitsBefore + 1);
+    EXPECT_TRUE(SameTopology(CaptureTopology(*backend), original));
+}
+
+MONITORRES_TEST(TopologyRestoreStagesOnlyChangedDevices)
+{
+    auto backend = UseTwoDisplays();
+    Topology original = CaptureTopology(*backend);
+
+    Topology mutated = original;
+    Find(mutated, kDisplay2)->mode.width = 1280;
+    Find(mutated, kDisplay2)->mode.height = 720;
+    RestoreTopology(*backend, mutated);
+
+    uint64_t stagedBefore = backend->Stats().stagedModes;
+    TopologyRestoreResult restored = RestoreTopology(*backend, original);
+    ASSERT_TRUE(restored.changed.size() == 1);
+    EXPECT_EQ(restored.changed[0], std::string(kDisplay2));
+    EXPECT_EQ(backend->Stats().stagedModes, stagedBefore + 1);
+
+    // Nothing differs, so nothing is committed
+    uint64_t commitsBefore = backend->Stats().commits;
+    EXPECT_TRUE(RestoreTopology(*backend, original).changed.empty());
+    EXPECT_EQ(backend->Stats().commits, commitsBefore);
+}
+
+MONITORRES_TEST(TopologyRestoreSkipsMissingDevices)
+{
+    auto backend = UseTwoDisplays();
+    Topology original = CaptureTopology(*backend);
+    Find(original, kDisplay1)->mode.width = 1280;
+    Find(original, kDisplay1)->mode.height = 720;
+    ASSERT_TRUE(backend->Disconnect(kDisplay2));
+
+    TopologyRestoreResult restored = RestoreTopology(*backend, original);
+    EXPECT_EQ(restored.code, static_cast<long>(kDispChangeSuccessful));
+    ASSERT_TRUE(restored.missing.size() == 1);
+    EXPECT_EQ(restored.missing[0], std::string(kDisplay2));
+    ASSERT_TRUE(restored.changed.size() == 1);
+    EXPECT_EQ(restored.changed[0], std::string(kDisplay1));
+}
+
+MONITORRES_TEST(TopologyRestoreAppliesNothingWhenDeviceRejectsState)
+{
+    auto backend = UseTwoDisplays();
+    Topology original = CaptureTopology(*backend);
+
+    // The first device is staged, then the second rejects a mode it does not list
+    Topology wanted = original;
+    Find(wanted, kDisplay1)->mode.width = 1280;
+    Find(wanted, kDisplay1)->mode.height = 720;
+    Find(wanted, kDisplay2)->mode.width = 800;
+    Find(wanted, kDisplay2)->mode.height = 600;
+
+    uint64_t commitsBefore = backend->Stats().commits;
+    TopologyRestoreResult restored = RestoreTopology(*backend, wanted);
+    EXPECT_EQ(restored.code, static_cast<long>(kDispChangeBadMode));
+    EXPECT_EQ(restored.failedId, std::string(kDisplay2));
+    EXPECT_TRUE(restored.changed.empty());
+    EXPECT_EQ(backend->Stats().commits, commitsBefore);
+    EXPECT_TRUE(SameTopology(CaptureTopology(*backend), original));
+
+    // The restaged first device must not leak into the next commit
+    Topology next = original;
+    Find(next, kDisplay2)->mode.width = 1280;
+    Find(next, kDisplay2)->mode.height = 720;
+    ASSERT_TRUE(RestoreTopology(*backend, next).code == kDispChangeSuccessful);
+    EXPECT_TRUE(SameTopology(CaptureTopology(*backend), next));
+}
+
+MONITORRES_TEST(TopologyRejectsOtherVersions)
+{
+    auto backend = UseTwoDisplays();
+    std::vector<uint8_t> blob = SerializeTopology(CaptureTopology(*backend));
+    for (uint8_t version : {static_cast<uint8_t>(0), static_cast<uint8_t>(kTopologyFormatVersion + 1), static_cast<uint8_t>(0xFF)})
+    {
+        std::vector<uint8_t> skewed = blob;
+        skewed[4] = version;
+        Reseal(skewed);
+        EXPECT_EQ(DeserializeError(skewed), "unsupported version " + std::to_string(version));
+    }
+}
+
+MONITORRES_TEST(TopologyRejectsTruncatedBlobs)
+{
+    auto backend = UseTwoDisplays();
+    std::vector<uint8_t> blob = SerializeTopology(CaptureTopology(*backend));
+
+    // Cut anywhere, the checksum no longer matches or the header is gone
+    for (size_t size = 0; size < blob.size(); size++)
+    {
+        std::vector<uint8_t> cut(blob.begin(), blob.begin() + size);
+        EXPECT_TRUE(!DeserializeError(cut).empty());
+    }
+
+    // Cut inside the devices and resealed, the body runs short
+    for (size_t size = 6; size + 4 < blob.size(); size++)
+    {
+        std::vector<uint8_t> cut(blob.begin(), blob.begin() + size);
+        cut.resize(size + 4);
+        Reseal(cut);
+        EXPECT_EQ(DeserializeError(cut), std::string("truncated"));
+    }
+}
+
+MONITORRES_TEST(TopologyRejectsCorruptBlobs)
+{
+    auto backend = UseTwoDisplays();
+    std::vector<uint8_t> blob = SerializeTopology(CaptureTopology(*backend));
+
+    std::vector<uint8_t> flipped = blob;
+    flipped[blob.size() / 2] ^= 0x01;
+    EXPECT_EQ(DeserializeError(flipped), std::string("checksum mismatch"));
+
+    std::vector<uint8_t> trailing = blob;
+    trailing.insert(trailing.end() - 4, 0x00);
+    Reseal(trailing);
+    EXPECT_EQ(DeserializeError(trailing), std::string("trailing bytes"));
+
+    std::vector<uint8_t> foreign = blob;
+    foreign[0] = 'X';
+    EXPECT_EQ(DeserializeError(foreign), std::string("not a topology blob"));
+}
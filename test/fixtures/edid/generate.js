@@ -0,0 +1,104 @@
+// Writes the EDID fixtures in this directory. Run `node generate.js` after
+// changing it; the files are checked in so the tests do not depend on it.
+//
+//   base.bin                    Base block only: GSM, product 0x5B08, serial 12345678,
+//                               week 12 of 2022, EDID 1.4, 598x336 mm, "TESTMON",
+//                               "SN0001", preferred timing 1920x1080@60
+//   cea861.bin                  base.bin plus a CEA-861 extension with a 1280x720@60 timing
+//   displayid.bin               cea861.bin plus a DisplayID extension with a 2560x1440@144 timing
+//   truncated_base.bin          The first 100 bytes of base.bin
+//   truncated_extensions.bin    displayid.bin cut off inside its CEA-861 extension
+//   bad_checksum.bin            base.bin with a wrong base block checksum
+//   bad_extension_checksum.bin  cea861.bin with a wrong extension checksum
+
+const fs = require('fs');
+const path = require('path');
+
+const kBlockSize = 128;
+
+// 1920x1080@60: 148.5 MHz, 2200x1125 total, 598x336 mm
+const kTiming1080p = [0x02, 0x3A, 0x80, 0x18, 0x71, 0x38, 0x2D, 0x40, 0x58, 0x2C, 0x45, 0x00, 0x56, 0x50, 0x21, 0x00, 0x00, 0x1E];
+// 1280x720@60: 74.25 MHz, 1650x750 total, 598x336 mm
+const kTiming720p = [0x01, 0x1D, 0x00, 0x72, 0x51, 0xD0, 0x1E, 0x20, 0x6E, 0x28, 0x55, 0x00, 0x56, 0x50, 0x21, 0x00, 0x00, 0x1E];
+// DisplayID Type I 2560x1440@144: 580.08 MHz, 2720x1481 total
+const kTiming1440p = [0x97, 0xE2, 0x00, 0x00, 0xFF, 0x09, 0x9F, 0x00, 0x30, 0x00, 0x1F, 0x00, 0x9F, 0x05, 0x28, 0x00, 0x02, 0x00, 0x04, 0x00];
+
+function checksum(block) {
+  let sum = 0;
+  for (let i = 0; i < kBlockSize - 1; i++) {
+    sum = (sum + block[i]) & 0xFF;
+  }
+  block[kBlockSize - 1] = (0x100 - sum) & 0xFF;
+  return block;
+}
+
+function textDescriptor(tag, text) {
+  const descriptor = Buffer.alloc(18);
+  descriptor[3] = tag;
+  Buffer.from((text + '\n').padEnd(13, ' ')).copy(descriptor, 5);
+  return descriptor;
+}
+
+function baseBlock(extensions) {
+  const block = Buffer.alloc(kBlockSize);
+  Buffer.from([0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00]).copy(block, 0);
+  block.writeUInt16BE(0x1E6D, 8); // GSM
+  block.writeUInt16LE(0x5B08, 10);
+  block.writeUInt32LE(12345678, 12);
+  block[16] = 12;
+  block[17] = 2022 - 1990;
+  block[18] = 1;
+  block[19] = 4;
+  block[21] = 60;
+  block[22] = 34;
+  Buffer.from(kTiming1080p).copy(block, 54);
+  textDescriptor(0xFC, 'TESTMON').copy(block, 72);
+  textDescriptor(0xFF, 'SN0001').copy(block, 90);
+  textDescriptor(0x10, '').copy(block, 108);
+  block[126] = extensions;
+  return checksum(block);
+}
+
+function ceaBlock() {
+  const block = Buffer.alloc(kBlockSize);
+  block[0] = 0x02;
+  block[1] = 0x03;
+  block[2] = 4;
+  Buffer.from(kTiming720p).copy(block, 4);
+  return checksum(block);
+}
+
+function displayIdBlock() {
+  const block = Buffer.alloc(kBlockSize);
+  block[0] = 0x70;
+  block[1] = 0x13;
+  block[2] = 3 + kTiming1440p.length;
+  block[5] = 0x03;
+  block[7] = kTiming1440p.length;
+  Buffer.from(kTiming1440p).copy(block, 8);
+  return checksum(block);
+}
+
+function corrupt(buffer, offset) {
+  const copy = Buffer.from(buffer);
+  copy[offset] ^= 0x01;
+  return copy;
+}
+
+const base = baseBlock(0);
+const cea861 = Buffer.concat([baseBlock(1), ceaBlock()]);
+const displayId = Buffer.concat([baseBlock(2), ceaBlock(), displayIdBlock()]);
+
+const fixtures = {
+  'base.bin': base,
+  'cea861.bin': cea861,
+  'displayid.bin': displayId,
+  'truncated_base.bin': base.subarray(0, 100),
+  'truncated_extensions.bin': displayId.subarray(0, 200),
+  'bad_checksum.bin': corrupt(base, kBlockSize - 1),
+  'bad_extension_checksum.bin': corrupt(cea861, 2 * kBlockSize - 1),
+};
+
+for (const [name, data] of Object.entries(fixtures)) {
+  fs.writeFileSync(path.join(__dirname, name), data);
+}
@@ -0,0 +1,126 @@
+// Records the backend traces in this directory from the simulated backend,
+// with the results each scenario's exports returned, for replay.test.js.
+// Run `node test/fixtures/traces/record.js` after building the addon and
+// changing a scenario; the traces are checked in so the tests replay the
+// same calls on every platform.
+//
+//   multi_monitor  Three monitors side by side, queried and changed
+//   rotated        Two monitors, the second rotated to portrait by restoreTopology
+//   hotplug        A monitor connected and then disconnected between queries
+
+const fs = require('fs');
+const path = require('path');
+
+const kDisplay1 = '\\\\.\\DISPLAY1';
+const kDisplay2 = '\\\\.\\DISPLAY2';
+const kDisplay3 = '\\\\.\\DISPLAY3';
+
+const kModes = [
+  { width: 2560, height: 1440, refreshRate: 144 },
+  { width: 2560, height: 1440, refreshRate: 60 },
+  { width: 1920, height: 1080, refreshRate: 60 },
+  { width: 1280, height: 720, refreshRate: 60 },
+];
+
+function monitor(id, x, width, height) {
+  return { id, width, height, refreshRate: 60, position: { x, y: 0 }, modes: kModes };
+}
+
+// What the exports report about every monitor
+function query(monitorres) {
+  const monitors = monitorres.getAllMonitors();
+  // The layout generation counts rebuilds over the whole process
+  const { generation, ...layout } = monitorres.getDesktopLayout();
+  return {
+    monitors,
+    modes: monitors.map((m) => monitorres.getAvailableResolutions(m.id)),
+    current: monitors.map((m) => monitorres.getMonitorResolution(m.id)),
+    layout,
+  };
+}
+
+// A topology blob as captureTopology writes it (see src/topology.h)
+function topologyBlob(devices) {
+  const bytes = [...Buffer.from('MRTP'), 1];
+  const varint = (value) => {
+    for (; value >= 0x80; value = Math.floor(value / 0x80)) {
+      bytes.push((value & 0x7F) | 0x80);
+    }
+    bytes.push(value);
+  };
+  varint(devices.length);
+  for (const device of devices) {
+    varint(Buffer.byteLength(device.id));
+    bytes.push(...Buffer.from(device.id));
+    [device.width, device.height, device.refreshRate, 32].forEach(varint);
+    bytes.push(device.orientation | (device.primary ? 0x04 : 0));
+    [device.x, device.y].forEach((v) => varint(v < 0 ? -2 * v - 1 : 2 * v));
+  }
+  let hash = 2166136261;
+  for (const byte of bytes) {
+    hash = Math.imul(hash ^ byte, 16777619) >>> 0;
+  }
+  const checksum = Buffer.alloc(4);
+  checksum.writeUInt32LE(hash);
+  return Buffer.concat([Buffer.from(bytes), checksum]);
+}
+
+const scenarios = {
+  multi_monitor: {
+    backend: { monitors: [monitor(kDisplay1, 0, 2560, 1440), monitor(kDisplay2, 2560, 1920, 1080), monitor(kDisplay3, 4480, 1920, 1080)] },
+    run(monitorres) {
+      const before = query(monitorres);
+      const set = monitorres.setMonitorResolution(kDisplay2, 1280, 720, 60);
+      const closest = monitorres.setMonitorResolution(kDisplay3, 2560, 1440, 75);
+      return { before, set, closest, after: query(monitorres) };
+    },
+  },
+  rotated: {
+    backend: { monitors: [monitor(kDisplay1, 0, 1920, 1080), monitor(kDisplay2, 1920, 1920, 1080)] },
+    run(monitorres) {
+      const restored = monitorres.restoreTopology(topologyBlob([
+        { id: kDisplay1, width: 1920, height: 1080, refreshRate: 60, orientation: 0, primary: true, x: 0, y: 0 },
+        { id: kDisplay2, width: 1080, height: 1920, refreshRate: 60, orientation: 1, primary: false, x: 1920, y: 0 },
+      ]));
+      return { restored, after: query(monitorres) };
+    },
+  },
+  hotplug: {
+    backend: { monitors: [monitor(kDisplay1, 0, 1920, 1080)] },
+    // Connecting and unplugging only happens while recording; the replay
+    // backend answers the queries after it from the trace
+    run(monitorres, recording) {
+      const before = query(monitorres);
+      if (recording) {
+        monitorres.simulateDisplayChange({ connect: monitor(kDisplay2, 1920, 2560, 1440), signals: 0 });
+      }
+      const connected = query(monitorres);
+      if (recording) {
+        monitorres.simulateDisplayChange({ disconnect: kDisplay2, signals: 0 });
+      }
+      return { before, connected, disconnected: query(monitorres) };
+    },
+  },
+};
+
+function record(monitorres, name) {
+  const scenario = scenarios[name];
+  monitorres.useSimulatedBackend(scenario.backend);
+  monitorres.startBackendRecording(path.join(__dirname, `${name}.trace`));
+  let results;
+  try {
+    results = scenario.run(monitorres, true);
+  } finally {
+    monitorres.stopBackendRecording();
+  }
+  fs.writeFileSync(path.join(__dirname, `${name}.json`), JSON.stringify(results, null, 2) + '\n');
+}
+
+if (require.main === module) {
+  const monitorres = require('../../..');
+  for (const name of Object.keys(scenarios)) {
+    record(monitorres, name);
+  }
+}
+
+module.exports = { scenarios, topologyBlob };
@@ -0,0 +1,44 @@
+/**
+ * Minimal test harness for the addon tests in test/addon
+ *
+ * Each file registers its tests with test(name, fn) and they run in order
+ * once the file has loaded; fn may return a promise. The process exits with
+ * 1 if any test failed. Every test starts on the default simulated backend.
+ */
+
+const assert = require('assert');
+const monitorres = require('..');
+
+const tests = [];
+
+function test(name, fn) {
+  tests.push({ name, fn });
+}
+
+async function run() {
+  const filter = process.argv[2];
+  let failed = 0;
+  let ran = 0;
+  for (const { name, fn } of tests) {
+    if (filter && !name.includes(filter)) {
+      continue;
+    }
+    ran++;
+    monitorres.useSimulatedBackend();
+    try {
+      await fn();
+      console.log(`  ok ${name}`);
+    } catch (err) {
+      failed++;
+      console.log(`  FAILED ${name}`);
+      console.log(String(err && err.stack ? err.stack : err).replace(/^/gm, '    '));
+    }
+  }
+  monitorres.clearDesiredState();
+  console.log(`  ${ran - failed} of ${ran} tests passed`);
+  process.exitCode = failed === 0 ? 0 : 1;
+}
+
+setImmediate(run);
+
+module.exports = { test, assert, monitorres };
@@ -0,0 +1,43 @@
+/**
+ * Runs the native core tests, then every test/addon/*.test.js file in its
+ * own process, since the active backend and the caches are process-wide.
+ * Build first with `node-gyp rebuild --monitorres_tests=1`; the native tests
+ * are skipped with a note when that build has not been made.
+ *
+ * Usage: node test/run.js [filter]
+ */
+
+const { spawnSync } = require('child_process');
+const fs = require('fs');
+const path = require('path');
+
+const root = path.join(__dirname, '..');
+const filter = process.argv.slice(2);
+let failed = 0;
+
+function runStep(label, file, args) {
+  console.log(label);
+  const result = spawnSync(file, args, {
+    cwd: root,
+    stdio: 'inherit',
+    env: { ...process.env, MONITORRES_TEST_FIXTURES: path.join(__dirname, 'fixtures') }
+  });
+  if (result.error || result.status !== 0) {
+    failed++;
+    console.log(`${label} failed${result.error ? `: ${result.error.message}` : ''}`);
+  }
+}
+
+const coreTests = path.join(root, 'build', 'Release', process.platform === 'win32' ? 'monitorres_core_tests.exe' : 'monitorres_core_tests');
+if (fs.existsSync(coreTests)) {
+  runStep('monitorres_core_tests', coreTests, filter);
+} else {
+  console.log('monitorres_core_tests not built; run node-gyp rebuild --monitorres_tests=1');
+}
+
+const addonDir = path.join(__dirname, 'addon');
+for (const file of fs.readdirSync(addonDir).filter((name) => name.endsWith('.test.js')).sort()) {
+  runStep(file, process.execPath, [path.join(addonDir, file), ...filter]);
+}
+
+process.exitCode = failed === 0 ? 0 : 1;